@@ -25,6 +25,7 @@
 ****/
 #pragma once
 
+#include <atomic>
 #include <ios>
 #include <memory>
 #include <cstring>
@@ -733,8 +734,10 @@ namespace streams
         }
 
         std::exception_ptr m_currentException;
-        // The in/out mode for the buffer
-        bool m_stream_can_read, m_stream_can_write, m_stream_read_eof, m_alloced;
+        // The in/out mode for the buffer, and whether the read head is at the end. They are atomic since the
+        // reader and the writer of a buffer, and whoever closes it, may be on different threads.
+        std::atomic<bool> m_stream_can_read, m_stream_can_write, m_stream_read_eof;
+        bool m_alloced;
 
 
     private:
@@ -0,0 +1,588 @@
+/***
+* ==++==
+*
+* Copyright (c) Microsoft Corporation. All rights reserved.
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* ==--==
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* This file defines a read-only stream buffer over a chain of memory blocks owned elsewhere, for example
+* serialized headers, an encoded JSON document and a memory-mapped file. The blocks are never copied into
+* the buffer, so a message composed of them can be sent with one gathered write.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+#pragma once
+
+#ifndef _CASA_BUFFER_CHAIN_STREAMS_H
+#define _CASA_BUFFER_CHAIN_STREAMS_H
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+
+#include "pplx/pplxtasks.h"
+#include "cpprest/astreambuf.h"
+#include "cpprest/streams.h"
+
+namespace Concurrency { namespace streams {
+
+    // Forward declarations
+    template <typename _CharType> class buffer_chain;
+
+    namespace details {
+
+    /// <summary>
+    /// The basic_buffer_chain class serves as a stream buffer that supports reading a sequence of characters
+    /// spread over several contiguous blocks, each kept alive by a reference to its owner.
+    /// The class itself should not be used in application code, it is used by the stream definitions farther down in the header file.
+    /// </summary>
+    /// <remarks>Blocks are appended before the buffer is read. <c>acquire</c> hands out the rest of the block
+    /// holding the read position, <see cref="::peek_blocks method"/> all blocks up to a given length.</remarks>
+    template<typename _CharType>
+    class basic_buffer_chain : public streams::details::streambuf_state_manager<_CharType>
+    {
+    public:
+        typedef _CharType char_type;
+
+        typedef typename basic_streambuf<_CharType>::traits traits;
+        typedef typename basic_streambuf<_CharType>::int_type int_type;
+        typedef typename basic_streambuf<_CharType>::pos_type pos_type;
+        typedef typename basic_streambuf<_CharType>::off_type off_type;
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        basic_buffer_chain()
+            : streambuf_state_manager<_CharType>(std::ios_base::in),
+              m_size(0),
+              m_current_position(0),
+              m_current_block(0)
+        {
+        }
+
+        /// <summary>
+        /// Destructor
+        /// </summary>
+        virtual ~basic_buffer_chain()
+        {
+            this->_close_read();
+        }
+
+        /// <summary>
+        /// Adds a block to the end of the chain.
+        /// </summary>
+        /// <param name="data">The address of the block.</param>
+        /// <param name="count">The block size, measured in number of characters.</param>
+        /// <param name="owner">Keeps the block alive for as long as the buffer refers to it.</param>
+        void append(const _CharType *data, size_t count, std::shared_ptr<const void> owner)
+        {
+            if (count == 0) return;
+
+            _block block;
+            block.m_data = data;
+            block.m_count = count;
+            block.m_offset = m_size;
+            block.m_owner = std::move(owner);
+            m_blocks.push_back(std::move(block));
+
+            m_size += count;
+        }
+
+        /// <summary>
+        /// Calls a function with each contiguous block of the characters following the read position,
+        /// without moving it.
+        /// </summary>
+        /// <param name="count">The maximum number of characters to visit.</param>
+        /// <param name="visit">Called with the address and the number of characters of each block, in order.</param>
+        /// <returns>The number of characters visited.</returns>
+        template<typename _Visitor>
+        size_t peek_blocks(size_t count, const _Visitor &visit) const
+        {
+            if (!this->can_read()) return 0;
+
+            size_t visited = 0;
+            size_t position = m_current_position;
+            for (size_t i = m_current_block; i < m_blocks.size() && visited < count; ++i)
+            {
+                const auto &block = m_blocks[i];
+                const size_t skip = position - block.m_offset;
+                const size_t length = (std::min)(block.m_count - skip, count - visited);
+                visit(block.m_data + skip, length);
+                visited += length;
+                position += length;
+            }
+            return visited;
+        }
+
+        /// <summary>
+        /// Gets the number of blocks in the chain.
+        /// </summary>
+        size_t block_count() const
+        {
+            return m_blocks.size();
+        }
+
+    protected:
+
+        /// <summary>
+        /// can_seek is used to determine whether a stream buffer supports seeking.
+        /// </summary>
+        virtual bool can_seek() const { return this->is_open(); }
+
+        /// <summary>
+        /// <c>has_size<c/> is used to determine whether a stream buffer supports size().
+        /// </summary>
+        virtual bool has_size() const { return this->is_open(); }
+
+        /// <summary>
+        /// Gets the size of the stream, if known. Calls to <c>has_size</c> will determine whether
+        /// the result of <c>size</c> can be relied on.
+        /// </summary>
+        virtual utility::size64_t size() const
+        {
+            return utility::size64_t(m_size);
+        }
+
+        /// <summary>
+        /// Get the stream buffer size, if one has been set.
+        /// </summary>
+        /// <param name="direction">The direction of buffering (in or out)</param>
+        /// <remarks>An implementation that does not support buffering will always return '0'.</remarks>
+        virtual size_t buffer_size(std::ios_base::openmode = std::ios_base::in) const
+        {
+            return 0;
+        }
+
+        /// <summary>
+        /// Set the stream buffer implementation to buffer or not buffer.
+        /// </summary>
+        /// <param name="size">The size to use for internal buffering, 0 if no buffering should be done.</param>
+        /// <param name="direction">The direction of buffering (in or out)</param>
+        /// <remarks>An implementation that does not support buffering will silently ignore calls to this function and it will not have
+        ///          any effect on what is returned by subsequent calls to buffer_size().</remarks>
+        virtual void set_buffer_size(size_t , std::ios_base::openmode = std::ios_base::in)
+        {
+            return;
+        }
+
+        /// <summary>
+        /// For any input stream, in_avail returns the number of characters that are immediately available
+        /// to be consumed without blocking. May be used in conjunction with <cref="::sbumpc method"/> and sgetn() to
+        /// read data without incurring the overhead of using tasks.
+        /// </summary>
+        virtual size_t in_avail() const
+        {
+            _ASSERTE(m_current_position <= m_size);
+            return m_size - m_current_position;
+        }
+
+        /// <summary>
+        /// Closes the stream buffer, preventing further read or write operations.
+        /// </summary>
+        /// <param name="mode">The I/O mode (in or out) to close for.</param>
+        virtual pplx::task<void> close(std::ios_base::openmode mode)
+        {
+            if (mode & std::ios_base::in)
+            {
+                this->_close_read().get(); // Safe to call get() here.
+            }
+
+            if (mode & std::ios_base::out)
+            {
+                this->_close_write().get(); // Safe to call get() here.
+            }
+
+            if (!this->can_read() && !this->can_write())
+            {
+                // Let go of the owners of the blocks.
+                m_blocks.clear();
+                m_size = m_current_position = m_current_block = 0;
+            }
+
+            // Exceptions will be propagated out of _close_read or _close_write
+            return pplx::task_from_result();
+        }
+
+        virtual pplx::task<bool> _sync()
+        {
+            return pplx::task_from_result(true);
+        }
+
+        virtual pplx::task<int_type> _putc(_CharType)
+        {
+            return pplx::task_from_result<int_type>(traits::eof());
+        }
+
+        virtual pplx::task<size_t> _putn(const _CharType *, size_t)
+        {
+            return pplx::task_from_result<size_t>(0);
+        }
+
+        _CharType* _alloc(size_t)
+        {
+            return nullptr;
+        }
+
+        void _commit(size_t)
+        {
+        }
+
+        /// <summary>
+        /// Gets a pointer to the next already allocated contiguous block of data.
+        /// </summary>
+        /// <param name="ptr">A reference to a pointer variable that will hold the address of the block on success.</param>
+        /// <param name="count">The number of contiguous characters available at the address in 'ptr.'</param>
+        /// <returns><c>true</c> if the operation succeeded, <c>false</c> otherwise.</returns>
+        /// <remarks>
+        /// Every call returns the rest of the block holding the read position, so after releasing a whole block
+        /// the next call returns the block after it.
+        /// If the end of the stream is reached, the function will return <c>true</c>, a null pointer, and a count of zero;
+        /// a subsequent read will not succeed.
+        /// </remarks>
+        virtual bool acquire(_Out_ _CharType*& ptr, _Out_ size_t& count)
+        {
+            count = 0;
+            ptr = nullptr;
+
+            if (!this->can_read()) return false;
+
+            if (m_current_block < m_blocks.size())
+            {
+                const auto &block = m_blocks[m_current_block];
+                const size_t skip = m_current_position - block.m_offset;
+                ptr = const_cast<_CharType*>(block.m_data + skip);
+                count = block.m_count - skip;
+            }
+
+            // A null pointer marks the end of the stream.
+            return true;
+        }
+
+        /// <summary>
+        /// Releases a block of data acquired using <see cref="::acquire method"/>. This frees the stream buffer to de-allocate the
+        /// memory, if it so desires. Move the read position ahead by the count.
+        /// </summary>
+        /// <param name="ptr">A pointer to the block of data to be released.</param>
+        /// <param name="count">The number of characters that were read.</param>
+        virtual void release(_Out_writes_opt_ (count) _CharType *ptr, _In_ size_t count)
+        {
+            if (ptr != nullptr)
+                update_current_position(m_current_position + count);
+        }
+
+        virtual pplx::task<size_t> _getn(_Out_writes_ (count) _CharType *ptr, _In_ size_t count)
+        {
+            return pplx::task_from_result(this->read(ptr, count));
+        }
+
+        size_t _sgetn(_Out_writes_ (count) _CharType *ptr, _In_ size_t count)
+        {
+            return this->read(ptr, count);
+        }
+
+        virtual size_t _scopy(_Out_writes_ (count) _CharType *ptr, _In_ size_t count)
+        {
+            return this->read(ptr, count, false);
+        }
+
+        virtual pplx::task<int_type> _bumpc()
+        {
+            return pplx::task_from_result(this->read_byte(true));
+        }
+
+        virtual int_type _sbumpc()
+        {
+            return this->read_byte(true);
+        }
+
+        virtual pplx::task<int_type> _getc()
+        {
+            return pplx::task_from_result(this->read_byte(false));
+        }
+
+        int_type _sgetc()
+        {
+            return this->read_byte(false);
+        }
+
+        virtual pplx::task<int_type> _nextc()
+        {
+            if (in_avail() <= 1)
+            {
+                update_current_position(m_size);
+                return pplx::task_from_result(traits::eof());
+            }
+
+            this->read_byte(true);
+            return pplx::task_from_result(this->read_byte(false));
+        }
+
+        virtual pplx::task<int_type> _ungetc()
+        {
+            auto pos = seekoff(-1, std::ios_base::cur, std::ios_base::in);
+            if (pos == (pos_type)traits::eof())
+                return pplx::task_from_result(traits::eof());
+            return this->getc();
+        }
+
+        /// <summary>
+        /// Gets the current read or write position in the stream.
+        /// </summary>
+        /// <param name="direction">The I/O direction to seek (see remarks)</param>
+        /// <returns>The current position. EOF if the operation fails.</returns>
+        /// <remarks>The buffer is read-only, only the read position is supported.</remarks>
+        virtual pos_type getpos(std::ios_base::openmode mode) const
+        {
+            if (mode != std::ios_base::in || !this->can_read())
+                return static_cast<pos_type>(traits::eof());
+
+            return static_cast<pos_type>(m_current_position);
+        }
+
+        /// <summary>
+        /// Seeks to the given position.
+        /// </summary>
+        /// <param name="pos">The offset from the beginning of the stream.</param>
+        /// <param name="direction">The I/O direction to seek (see remarks).</param>
+        /// <returns>The position. EOF if the operation fails.</returns>
+        /// <remarks>The buffer is read-only, only the read position is supported.</remarks>
+        virtual pos_type seekpos(pos_type position, std::ios_base::openmode mode)
+        {
+            pos_type beg(0);
+            pos_type end(m_size);
+
+            // We do not allow reads to seek beyond the end or before the start position.
+            if ((mode & std::ios_base::in) && this->can_read() && position >= beg && position <= end)
+            {
+                update_current_position(static_cast<size_t>(position));
+                return static_cast<pos_type>(m_current_position);
+            }
+
+            return static_cast<pos_type>(traits::eof());
+        }
+
+        /// <summary>
+        /// Seeks to a position given by a relative offset.
+        /// </summary>
+        /// <param name="offset">The relative position to seek to</param>
+        /// <param name="way">The starting point (beginning, end, current) for the seek.</param>
+        /// <param name="mode">The I/O direction to seek (see remarks)</param>
+        /// <returns>The position. EOF if the operation fails.</returns>
+        /// <remarks>The buffer is read-only, only the read position is supported.</remarks>
+        virtual pos_type seekoff(off_type offset, std::ios_base::seekdir way, std::ios_base::openmode mode)
+        {
+            pos_type beg = 0;
+            pos_type cur = static_cast<pos_type>(m_current_position);
+            pos_type end = static_cast<pos_type>(m_size);
+
+            switch ( way )
+            {
+            case std::ios_base::beg:
+                return seekpos(beg + offset, mode);
+
+            case std::ios_base::cur:
+                return seekpos(cur + offset, mode);
+
+            case std::ios_base::end:
+                return seekpos(end + offset, mode);
+
+            default:
+                return static_cast<pos_type>(traits::eof());
+            }
+        }
+
+    private:
+        template<typename _CharType1> friend class ::concurrency::streams::buffer_chain;
+
+        struct _block
+        {
+            const _CharType *m_data;
+            size_t m_count;
+
+            // The position of the first character of the block in the stream.
+            size_t m_offset;
+
+            std::shared_ptr<const void> m_owner;
+        };
+
+        /// <summary>
+        /// Reads a byte from the stream and returns it as int_type.
+        /// </summary>
+        int_type read_byte(bool advance = true)
+        {
+            _CharType value;
+            auto read_size = this->read(&value, 1, advance);
+            return read_size == 1 ? static_cast<int_type>(value) : traits::eof();
+        }
+
+        /// <summary>
+        /// Reads up to count characters into ptr and returns the count of characters copied.
+        /// The return value (actual characters copied) could be <= count.
+        /// </summary>
+        size_t read(_Out_writes_ (count) _CharType *ptr, _In_ size_t count, bool advance = true)
+        {
+            if (!this->can_read()) return 0;
+
+            const size_t read_size = peek_blocks(count, [&ptr](const _CharType *data, size_t length)
+            {
+#ifdef _WIN32
+                // Avoid warning C4996: Use checked iterators under SECURE_SCL
+                std::copy(data, data + length, stdext::checked_array_iterator<_CharType *>(ptr, length));
+#else
+                std::copy(data, data + length, ptr);
+#endif // _WIN32
+                ptr += length;
+            });
+
+            if (advance)
+            {
+                update_current_position(m_current_position + read_size);
+            }
+
+            return read_size;
+        }
+
+        /// <summary>
+        /// Updates the read position and the block holding it.
+        /// </summary>
+        void update_current_position(size_t newPos)
+        {
+            _ASSERTE(newPos <= m_size);
+            m_current_position = newPos;
+
+            // Find the first block ending after the read position, which is past the last block at the end of the stream.
+            auto block = std::upper_bound(m_blocks.begin(), m_blocks.end(), newPos, [](size_t position, const _block &b)
+            {
+                return position < b.m_offset + b.m_count;
+            });
+            m_current_block = static_cast<size_t>(std::distance(m_blocks.begin(), block));
+        }
+
+        std::vector<_block> m_blocks;
+
+        // The total number of characters in all blocks
+        size_t m_size;
+
+        // Read head
+        size_t m_current_position;
+
+        // The index of the block holding the read head
+        size_t m_current_block;
+    };
+
+    } // namespace details
+
+    /// <summary>
+    /// The <c>buffer_chain</c> class serves as a read-only stream buffer over a chain of memory blocks which are
+    /// owned elsewhere and never copied, such as serialized headers, an encoded JSON document and a memory-mapped file.
+    /// </summary>
+    /// <typeparam name="_CharType">
+    /// The data type of the basic element of the <c>buffer_chain</c>.
+    /// </typeparam>
+    /// <remarks>
+    /// Blocks are appended before the buffer is read. The HTTP client and listener send a body held in a
+    /// <c>buffer_chain</c> with gathered writes straight from the blocks.
+    /// This is a reference-counted version of <c>basic_buffer_chain</c>.
+    /// </remarks>
+    template<typename _CharType>
+    class buffer_chain : public streambuf<_CharType>
+    {
+    public:
+        typedef _CharType char_type;
+
+        /// <summary>
+        /// Creates an empty buffer_chain.
+        /// </summary>
+        buffer_chain()
+            : streambuf<char_type>(std::shared_ptr<details::basic_buffer_chain<char_type>>(new details::basic_buffer_chain<char_type>()))
+        {
+        }
+
+        /// <summary>
+        /// Adds a block to the end of the chain.
+        /// </summary>
+        /// <param name="data">The address of the block.</param>
+        /// <param name="count">The block size, measured in number of characters.</param>
+        /// <param name="owner">Keeps the block alive for as long as the buffer refers to it, may be null if the block outlives the buffer.</param>
+        void append(const char_type *data, size_t count, std::shared_ptr<const void> owner)
+        {
+            chain()->append(data, count, std::move(owner));
+        }
+
+        /// <summary>
+        /// Adds the contents of a collection to the end of the chain, without copying them.
+        /// </summary>
+        /// <param name="data">The collection, e.g. a std::string or std::vector, which must not be modified while the buffer refers to it.</param>
+        template<typename _Collection>
+        void append(std::shared_ptr<_Collection> data)
+        {
+            static_assert(sizeof(typename _Collection::value_type) == sizeof(char_type), "the collection elements must have the size of the buffer characters");
+            const size_t count = data->size();
+            const auto begin = count == 0 ? nullptr : reinterpret_cast<const char_type *>(&(*data)[0]);
+            chain()->append(begin, count, std::move(data));
+        }
+
+        /// <summary>
+        /// Adds the rest of the data of another stream buffer to the end of the chain, without copying it.
+        /// </summary>
+        /// <param name="source">A stream buffer open for reading only, which hands out all its remaining data as one block
+        /// from <c>acquire</c>, like a read-only container, raw pointer or memory-mapped file buffer. The block stays acquired,
+        /// and the stream buffer open, until the chain is done with it; it must not be read in the meantime.</param>
+        /// <returns><c>true</c> if the data was added, <c>false</c> if the stream buffer is open for writing, which could move
+        /// its data, or does not hold its data in one block.</returns>
+        bool append(streambuf<char_type> source)
+        {
+            char_type *ptr = nullptr;
+            size_t count = 0;
+            if (source.can_write() || !source.acquire(ptr, count))
+            {
+                return false;
+            }
+            if (count != source.in_avail())
+            {
+                source.release(ptr, 0);
+                return false;
+            }
+
+            // The block is released when the chain lets go of its owner.
+            std::shared_ptr<streambuf<char_type>> owner(new streambuf<char_type>(std::move(source)), [ptr](streambuf<char_type> *held)
+            {
+                held->release(ptr, 0);
+                delete held;
+            });
+            chain()->append(ptr, count, std::move(owner));
+            return true;
+        }
+
+        /// <summary>
+        /// Gets the number of blocks in the chain.
+        /// </summary>
+        size_t block_count() const
+        {
+            return chain()->block_count();
+        }
+
+    private:
+        details::basic_buffer_chain<char_type> *chain() const
+        {
+            return static_cast<details::basic_buffer_chain<char_type> *>(this->get_base().get());
+        }
+    };
+
+}} // namespaces
+
+#endif
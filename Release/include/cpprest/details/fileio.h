@@ -58,6 +58,8 @@ namespace details
             m_bufoff(0),
             m_bufsize(0),
             m_buffill(0),
+            m_mapped(false),
+            m_write_buffer_size(0),
             m_mode(mode)
         {
         }
@@ -76,6 +78,11 @@ namespace details
         size_t m_bufoff;       // File position that the start of the buffer represents.
         msl::safeint3::SafeInt<size_t> m_bufsize;    // Buffer allocated size, as actually allocated.
         size_t m_buffill;      // Amount of file data actually in the buffer
+        bool   m_mapped;       // The buffer is a read-only mapping of the whole file.
+
+        // Output buffer
+
+        size_t m_write_buffer_size;  // The size of the buffer small writes are gathered in, 0 to write them through.
 
         std::ios_base::openmode m_mode;
 
@@ -117,6 +124,21 @@ extern "C"
 _ASYNCRTIMP bool __cdecl _open_fsb_str(_In_ concurrency::streams::details::_filestream_callback *callback, const utility::char_t *filename, std::ios_base::openmode mode, int prot);
 #endif
 
+/// <summary>
+/// Open a file for reading, mapping all of it into memory, and create a streambuf instance to represent it.
+/// </summary>
+/// <param name="callback">A pointer to the callback interface to invoke when the file has been opened.</param>
+/// <param name="filename">The name of the file to open</param>
+/// <param name="char_size">The size of the character type used for this stream</param>
+/// <returns><c>true</c> if the opening operation could be initiated, <c>false</c> otherwise.</returns>
+/// <remarks>
+/// True does not signal that the file will eventually be successfully opened, just that the process was started.
+/// This is not available for WinRT.
+/// </remarks>
+#if !defined(__cplusplus_winrt)
+_ASYNCRTIMP bool __cdecl _open_fsb_mapped_str(_In_ concurrency::streams::details::_filestream_callback *callback, const utility::char_t *filename, size_t char_size);
+#endif
+
 /// <summary>
 /// Create a streambuf instance to represent a WinRT file.
 /// </summary>
@@ -199,22 +199,7 @@ public:
 
 protected:
 
-    request_context(const std::shared_ptr<_http_client_communicator> &client, const http_request &request)
-        : m_http_client(client),
-        m_request(request),
-        m_uploaded(0),
-        m_downloaded(0)
-    {
-        auto responseImpl = m_response._get_impl();
-
-        // Copy the user specified output stream over to the response
-        responseImpl->set_outstream(request._get_impl()->_response_stream(), false);
-
-        // Prepare for receiving data from the network. Ideally, this should be done after
-        // we receive the headers and determine that there is a response body. We will do it here
-        // since it is not immediately apparent where that would be in the callback handler
-        responseImpl->_prepare_to_receive_data();
-    }
+    request_context(const std::shared_ptr<_http_client_communicator> &client, const http_request &request);
 
     virtual void finish();
 };
@@ -371,6 +356,23 @@ private:
     int m_scheduled;
 };
 
+inline request_context::request_context(const std::shared_ptr<_http_client_communicator> &client, const http_request &request)
+    : m_http_client(client),
+    m_request(request),
+    m_uploaded(0),
+    m_downloaded(0)
+{
+    auto responseImpl = m_response._get_impl();
+
+    // Copy the user specified output stream over to the response
+    responseImpl->set_outstream(request._get_impl()->_response_stream(), false);
+
+    // Prepare for receiving data from the network. Ideally, this should be done after
+    // we receive the headers and determine that there is a response body. We will do it here
+    // since it is not immediately apparent where that would be in the callback handler
+    responseImpl->_prepare_to_receive_data(client->client_config().single_reader_response_body());
+}
+
 inline void request_context::finish()
 {
     // If cancellation is enabled and registration was performed, unregister.
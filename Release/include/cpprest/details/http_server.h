@@ -74,6 +74,15 @@ public:
     /// <param name="response">The http_response to send.</param>
     /// <returns>A operation which is completed once the response has been sent.</returns>
     virtual pplx::task<void> respond(http::http_response response) = 0;
+
+    /// <summary>
+    /// Gets a snapshot of the traffic handled on the host and port of the given listener.
+    /// </summary>
+    /// <remarks>Servers which do not collect metrics return an empty snapshot.</remarks>
+    virtual web::http::experimental::listener::http_listener_metrics metrics(_In_ web::http::experimental::listener::details::http_listener_impl *)
+    {
+        return web::http::experimental::listener::http_listener_metrics();
+    }
 };
 
 } // namespace details
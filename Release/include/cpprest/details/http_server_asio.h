@@ -15,6 +15,7 @@
 #pragma once
 
 #include <set>
+#include <thread>
 #include "pplx/threadpool.h"
 #include "cpprest/details/http_server.h"
 #if defined(__clang__)
@@ -61,6 +62,10 @@ private:
     typedef void (connection::*ResponseFuncPtr) (const http_response &response, const boost::system::error_code& ec);
 
     std::unique_ptr<boost::asio::ip::tcp::socket> m_socket;
+
+    // Every handler of the connection and close() run on this strand, so the socket and the request
+    // are never used from two threads at once. The listener's request handlers run outside of it.
+    boost::asio::io_service::strand m_strand;
     boost::asio::streambuf m_request_buf;
     boost::asio::streambuf m_response_buf;
     http_linux_server* m_p_server;
@@ -68,41 +73,54 @@ private:
     http_request m_request;
     size_t m_read, m_write;
     size_t m_read_size, m_write_size;
-    bool m_close;
+    std::atomic<bool> m_close;
     bool m_chunked;
+    bool m_holds_request_slot; // whether the current request counts against the concurrent request limit
     std::atomic<int> m_refs; // track how many threads are still referring to this
+
+    // Deadline for the pending read or write, checked periodically by the parent hostport_listener.
+    // It is time_point::max() while no network operation is outstanding, e.g. when a handler is running.
+    std::atomic<std::chrono::steady_clock::time_point> m_deadline;
+    utility::seconds m_keep_alive_timeout;
+    utility::seconds m_header_timeout;
+    utility::seconds m_body_timeout;
+
+    // Body data is moved in chunks of m_read_chunk_size/m_write_chunk_size bytes. In adaptive mode these
+    // start small for every message and double each time a chunk is filled, up to m_max_chunk_size.
+    size_t m_max_chunk_size;
+    bool m_adaptive_chunks;
+    size_t m_read_chunk_size;
+    size_t m_write_chunk_size;
+
+    // Traffic counters, only written by the handlers of this connection and read by metrics snapshots.
+    std::atomic<uint64_t> m_bytes_received;
+    std::atomic<uint64_t> m_bytes_sent;
+    std::chrono::steady_clock::time_point m_request_start;
+    utility::string_t m_request_path;
     
     std::unique_ptr<boost::asio::ssl::stream<boost::asio::ip::tcp::socket&>> m_ssl_stream;
 
 public:
-    connection(std::unique_ptr<boost::asio::ip::tcp::socket> socket, http_linux_server* server, hostport_listener* parent, bool is_https, const std::function<void(boost::asio::ssl::context&)>& ssl_context_callback)
-    : m_socket(std::move(socket))
-    , m_request_buf()
-    , m_response_buf()
-    , m_p_server(server)
-    , m_p_parent(parent)
-    , m_refs(1)
-    {
-        if (is_https)
-        {
-            boost::asio::ssl::context ssl_context(boost::asio::ssl::context::sslv23);
-            ssl_context_callback(ssl_context);
-            m_ssl_stream = utility::details::make_unique<boost::asio::ssl::stream<boost::asio::ip::tcp::socket&>>(*m_socket, ssl_context);
-            m_ssl_stream->async_handshake(boost::asio::ssl::stream_base::server, [this](const boost::system::error_code&) { this->start_request_response(); });
-        }
-        else 
-        {
-            start_request_response();
-        }
-    }
+    connection(std::unique_ptr<boost::asio::ip::tcp::socket> socket, http_linux_server* server, hostport_listener* parent, bool is_https, const std::function<void(boost::asio::ssl::context&)>& ssl_context_callback);
 
     connection(const connection&) = delete;
     connection& operator=(const connection&) = delete;
 
     void close();
+    void close_if_past_deadline();
+    bool is_past_deadline(std::chrono::steady_clock::time_point now) const { return m_deadline.load() <= now; }
+    uint64_t bytes_received() const { return m_bytes_received.load(std::memory_order_relaxed); }
+    uint64_t bytes_sent() const { return m_bytes_sent.load(std::memory_order_relaxed); }
 
 private:
+    void arm_timeout(utility::seconds timeout);
+    void disarm_timeout();
+    size_t initial_chunk_size() const;
+    void grow_chunk_size(size_t &chunk_size, size_t transferred) const;
+    void count_received(size_t previously_buffered);
+    void count_sent(size_t sent);
     void start_request_response();
+    void wait_for_next_request();
     void handle_http_line(const boost::system::error_code& ec);
     void handle_headers();
     void handle_body(const boost::system::error_code& ec);
@@ -111,6 +129,8 @@ private:
     void dispatch_request_to_listener();
     void do_response(bool bad_request);
     void async_write(ResponseFuncPtr response_func_ptr, const http_response &response);
+    template <typename ConstBufferSequence, typename WriteHandler>
+    void async_write_buffers(const ConstBufferSequence &buffers, WriteHandler &&write_handler);
     template <typename CompletionCondition, typename Handler>
     void async_read(CompletionCondition &&condition, Handler &&read_handler);
     void async_read_until();
@@ -120,8 +140,11 @@ private:
     void cancel_sending_response_with_error(const http_response &response, const std::exception_ptr &);
     void handle_headers_written(const http_response &response, const boost::system::error_code& ec);
     void handle_write_large_response(const http_response &response, const boost::system::error_code& ec);
+    bool write_response_body_in_place(const http_response &response);
     void handle_write_chunked_response(const http_response &response, const boost::system::error_code& ec);
+    void handle_write_file_response(const http_response &response, const boost::system::error_code& ec);
     void handle_response_written(const http_response &response, const boost::system::error_code& ec);
+    void release_request_slot();
     void finish_request_response();
 };
 
@@ -137,6 +160,38 @@ private:
     pplx::extensibility::recursive_lock_t m_connections_lock;
     pplx::extensibility::event_t m_all_connections_complete;
     std::set<connection*> m_connections;
+    bool m_accept_paused;
+
+    // Limits taken from the configuration of the first listener registered on this host and port, 0 means unlimited.
+    size_t m_max_connections;
+    std::atomic<size_t> m_max_concurrent_requests;
+    std::atomic<size_t> m_concurrent_requests;
+
+    // One timer per host and port closes connections whose current phase has overrun its deadline.
+    std::unique_ptr<boost::asio::deadline_timer> m_timeout_timer;
+    utility::seconds m_keep_alive_timeout;
+    utility::seconds m_header_timeout;
+    utility::seconds m_body_timeout;
+
+    size_t m_chunksize;
+    bool m_adaptive_chunks;
+
+    // Connection counters are guarded by m_connections_lock, closed connections add their byte counts to these totals.
+    uint64_t m_connections_accepted;
+    uint64_t m_connections_closed;
+    uint64_t m_closed_bytes_received;
+    uint64_t m_closed_bytes_sent;
+    std::atomic<uint64_t> m_requests_rejected;
+
+    // Request latencies are recorded into one of several shards picked by thread, so that handlers
+    // completing on different threads rarely wait for each other.
+    struct metrics_shard
+    {
+        pplx::extensibility::critical_section_t m_lock;
+        std::map<utility::string_t, http_path_metrics> m_paths;
+    };
+    static const size_t MetricsShards = 16;
+    std::array<metrics_shard, MetricsShards> m_metrics_shards;
 
     http_linux_server* m_p_server;
 
@@ -153,6 +208,22 @@ public:
     , m_listeners_lock()
     , m_connections_lock()
     , m_connections()
+    , m_accept_paused(false)
+    , m_max_connections(config.max_connections())
+    , m_max_concurrent_requests(config.max_concurrent_requests())
+    , m_concurrent_requests(0)
+    , m_timeout_timer()
+    , m_keep_alive_timeout(config.keep_alive_timeout())
+    , m_header_timeout(config.header_timeout())
+    , m_body_timeout(config.body_timeout())
+    , m_chunksize(config.chunksize())
+    , m_adaptive_chunks(config.is_default_chunksize())
+    , m_connections_accepted(0)
+    , m_connections_closed(0)
+    , m_closed_bytes_received(0)
+    , m_closed_bytes_sent(0)
+    , m_requests_rejected(0)
+    , m_metrics_shards()
     , m_p_server(server)
     , m_is_https(is_https)
     , m_ssl_context_callback(config.get_ssl_context_callback())
@@ -177,8 +248,17 @@ public:
     void add_listener(const std::string& path, web::http::experimental::listener::details::http_listener_impl* listener);
     void remove_listener(const std::string& path, web::http::experimental::listener::details::http_listener_impl* listener);
 
+    http_listener_metrics metrics();
+
 private:
+    void do_accept();
+    void schedule_timeout_check();
+    void on_timeout_check(const boost::system::error_code& ec);
     void on_accept(boost::asio::ip::tcp::socket* socket, const boost::system::error_code& ec);
+    void on_connection_closed(connection* conn);
+    bool try_acquire_request_slot();
+    void release_request_slot();
+    void record_request(const utility::string_t& path, http::status_code status, std::chrono::microseconds latency);
 
 };
 
@@ -221,6 +301,8 @@ public:
     virtual pplx::task<void> unregister_listener(web::http::experimental::listener::details::http_listener_impl* listener);
 
     pplx::task<void> respond(http::http_response response);
+
+    virtual http_listener_metrics metrics(web::http::experimental::listener::details::http_listener_impl* listener);
 };
 
 }}}}
@@ -147,7 +147,7 @@ namespace details {
             if ( direction == std::ios_base::in )
                 return m_info->m_buffer_size;
             else
-                return 0;
+                return m_info->m_write_buffer_size;
         }
 
         /// <summary>
@@ -156,14 +156,24 @@ namespace details {
         /// <param name="size">The size to use for internal buffering, 0 if no buffering should be done.</param>
         /// <param name="direction">The direction of buffering (in or out)</param>
         /// <remarks>An implementation that does not support buffering will silently ignore calls to this function and it will not have
-        ///          any effect on what is returned by subsequent calls to buffer_size().</remarks>
+        ///          any effect on what is returned by subsequent calls to buffer_size().
+        ///          On Linux and OS X, writes smaller than the output buffer size are gathered and written together once the buffer
+        ///          fills up or the stream is flushed; this only applies to files that aren't also open for reading. A size of 0 on
+        ///          input turns off reading ahead of sequential reads.</remarks>
         virtual void set_buffer_size(size_t size, std::ios_base::openmode direction = std::ios_base::in)
         {
-            if ( direction == std::ios_base::out ) return;
+            if ( direction == std::ios_base::out )
+            {
+#if !defined(_WIN32)
+                pplx::extensibility::scoped_recursive_lock_t lck(m_info->m_lock);
+                m_info->m_write_buffer_size = size;
+#endif
+                return;
+            }
 
             m_info->m_buffer_size = size;
 
-            if ( size == 0 && m_info->m_buffer != nullptr )
+            if ( size == 0 && m_info->m_buffer != nullptr && !m_info->m_mapped )
             {
                delete m_info->m_buffer;
                m_info->m_buffer = nullptr;
@@ -340,12 +350,26 @@ namespace details {
         /// The stream buffer may not de-allocate the block until <see cref="::release method" /> is called.
         /// If the end of the stream is reached, the function will return <c>true</c>, a null pointer, and a count of zero;
         /// a subsequent read will not succeed.
+        /// Only files opened with <see cref="::open_mapped method"/> support this; the block is the rest of the mapped file.
         /// </remarks>
         virtual bool acquire(_Out_ _CharType*& ptr, _Out_ size_t& count)
         {
             ptr = nullptr;
             count = 0;
-            return false;
+
+            if ( !this->can_read() || !m_info->m_mapped ) return false;
+
+            m_readOps.wait();
+
+            pplx::extensibility::scoped_recursive_lock_t lck(m_info->m_lock);
+
+            count = _in_avail_unprot();
+            if ( count > 0 )
+            {
+                auto bufoff = m_info->m_rdpos - m_info->m_bufoff;
+                ptr = reinterpret_cast<_CharType *>(m_info->m_buffer + bufoff*sizeof(_CharType));
+            }
+            return true;
         }
 
         /// <summary>
@@ -354,9 +378,12 @@ namespace details {
         /// </summary>
         /// <param name="ptr">A pointer to the block of data to be released.</param>
         /// <param name="count">The number of characters that were read.</param>
-        virtual void release(_Out_writes_ (count) _CharType *, _In_ size_t count)
+        virtual void release(_Out_writes_ (count) _CharType *ptr, _In_ size_t count)
         {
-            (void)(count);
+            if ( ptr == nullptr ) return;
+
+            pplx::extensibility::scoped_recursive_lock_t lck(m_info->m_lock);
+            m_info->m_rdpos += count;
         }
 
         /// <summary>
@@ -756,6 +783,14 @@ namespace details {
             return pplx::create_task(result_tce);
         }
 
+        static pplx::task<std::shared_ptr<basic_streambuf<_CharType>>> open_mapped(const utility::string_t &_Filename)
+        {
+            auto result_tce = pplx::task_completion_event<std::shared_ptr<basic_streambuf<_CharType>>>();
+            auto callback = new _filestream_callback_open(result_tce);
+            _open_fsb_mapped_str(callback, _Filename.c_str(), sizeof(_CharType));
+            return pplx::create_task(result_tce);
+        }
+
 #else
         static pplx::task<std::shared_ptr<basic_streambuf<_CharType>>> open(
             ::Windows::Storage::StorageFile^ file,
@@ -984,6 +1019,24 @@ namespace details {
                 });
         }
 
+        /// <summary>
+        /// Open a new read-only stream buffer representing the given file, which is mapped into memory.
+        /// Reads are served from the mapping without any I/O requests, and <c>acquire</c> returns pointers
+        /// straight into it, so the data can be consumed without being copied.
+        /// </summary>
+        /// <param name="file_name">The name of the file</param>
+        /// <returns>A <c>task</c> that returns an opened stream buffer on completion.</returns>
+        /// <remarks>The file must not be truncated while the stream buffer is open. Use this for files which are
+        /// read in full, like static assets; the mapping takes up address space for all of the file.</remarks>
+        static pplx::task<streambuf<_CharType>> open_mapped(const utility::string_t &file_name)
+        {
+            auto bfb = details::basic_file_buffer<_CharType>::open_mapped(file_name);
+            return bfb.then([](pplx::task<std::shared_ptr<details::basic_streambuf<_CharType>>> op) -> streambuf<_CharType>
+                {
+                    return streambuf<_CharType>(op.get());
+                });
+        }
+
 #else
         /// <summary>
         /// Open a new stream buffer representing the given file.
@@ -1044,6 +1097,22 @@ namespace details {
                 });
         }
 
+        /// <summary>
+        /// Open a new input stream representing the given file, which is mapped into memory.
+        /// The file should already exist on disk, or an exception will be thrown.
+        /// </summary>
+        /// <param name="file_name">The name of the file</param>
+        /// <returns>A <c>task</c> that returns an opened input stream on completion.</returns>
+        /// <remarks>See <see cref="file_buffer::open_mapped method"/>.</remarks>
+        static pplx::task<streams::basic_istream<_CharType>> open_mapped_istream(const utility::string_t &file_name)
+        {
+            return streams::file_buffer<_CharType>::open_mapped(file_name)
+                .then([](streams::streambuf<_CharType> buf) -> basic_istream<_CharType>
+                {
+                    return basic_istream<_CharType>(buf);
+                });
+        }
+
         /// <summary>
         /// Open a new ouput stream representing the given file.
         /// If the file does not exist, it will be create unless the folder or directory
@@ -94,7 +94,8 @@ public:
     http_client_config() :
         m_guarantee_order(false),
         m_timeout(std::chrono::seconds(30)),
-        m_chunksize(0)
+        m_chunksize(0),
+        m_single_reader_response_body(false)
 #if !defined(__cplusplus_winrt)
         , m_validate_certificates(true)
 #endif
@@ -258,6 +259,27 @@ public:
         return m_chunksize == 0;
     }
 
+    /// <summary>
+    /// Checks if response bodies are received into a single producer/consumer buffer, the default is off.
+    /// </summary>
+    /// <returns>True if the single producer/consumer buffer is used, false otherwise.</returns>
+    bool single_reader_response_body() const
+    {
+        return m_single_reader_response_body;
+    }
+
+    /// <summary>
+    /// Sets whether response bodies are received into a single producer/consumer buffer, which hands data
+    /// from the network to the reader without taking a lock.
+    /// </summary>
+    /// <param name="single_reader">True to use the single producer/consumer buffer, false otherwise.</param>
+    /// <remarks>The body must then be read by one thread at a time.
+    /// This has no effect when the request sets its own response stream.</remarks>
+    void set_single_reader_response_body(bool single_reader)
+    {
+        m_single_reader_response_body = single_reader;
+    }
+
 #if !defined(__cplusplus_winrt)
     /// <summary>
     /// Gets the server certificate validation property.
@@ -362,6 +384,7 @@ private:
 
     std::chrono::microseconds m_timeout;
     size_t m_chunksize;
+    bool m_single_reader_response_body;
 
 #if !defined(__cplusplus_winrt)
     // IXmlHttpRequest2 doesn't allow configuration of certificate verification.
@@ -28,6 +28,8 @@
 
 #include <limits>
 #include <functional>
+#include <array>
+#include <chrono>
 
 #include "cpprest/http_msg.h"
 #if !defined(_WIN32) && !defined(__cplusplus_winrt)
@@ -59,6 +61,12 @@ public:
     /// </summary>
     http_listener_config()
         : m_timeout(utility::seconds(120))
+        , m_keep_alive_timeout(0)
+        , m_header_timeout(0)
+        , m_body_timeout(0)
+        , m_max_connections(0)
+        , m_max_concurrent_requests(0)
+        , m_chunksize(0)
     {}
 
     /// <summary>
@@ -67,6 +75,12 @@ public:
     /// <param name="other">http_listener_config to copy.</param>
     http_listener_config(const http_listener_config &other)
         : m_timeout(other.m_timeout)
+        , m_keep_alive_timeout(other.m_keep_alive_timeout)
+        , m_header_timeout(other.m_header_timeout)
+        , m_body_timeout(other.m_body_timeout)
+        , m_max_connections(other.m_max_connections)
+        , m_max_concurrent_requests(other.m_max_concurrent_requests)
+        , m_chunksize(other.m_chunksize)
 #ifndef _WIN32
         , m_ssl_context_callback(other.m_ssl_context_callback)
 #endif
@@ -78,6 +92,12 @@ public:
     /// <param name="other">http_listener_config to move from.</param>
     http_listener_config(http_listener_config &&other)
         : m_timeout(std::move(other.m_timeout))
+        , m_keep_alive_timeout(std::move(other.m_keep_alive_timeout))
+        , m_header_timeout(std::move(other.m_header_timeout))
+        , m_body_timeout(std::move(other.m_body_timeout))
+        , m_max_connections(other.m_max_connections)
+        , m_max_concurrent_requests(other.m_max_concurrent_requests)
+        , m_chunksize(other.m_chunksize)
 #ifndef _WIN32
         , m_ssl_context_callback(std::move(other.m_ssl_context_callback))
 #endif
@@ -92,6 +112,12 @@ public:
         if(this != &rhs)
         {
             m_timeout = rhs.m_timeout;
+            m_keep_alive_timeout = rhs.m_keep_alive_timeout;
+            m_header_timeout = rhs.m_header_timeout;
+            m_body_timeout = rhs.m_body_timeout;
+            m_max_connections = rhs.m_max_connections;
+            m_max_concurrent_requests = rhs.m_max_concurrent_requests;
+            m_chunksize = rhs.m_chunksize;
 #ifndef _WIN32
             m_ssl_context_callback = rhs.m_ssl_context_callback;
 #endif
@@ -108,6 +134,12 @@ public:
         if(this != &rhs)
         {
             m_timeout = std::move(rhs.m_timeout);
+            m_keep_alive_timeout = std::move(rhs.m_keep_alive_timeout);
+            m_header_timeout = std::move(rhs.m_header_timeout);
+            m_body_timeout = std::move(rhs.m_body_timeout);
+            m_max_connections = rhs.m_max_connections;
+            m_max_concurrent_requests = rhs.m_max_concurrent_requests;
+            m_chunksize = rhs.m_chunksize;
 #ifndef _WIN32
             m_ssl_context_callback = std::move(rhs.m_ssl_context_callback);
 #endif
@@ -133,6 +165,136 @@ public:
         m_timeout = std::move(timeout);
     }
 
+    /// <summary>
+    /// Get the keep-alive timeout
+    /// </summary>
+    /// <returns>The time (in seconds) an idle connection is kept open waiting for its next request.</returns>
+    utility::seconds keep_alive_timeout() const
+    {
+        return m_keep_alive_timeout.count() == 0 ? m_timeout : m_keep_alive_timeout;
+    }
+
+    /// <summary>
+    /// Set the keep-alive timeout
+    /// </summary>
+    /// <param name="timeout">The time (in seconds) an idle connection is kept open waiting for its next request,
+    /// 0 uses the value of timeout().</param>
+    void set_keep_alive_timeout(utility::seconds timeout)
+    {
+        m_keep_alive_timeout = std::move(timeout);
+    }
+
+    /// <summary>
+    /// Get the header timeout
+    /// </summary>
+    /// <returns>The time (in seconds) a new connection has to send its request headers.</returns>
+    utility::seconds header_timeout() const
+    {
+        return m_header_timeout.count() == 0 ? m_timeout : m_header_timeout;
+    }
+
+    /// <summary>
+    /// Set the header timeout
+    /// </summary>
+    /// <param name="timeout">The time (in seconds) a new connection has to send its request headers,
+    /// 0 uses the value of timeout().</param>
+    void set_header_timeout(utility::seconds timeout)
+    {
+        m_header_timeout = std::move(timeout);
+    }
+
+    /// <summary>
+    /// Get the body timeout
+    /// </summary>
+    /// <returns>The time (in seconds) allowed between successive reads or writes of a message body.</returns>
+    utility::seconds body_timeout() const
+    {
+        return m_body_timeout.count() == 0 ? m_timeout : m_body_timeout;
+    }
+
+    /// <summary>
+    /// Set the body timeout
+    /// </summary>
+    /// <param name="timeout">The time (in seconds) allowed between successive reads or writes of a message body,
+    /// 0 uses the value of timeout().</param>
+    /// <remarks>The deadline restarts whenever data is transferred, so large bodies are not cut off as long as they make progress.</remarks>
+    void set_body_timeout(utility::seconds timeout)
+    {
+        m_body_timeout = std::move(timeout);
+    }
+
+    /// <summary>
+    /// Get the maximum number of simultaneously open connections.
+    /// </summary>
+    /// <returns>The maximum number of connections, or 0 if unlimited.</returns>
+    size_t max_connections() const
+    {
+        return m_max_connections;
+    }
+
+    /// <summary>
+    /// Set the maximum number of simultaneously open connections.
+    /// </summary>
+    /// <param name="count">The maximum number of connections, 0 means unlimited.</param>
+    /// <remarks>Once the limit is reached no further connections are accepted until an existing one
+    /// is closed. Only the first listener registered on a given host and port determines the limit.</remarks>
+    void set_max_connections(size_t count)
+    {
+        m_max_connections = count;
+    }
+
+    /// <summary>
+    /// Get the maximum number of requests which may be handled concurrently.
+    /// </summary>
+    /// <returns>The maximum number of outstanding requests, or 0 if unlimited.</returns>
+    size_t max_concurrent_requests() const
+    {
+        return m_max_concurrent_requests;
+    }
+
+    /// <summary>
+    /// Set the maximum number of requests which may be handled concurrently.
+    /// </summary>
+    /// <param name="count">The maximum number of outstanding requests, 0 means unlimited.</param>
+    /// <remarks>A request arriving while this many responses are still outstanding is not dispatched
+    /// to a handler, it is immediately answered with 503 Service Unavailable instead.</remarks>
+    void set_max_concurrent_requests(size_t count)
+    {
+        m_max_concurrent_requests = count;
+    }
+
+    /// <summary>
+    /// Get the listener chunk size.
+    /// </summary>
+    /// <returns>The largest amount of message body data the listener reads or writes in one network operation.</returns>
+    /// <remarks>Unless set, this is 64K, the cap adaptive chunks grow to.</remarks>
+    size_t chunksize() const
+    {
+        return m_chunksize == 0 ? 64 * 1024 : m_chunksize;
+    }
+
+    /// <summary>
+    /// Sets the listener chunk size.
+    /// </summary>
+    /// <param name="size">The amount of message body data the listener reads or writes in one network operation.</param>
+    /// <remarks>This is a hint -- an implementation may disregard the setting and use some other chunk size.</remarks>
+    void set_chunksize(size_t size)
+    {
+        m_chunksize = size;
+    }
+
+    /// <summary>
+    /// Returns true if the default chunk size is in use.
+    /// <remarks>If true, implementations are allowed to choose whatever size is best. The Boost.ASIO based
+    /// listener starts each message body with 4K chunks and doubles them while the body keeps filling them,
+    /// up to the 64K returned by chunksize().</remarks>
+    /// </summary>
+    /// <returns>True if default, false if set by user.</returns>
+    bool is_default_chunksize() const
+    {
+        return m_chunksize == 0;
+    }
+
 #ifndef _WIN32
     /// <summary>
     /// Get the callback of ssl context
@@ -156,11 +318,247 @@ public:
 private:
 
     utility::seconds m_timeout;
+    utility::seconds m_keep_alive_timeout;
+    utility::seconds m_header_timeout;
+    utility::seconds m_body_timeout;
+    size_t m_max_connections;
+    size_t m_max_concurrent_requests;
+    size_t m_chunksize;
 #ifndef _WIN32
     std::function<void(boost::asio::ssl::context&)> m_ssl_context_callback;
 #endif
 };
 
+namespace details
+{
+class hostport_listener;
+}
+
+/// <summary>
+/// Log-linear histogram of request latencies.
+/// </summary>
+/// <remarks>
+/// Latencies under 16 microseconds each have their own bucket, every following power of two is split
+/// into 8 equally sized buckets. A latency read back from the histogram is therefore never overstated
+/// by more than an eighth.
+/// </remarks>
+class latency_histogram
+{
+public:
+
+    /// <summary>
+    /// Number of buckets, the last one also collects everything too large for the others.
+    /// </summary>
+    static const size_t bucket_count = 16 + 8 * 36;
+
+    /// <summary>
+    /// Creates an empty histogram.
+    /// </summary>
+    latency_histogram()
+        : m_buckets(), m_count(0), m_total(0), m_max(0)
+    {
+    }
+
+    /// <summary>
+    /// Adds a single latency to the histogram.
+    /// </summary>
+    /// <param name="latency">The latency to record.</param>
+    _ASYNCRTIMP void record(std::chrono::microseconds latency);
+
+    /// <summary>
+    /// Adds all the latencies recorded in another histogram to this one.
+    /// </summary>
+    /// <param name="other">The histogram to merge.</param>
+    _ASYNCRTIMP void merge(const latency_histogram &other);
+
+    /// <summary>
+    /// Gets the number of recorded latencies.
+    /// </summary>
+    uint64_t count() const { return m_count; }
+
+    /// <summary>
+    /// Gets the exact mean of the recorded latencies, zero if there are none.
+    /// </summary>
+    std::chrono::microseconds mean() const
+    {
+        return std::chrono::microseconds(m_count == 0 ? 0 : static_cast<std::chrono::microseconds::rep>(m_total / m_count));
+    }
+
+    /// <summary>
+    /// Gets the exact largest recorded latency.
+    /// </summary>
+    std::chrono::microseconds max() const { return std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(m_max)); }
+
+    /// <summary>
+    /// Gets an upper bound of the given percentile of the recorded latencies.
+    /// </summary>
+    /// <param name="percentile">The percentile to look up, between 0 and 100.</param>
+    /// <returns>The upper bound of the bucket holding the percentile, zero if nothing was recorded.</returns>
+    _ASYNCRTIMP std::chrono::microseconds percentile(double percentile) const;
+
+    /// <summary>
+    /// Gets the number of latencies recorded in each bucket.
+    /// </summary>
+    const std::array<uint64_t, bucket_count> & buckets() const { return m_buckets; }
+
+    /// <summary>
+    /// Gets the largest latency counted in the given bucket.
+    /// </summary>
+    /// <param name="index">Bucket index, less than bucket_count.</param>
+    _ASYNCRTIMP static std::chrono::microseconds bucket_upper_bound(size_t index);
+
+    /// <summary>
+    /// Gets the index of the bucket a latency is counted in.
+    /// </summary>
+    /// <param name="latency">The latency to look up.</param>
+    _ASYNCRTIMP static size_t bucket_index(std::chrono::microseconds latency);
+
+private:
+    std::array<uint64_t, bucket_count> m_buckets;
+    uint64_t m_count;
+    uint64_t m_total;
+    uint64_t m_max;
+};
+
+/// <summary>
+/// Request statistics for one listener path.
+/// </summary>
+class http_path_metrics
+{
+public:
+
+    /// <summary>
+    /// Gets the latencies of the requests answered with a status code in the given class,
+    /// measured from reading the request line until the response was fully written.
+    /// </summary>
+    /// <param name="status_class">The first digit of the status code, between 1 and 5.</param>
+    const latency_histogram & latency(int status_class) const
+    {
+        return m_latency[static_cast<size_t>(clamp_status_class(status_class) - 1)];
+    }
+
+    /// <summary>
+    /// Gets the number of answered requests, whatever their status code.
+    /// </summary>
+    uint64_t requests() const
+    {
+        uint64_t total = 0;
+        for (const auto &histogram : m_latency)
+        {
+            total += histogram.count();
+        }
+        return total;
+    }
+
+    /// <summary>
+    /// Records a request answered with the given status code.
+    /// </summary>
+    void record(http::status_code status, std::chrono::microseconds latency)
+    {
+        m_latency[static_cast<size_t>(clamp_status_class(status / 100) - 1)].record(latency);
+    }
+
+    /// <summary>
+    /// Adds all the requests recorded in another instance to this one.
+    /// </summary>
+    void merge(const http_path_metrics &other)
+    {
+        for (size_t i = 0; i < m_latency.size(); ++i)
+        {
+            m_latency[i].merge(other.m_latency[i]);
+        }
+    }
+
+private:
+    // Status codes outside of the standard classes are counted with the closest one.
+    static int clamp_status_class(int status_class)
+    {
+        return status_class < 1 ? 1 : (status_class > 5 ? 5 : status_class);
+    }
+
+    std::array<latency_histogram, 5> m_latency;
+};
+
+/// <summary>
+/// Snapshot of the traffic handled on the host and port of a listener.
+/// </summary>
+/// <remarks>
+/// The counters are cumulative since the first listener was opened on the host and port. Only the
+/// Boost.ASIO based listener collects them, other implementations return an empty snapshot.
+/// </remarks>
+class http_listener_metrics
+{
+public:
+
+    /// <summary>
+    /// Creates an empty snapshot.
+    /// </summary>
+    http_listener_metrics()
+        : m_connections_accepted(0)
+        , m_connections_closed(0)
+        , m_active_connections(0)
+        , m_active_requests(0)
+        , m_requests_rejected(0)
+        , m_bytes_received(0)
+        , m_bytes_sent(0)
+    {
+    }
+
+    /// <summary>
+    /// Gets the number of accepted client connections.
+    /// </summary>
+    uint64_t connections_accepted() const { return m_connections_accepted; }
+
+    /// <summary>
+    /// Gets the number of client connections which have been closed.
+    /// </summary>
+    uint64_t connections_closed() const { return m_connections_closed; }
+
+    /// <summary>
+    /// Gets the number of client connections open at the time of the snapshot.
+    /// </summary>
+    size_t active_connections() const { return m_active_connections; }
+
+    /// <summary>
+    /// Gets the number of requests handed to a listener and not yet answered at the time of the snapshot.
+    /// </summary>
+    size_t active_requests() const { return m_active_requests; }
+
+    /// <summary>
+    /// Gets the number of requests turned away with 503 Service Unavailable because the
+    /// concurrent request limit was reached.
+    /// </summary>
+    uint64_t requests_rejected() const { return m_requests_rejected; }
+
+    /// <summary>
+    /// Gets the number of bytes read from clients, including headers.
+    /// </summary>
+    uint64_t bytes_received() const { return m_bytes_received; }
+
+    /// <summary>
+    /// Gets the number of bytes written to clients, including headers.
+    /// </summary>
+    uint64_t bytes_sent() const { return m_bytes_sent; }
+
+    /// <summary>
+    /// Gets the request statistics of each listener path on the host and port.
+    /// </summary>
+    /// <remarks>Requests which did not reach a listener, e.g. malformed ones, are counted under an empty path.</remarks>
+    const std::map<utility::string_t, http_path_metrics> & paths() const { return m_paths; }
+
+private:
+    friend class details::hostport_listener;
+
+    uint64_t m_connections_accepted;
+    uint64_t m_connections_closed;
+    size_t m_active_connections;
+    size_t m_active_requests;
+    uint64_t m_requests_rejected;
+    uint64_t m_bytes_received;
+    uint64_t m_bytes_sent;
+    std::map<utility::string_t, http_path_metrics> m_paths;
+};
+
 namespace details
 {
 
@@ -193,6 +591,8 @@ public:
 
     const http_listener_config & configuration() const { return m_config; }
 
+    _ASYNCRTIMP http_listener_metrics metrics() const;
+
     // Handlers
     std::function<void(http::http_request)> m_all_requests;
     std::map<http::method, std::function<void(http::http_request)>> m_supported_methods;
@@ -315,6 +715,13 @@ public:
     /// <returns>Configuration this listener was constructed with.</returns>
     const http_listener_config & configuration() const { return m_impl->configuration(); }
 
+    /// <summary>
+    /// Get a snapshot of the connections, requests and latencies seen on the host and port of this listener.
+    /// </summary>
+    /// <returns>The metrics collected so far, empty while the listener is not open.</returns>
+    /// <remarks>The snapshot covers every listener sharing the host and port, split by path where possible.</remarks>
+    http_listener_metrics metrics() const { return m_impl->metrics(); }
+
     /// <summary>
     /// Move constructor.
     /// </summary>
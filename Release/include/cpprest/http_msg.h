@@ -32,6 +32,7 @@
 
 #include "pplx/pplxtasks.h"
 #include "cpprest/json.h"
+#include "cpprest/json_binary.h"
 #include "cpprest/uri.h"
 #include "cpprest/http_headers.h"
 #include "cpprest/details/cpprest_compat.h"
@@ -286,7 +287,8 @@ public:
     /// <summary>
     /// Prepare the message with an output stream to receive network data
     /// </summary>
-    _ASYNCRTIMP void _prepare_to_receive_data();
+    /// <param name="single_reader">Whether the body is received into a single producer/consumer buffer.</param>
+    _ASYNCRTIMP void _prepare_to_receive_data(bool single_reader = false);
 
     /// <summary>
     /// Determine the content length
@@ -343,6 +345,40 @@ public:
 private:
 };
 
+#if !defined(_WIN32)
+/// <summary>
+/// A region of an open file used as a response body, sent by the listener without going through a stream.
+/// </summary>
+class _file_body
+{
+public:
+    /// <summary>
+    /// Opens the file at the given path, a length past the end of the file is truncated to the file size.
+    /// </summary>
+    _ASYNCRTIMP static std::shared_ptr<_file_body> open(const utility::string_t &file_path, utility::size64_t offset, utility::size64_t length);
+
+    /// <summary>
+    /// Duplicates the file descriptor, so the caller remains responsible for closing the one passed in.
+    /// </summary>
+    _ASYNCRTIMP static std::shared_ptr<_file_body> duplicate(int fd, utility::size64_t offset, utility::size64_t length);
+
+    _ASYNCRTIMP ~_file_body();
+
+    int fd() const { return m_fd; }
+    utility::size64_t offset() const { return m_offset; }
+    utility::size64_t length() const { return m_length; }
+
+private:
+    _file_body(int fd, utility::size64_t offset, utility::size64_t length);
+    _file_body(const _file_body &);
+    _file_body & operator=(const _file_body &);
+
+    int m_fd;
+    utility::size64_t m_offset;
+    utility::size64_t m_length;
+};
+#endif
+
 /// <summary>
 /// Internal representation of an HTTP response.
 /// </summary>
@@ -367,8 +403,23 @@ public:
 
     void _set_server_context(std::unique_ptr<details::_http_server_context> server_context) { m_server_context = std::move(server_context); }
 
+#if !defined(_WIN32)
+    // Setting a stream body replaces the file body, if one was set before.
+    void set_body(const concurrency::streams::istream &instream, const utf8string &contentType) { m_file_body.reset(); http_msg_base::set_body(instream, contentType); }
+    void set_body(const concurrency::streams::istream &instream, const utf16string &contentType) { m_file_body.reset(); http_msg_base::set_body(instream, contentType); }
+    void set_body(const concurrency::streams::istream &instream, utility::size64_t contentLength, const utf8string &contentType) { m_file_body.reset(); http_msg_base::set_body(instream, contentLength, contentType); }
+    void set_body(const concurrency::streams::istream &instream, utility::size64_t contentLength, const utf16string &contentType) { m_file_body.reset(); http_msg_base::set_body(instream, contentLength, contentType); }
+
+    _ASYNCRTIMP void set_file_body(std::shared_ptr<_file_body> file, const utility::string_t &contentType);
+
+    const std::shared_ptr<_file_body> & _get_file_body() const { return m_file_body; }
+#endif
+
 private:
     std::unique_ptr<_http_server_context> m_server_context;
+#if !defined(_WIN32)
+    std::shared_ptr<_file_body> m_file_body;
+#endif
 
     http::status_code m_status_code;
     http::reason_phrase m_reason_phrase;
@@ -492,6 +543,7 @@ public:
 
     /// <summary>
     /// Extracts the body of the response message into a json value, checking that the content type is application/json.
+    /// Bodies with a binary content type, 'application/cbor' or 'application/msgpack', are decoded accordingly.
     /// A body can only be extracted once because in some cases an optimization is made where the data is 'moved' out.
     /// </summary>
     /// <param name="ignore_content_type">If true, ignores the Content-Type header and assumes UTF-8.</param>
@@ -580,6 +632,22 @@ public:
         set_body(concurrency::streams::bytestream::open_istream(std::move(body_text)), length, _XPLATSTR("application/json"));
     }
 
+    /// <summary>
+    /// Sets the body of the message to contain json value in a binary encoding. If the 'Content-Type'
+    /// header hasn't already been set it will be set to the media type of the encoding, e.g. 'application/cbor'.
+    /// </summary>
+    /// <param name="body_data">json value.</param>
+    /// <param name="format">The binary encoding to send the value in.</param>
+    /// <remarks>
+    /// This will overwrite any previously set body data.
+    /// </remarks>
+    void set_body(const json::value &body_data, json::binary_format format)
+    {
+        auto body_bytes = json::encode_binary(body_data, format);
+        auto length = body_bytes.size();
+        set_body(concurrency::streams::bytestream::open_istream(std::move(body_bytes)), length, json::binary_content_type(format));
+    }
+
     /// <summary>
     /// Sets the body of the message to the contents of a byte vector. If the 'Content-Type'
     /// header hasn't already been set it will be set to 'application/octet-stream'.
@@ -638,6 +706,42 @@ public:
         _m_impl->set_body(stream, content_length, content_type);
     }
 
+#if !defined(_WIN32)
+    /// <summary>
+    /// Sets a region of a file as the body of the response.
+    /// </summary>
+    /// <param name="file_path">Path of the file to send.</param>
+    /// <param name="offset">Position in the file of the first byte to send.</param>
+    /// <param name="length">Number of bytes to send, by default everything up to the end of the file.</param>
+    /// <param name="content_type">A string holding the MIME type of the message body.</param>
+    /// <remarks>
+    /// This will overwrite any previously set body data. The http_listener copies the file to plain connections
+    /// with sendfile() and uses large buffered reads for https connections, in neither case is the data passed
+    /// through a stream, so body() does not return a readable stream for this response.
+    /// To answer a range request pass the requested range and set the 206 status code and Content-Range header.
+    /// Throws an http_exception if the file cannot be opened.
+    /// </remarks>
+    void set_body_from_file(const utility::string_t &file_path, utility::size64_t offset = 0, utility::size64_t length = (std::numeric_limits<utility::size64_t>::max)(), const utility::string_t &content_type = _XPLATSTR("application/octet-stream"))
+    {
+        _m_impl->set_file_body(details::_file_body::open(file_path, offset, length), content_type);
+    }
+
+    /// <summary>
+    /// Sets a region of an already open file as the body of the response.
+    /// </summary>
+    /// <param name="fd">Descriptor of the file to send, it is duplicated so the caller may close it right away.</param>
+    /// <param name="offset">Position in the file of the first byte to send.</param>
+    /// <param name="length">Number of bytes to send, by default everything up to the end of the file.</param>
+    /// <param name="content_type">A string holding the MIME type of the message body.</param>
+    /// <remarks>
+    /// This behaves like the overload taking a file path.
+    /// </remarks>
+    void set_body_from_file(int fd, utility::size64_t offset = 0, utility::size64_t length = (std::numeric_limits<utility::size64_t>::max)(), const utility::string_t &content_type = _XPLATSTR("application/octet-stream"))
+    {
+        _m_impl->set_file_body(details::_file_body::duplicate(fd, offset, length), content_type);
+    }
+#endif
+
     /// <summary>
     /// Produces a stream which the caller may use to retrieve data from an incoming request.
     /// </summary>
@@ -889,6 +993,7 @@ public:
 
     /// <summary>
     /// Extracts the body of the request message into a json value, checking that the content type is application/json.
+    /// Bodies with a binary content type, 'application/cbor' or 'application/msgpack', are decoded accordingly.
     /// A body can only be extracted once because in some cases an optimization is made where the data is 'moved' out.
     /// </summary>
     /// <param name="ignore_content_type">If true, ignores the Content-Type header and assumes UTF-8.</param>
@@ -978,6 +1083,22 @@ public:
         _m_impl->set_body(concurrency::streams::bytestream::open_istream(std::move(body_text)), length, _XPLATSTR("application/json"));
     }
 
+    /// <summary>
+    /// Sets the body of the message to contain json value in a binary encoding. If the 'Content-Type'
+    /// header hasn't already been set it will be set to the media type of the encoding, e.g. 'application/cbor'.
+    /// </summary>
+    /// <param name="body_data">json value.</param>
+    /// <param name="format">The binary encoding to send the value in.</param>
+    /// <remarks>
+    /// This will overwrite any previously set body data.
+    /// </remarks>
+    void set_body(const json::value &body_data, json::binary_format format)
+    {
+        auto body_bytes = json::encode_binary(body_data, format);
+        auto length = body_bytes.size();
+        _m_impl->set_body(concurrency::streams::bytestream::open_istream(std::move(body_bytes)), length, json::binary_content_type(format));
+    }
+
     /// <summary>
     /// Sets the body of the message to the contents of a byte vector. If the 'Content-Type'
     /// header hasn't already been set it will be set to 'application/octet-stream'.
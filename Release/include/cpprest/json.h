@@ -27,6 +27,8 @@
 #ifndef _CASA_JSON_H
 #define _CASA_JSON_H
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <sstream>
@@ -51,7 +53,11 @@ namespace json
         class _String;
         class _Object;
         class _Array;
+        class _Deferred;
+        class _Shared;
         template <typename CharType> class JSON_Parser;
+        class json_writer_impl;
+        class json_mapping_writer;
     }
 
     namespace details
@@ -67,6 +73,99 @@ namespace json
     /// <remarks>Note this is a global setting and affects all JSON parsing done.</remarks>
     void _ASYNCRTIMP __cdecl keep_object_element_order(bool keep_order);
 
+    /// <summary>
+    /// Options controlling how a single JSON document is parsed.
+    /// </summary>
+    class parse_options
+    {
+    public:
+        parse_options()
+            : m_use_arena(false),
+              m_lazy(false),
+              m_intern_keys(false)
+        {
+        }
+
+        /// <summary>
+        /// Get whether the nodes of the parsed document are allocated from a per-document arena.
+        /// </summary>
+        /// <returns><c>true</c> if an arena is used, <c>false</c> otherwise.</returns>
+        bool use_arena() const
+        {
+            return m_use_arena;
+        }
+
+        /// <summary>
+        /// Allocate all the nodes of a parsed document from blocks owned by the document instead of one
+        /// heap allocation each. The blocks are freed together once the last node is destroyed.
+        /// </summary>
+        /// <param name="use_arena"><c>true</c> to allocate nodes from an arena, <c>false</c> otherwise.</param>
+        /// <remarks>
+        /// The resulting values behave exactly like any other. Nodes created later, e.g. by copying or assigning,
+        /// are allocated as usual, and string and container contents always use the standard allocator.
+        /// Keeping a single small value of a large document alive keeps the whole arena alive.
+        /// </remarks>
+        void set_use_arena(bool use_arena)
+        {
+            m_use_arena = use_arena;
+        }
+
+        /// <summary>
+        /// Get whether the objects, arrays and strings nested in the parsed document are only parsed when first accessed.
+        /// </summary>
+        /// <returns><c>true</c> if nested values are parsed on demand, <c>false</c> otherwise.</returns>
+        bool lazy() const
+        {
+            return m_lazy;
+        }
+
+        /// <summary>
+        /// Parse the objects, arrays and strings held by the top-level object or array of a document only when they
+        /// are first accessed. The whole document is still checked for errors up front, but only the top level is built,
+        /// which saves time and memory when just a few fields of a large document are used.
+        /// </summary>
+        /// <param name="lazy"><c>true</c> to parse nested values on demand, <c>false</c> otherwise.</param>
+        /// <remarks>
+        /// Only applies when parsing from a string, which is copied and kept alive for as long as any value of the
+        /// document still has to be parsed. A deferred value is parsed the same way once accessed, so each level of
+        /// the document is built as it is reached. Checking a value's type does not parse it, and parsed values are
+        /// safe to read from several threads like any other.
+        /// </remarks>
+        void set_lazy(bool lazy)
+        {
+            m_lazy = lazy;
+        }
+
+        /// <summary>
+        /// Get whether the field names of the objects of the parsed document are interned.
+        /// </summary>
+        /// <returns><c>true</c> if field names are interned, <c>false</c> otherwise.</returns>
+        bool intern_keys() const
+        {
+            return m_intern_keys;
+        }
+
+        /// <summary>
+        /// Remember the field names of the last object parsed at each level of nesting of the document. An object which
+        /// starts with the same names, like the records of an array usually do, copies its keys from there, and if it has
+        /// exactly the same fields, its storage is sized up front and it is put in order without being sorted again.
+        /// </summary>
+        /// <param name="intern_keys"><c>true</c> to intern field names, <c>false</c> otherwise.</param>
+        /// <remarks>
+        /// This speeds up parsing documents made of many objects of the same shape, but adds some work for objects
+        /// which all differ. The resulting values are the same either way.
+        /// </remarks>
+        void set_intern_keys(bool intern_keys)
+        {
+            m_intern_keys = intern_keys;
+        }
+
+    private:
+        bool m_use_arena;
+        bool m_lazy;
+        bool m_intern_keys;
+    };
+
 #ifdef _WIN32
 #ifdef _DEBUG
 #define ENABLE_JSON_VALUE_VISUALIZER
@@ -335,6 +434,19 @@ public:
         /// <returns>A JSON array value</returns>
         static _ASYNCRTIMP json::value __cdecl array(std::vector<value> elements);
 
+        /// <summary>
+        /// Turns a JSON value into an immutable document shared by all copies made of it or of any value inside it.
+        /// </summary>
+        /// <param name="document">The JSON value to share, which is moved rather than copied.</param>
+        /// <returns>A JSON value holding the shared document</returns>
+        /// <remarks>
+        /// Copies take constant time, so a parsed document can be cached and handed out freely. Changing a copy first
+        /// copies the object or array being changed, whose members go on sharing the document; other copies never
+        /// see the change. Non-const accessors like at() and operator[] count as changes, read through a const
+        /// reference to avoid them. A shared document, and copies of it, may be read from several threads at once.
+        /// </remarks>
+        static _ASYNCRTIMP json::value __cdecl shared(value document);
+
         /// <summary>
         /// Accesses the type of JSON value the current value instance is
         /// </summary>
@@ -417,6 +529,58 @@ public:
         /// <returns>The parsed object. Returns web::json::value::null if failed</returns>
         _ASYNCRTIMP static value __cdecl parse(const utility::string_t &value, std::error_code &errorCode);
 
+        /// <summary>
+        /// Parses a string and construct a JSON value.
+        /// </summary>
+        /// <param name="value">The C++ value to create a JSON value from, a C++ STL double-byte string</param>
+        /// <param name="options">Options controlling how the value is parsed.</param>
+        _ASYNCRTIMP static value __cdecl parse(const utility::string_t &value, const parse_options &options);
+
+        /// <summary>
+        /// Attempts to parse a string and construct a JSON value.
+        /// </summary>
+        /// <param name="value">The C++ value to create a JSON value from, a C++ STL double-byte string</param>
+        /// <param name="options">Options controlling how the value is parsed.</param>
+        /// <param name="errorCode">If parsing fails, the error code is greater than 0</param>
+        /// <returns>The parsed object. Returns web::json::value::null if failed</returns>
+        _ASYNCRTIMP static value __cdecl parse(const utility::string_t &value, const parse_options &options, std::error_code &errorCode);
+
+        /// <summary>
+        /// Parses a UTF-8 encoded JSON document held in memory, without copying it first.
+        /// </summary>
+        /// <param name="data">A pointer to the first character of the document.</param>
+        /// <param name="length">The number of characters in the document.</param>
+        /// <returns>The JSON value object created from the document.</returns>
+        _ASYNCRTIMP static value __cdecl parse(const char *data, size_t length);
+
+        /// <summary>
+        /// Attempts to parse a UTF-8 encoded JSON document held in memory, without copying it first.
+        /// </summary>
+        /// <param name="data">A pointer to the first character of the document.</param>
+        /// <param name="length">The number of characters in the document.</param>
+        /// <param name="errorCode">If parsing fails, the error code is greater than 0</param>
+        /// <returns>The parsed object. Returns web::json::value::null if failed</returns>
+        _ASYNCRTIMP static value __cdecl parse(const char *data, size_t length, std::error_code &errorCode);
+
+        /// <summary>
+        /// Parses a UTF-8 encoded JSON document held in memory, without copying it first.
+        /// </summary>
+        /// <param name="data">A pointer to the first character of the document.</param>
+        /// <param name="length">The number of characters in the document.</param>
+        /// <param name="options">Options controlling how the value is parsed. A lazily parsed document is copied.</param>
+        /// <returns>The JSON value object created from the document.</returns>
+        _ASYNCRTIMP static value __cdecl parse(const char *data, size_t length, const parse_options &options);
+
+        /// <summary>
+        /// Attempts to parse a UTF-8 encoded JSON document held in memory, without copying it first.
+        /// </summary>
+        /// <param name="data">A pointer to the first character of the document.</param>
+        /// <param name="length">The number of characters in the document.</param>
+        /// <param name="options">Options controlling how the value is parsed. A lazily parsed document is copied.</param>
+        /// <param name="errorCode">If parsing fails, the error code is greater than 0</param>
+        /// <returns>The parsed object. Returns web::json::value::null if failed</returns>
+        _ASYNCRTIMP static value __cdecl parse(const char *data, size_t length, const parse_options &options, std::error_code &errorCode);
+
         /// <summary>
         /// Serializes the current JSON value to a C++ string.
         /// </summary>
@@ -445,6 +609,23 @@ public:
         /// <returns>The parsed object. Returns web::json::value::null if failed</returns>
         _ASYNCRTIMP static value __cdecl parse(utility::istream_t &input, std::error_code &errorCode);
 
+        /// <summary>
+        /// Parses a JSON value from the contents of an input stream using the native platform character width.
+        /// </summary>
+        /// <param name="input">The stream to read the JSON value from</param>
+        /// <param name="options">Options controlling how the value is parsed.</param>
+        /// <returns>The JSON value object created from the input stream.</returns>
+        _ASYNCRTIMP static value __cdecl parse(utility::istream_t &input, const parse_options &options);
+
+        /// <summary>
+        /// Parses a JSON value from the contents of an input stream using the native platform character width.
+        /// </summary>
+        /// <param name="input">The stream to read the JSON value from</param>
+        /// <param name="options">Options controlling how the value is parsed.</param>
+        /// <param name="errorCode">If parsing fails, the error code is greater than 0</param>
+        /// <returns>The parsed object. Returns web::json::value::null if failed</returns>
+        _ASYNCRTIMP static value __cdecl parse(utility::istream_t &input, const parse_options &options, std::error_code &errorCode);
+
         /// <summary>
         /// Writes the current JSON value to a stream with the native platform character width.
         /// </summary>
@@ -640,7 +821,11 @@ public:
     private:
         friend class web::json::details::_Object;
         friend class web::json::details::_Array;
+        friend class web::json::details::_Deferred;
+        friend class web::json::details::_Shared;
         template<typename CharType> friend class web::json::details::JSON_Parser;
+        friend class web::json::details::json_writer_impl;
+        friend class web::json::details::json_mapping_writer;
 
 #ifdef _WIN32
         /// <summary>
@@ -956,9 +1141,170 @@ public:
         template<typename CharType> friend class json::details::JSON_Parser;
     };
 
+    namespace details
+    {
+        /// <summary>
+        /// Hash index of the fields of a large object. Its slots hold the position of each field and the
+        /// hash of its key, so the keys themselves aren't copied.
+        /// </summary>
+        class _Object_index
+        {
+        public:
+            typedef std::vector<std::pair<utility::string_t, json::value>> storage_type;
+
+            /// Objects with more fields than this are indexed.
+            static const size_t threshold = 32;
+
+            static const size_t npos = static_cast<size_t>(-1);
+
+            explicit _Object_index(const storage_type &fields) : m_slots(64), m_count(0), m_duplicates(false)
+            {
+                while (m_slots.size() < fields.size() * 2)
+                {
+                    m_slots.resize(m_slots.size() * 2);
+                }
+                for (size_t i = 0; i < fields.size(); ++i)
+                {
+                    // Only the first of any duplicate keys is found.
+                    if (!insert(fields, i))
+                    {
+                        m_duplicates = true;
+                    }
+                }
+            }
+
+            /// Whether some fields have the same key, in which case only the first of them is indexed.
+            bool has_duplicates() const { return m_duplicates; }
+
+            size_t find(const storage_type &fields, const utility::string_t &key) const
+            {
+                const size_t hash = std::hash<utility::string_t>()(key);
+                for (size_t i = hash & mask(); m_slots[i].m_position != npos; i = (i + 1) & mask())
+                {
+                    if (m_slots[i].m_hash == hash && fields[m_slots[i].m_position].first == key)
+                    {
+                        return m_slots[i].m_position;
+                    }
+                }
+                return npos;
+            }
+
+            /// Indexes the field at a position, unless a field with the same key already is.
+            bool insert(const storage_type &fields, size_t position)
+            {
+                if ((m_count + 1) * 2 > m_slots.size())
+                {
+                    grow();
+                }
+
+                const auto &key = fields[position].first;
+                const size_t hash = std::hash<utility::string_t>()(key);
+                size_t i = hash & mask();
+                for (; m_slots[i].m_position != npos; i = (i + 1) & mask())
+                {
+                    if (m_slots[i].m_hash == hash && fields[m_slots[i].m_position].first == key)
+                    {
+                        return false;
+                    }
+                }
+                m_slots[i].m_position = position;
+                m_slots[i].m_hash = hash;
+                ++m_count;
+                return true;
+            }
+
+            /// Drops the indexed field at a position.
+            void erase(const storage_type &fields, size_t position)
+            {
+                // The entries after the freed slot move back into it, unless that would put them before
+                // the slot their hash starts at.
+                size_t hole = locate(fields, position);
+                for (size_t i = (hole + 1) & mask(); m_slots[i].m_position != npos; i = (i + 1) & mask())
+                {
+                    const size_t start = m_slots[i].m_hash & mask();
+                    const bool stays = hole < i ? (hole < start && start <= i) : (hole < start || start <= i);
+                    if (!stays)
+                    {
+                        m_slots[hole] = m_slots[i];
+                        hole = i;
+                    }
+                }
+                m_slots[hole].m_position = npos;
+                --m_count;
+            }
+
+            /// Records that the indexed field at one position was moved to another.
+            void move(const storage_type &fields, size_t from, size_t to)
+            {
+                m_slots[locate(fields, from)].m_position = to;
+            }
+
+            /// Records that the fields after a position moved down by one.
+            void shift_down(size_t position)
+            {
+                for (auto &slot : m_slots)
+                {
+                    if (slot.m_position != npos && slot.m_position > position)
+                    {
+                        --slot.m_position;
+                    }
+                }
+            }
+
+        private:
+            struct slot
+            {
+                slot() : m_position(npos), m_hash(0) { }
+
+                size_t m_position;
+                size_t m_hash;
+            };
+
+            size_t mask() const { return m_slots.size() - 1; }
+
+            size_t locate(const storage_type &fields, size_t position) const
+            {
+                size_t i = std::hash<utility::string_t>()(fields[position].first) & mask();
+                while (m_slots[i].m_position != position)
+                {
+                    i = (i + 1) & mask();
+                }
+                return i;
+            }
+
+            void grow()
+            {
+                std::vector<slot> slots(m_slots.size() * 2);
+                slots.swap(m_slots);
+                for (const auto &entry : slots)
+                {
+                    if (entry.m_position != npos)
+                    {
+                        size_t i = entry.m_hash & mask();
+                        while (m_slots[i].m_position != npos)
+                        {
+                            i = (i + 1) & mask();
+                        }
+                        m_slots[i] = entry;
+                    }
+                }
+            }
+
+            std::vector<slot> m_slots;
+            size_t m_count;
+            bool m_duplicates;
+        };
+    }
+
     /// <summary>
     /// A JSON object represented as a C++ class.
     /// </summary>
+    /// <remarks>
+    /// Large objects are indexed by key the first time a field is looked up. Fields added to an indexed object
+    /// are appended, and a sorted object moves them into key order the next time it is iterated from a non-const
+    /// begin(), which invalidates iterators and references like an insert does. Until then they come last in a
+    /// const iteration; serialization and comparison always see key order.
+    /// </remarks>
     class object
     {
         typedef std::vector<std::pair<utility::string_t, json::value>> storage_type;
@@ -971,8 +1317,9 @@ public:
         typedef storage_type::size_type size_type;
 
     private:
-        object(bool keep_order = false) : m_elements(), m_keep_order(keep_order) { }
-        object(storage_type elements, bool keep_order = false) : m_elements(std::move(elements)), m_keep_order(keep_order)
+        object(bool keep_order = false) : m_elements(), m_keep_order(keep_order), m_appended(0), m_index(nullptr) { }
+        object(storage_type elements, bool keep_order = false)
+            : m_elements(std::move(elements)), m_keep_order(keep_order), m_appended(0), m_index(nullptr)
         {
             if (!keep_order) {
                 sort(m_elements.begin(), m_elements.end(), compare_pairs);
@@ -980,12 +1327,58 @@ public:
         }
 
     public:
+        // The index isn't copied; the copy builds its own when it is looked up.
+        object(const object &other)
+            : m_elements(other.m_elements), m_keep_order(other.m_keep_order), m_appended(other.m_appended), m_index(nullptr)
+        {
+        }
+
+        object(object &&other)
+            : m_elements(std::move(other.m_elements)), m_keep_order(other.m_keep_order), m_appended(other.m_appended),
+              m_index(other.m_index.exchange(nullptr))
+        {
+            other.m_elements.clear();
+            other.m_appended = 0;
+        }
+
+        ~object()
+        {
+            delete m_index.load();
+        }
+
+        object &operator=(const object &other)
+        {
+            if (this != &other)
+            {
+                m_elements = other.m_elements;
+                m_keep_order = other.m_keep_order;
+                m_appended = other.m_appended;
+                drop_index();
+            }
+            return *this;
+        }
+
+        object &operator=(object &&other)
+        {
+            if (this != &other)
+            {
+                m_elements = std::move(other.m_elements);
+                m_keep_order = other.m_keep_order;
+                m_appended = other.m_appended;
+                delete m_index.exchange(other.m_index.exchange(nullptr));
+                other.m_elements.clear();
+                other.m_appended = 0;
+            }
+            return *this;
+        }
+
         /// <summary>
         /// Gets the beginning iterator element of the object
         /// </summary>
         /// <returns>An <c>iterator</c> to the beginning of the JSON object.</returns>
         iterator begin()
         {
+            sort_appended_fields();
             return m_elements.begin();
         }
 
@@ -1022,6 +1415,7 @@ public:
         /// <returns>An <c>reverse_iterator</c> to the beginning of the JSON object.</returns>
         reverse_iterator rbegin()
         {
+            sort_appended_fields();
             return m_elements.rbegin();
         }
 
@@ -1088,6 +1482,29 @@ public:
             return m_elements.crend();
         }
 
+        /// <summary>
+        /// Gets the fields of the object in the order it is serialized in, if a const iteration doesn't
+        /// visit them in that order.
+        /// </summary>
+        /// <returns>Iterators to the fields in key order, or an empty vector if the fields are stored in order.</returns>
+        std::vector<const_iterator> ordered_fields() const
+        {
+            std::vector<const_iterator> fields;
+            if (m_appended > 0)
+            {
+                fields.reserve(m_elements.size());
+                for (auto iter = m_elements.cbegin(); iter != m_elements.cend(); ++iter)
+                {
+                    fields.push_back(iter);
+                }
+                std::sort(fields.begin(), fields.end(), [](const_iterator left, const_iterator right)
+                {
+                    return left->first < right->first;
+                });
+            }
+            return fields;
+        }
+
         /// <summary>
         /// Deletes an element of the JSON object.
         /// </summary>
@@ -1096,7 +1513,40 @@ public:
         /// <remarks>GCC doesn't support erase with const_iterator on vector yet. In the future this should be changed.</remarks>
         iterator erase(iterator position)
         {
-            return m_elements.erase(position);
+            const size_t erased = static_cast<size_t>(position - m_elements.begin());
+            const size_t last = m_elements.size() - 1;
+
+            auto index = m_index.load(std::memory_order_relaxed);
+            if (index && index->has_duplicates())
+            {
+                drop_index();
+                index = nullptr;
+            }
+
+            if (index && !m_keep_order && erased != last)
+            {
+                // The last field takes the place of the erased one, so no other field moves. The fields
+                // from there on are put back in order with the appended ones.
+                const size_t sorted = m_elements.size() - m_appended;
+                index->erase(m_elements, erased);
+                index->move(m_elements, last, erased);
+                *position = std::move(m_elements.back());
+                m_elements.pop_back();
+                m_appended = m_elements.size() - (std::min)(sorted, erased);
+                return position;
+            }
+
+            if (index)
+            {
+                index->erase(m_elements, erased);
+                index->shift_down(erased);
+            }
+            if (erased + m_appended > last)
+            {
+                --m_appended;
+            }
+            m_elements.erase(position);
+            return m_elements.begin() + erased;
         }
 
         /// <summary>
@@ -1111,7 +1561,7 @@ public:
                 throw web::json::json_exception(_XPLATSTR("Key not found"));
             }
 
-            m_elements.erase(iter);
+            erase(iter);
         }
 
         /// <summary>
@@ -1153,6 +1603,23 @@ public:
         /// <returns>If the key exists, a reference to the value kept in the field, otherwise a newly created null value that will be stored for the given key.</returns>
         json::value& operator[](const utility::string_t& key)
         {
+            if (auto index = field_index())
+            {
+                const auto position = index->find(m_elements, key);
+                if (position != details::_Object_index::npos)
+                {
+                    return m_elements[position].second;
+                }
+
+                m_elements.push_back(std::pair<utility::string_t, value>(key, value()));
+                index->insert(m_elements, m_elements.size() - 1);
+                if (!m_keep_order)
+                {
+                    ++m_appended;
+                }
+                return m_elements.back().second;
+            }
+
             auto iter = find_insert_location(key);
 
             if (iter == m_elements.end() || key != iter->first)
@@ -1218,7 +1685,12 @@ public:
 
         storage_type::const_iterator find_by_key(const utility::string_t& key) const
         {
-            if (m_keep_order)
+            if (auto index = field_index())
+            {
+                const auto position = index->find(m_elements, key);
+                return position == details::_Object_index::npos ? m_elements.end() : m_elements.begin() + position;
+            }
+            else if (m_keep_order)
             {
                 return std::find_if(m_elements.begin(), m_elements.end(),
                     [&key](const std::pair<utility::string_t, value>& p) {
@@ -1238,16 +1710,54 @@ public:
 
         storage_type::iterator find_by_key(const utility::string_t& key)
         {
-            auto iter = find_insert_location(key);
-            if (iter != m_elements.end() && key != iter->first)
+            const auto &self = *this;
+            return m_elements.begin() + (self.find_by_key(key) - m_elements.cbegin());
+        }
+
+        // The index of a large object, or of one with appended fields, built by the first lookup that
+        // needs it. Lookups on a shared object may race to build it, and all use the one published first.
+        details::_Object_index *field_index() const
+        {
+            auto index = m_index.load(std::memory_order_acquire);
+            if (index == nullptr && (m_elements.size() > details::_Object_index::threshold || m_appended > 0))
+            {
+                std::unique_ptr<details::_Object_index> built(new details::_Object_index(m_elements));
+                if (m_index.compare_exchange_strong(index, built.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    index = built.release();
+                }
+            }
+            return index;
+        }
+
+        void drop_index()
+        {
+            delete m_index.exchange(nullptr);
+        }
+
+        // Merges the fields appended to a sorted object into key order. Every position changes, so the
+        // index is dropped and built again by the next lookup.
+        void sort_appended_fields()
+        {
+            if (m_appended == 0)
             {
-                return m_elements.end();
+                return;
             }
-            return iter;
+
+            const auto appended = m_elements.end() - static_cast<std::ptrdiff_t>(m_appended);
+            std::sort(appended, m_elements.end(), compare_pairs);
+            std::inplace_merge(m_elements.begin(), appended, m_elements.end(), compare_pairs);
+            m_appended = 0;
+            drop_index();
         }
 
         storage_type m_elements;
         bool m_keep_order;
+
+        // How many fields at the end of a sorted object were appended or moved out of key order.
+        size_t m_appended;
+
+        mutable std::atomic<details::_Object_index *> m_index;
         friend class details::_Object;
 
         template<typename CharType> friend class json::details::JSON_Parser;
@@ -1420,6 +1930,9 @@ public:
         public:
             virtual std::unique_ptr<_Value> _copy_value() = 0;
 
+            // Prepares the members of an object or array for value::shared(), returns whether the node is worth sharing.
+            virtual bool _share_members() { return false; }
+
             virtual bool has_field(const utility::string_t &) const { return false; }
             virtual value get_field(const utility::string_t &) const { throw json_exception(_XPLATSTR("not an object")); }
             virtual value get_element(array::size_type) const { throw json_exception(_XPLATSTR("not an array")); }
@@ -1484,6 +1997,7 @@ public:
         private:
 
             friend class web::json::value;
+            friend class _Shared;
         };
 
         class _Null : public _Value
@@ -1669,6 +2183,15 @@ public:
                 return utility::details::make_unique<_Object>(*this);
             }
 
+            virtual bool _share_members()
+            {
+                for (auto &field : m_object)
+                {
+                    field.second = value::shared(std::move(field.second));
+                }
+                return true;
+            }
+
             virtual json::object& as_object() { return m_object; }
 
             virtual const json::object& as_object() const { return m_object; }
@@ -1679,14 +2202,6 @@ public:
 
             virtual json::value &index(const utility::string_t &key);
 
-            bool is_equal(const _Object* other) const
-            {
-                if (m_object.size() != other->m_object.size())
-                    return false;
-
-                return std::equal(std::begin(m_object), std::end(m_object), std::begin(other->m_object));
-            }
-
             virtual void serialize_impl(std::string& str) const
             {
                 // To avoid repeated allocations reserve some space all up front.
@@ -1724,19 +2239,17 @@ public:
             void format_impl(std::basic_string<CharType>& str) const
             {
                 str.push_back('{');
-                if(!m_object.empty())
+                const auto ordered = m_object.ordered_fields();
+                for (size_t i = 0; i < m_object.size(); ++i)
                 {
-                    auto lastElement = m_object.end() - 1;
-                    for (auto iter = m_object.begin(); iter != lastElement; ++iter)
+                    const auto &field = ordered.empty() ? *(m_object.begin() + i) : *ordered[i];
+                    if (i > 0)
                     {
-                        format_string(iter->first, str);
-                        str.push_back(':');
-                        iter->second.format(str);
                         str.push_back(',');
                     }
-                    format_string(lastElement->first, str);
+                    format_string(field.first, str);
                     str.push_back(':');
-                    lastElement->second.format(str);
+                    field.second.format(str);
                 }
                 str.push_back('}');
             }
@@ -1755,7 +2268,7 @@ public:
                     {
                         if(iter->second.type() == json::value::String)
                         {
-                            valueSize = static_cast<_String *>(iter->second.m_value.get())->get_reserve_size();
+                            valueSize = iter->second.as_string().size() + 2; // 2 for quotes
                         }
                         else
                         {
@@ -1780,6 +2293,15 @@ public:
                 return utility::details::make_unique<_Array>(*this);
             }
 
+            virtual bool _share_members()
+            {
+                for (auto &element : m_array)
+                {
+                    element = value::shared(std::move(element));
+                }
+                return true;
+            }
+
             virtual json::value::value_type type() const { return json::value::Array; }
 
             virtual json::array& as_array() { return m_array; }
@@ -1790,25 +2312,6 @@ public:
                 return m_array[index];
             }
 
-            bool is_equal(const _Array* other) const
-            {
-                if ( m_array.size() != other->m_array.size())
-                    return false;
-
-                auto iterT  = m_array.cbegin();
-                auto iterO  = other->m_array.cbegin();
-                auto iterTe = m_array.cend();
-                auto iterOe = other->m_array.cend();
-
-                for (; iterT != iterTe && iterO != iterOe; ++iterT, ++iterO)
-                {
-                    if ( *iterT != *iterO )
-                        return false;
-                }
-
-                return true;
-            }
-
             virtual void serialize_impl(std::string& str) const
             {
                 // To avoid repeated allocations reserve some space all up front.
@@ -0,0 +1,121 @@
+/***
+* ==++==
+*
+* Copyright (c) Microsoft Corporation. All rights reserved.
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* ==--==
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: Binary encodings of JSON values, CBOR and MessagePack.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+#pragma once
+
+#ifndef _CASA_JSON_BINARY_H
+#define _CASA_JSON_BINARY_H
+
+#include <vector>
+
+#include "pplx/pplxtasks.h"
+#include "cpprest/json.h"
+#include "cpprest/streams.h"
+
+namespace web
+{
+namespace json
+{
+
+/// <summary>
+/// Binary encodings a json::value can be written in and read from.
+/// </summary>
+enum class binary_format
+{
+    /// Concise Binary Object Representation, RFC 8949, media type 'application/cbor'.
+    cbor,
+    /// MessagePack, media type 'application/msgpack'.
+    msgpack
+};
+
+/// <summary>
+/// Encodes a JSON value.
+/// </summary>
+/// <param name="value">The value to encode.</param>
+/// <param name="format">The binary encoding to use.</param>
+/// <param name="output">The vector the encoded bytes are appended to.</param>
+/// <remarks>Integers take the smallest encoding which holds them, doubles are written as single precision
+/// floats when that loses nothing.</remarks>
+_ASYNCRTIMP void __cdecl encode_binary(const json::value &value, binary_format format, std::vector<unsigned char> &output);
+
+/// <summary>
+/// Encodes a JSON value.
+/// </summary>
+/// <param name="value">The value to encode.</param>
+/// <param name="format">The binary encoding to use.</param>
+/// <returns>The encoded bytes.</returns>
+_ASYNCRTIMP std::vector<unsigned char> __cdecl encode_binary(const json::value &value, binary_format format);
+
+/// <summary>
+/// Decodes a single JSON value, which must take up all of the given bytes.
+/// </summary>
+/// <param name="data">The encoded bytes.</param>
+/// <param name="size">The number of encoded bytes.</param>
+/// <param name="format">The binary encoding of the bytes.</param>
+/// <returns>The decoded value.</returns>
+/// <remarks>Malformed input, and items without a JSON counterpart like byte strings or map keys other than
+/// strings, throw a json_exception. CBOR tags are ignored.</remarks>
+_ASYNCRTIMP json::value __cdecl decode_binary(const unsigned char *data, size_t size, binary_format format);
+
+/// <summary>
+/// Decodes a single JSON value, which must take up all of the given bytes.
+/// </summary>
+/// <param name="data">The encoded bytes.</param>
+/// <param name="format">The binary encoding of the bytes.</param>
+/// <returns>The decoded value.</returns>
+_ASYNCRTIMP json::value __cdecl decode_binary(const std::vector<unsigned char> &data, binary_format format);
+
+/// <summary>
+/// Encodes a JSON value into a stream buffer.
+/// </summary>
+/// <param name="value">The value to encode.</param>
+/// <param name="format">The binary encoding to use.</param>
+/// <param name="target">The stream buffer to write the encoded bytes to.</param>
+/// <returns>A task which completes once all bytes have been written.</returns>
+_ASYNCRTIMP pplx::task<void> __cdecl write_binary(const json::value &value, binary_format format, concurrency::streams::streambuf<uint8_t> target);
+
+/// <summary>
+/// Decodes a JSON value from the rest of a stream buffer.
+/// </summary>
+/// <param name="source">The stream buffer holding the encoded value, which is read to its end.</param>
+/// <param name="format">The binary encoding of the bytes.</param>
+/// <returns>A task yielding the decoded value.</returns>
+_ASYNCRTIMP pplx::task<json::value> __cdecl read_binary(concurrency::streams::streambuf<uint8_t> source, binary_format format);
+
+/// <summary>
+/// Gets the media type of a binary encoding, for the 'Content-Type' header.
+/// </summary>
+_ASYNCRTIMP const utility::string_t & __cdecl binary_content_type(binary_format format);
+
+/// <summary>
+/// Finds the binary encoding a media type stands for.
+/// </summary>
+/// <param name="content_type">The media type, without parameters.</param>
+/// <param name="format">Set to the encoding when one is found.</param>
+/// <returns><c>true</c> if the media type is 'application/cbor', 'application/msgpack' or 'application/x-msgpack'.</returns>
+_ASYNCRTIMP bool __cdecl binary_format_of(const utility::string_t &content_type, binary_format &format);
+
+}} // namespace web::json
+
+#endif
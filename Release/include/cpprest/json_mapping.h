@@ -0,0 +1,432 @@
+/***
+* ==++==
+*
+* Copyright (c) Microsoft Corporation. All rights reserved.
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* ==--==
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: Mapping between C++ types and JSON documents without an intermediate json::value.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+#pragma once
+
+#ifndef _CASA_JSON_MAPPING_H
+#define _CASA_JSON_MAPPING_H
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "cpprest/json.h"
+#include "cpprest/json_reader.h"
+
+namespace web
+{
+namespace json
+{
+namespace details
+{
+    class json_mapping_reader_impl;
+
+    /// <summary>
+    /// Pull reader over a complete UTF-8 encoded JSON document held in memory, used by parse_fields().
+    /// </summary>
+    class json_mapping_reader
+    {
+    public:
+        _ASYNCRTIMP json_mapping_reader(const char *begin, const char *end);
+        _ASYNCRTIMP ~json_mapping_reader();
+
+        /// <summary>
+        /// Advances to the next token, returns <c>false</c> once the document has ended.
+        /// </summary>
+        _ASYNCRTIMP bool read();
+
+        _ASYNCRTIMP json_token token() const;
+
+        /// <summary>
+        /// Checks that the reader is at the given token, throws a json_exception otherwise.
+        /// </summary>
+        _ASYNCRTIMP void expect(json_token token) const;
+
+        /// <summary>
+        /// Checks whether the reader is at a property with the given name.
+        /// </summary>
+        _ASYNCRTIMP bool name_is(const char *name) const;
+
+        /// <summary>
+        /// Skips the complete value the reader is at, or the value of the property it is at.
+        /// </summary>
+        _ASYNCRTIMP void skip();
+
+        /// <summary>
+        /// Reads the complete value the reader is at into a json::value.
+        /// </summary>
+        _ASYNCRTIMP json::value read_value();
+
+        _ASYNCRTIMP const utility::string_t & string_value() const;
+        _ASYNCRTIMP bool bool_value() const;
+        _ASYNCRTIMP int64_t int64_value() const;
+        _ASYNCRTIMP uint64_t uint64_value() const;
+        _ASYNCRTIMP double double_value() const;
+
+    private:
+        json_mapping_reader(const json_mapping_reader &);
+        json_mapping_reader & operator=(const json_mapping_reader &);
+
+        std::unique_ptr<json_mapping_reader_impl> m_impl;
+    };
+
+    /// <summary>
+    /// Appends JSON text to a UTF-8 string, used by serialize_fields().
+    /// </summary>
+    class json_mapping_writer
+    {
+    public:
+        explicit json_mapping_writer(std::string &out) : m_out(out) { }
+
+        void put(char ch) { m_out.push_back(ch); }
+
+        /// <summary>
+        /// Writes a property name followed by the colon.
+        /// </summary>
+        _ASYNCRTIMP void write_name(const char *name);
+
+        _ASYNCRTIMP void write_string(const utility::string_t &value);
+#ifdef _UTF16_STRINGS
+        _ASYNCRTIMP void write_string(const std::string &utf8);
+#endif
+        void write_bool(bool value) { m_out.append(value ? "true" : "false"); }
+        _ASYNCRTIMP void write_number(int64_t value);
+        _ASYNCRTIMP void write_number(uint64_t value);
+        _ASYNCRTIMP void write_number(double value);
+        _ASYNCRTIMP void write_value(const json::value &value);
+
+    private:
+        json_mapping_writer & operator=(const json_mapping_writer &);
+
+        std::string &m_out;
+    };
+}
+
+/// <summary>
+/// Lists the fields of a type mapped to the members of a JSON object.
+/// </summary>
+/// <remarks>
+/// By default the type's own member function template <c>json_fields</c> is called, which names each field in turn:
+/// <code>
+/// struct point
+/// {
+///     int x, y;
+///     template &lt;typename Fields&gt; void json_fields(Fields &amp;fields) { fields("x", x)("y", y); }
+/// };
+/// </code>
+/// Specialize this template to map a type which cannot be changed.
+/// </remarks>
+template <typename T>
+struct field_mapping
+{
+    template <typename Fields>
+    static void fields(Fields &fields, T &object)
+    {
+        object.json_fields(fields);
+    }
+};
+
+/// <summary>
+/// Writes and reads values of one type, the primary template maps types with a field_mapping to JSON objects.
+/// </summary>
+/// <remarks>
+/// <c>read</c> is called with the reader at the first token of the value and leaves it at the value's last token.
+/// Specialize this template to give a type another representation.
+/// </remarks>
+template <typename T, typename Enable = void>
+struct field_codec;
+
+namespace details
+{
+    template <typename T>
+    void write_field(json_mapping_writer &writer, const T &value)
+    {
+        field_codec<T>::write(writer, value);
+    }
+
+    // A null leaves the field unchanged, apart from json::value fields which can hold it.
+    template <typename T>
+    void read_field(json_mapping_reader &reader, T &value)
+    {
+        if (reader.token() != json_token::null)
+        {
+            field_codec<T>::read(reader, value);
+        }
+    }
+
+    inline void read_field(json_mapping_reader &reader, json::value &value)
+    {
+        value = reader.read_value();
+    }
+
+    class field_writer
+    {
+    public:
+        explicit field_writer(json_mapping_writer &writer) : m_writer(writer), m_first(true) { }
+
+        template <typename T>
+        field_writer & operator()(const char *name, const T &field)
+        {
+            if (!m_first)
+            {
+                m_writer.put(',');
+            }
+            m_first = false;
+            m_writer.write_name(name);
+            write_field(m_writer, field);
+            return *this;
+        }
+
+    private:
+        field_writer & operator=(const field_writer &);
+
+        json_mapping_writer &m_writer;
+        bool m_first;
+    };
+
+    // Reads the value of the property the reader is at into the field with its name, if there is one.
+    class field_reader
+    {
+    public:
+        explicit field_reader(json_mapping_reader &reader) : m_reader(reader), m_matched(false) { }
+
+        template <typename T>
+        field_reader & operator()(const char *name, T &field)
+        {
+            if (!m_matched && m_reader.name_is(name))
+            {
+                m_matched = true;
+                m_reader.read();
+                read_field(m_reader, field);
+            }
+            return *this;
+        }
+
+        void reset() { m_matched = false; }
+
+        bool matched() const { return m_matched; }
+
+    private:
+        field_reader & operator=(const field_reader &);
+
+        json_mapping_reader &m_reader;
+        bool m_matched;
+    };
+}
+
+template <typename T, typename Enable>
+struct field_codec
+{
+    static void write(details::json_mapping_writer &writer, const T &value)
+    {
+        writer.put('{');
+        details::field_writer fields(writer);
+        // The fields are only read, one listing serves both directions.
+        field_mapping<T>::fields(fields, const_cast<T &>(value));
+        writer.put('}');
+    }
+
+    static void read(details::json_mapping_reader &reader, T &value)
+    {
+        reader.expect(json_token::start_object);
+        details::field_reader fields(reader);
+        while (reader.read() && reader.token() == json_token::property_name)
+        {
+            fields.reset();
+            field_mapping<T>::fields(fields, value);
+            if (!fields.matched())
+            {
+                reader.skip();
+            }
+        }
+    }
+};
+
+template <>
+struct field_codec<bool>
+{
+    static void write(details::json_mapping_writer &writer, bool value) { writer.write_bool(value); }
+    static void read(details::json_mapping_reader &reader, bool &value) { value = reader.bool_value(); }
+};
+
+template <typename T>
+struct field_codec<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type>
+{
+    static void write(details::json_mapping_writer &writer, T value) { writer.write_number(static_cast<int64_t>(value)); }
+    static void read(details::json_mapping_reader &reader, T &value)
+    {
+        const int64_t number = reader.int64_value();
+        if (number < (std::numeric_limits<T>::min)() || number > (std::numeric_limits<T>::max)())
+        {
+            throw json_exception(_XPLATSTR("number out of range"));
+        }
+        value = static_cast<T>(number);
+    }
+};
+
+template <typename T>
+struct field_codec<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>::type>
+{
+    static void write(details::json_mapping_writer &writer, T value) { writer.write_number(static_cast<uint64_t>(value)); }
+    static void read(details::json_mapping_reader &reader, T &value)
+    {
+        const uint64_t number = reader.uint64_value();
+        if (number > (std::numeric_limits<T>::max)())
+        {
+            throw json_exception(_XPLATSTR("number out of range"));
+        }
+        value = static_cast<T>(number);
+    }
+};
+
+template <typename T>
+struct field_codec<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static void write(details::json_mapping_writer &writer, T value) { writer.write_number(static_cast<double>(value)); }
+    static void read(details::json_mapping_reader &reader, T &value) { value = static_cast<T>(reader.double_value()); }
+};
+
+template <>
+struct field_codec<utility::string_t>
+{
+    static void write(details::json_mapping_writer &writer, const utility::string_t &value) { writer.write_string(value); }
+    static void read(details::json_mapping_reader &reader, utility::string_t &value) { value = reader.string_value(); }
+};
+
+#ifdef _UTF16_STRINGS
+template <>
+struct field_codec<std::string>
+{
+    static void write(details::json_mapping_writer &writer, const std::string &value) { writer.write_string(value); }
+    static void read(details::json_mapping_reader &reader, std::string &value) { value = utility::conversions::to_utf8string(reader.string_value()); }
+};
+#endif
+
+template <>
+struct field_codec<json::value>
+{
+    static void write(details::json_mapping_writer &writer, const json::value &value) { writer.write_value(value); }
+    static void read(details::json_mapping_reader &reader, json::value &value) { value = reader.read_value(); }
+};
+
+template <typename T, typename Allocator>
+struct field_codec<std::vector<T, Allocator>>
+{
+    static void write(details::json_mapping_writer &writer, const std::vector<T, Allocator> &value)
+    {
+        writer.put('[');
+        for (auto iter = value.begin(); iter != value.end(); ++iter)
+        {
+            if (iter != value.begin())
+            {
+                writer.put(',');
+            }
+            details::write_field(writer, *iter);
+        }
+        writer.put(']');
+    }
+
+    static void read(details::json_mapping_reader &reader, std::vector<T, Allocator> &value)
+    {
+        reader.expect(json_token::start_array);
+        value.clear();
+        while (reader.read() && reader.token() != json_token::end_array)
+        {
+            value.emplace_back();
+            details::read_field(reader, value.back());
+        }
+    }
+};
+
+/// <summary>
+/// Serializes a value with a field_mapping, or any other value with a field_codec, directly to JSON text.
+/// </summary>
+/// <param name="value">The value to serialize.</param>
+/// <param name="utf8">The string the UTF-8 encoded JSON text is appended to.</param>
+template <typename T>
+void serialize_fields(const T &value, std::string &utf8)
+{
+    details::json_mapping_writer writer(utf8);
+    details::write_field(writer, value);
+}
+
+/// <summary>
+/// Serializes a value with a field_mapping, or any other value with a field_codec, directly to JSON text.
+/// </summary>
+/// <param name="value">The value to serialize.</param>
+/// <returns>The JSON text.</returns>
+template <typename T>
+utility::string_t serialize_fields(const T &value)
+{
+    std::string utf8;
+    serialize_fields(value, utf8);
+#ifdef _UTF16_STRINGS
+    return utility::conversions::to_string_t(utf8);
+#else
+    return utf8;
+#endif
+}
+
+/// <summary>
+/// Parses UTF-8 encoded JSON text directly into a value with a field_mapping, or any other value with a field_codec.
+/// </summary>
+/// <param name="data">The JSON text, which need not be null terminated.</param>
+/// <param name="size">The number of bytes of JSON text.</param>
+/// <param name="value">The value to fill in.</param>
+/// <remarks>Properties without a field are skipped and null values leave their field unchanged.
+/// A value of the wrong type, like malformed text, throws a json_exception.</remarks>
+template <typename T>
+void parse_fields(const char *data, size_t size, T &value)
+{
+    details::json_mapping_reader reader(data, data + size);
+    reader.read();
+    details::read_field(reader, value);
+
+    // Fails unless the document ends after the value.
+    reader.read();
+}
+
+/// <summary>
+/// Parses JSON text directly into a value with a field_mapping, or any other value with a field_codec.
+/// </summary>
+/// <param name="json">The JSON text.</param>
+/// <param name="value">The value to fill in.</param>
+/// <remarks>Properties without a field are skipped and null values leave their field unchanged.
+/// A value of the wrong type, like malformed text, throws a json_exception.</remarks>
+template <typename T>
+void parse_fields(const utility::string_t &json, T &value)
+{
+#ifdef _UTF16_STRINGS
+    const std::string utf8 = utility::conversions::to_utf8string(json);
+#else
+    const std::string &utf8 = json;
+#endif
+    parse_fields(utf8.data(), utf8.size(), value);
+}
+
+}} // namespace web::json
+
+#endif
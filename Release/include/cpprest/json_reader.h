@@ -0,0 +1,146 @@
+/***
+* ==++==
+*
+* Copyright (c) Microsoft Corporation. All rights reserved.
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* ==--==
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: Incremental JSON reader over asynchronous streams.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+#pragma once
+
+#ifndef _CASA_JSON_READER_H
+#define _CASA_JSON_READER_H
+
+#include <memory>
+
+#include "pplx/pplxtasks.h"
+#include "cpprest/json.h"
+#include "cpprest/streams.h"
+
+namespace web
+{
+namespace json
+{
+
+/// <summary>
+/// The kinds of tokens a json_reader stops at.
+/// </summary>
+enum class json_token
+{
+    /// No token has been read yet, or the document has ended.
+    none,
+    start_object,
+    end_object,
+    start_array,
+    end_array,
+    /// The name of the next field of an object, see json_reader::string_value().
+    property_name,
+    /// A string value, see json_reader::string_value().
+    string,
+    /// A numeric value, see json_reader::number_value().
+    number,
+    /// A boolean value, see json_reader::bool_value().
+    boolean,
+    null
+};
+
+namespace details
+{
+    class json_reader_impl;
+}
+
+/// <summary>
+/// Pull-style reader that walks through a UTF-8 encoded JSON document one token at a time while it arrives
+/// on an asynchronous stream, e.g. the body of an http_response, without building a json::value for all of it.
+/// </summary>
+/// <remarks>
+/// Only the input needed for the current token is buffered, so memory use does not grow with the size of the document.
+/// The document is validated as it is read: malformed input makes the pending operation fail with a json_exception.
+/// Only one operation may be outstanding at a time, and the reader must stay alive until it completes.
+/// </remarks>
+class json_reader
+{
+public:
+
+    /// <summary>
+    /// Creates a reader consuming the given stream buffer.
+    /// </summary>
+    /// <param name="buffer">The stream buffer to read the document from.</param>
+    /// <param name="chunk_size">The number of bytes requested from the stream buffer whenever more input is needed.</param>
+    _ASYNCRTIMP json_reader(concurrency::streams::streambuf<uint8_t> buffer, size_t chunk_size = 64 * 1024);
+
+    /// <summary>
+    /// Creates a reader consuming the given input stream.
+    /// </summary>
+    /// <param name="stream">The stream to read the document from.</param>
+    /// <param name="chunk_size">The number of bytes requested from the stream whenever more input is needed.</param>
+    _ASYNCRTIMP json_reader(concurrency::streams::istream stream, size_t chunk_size = 64 * 1024);
+
+    /// <summary>
+    /// Advances to the next token of the document.
+    /// </summary>
+    /// <returns>A task yielding <c>true</c> if the reader moved to a token, <c>false</c> once the document has ended.</returns>
+    _ASYNCRTIMP pplx::task<bool> read();
+
+    /// <summary>
+    /// Reads the complete value the reader is at into a json::value, leaving the reader at its last token.
+    /// </summary>
+    /// <returns>A task yielding the value.</returns>
+    /// <remarks>When positioned at a property name, the value of the property is read.
+    /// Before the first call to read(), the whole document is read.</remarks>
+    _ASYNCRTIMP pplx::task<json::value> read_value();
+
+    /// <summary>
+    /// Skips the complete value the reader is at, leaving the reader at its last token.
+    /// </summary>
+    /// <remarks>When positioned at a property name, the value of the property is skipped.</remarks>
+    _ASYNCRTIMP pplx::task<void> skip();
+
+    /// <summary>
+    /// Gets the token the reader is at.
+    /// </summary>
+    _ASYNCRTIMP json_token token() const;
+
+    /// <summary>
+    /// Gets the number of objects and arrays enclosing the current token, including one it starts or ends.
+    /// </summary>
+    _ASYNCRTIMP size_t depth() const;
+
+    /// <summary>
+    /// Gets the text of the current property_name or string token.
+    /// </summary>
+    _ASYNCRTIMP const utility::string_t & string_value() const;
+
+    /// <summary>
+    /// Gets the value of the current number token.
+    /// </summary>
+    _ASYNCRTIMP const json::number & number_value() const;
+
+    /// <summary>
+    /// Gets the value of the current boolean token.
+    /// </summary>
+    _ASYNCRTIMP bool bool_value() const;
+
+private:
+    std::shared_ptr<details::json_reader_impl> m_impl;
+};
+
+}} // namespace web::json
+
+#endif
@@ -0,0 +1,166 @@
+/***
+* ==++==
+*
+* Copyright (c) Microsoft Corporation. All rights reserved.
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* ==--==
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: Incremental JSON writer over asynchronous streams.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+#pragma once
+
+#ifndef _CASA_JSON_WRITER_H
+#define _CASA_JSON_WRITER_H
+
+#include <memory>
+
+#include "pplx/pplxtasks.h"
+#include "cpprest/json.h"
+#include "cpprest/streams.h"
+
+namespace web
+{
+namespace json
+{
+
+namespace details
+{
+    class json_writer_impl;
+}
+
+/// <summary>
+/// Writer that serializes a JSON document as UTF-8 straight to an asynchronous stream, e.g. the body of a chunked
+/// http_response, in chunks of bounded size rather than building the whole document into one string first.
+/// </summary>
+/// <remarks>
+/// The document can be produced token by token, with separators added as needed, and existing json::value
+/// instances can be written into it. Output is collected until a chunk is full and then handed to the stream;
+/// call flush() regularly, or use write_value() for large values, to wait for the stream to catch up.
+/// Tokens which would make the document malformed are rejected with a json_exception.
+/// Only one operation may be outstanding at a time, and the writer must stay alive until it completes.
+/// </remarks>
+class json_writer
+{
+public:
+
+    /// <summary>
+    /// Creates a writer producing into the given stream buffer.
+    /// </summary>
+    /// <param name="buffer">The stream buffer to write the document to.</param>
+    /// <param name="chunk_size">The number of bytes collected before they are written to the stream buffer.</param>
+    _ASYNCRTIMP json_writer(concurrency::streams::streambuf<uint8_t> buffer, size_t chunk_size = 64 * 1024);
+
+    /// <summary>
+    /// Creates a writer producing into the given output stream.
+    /// </summary>
+    /// <param name="stream">The stream to write the document to.</param>
+    /// <param name="chunk_size">The number of bytes collected before they are written to the stream.</param>
+    _ASYNCRTIMP json_writer(concurrency::streams::ostream stream, size_t chunk_size = 64 * 1024);
+
+    /// <summary>
+    /// Starts an object.
+    /// </summary>
+    _ASYNCRTIMP void write_start_object();
+
+    /// <summary>
+    /// Ends the innermost object.
+    /// </summary>
+    _ASYNCRTIMP void write_end_object();
+
+    /// <summary>
+    /// Starts an array.
+    /// </summary>
+    _ASYNCRTIMP void write_start_array();
+
+    /// <summary>
+    /// Ends the innermost array.
+    /// </summary>
+    _ASYNCRTIMP void write_end_array();
+
+    /// <summary>
+    /// Writes the name of the next field of the innermost object; its value must be written next.
+    /// </summary>
+    /// <param name="name">The name of the field.</param>
+    _ASYNCRTIMP void write_property_name(const utility::string_t &name);
+
+    /// <summary>
+    /// Writes a string value.
+    /// </summary>
+    _ASYNCRTIMP void write_string(const utility::string_t &value);
+
+    /// <summary>
+    /// Writes a numeric value.
+    /// </summary>
+    _ASYNCRTIMP void write_number(double value);
+
+    /// <summary>
+    /// Writes a numeric value.
+    /// </summary>
+    _ASYNCRTIMP void write_number(int32_t value);
+
+    /// <summary>
+    /// Writes a numeric value.
+    /// </summary>
+    _ASYNCRTIMP void write_number(uint32_t value);
+
+    /// <summary>
+    /// Writes a numeric value.
+    /// </summary>
+    _ASYNCRTIMP void write_number(int64_t value);
+
+    /// <summary>
+    /// Writes a numeric value.
+    /// </summary>
+    _ASYNCRTIMP void write_number(uint64_t value);
+
+    /// <summary>
+    /// Writes a boolean value.
+    /// </summary>
+    _ASYNCRTIMP void write_boolean(bool value);
+
+    /// <summary>
+    /// Writes a null value.
+    /// </summary>
+    _ASYNCRTIMP void write_null();
+
+    /// <summary>
+    /// Writes a complete value, waiting for the stream after every chunk so that large values are
+    /// streamed without serializing them as a whole.
+    /// </summary>
+    /// <param name="value">The value to write, which must stay alive and unchanged until the task completes.</param>
+    /// <returns>A task that completes once the value has been serialized and all full chunks have been written to the stream.</returns>
+    _ASYNCRTIMP pplx::task<void> write_value(const json::value &value);
+
+    /// <summary>
+    /// Writes out everything collected so far.
+    /// </summary>
+    /// <returns>A task that completes once all output has been written to the stream.</returns>
+    _ASYNCRTIMP pplx::task<void> flush();
+
+    /// <summary>
+    /// Checks whether a complete document has been written.
+    /// </summary>
+    _ASYNCRTIMP bool is_complete() const;
+
+private:
+    std::shared_ptr<details::json_writer_impl> m_impl;
+};
+
+}} // namespace web::json
+
+#endif
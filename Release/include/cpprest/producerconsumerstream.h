@@ -32,6 +32,7 @@
 #include <queue>
 #include <algorithm>
 #include <iterator>
+#include <atomic>
 
 #include "pplx/pplxtasks.h"
 #include "cpprest/astreambuf.h"
@@ -56,9 +57,11 @@ namespace Concurrency { namespace streams {
             /// <summary>
             /// Constructor
             /// </summary>
-            basic_producer_consumer_buffer(size_t alloc_size)
+            basic_producer_consumer_buffer(size_t alloc_size, size_t high_water_mark = 0, size_t low_water_mark = 0)
                 : streambuf_state_manager<_CharType>(std::ios_base::out | std::ios_base::in),
                 m_alloc_size(alloc_size),
+                m_high_water(high_water_mark),
+                m_low_water(low_water_mark),
                 m_allocBlock(nullptr),
                 m_total(0), m_total_read(0), m_total_written(0),
                 m_synced(0)
@@ -152,7 +155,10 @@ namespace Concurrency { namespace streams {
             /// <returns>A pointer to a block to write to, null if the stream buffer implementation does not support alloc/commit.</returns>
             virtual _CharType* _alloc(size_t count)
             {
-                if (!this->can_write())
+                pplx::extensibility::scoped_critical_section_t l(m_lock);
+
+                // Above the high-water mark callers have to fall back to putn(), which waits for the reader.
+                if (!this->can_write() || (m_high_water > 0 && in_avail() >= m_high_water))
                 {
                     return nullptr;
                 }
@@ -162,7 +168,7 @@ namespace Concurrency { namespace streams {
                 // easier book keeping
 
                 _ASSERTE(!m_allocBlock);
-                m_allocBlock = std::make_shared<_block>(count);
+                m_allocBlock = new_block(count);
                 return m_allocBlock->wbegin();
             }
 
@@ -174,9 +180,10 @@ namespace Concurrency { namespace streams {
             {
                 pplx::extensibility::scoped_critical_section_t l(m_lock);
 
-                // The count does not reflect the actual size of the block.
-                // Since we do not allow any more writes to this block it would suffice.
-                // If we ever change the algorithm to reuse blocks then this needs to be revisited.
+                // The block may be larger than count, a recycled block is always m_alloc_size long.
+                // Its write head is moved to exactly count so readers only see committed characters,
+                // and once it is the last block the next write() appends into the space left after it.
+                // This holds because new_block() resets a recycled block's read and write heads.
 
                 _ASSERTE((bool)m_allocBlock);
                 m_allocBlock->update_write_head(count);
@@ -260,12 +267,29 @@ namespace Concurrency { namespace streams {
 
             virtual pplx::task<int_type> _putc(_CharType ch)
             {
-                return pplx::task_from_result((this->write(&ch, 1) == 1) ? static_cast<int_type>(ch) : traits::eof());
+                if (this->write(&ch, 1) != 1)
+                {
+                    return pplx::task_from_result(traits::eof());
+                }
+
+                auto wait = drained();
+                if (wait.is_done())
+                {
+                    return pplx::task_from_result(static_cast<int_type>(ch));
+                }
+                return wait.then([ch] { return static_cast<int_type>(ch); });
             }
 
             virtual pplx::task<size_t> _putn(const _CharType *ptr, size_t count)
             {
-                return pplx::task_from_result<size_t>(this->write(ptr, count));
+                const size_t written = this->write(ptr, count);
+
+                auto wait = drained();
+                if (wait.is_done())
+                {
+                    return pplx::task_from_result<size_t>(written);
+                }
+                return wait.then([written] { return written; });
             }
 
 
@@ -363,6 +387,59 @@ namespace Concurrency { namespace streams {
                 return pplx::task_from_result();
             }
 
+            /// <summary>
+            /// Close the stream buffer for reading
+            /// </summary>
+            pplx::task<void> _close_read()
+            {
+                this->m_stream_can_read = false;
+
+                {
+                    pplx::extensibility::scoped_critical_section_t l(this->m_lock);
+
+                    // No one is left to drain the buffer.
+                    this->release_writers();
+                }
+
+                return pplx::task_from_result();
+            }
+
+            /// <summary>
+            /// Gets a task which completes once the reader has drained the buffer to the low-water mark, when a write
+            /// took it to the high-water mark. Otherwise the task has already completed.
+            /// </summary>
+            pplx::task<void> drained()
+            {
+                if (m_high_water == 0)
+                {
+                    return pplx::task_from_result();
+                }
+
+                pplx::extensibility::scoped_critical_section_t l(m_lock);
+
+                if (m_total < m_high_water || !this->can_read())
+                {
+                    return pplx::task_from_result();
+                }
+
+                pplx::task_completion_event<void> tce;
+                m_blocked_writes.push_back(tce);
+                return pplx::create_task(tce);
+            }
+
+            /// <summary>
+            /// Completes the writes waiting for the reader.
+            /// </summary>
+            /// <remarks>This should be called with the lock held</remarks>
+            void release_writers()
+            {
+                for (auto &tce : m_blocked_writes)
+                {
+                    tce.set();
+                }
+                m_blocked_writes.clear();
+            }
+
             /// <summary>
             /// Updates the write head by an offset specified by count
             /// </summary>
@@ -390,8 +467,7 @@ namespace Concurrency { namespace streams {
                 // Allocate a new block if necessary
                 if ( m_blocks.empty() || m_blocks.back()->wr_chars_left() < count )
                 {
-                    msl::safeint3::SafeInt<size_t> alloc = m_alloc_size.Max(count);
-                    m_blocks.push_back(std::make_shared<_block>(alloc));
+                    m_blocks.push_back(new_block(count));
                 }
 
                 // The block at the back is always the write head
@@ -523,6 +599,25 @@ namespace Concurrency { namespace streams {
                 _block& operator=(const _block&);
             };
 
+            /// <summary>
+            /// Gets an empty block for at least count characters, reusing one that has been read when possible.
+            /// </summary>
+            /// <remarks>This should be called with the lock held</remarks>
+            std::shared_ptr<_block> new_block(size_t count)
+            {
+                if (count <= m_alloc_size && !m_free_blocks.empty())
+                {
+                    auto block = m_free_blocks.back();
+                    m_free_blocks.pop_back();
+                    block->m_read = 0;
+                    block->m_pos = 0;
+                    return block;
+                }
+
+                msl::safeint3::SafeInt<size_t> alloc = m_alloc_size.Max(count);
+                return std::make_shared<_block>(alloc);
+            }
+
             /// <summary>
             /// Represents a request on the stream buffer - typically reads
             /// </summary>
@@ -638,9 +733,18 @@ namespace Concurrency { namespace streams {
                     // If front block is not empty - we are done
                     if (m_blocks.front()->rd_chars_left() > 0) break;
 
-                    // The block has no more data to be read. Relase the block
+                    // The block has no more data to be read. Keep a few blocks of the usual size for the writer to reuse.
+                    if (m_blocks.front()->m_size == static_cast<size_t>(m_alloc_size) && m_free_blocks.size() < 16)
+                    {
+                        m_free_blocks.push_back(m_blocks.front());
+                    }
                     m_blocks.pop_front();
                 }
+
+                if (!m_blocked_writes.empty() && m_total <= m_low_water)
+                {
+                    release_writers();
+                }
             }
 
             // The in/out mode for the buffer
@@ -649,6 +753,11 @@ namespace Concurrency { namespace streams {
             // Default block size
             msl::safeint3::SafeInt<size_t> m_alloc_size;
 
+            // Writes taking the buffer to the high-water mark complete once the reader drains it to the low-water mark,
+            // a high-water mark of 0 leaves the buffer unbounded.
+            size_t m_high_water;
+            size_t m_low_water;
+
             // Block used for alloc/commit
             std::shared_ptr<_block> m_allocBlock;
 
@@ -673,33 +782,811 @@ namespace Concurrency { namespace streams {
             // Memory blocks
             std::deque<std::shared_ptr<_block>> m_blocks;
 
+            // Blocks which have been read, ready to be written again
+            std::vector<std::shared_ptr<_block>> m_free_blocks;
+
             // Queue of requests
             std::queue<_request> m_requests;
-        };
-
-    } // namespace details
 
-    /// <summary>
-    /// The producer_consumer_buffer class serves as a memory-based steam buffer that supports both writing and reading
-    /// sequences of bytes. It can be used as a consumer/producer buffer.
-    /// </summary>
-    /// <typeparam name="_CharType">
-    /// The data type of the basic element of the <c>producer_consumer_buffer</c>.
-    /// </typeparam>
-    /// <remarks>
-    /// This is a reference-counted version of basic_producer_consumer_buffer.</remarks>
-    template<typename _CharType>
-    class producer_consumer_buffer : public streambuf<_CharType>
-    {
-    public:
-        typedef _CharType char_type;
+            // Writes waiting for the reader to drain the buffer
+            std::vector<pplx::task_completion_event<void>> m_blocked_writes;
+        };
 
         /// <summary>
-        /// Create a producer_consumer_buffer.
+        /// The basic_spsc_producer_consumer_buffer class is a memory-based stream buffer for exactly one writer and one reader.
+        /// Blocks are handed from the writer to the reader without taking a lock, and the blocks the reader is done with
+        /// go back to the writer to be filled again.
         /// </summary>
-        /// <param name="alloc_size">The internal default block size.</param>
-        producer_consumer_buffer(size_t alloc_size = 512)
-            : streambuf<_CharType>(std::make_shared<details::basic_producer_consumer_buffer<_CharType>>(alloc_size))
+        /// <remarks>Either side may move between threads, but must not start an operation before its previous one has completed.
+        /// Only reads which have to wait for data take a lock.</remarks>
+        template<typename _CharType>
+        class basic_spsc_producer_consumer_buffer : public streams::details::streambuf_state_manager<_CharType>
+        {
+        public:
+            typedef typename ::concurrency::streams::char_traits<_CharType> traits;
+            typedef typename basic_streambuf<_CharType>::int_type int_type;
+            typedef typename basic_streambuf<_CharType>::pos_type pos_type;
+            typedef typename basic_streambuf<_CharType>::off_type off_type;
+
+            /// <summary>
+            /// Constructor
+            /// </summary>
+            basic_spsc_producer_consumer_buffer(size_t alloc_size, size_t high_water_mark = 0, size_t low_water_mark = 0)
+                : streambuf_state_manager<_CharType>(std::ios_base::out | std::ios_base::in),
+                m_alloc_size(alloc_size == 0 ? 1 : alloc_size),
+                m_high_water(high_water_mark),
+                m_low_water(low_water_mark),
+                m_allocBlock(nullptr),
+                m_spare(nullptr),
+                m_returned(nullptr),
+                m_total_read(0), m_total_written(0),
+                m_synced_to(0),
+                m_write_closed(false),
+                m_waiting(false),
+                m_writer_waiting(false)
+            {
+                m_head = m_tail = new _block(m_alloc_size);
+            }
+
+            /// <summary>
+            /// Destructor
+            /// </summary>
+            virtual ~basic_spsc_producer_consumer_buffer()
+            {
+                this->_close_read();
+                this->_close_write();
+
+                _ASSERTE(m_requests.empty());
+                delete_blocks(m_head);
+                delete_blocks(m_spare);
+                delete_blocks(m_returned.load());
+            }
+
+            /// <summary>
+            /// <c>can_seek<c/> is used to determine whether a stream buffer supports seeking.
+            /// </summary>
+            virtual bool can_seek() const { return false; }
+
+            /// <summary>
+            /// <c>has_size<c/> is used to determine whether a stream buffer supports size().
+            /// </summary>
+            virtual bool has_size() const { return false; }
+
+            /// <summary>
+            /// Get the stream buffer size, if one has been set.
+            /// </summary>
+            /// <param name="direction">The direction of buffering (in or out)</param>
+            /// <remarks>An implementation that does not support buffering will always return '0'.</remarks>
+            virtual size_t buffer_size(std::ios_base::openmode = std::ios_base::in) const
+            {
+                return 0;
+            }
+
+            /// <summary>
+            /// Sets the stream buffer implementation to buffer or not buffer.
+            /// </summary>
+            /// <param name="size">The size to use for internal buffering, 0 if no buffering should be done.</param>
+            /// <param name="direction">The direction of buffering (in or out)</param>
+            /// <remarks>An implementation that does not support buffering will silently ignore calls to this function and it will not have any effect on what is returned by subsequent calls to <see cref="::buffer_size method" />.</remarks>
+            virtual void set_buffer_size(size_t , std::ios_base::openmode = std::ios_base::in)
+            {
+                return;
+            }
+
+            /// <summary>
+            /// For any input stream, <c>in_avail</c> returns the number of characters that are immediately available
+            /// to be consumed without blocking. May be used in conjunction with <cref="::sbumpc method"/> to read data without
+            /// incurring the overhead of using tasks.
+            /// </summary>
+            virtual size_t in_avail() const { return m_total_written.load() - m_total_read.load(); }
+
+            /// <summary>
+            /// Gets the current read or write position in the stream.
+            /// </summary>
+            /// <param name="direction">The I/O direction to seek (see remarks)</param>
+            /// <returns>The current position. EOF if the operation fails.</returns>
+            /// <remarks>Some streams may have separate write and read cursors.
+            ///          For such streams, the direction parameter defines whether to move the read or the write cursor.</remarks>
+            virtual pos_type getpos(std::ios_base::openmode mode) const
+            {
+                if ( ((mode & std::ios_base::in) && !this->can_read()) ||
+                     ((mode & std::ios_base::out) && !this->can_write()))
+                     return static_cast<pos_type>(traits::eof());
+
+                if (mode == std::ios_base::in)
+                    return (pos_type)m_total_read.load();
+                else if (mode == std::ios_base::out)
+                    return (pos_type)m_total_written.load();
+                else
+                    return (pos_type)traits::eof();
+            }
+
+            // Seeking is not supported
+            virtual pos_type seekpos(pos_type, std::ios_base::openmode) { return (pos_type)traits::eof(); }
+            virtual pos_type seekoff(off_type , std::ios_base::seekdir , std::ios_base::openmode ) { return (pos_type)traits::eof(); }
+
+            /// <summary>
+            /// Allocates a contiguous memory block and returns it.
+            /// </summary>
+            /// <param name="count">The number of characters to allocate.</param>
+            /// <returns>A pointer to a block to write to, null if the stream buffer implementation does not support alloc/commit.</returns>
+            virtual _CharType* _alloc(size_t count)
+            {
+                // Above the high-water mark callers have to fall back to putn(), which waits for the reader.
+                if (!this->can_write() || (m_high_water > 0 && in_avail() >= m_high_water))
+                {
+                    return nullptr;
+                }
+
+                // Unlike the locked buffer, the rest of the current block is used when it is large enough.
+                _ASSERTE(m_allocBlock == nullptr);
+                m_allocBlock = reserve(count);
+                return m_allocBlock->wbegin();
+            }
+
+            /// <summary>
+            /// Submits a block already allocated by the stream buffer.
+            /// </summary>
+            /// <param name="count">The number of characters to be committed.</param>
+            virtual void _commit(size_t count)
+            {
+                _ASSERTE(m_allocBlock != nullptr);
+                _ASSERTE(m_allocBlock->wr_chars_left() >= count);
+                m_allocBlock->m_pos.store(m_allocBlock->m_pos.load(std::memory_order_relaxed) + count, std::memory_order_release);
+                m_allocBlock = nullptr;
+
+                update_write_head(count);
+            }
+
+            /// <summary>
+            /// Gets a pointer to the next already allocated contiguous block of data.
+            /// </summary>
+            /// <param name="ptr">A reference to a pointer variable that will hold the address of the block on success.</param>
+            /// <param name="count">The number of contiguous characters available at the address in 'ptr.'</param>
+            /// <returns><c>true</c> if the operation succeeded, <c>false</c> otherwise.</returns>
+            /// <remarks>
+            /// A return of false does not necessarily indicate that a subsequent read operation would fail, only that
+            /// there is no block to return immediately or that the stream buffer does not support the operation.
+            /// The stream buffer may not de-allocate the block until <see cref="::release method" /> is called.
+            /// If the end of the stream is reached, the function will return <c>true</c>, a null pointer, and a count of zero;
+            /// a subsequent read will not succeed.
+            /// </remarks>
+            virtual bool acquire(_Out_ _CharType*& ptr, _Out_ size_t& count)
+            {
+                count = 0;
+                ptr = nullptr;
+
+                if (!this->can_read()) return false;
+
+                // Checked first, so that the data written before closing is seen below.
+                const bool closed = m_write_closed.load();
+
+                auto block = front();
+                count = block->rd_chars_left();
+                if (count == 0)
+                {
+                    // If the write head has been closed then have reached the end of the
+                    // stream (return true), otherwise more data could be written later (return false).
+                    return closed;
+                }
+
+                ptr = block->rbegin();
+                return true;
+            }
+
+            /// <summary>
+            /// Releases a block of data acquired using <see cref="::acquire method"/>. This frees the stream buffer to de-allocate the
+            /// memory, if it so desires. Move the read position ahead by the count.
+            /// </summary>
+            /// <param name="ptr">A pointer to the block of data to be released.</param>
+            /// <param name="count">The number of characters that were read.</param>
+            virtual void release(_Out_writes_opt_ (count) _CharType *ptr, _In_ size_t count)
+            {
+                if (ptr == nullptr) return;
+
+                _ASSERTE(m_head->rd_chars_left() >= count);
+                m_head->m_read += count;
+
+                update_read_head(count);
+            }
+
+        protected:
+
+            virtual pplx::task<bool> _sync()
+            {
+                m_synced_to.store(m_total_written.load());
+
+                wake_reader();
+
+                return pplx::task_from_result(true);
+            }
+
+            virtual pplx::task<int_type> _putc(_CharType ch)
+            {
+                if (this->write(&ch, 1) != 1)
+                {
+                    return pplx::task_from_result(traits::eof());
+                }
+
+                auto wait = drained();
+                if (wait.is_done())
+                {
+                    return pplx::task_from_result(static_cast<int_type>(ch));
+                }
+                return wait.then([ch] { return static_cast<int_type>(ch); });
+            }
+
+            virtual pplx::task<size_t> _putn(const _CharType *ptr, size_t count)
+            {
+                const size_t written = this->write(ptr, count);
+
+                auto wait = drained();
+                if (wait.is_done())
+                {
+                    return pplx::task_from_result<size_t>(written);
+                }
+                return wait.then([written] { return written; });
+            }
+
+            virtual pplx::task<size_t> _getn(_Out_writes_ (count) _CharType *ptr, _In_ size_t count)
+            {
+                pplx::task_completion_event<size_t> tce;
+                enqueue_request(_request(count, [this, ptr, count, tce]()
+                {
+                    tce.set(this->read(ptr, count));
+                }));
+                return pplx::create_task(tce);
+            }
+
+            virtual size_t _sgetn(_Out_writes_ (count) _CharType *ptr, _In_ size_t count)
+            {
+                return can_satisfy(count) ? this->read(ptr, count) : (size_t)traits::requires_async();
+            }
+
+            virtual size_t _scopy(_Out_writes_ (count) _CharType *ptr, _In_ size_t count)
+            {
+                return can_satisfy(count) ? this->read(ptr, count, false) : (size_t)traits::requires_async();
+            }
+
+            virtual pplx::task<int_type> _bumpc()
+            {
+                pplx::task_completion_event<int_type> tce;
+                enqueue_request(_request(1, [this, tce]()
+                {
+                    tce.set(this->read_byte(true));
+                }));
+                return pplx::create_task(tce);
+            }
+
+            virtual int_type _sbumpc()
+            {
+                return can_satisfy(1) ? this->read_byte(true) : traits::requires_async();
+            }
+
+            virtual pplx::task<int_type> _getc()
+            {
+                pplx::task_completion_event<int_type> tce;
+                enqueue_request(_request(1, [this, tce]()
+                {
+                    tce.set(this->read_byte(false));
+                }));
+                return pplx::create_task(tce);
+            }
+
+            int_type _sgetc()
+            {
+                return can_satisfy(1) ? this->read_byte(false) : traits::requires_async();
+            }
+
+            virtual pplx::task<int_type> _nextc()
+            {
+                pplx::task_completion_event<int_type> tce;
+                enqueue_request(_request(1, [this, tce]()
+                {
+                    this->read_byte(true);
+                    tce.set(this->read_byte(false));
+                }));
+                return pplx::create_task(tce);
+            }
+
+            virtual pplx::task<int_type> _ungetc()
+            {
+                return pplx::task_from_result<int_type>(traits::eof());
+            }
+
+        private:
+
+            /// <summary>
+            /// Close the stream buffer for writing
+            /// </summary>
+            pplx::task<void> _close_write()
+            {
+                this->m_stream_can_write = false;
+                m_write_closed.store(true);
+
+                {
+                    pplx::extensibility::scoped_critical_section_t l(m_lock);
+
+                    // This runs on the thread that called close.
+                    fulfill_outstanding();
+                }
+
+                return pplx::task_from_result();
+            }
+
+            /// <summary>
+            /// Close the stream buffer for reading
+            /// </summary>
+            pplx::task<void> _close_read()
+            {
+                this->m_stream_can_read = false;
+
+                // No one is left to drain the buffer.
+                release_writer();
+
+                return pplx::task_from_result();
+            }
+
+            /// <summary>
+            /// Gets a task which completes once the reader has drained the buffer to the low-water mark, when a write
+            /// took it to the high-water mark. Otherwise the task has already completed.
+            /// </summary>
+            /// <remarks>Called by the writer only.</remarks>
+            pplx::task<void> drained()
+            {
+                if (m_high_water == 0 || in_avail() < m_high_water || !this->can_read())
+                {
+                    return pplx::task_from_result();
+                }
+
+                pplx::extensibility::scoped_critical_section_t l(m_drain_lock);
+
+                m_drained = pplx::task_completion_event<void>();
+                m_writer_waiting.store(true);
+
+                // The reader may have drained the buffer before it could see m_writer_waiting.
+                if (in_avail() <= m_low_water || !this->can_read())
+                {
+                    m_writer_waiting.store(false);
+                    return pplx::task_from_result();
+                }
+
+                return pplx::create_task(m_drained);
+            }
+
+            /// <summary>
+            /// Completes the write waiting for the reader, if there is one.
+            /// </summary>
+            void release_writer()
+            {
+                pplx::extensibility::scoped_critical_section_t l(m_drain_lock);
+
+                if (m_writer_waiting.load())
+                {
+                    m_writer_waiting.store(false);
+                    m_drained.set();
+                }
+            }
+
+            /// <summary>
+            /// Represents a memory block. The writer publishes the write head, the read head belongs to the reader.
+            /// </summary>
+            class _block
+            {
+            public:
+                _block(size_t size)
+                    : m_read(0), m_pos(0), m_next(nullptr), m_size(size), m_data(new _CharType[size])
+                {
+                }
+
+                ~_block()
+                {
+                    delete [] m_data;
+                }
+
+                // Read head
+                size_t m_read;
+
+                // Write head
+                std::atomic<size_t> m_pos;
+
+                // The block written after this one, set once the writer is done with this one.
+                // Also links the blocks handed back to the writer.
+                std::atomic<_block *> m_next;
+
+                // Allocation size (of m_data)
+                const size_t m_size;
+
+                // The data store
+                _CharType * m_data;
+
+                _CharType * rbegin() { return m_data + m_read; }
+                _CharType * wbegin() { return m_data + m_pos.load(std::memory_order_relaxed); }
+
+                size_t rd_chars_left() const { return m_pos.load(std::memory_order_acquire) - m_read; }
+                size_t wr_chars_left() const { return m_size - m_pos.load(std::memory_order_relaxed); }
+
+            private:
+
+                // Copy is not supported
+                _block(const _block&);
+                _block& operator=(const _block&);
+            };
+
+            /// <summary>
+            /// Represents a request on the stream buffer - typically reads
+            /// </summary>
+            class _request
+            {
+            public:
+
+                typedef std::function<void()> func_type;
+                _request(size_t count, const func_type& func)
+                    : m_func(func), m_count(count)
+                {
+                }
+
+                void complete()
+                {
+                    m_func();
+                }
+
+                size_t size() const
+                {
+                    return m_count;
+                }
+
+            private:
+
+                func_type m_func;
+                size_t m_count;
+            };
+
+            static void delete_blocks(_block *block)
+            {
+                while (block != nullptr)
+                {
+                    auto next = block->m_next.load();
+                    delete block;
+                    block = next;
+                }
+            }
+
+            /// <summary>
+            /// Gets a block with room for count contiguous characters at the write head.
+            /// </summary>
+            /// <remarks>Called by the writer only.</remarks>
+            _block *reserve(size_t count)
+            {
+                if (m_tail->wr_chars_left() >= count)
+                {
+                    return m_tail;
+                }
+
+                _block *block = nullptr;
+                if (count <= m_alloc_size)
+                {
+                    if (m_spare == nullptr)
+                    {
+                        m_spare = m_returned.exchange(nullptr, std::memory_order_acquire);
+                    }
+                    if (m_spare != nullptr)
+                    {
+                        block = m_spare;
+                        m_spare = block->m_next.load(std::memory_order_relaxed);
+                        block->m_read = 0;
+                        block->m_pos.store(0, std::memory_order_relaxed);
+                        block->m_next.store(nullptr, std::memory_order_relaxed);
+                    }
+                }
+                if (block == nullptr)
+                {
+                    block = new _block((std::max)(count, m_alloc_size));
+                }
+
+                // The writer never touches the old block again, the reader moves on once it has read it all.
+                m_tail->m_next.store(block, std::memory_order_release);
+                m_tail = block;
+                return block;
+            }
+
+            /// <summary>
+            /// Gives a block the reader is done with back to the writer.
+            /// </summary>
+            void recycle(_block *block)
+            {
+                if (block->m_size != m_alloc_size)
+                {
+                    delete block;
+                    return;
+                }
+
+                auto top = m_returned.load(std::memory_order_relaxed);
+                do
+                {
+                    block->m_next.store(top, std::memory_order_relaxed);
+                } while (!m_returned.compare_exchange_weak(top, block, std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            /// <summary>
+            /// Gets the block at the read head, recycling the blocks which have been read completely.
+            /// </summary>
+            _block *front()
+            {
+                for (;;)
+                {
+                    auto block = m_head;
+                    if (block->rd_chars_left() > 0) return block;
+
+                    // Characters written before the next block was linked are seen once the link is.
+                    auto next = block->m_next.load(std::memory_order_acquire);
+                    if (next == nullptr || block->rd_chars_left() > 0) return block;
+
+                    m_head = next;
+                    recycle(block);
+                }
+            }
+
+            /// <summary>
+            /// Writes count characters from ptr into the stream buffer
+            /// </summary>
+            size_t write(const _CharType *ptr, size_t count)
+            {
+                if (!this->can_write() || (count == 0)) return 0;
+
+                // If no one is going to read, why bother?
+                // Just pretend to be writing!
+                if (!this->can_read()) return count;
+
+                // Fill up the current block, then go on in as many blocks as it takes.
+                size_t written = 0;
+                while (written < count)
+                {
+                    auto block = reserve(1);
+                    const size_t chunk = (std::min)(count - written, block->wr_chars_left());
+                    std::memcpy(block->wbegin(), ptr + written, chunk * sizeof(_CharType));
+                    block->m_pos.store(block->m_pos.load(std::memory_order_relaxed) + chunk, std::memory_order_release);
+                    written += chunk;
+                }
+
+                update_write_head(count);
+                return count;
+            }
+
+            /// <summary>
+            /// Publishes count more characters to the reader.
+            /// </summary>
+            void update_write_head(size_t count)
+            {
+                m_total_written.fetch_add(count);
+                wake_reader();
+            }
+
+            /// <summary>
+            /// Fulfills the reads waiting for data, if there are any.
+            /// </summary>
+            /// <remarks>The reader sets m_waiting before it checks the totals a last time, and the writer checks m_waiting
+            /// after updating them, so one of the two always sees the other.</remarks>
+            void wake_reader()
+            {
+                if (m_waiting.load())
+                {
+                    pplx::extensibility::scoped_critical_section_t l(m_lock);
+                    fulfill_outstanding();
+                }
+            }
+
+            /// <summary>
+            /// Fulfill pending requests
+            /// </summary>
+            /// <remarks>This should be called with the lock held</remarks>
+            void fulfill_outstanding()
+            {
+                while ( !m_requests.empty() )
+                {
+                    auto req = m_requests.front();
+
+                    // If we cannot satisfy the request then we need
+                    // to wait for the producer to write data
+                    if (!can_satisfy(req.size())) return;
+
+                    // We have enough data to satisfy this request
+                    req.complete();
+
+                    // Remove it from the request queue
+                    m_requests.pop();
+                }
+
+                m_waiting.store(false);
+            }
+
+            void enqueue_request(_request req)
+            {
+                // Nothing is waiting and the data is there, so there is no one to coordinate with.
+                if (!m_waiting.load() && can_satisfy(req.size()))
+                {
+                    req.complete();
+                    return;
+                }
+
+                pplx::extensibility::scoped_critical_section_t l(m_lock);
+
+                m_requests.push(req);
+                m_waiting.store(true);
+
+                // Data may have come in before the writer could see m_waiting.
+                fulfill_outstanding();
+            }
+
+            /// <summary>
+            /// Determine if the request can be satisfied.
+            /// </summary>
+            bool can_satisfy(size_t count)
+            {
+                return (m_synced_to.load() > m_total_read.load(std::memory_order_relaxed)) || (this->in_avail() >= count) || m_write_closed.load();
+            }
+
+            /// <summary>
+            /// Reads a byte from the stream and returns it as int_type.
+            /// Note: This routine shall only be called if can_satisfy() returned true.
+            /// </summary>
+            int_type read_byte(bool advance = true)
+            {
+                _CharType value;
+                auto read_size = this->read(&value, 1, advance);
+                return read_size == 1 ? static_cast<int_type>(value) : traits::eof();
+            }
+
+            /// <summary>
+            /// Reads up to count characters into ptr and returns the count of characters copied.
+            /// The return value (actual characters copied) could be <= count.
+            /// Note: This routine shall only be called if can_satisfy() returned true.
+            /// </summary>
+            size_t read(_Out_writes_ (count) _CharType *ptr, _In_ size_t count, bool advance = true)
+            {
+                auto block = front();
+                size_t offset = block->m_read;
+                size_t read = 0;
+
+                for (;;)
+                {
+                    const size_t chunk = (std::min)(block->m_pos.load(std::memory_order_acquire) - offset, count - read);
+                    std::memcpy(ptr + read, block->m_data + offset, chunk * sizeof(_CharType));
+                    read += chunk;
+                    offset += chunk;
+                    if (read == count) break;
+
+                    auto next = block->m_next.load(std::memory_order_acquire);
+                    if (next == nullptr) break;
+                    if (block->m_pos.load(std::memory_order_acquire) != offset) continue;
+
+                    if (advance)
+                    {
+                        m_head = next;
+                        recycle(block);
+                    }
+                    block = next;
+                    offset = 0;
+                }
+
+                if (advance)
+                {
+                    block->m_read = offset;
+                    update_read_head(read);
+                }
+
+                return read;
+            }
+
+            /// <summary>
+            /// Updates the read head by the specified offset
+            /// </summary>
+            void update_read_head(size_t count)
+            {
+                m_total_read.store(m_total_read.load(std::memory_order_relaxed) + count);
+
+                if (m_writer_waiting.load() && in_avail() <= m_low_water)
+                {
+                    release_writer();
+                }
+            }
+
+            // Size of the blocks which are recycled
+            const size_t m_alloc_size;
+
+            // Writes taking the buffer to the high-water mark complete once the reader drains it to the low-water mark,
+            // a high-water mark of 0 leaves the buffer unbounded.
+            const size_t m_high_water;
+            const size_t m_low_water;
+
+            // Block used for alloc/commit
+            _block *m_allocBlock;
+
+            // The block the reader reads from, and the block the writer writes to, with the blocks between them linked through m_next.
+            _block *m_head;
+            _block *m_tail;
+
+            // Blocks ready to be written again, taken from m_returned by the writer.
+            _block *m_spare;
+
+            // Blocks the reader has handed back.
+            std::atomic<_block *> m_returned;
+
+            std::atomic<size_t> m_total_read;
+            std::atomic<size_t> m_total_written;
+
+            // The position up to which the writer has flushed, reads of data before it complete with what there is.
+            std::atomic<size_t> m_synced_to;
+
+            // Set after the write head is closed, so that the reader sees all data written before.
+            std::atomic<bool> m_write_closed;
+
+            // Whether reads are queued, taking the lock is only necessary then.
+            std::atomic<bool> m_waiting;
+
+            // Whether a write waits for the reader to drain the buffer, completed through m_drained.
+            std::atomic<bool> m_writer_waiting;
+            pplx::task_completion_event<void> m_drained;
+
+            pplx::extensibility::critical_section_t m_lock;
+
+            // Guards m_drained, separate from m_lock since reads completed under m_lock drain the buffer.
+            pplx::extensibility::critical_section_t m_drain_lock;
+
+            // Queue of requests
+            std::queue<_request> m_requests;
+        };
+
+    } // namespace details
+
+    /// <summary>
+    /// The producer_consumer_buffer class serves as a memory-based steam buffer that supports both writing and reading
+    /// sequences of bytes. It can be used as a consumer/producer buffer.
+    /// </summary>
+    /// <typeparam name="_CharType">
+    /// The data type of the basic element of the <c>producer_consumer_buffer</c>.
+    /// </typeparam>
+    /// <remarks>
+    /// This is a reference-counted version of basic_producer_consumer_buffer.</remarks>
+    template<typename _CharType>
+    class producer_consumer_buffer : public streambuf<_CharType>
+    {
+    public:
+        typedef _CharType char_type;
+
+        /// <summary>
+        /// Create a producer_consumer_buffer.
+        /// </summary>
+        /// <param name="alloc_size">The internal default block size.</param>
+        /// <param name="high_water_mark">The number of unread characters at which writes stop completing until the reader
+        /// has caught up, 0 for an unbounded buffer.</param>
+        /// <param name="low_water_mark">The number of unread characters the reader has to get the buffer down to before
+        /// the waiting writes complete.</param>
+        /// <remarks>Writes are always accepted in full, a bounded buffer holds at most the high-water mark and one write.
+        /// Above the high-water mark alloc() returns null, so that callers use putn() instead.</remarks>
+        producer_consumer_buffer(size_t alloc_size = 512, size_t high_water_mark = 0, size_t low_water_mark = 0)
+            : streambuf<_CharType>(std::make_shared<details::basic_producer_consumer_buffer<_CharType>>(alloc_size, high_water_mark, low_water_mark))
+        {
+        }
+
+        /// <summary>
+        /// Create a producer_consumer_buffer for exactly one writer and one reader, which hands data over without
+        /// taking a lock and reuses the blocks of memory that have been read.
+        /// </summary>
+        /// <param name="alloc_size">The internal block size, larger writes are spread over several blocks.</param>
+        /// <param name="high_water_mark">The number of unread characters at which writes stop completing until the reader
+        /// has caught up, 0 for an unbounded buffer.</param>
+        /// <param name="low_water_mark">The number of unread characters the reader has to get the buffer down to before
+        /// the waiting write completes.</param>
+        /// <remarks>Either side may move between threads, but must not start an operation before its previous one has completed.</remarks>
+        static producer_consumer_buffer single_producer_consumer(size_t alloc_size = 512, size_t high_water_mark = 0, size_t low_water_mark = 0)
+        {
+            return producer_consumer_buffer(std::make_shared<details::basic_spsc_producer_consumer_buffer<_CharType>>(alloc_size, high_water_mark, low_water_mark));
+        }
+
+    private:
+        producer_consumer_buffer(const std::shared_ptr<details::basic_streambuf<_CharType>> &ptr)
+            : streambuf<_CharType>(ptr)
         {
         }
     };
@@ -536,10 +536,9 @@ namespace Concurrency { namespace streams
 
         static pplx::task<T> _parse(streams::streambuf<CharType> buffer, std::true_type, std::false_type)
         {
-            return type_parser<CharType,int64_t>::parse(buffer).then(
-                [] (pplx::task<int64_t> op) -> T
+            return _narrow(type_parser<CharType,int64_t>::parse(buffer),
+                [] (int64_t val) -> T
                 {
-                    int64_t val = op.get();
                     if ( val <= _type_parser_integral_traits<T>::_max && val >= _type_parser_integral_traits<T>::_min )
                         return (T)val;
                     else
@@ -549,16 +548,37 @@ namespace Concurrency { namespace streams
 
         static pplx::task<T> _parse(streams::streambuf<CharType> buffer, std::true_type, std::true_type)
         {
-            return type_parser<CharType,uint64_t>::parse(buffer).then(
-                [] (pplx::task<uint64_t> op) -> T
+            return _narrow(type_parser<CharType,uint64_t>::parse(buffer),
+                [] (uint64_t val) -> T
                 {
-                    uint64_t val = op.get();
                     if ( val <= _type_parser_integral_traits<T>::_max )
                         return (T)val;
                     else
                         throw std::range_error("input out of range for target type");
                 });
         }
+
+        template<typename Wide, typename Convert>
+        static pplx::task<T> _narrow(pplx::task<Wide> op, Convert convert)
+        {
+            // A value that was parsed right away doesn't need a continuation either.
+            if ( op.is_done() )
+            {
+                try
+                {
+                    return pplx::task_from_result<T>(convert(op.get()));
+                }
+                catch (...)
+                {
+                    return pplx::task_from_exception<T>(std::current_exception());
+                }
+            }
+
+            return op.then([convert] (pplx::task<Wide> op) -> T
+                {
+                    return convert(op.get());
+                });
+        }
     };
 
     /// <summary>
@@ -811,8 +831,30 @@ namespace Concurrency { namespace streams
                     return true;
                 };
 
+            // A delimiter no character converts to is never found, everything up to the end is read.
+            const bool delim_is_char = static_cast<int_type>(static_cast<CharType>(delim)) == delim;
+            auto find_delim = [=](const CharType *begin, const CharType *end)
+                {
+                    return delim_is_char ? _find_char(begin, end, static_cast<CharType>(delim)) : end;
+                };
+
+            // When the buffer holds the delimiter in memory the read is done without going through the loop.
+            if (_read_acquired(buffer, *_locals, find_delim) != req_async)
+            {
+                return flush().then([=] { return _locals->total; });
+            }
+
             auto loop = pplx::details::do_while([=]() mutable -> pplx::task<bool>
                 {
+                    if (_read_acquired(buffer, *_locals, find_delim) != req_async)
+                    {
+                        return pplx::task_from_result(false);
+                    }
+                    if (_locals->is_full())
+                    {
+                        return flush().then([] { return true; });
+                    }
+
                     while (buffer.in_avail() > 0)
                     {
                         int_type ch = buffer.sbumpc();
@@ -902,8 +944,37 @@ namespace Concurrency { namespace streams
                     return pplx::task_from_result(false);
                 };
 
+            auto find_line_end = [](const CharType *begin, const CharType *end)
+                {
+                    // A '\r' can only matter before the first '\n'.
+                    const CharType *lf = _find_char(begin, end, static_cast<CharType>('\n'));
+                    return _find_char(begin, lf, static_cast<CharType>('\r'));
+                };
+
+            // When the buffer holds the whole line in memory the read is done without going through the loop.
+            const auto first = _read_acquired(buffer, *_locals, find_line_end);
+            if (first == '\n')
+            {
+                return flush().then([=] { return _locals->total; });
+            }
+            _locals->saw_CR = first == '\r';
+
             auto loop = pplx::details::do_while([=]() mutable -> pplx::task<bool>
                 {
+                    if (!_locals->saw_CR)
+                    {
+                        auto ch = _read_acquired(buffer, *_locals, find_line_end);
+                        if (ch == '\n')
+                        {
+                            return pplx::task_from_result(false);
+                        }
+                        _locals->saw_CR = ch == '\r';
+                        if (!_locals->saw_CR && _locals->is_full())
+                        {
+                            return flush().then([] { return true; });
+                        }
+                    }
+
                     while ( buffer.in_avail() > 0 )
                     {
 #ifndef _WIN32 // Required by GCC, because concurrency::streams::char_traits<CharType> is a dependent scope
@@ -1075,6 +1146,74 @@ namespace Concurrency { namespace streams
             return type_parser<CharType,T>::parse(helper()->m_buffer);
         }
 
+        /// <summary>
+        /// Read a number of whitespace-separated values of type <c>T</c> from the stream.
+        /// </summary>
+        /// <remarks>
+        /// Values that are already buffered are parsed without waiting on a task for each, which makes this
+        /// much faster than calling <c>extract</c> repeatedly for long runs of numbers or tokens.
+        /// </remarks>
+        /// <typeparam name="T">
+        /// The data type of the elements to be read from the stream.
+        /// </typeparam>
+        /// <param name="count">The maximum number of values to read.</param>
+        /// <returns>A <c>task</c> that holds the values read, fewer than <paramref name="count"/> if the end of the stream
+        /// is reached first.</returns>
+        template<typename T>
+        pplx::task<std::vector<T>> extract_n(size_t count) const
+        {
+            pplx::task<std::vector<T>> result;
+            if ( !_verify_and_return_task(details::_in_stream_msg, result) ) return result;
+
+            auto buffer = helper()->m_buffer;
+            auto values = std::make_shared<std::vector<T>>();
+
+            // Parses values as long as no waiting is needed. Returns false when done, or a task to wait on before
+            // going on.
+            auto parse_available = [=]() -> pplx::task<bool>
+            {
+                auto buffer_ = buffer;
+                int_type eof = traits::eof(), req_async = traits::requires_async();
+                try
+                {
+                    while ( values->size() < count )
+                    {
+                        // Whitespace at the end of the stream doesn't make another value.
+                        int_type ch;
+                        while ( (ch = buffer_.sgetc()) != eof && ch != req_async && isspace(ch) )
+                        {
+                            buffer_.sbumpc();
+                        }
+                        if ( ch == eof )
+                        {
+                            break;
+                        }
+                        if ( ch == req_async )
+                        {
+                            return buffer_.getc().then([eof](int_type ch) { return ch != eof; });
+                        }
+
+                        auto value = type_parser<CharType,T>::parse(buffer_);
+                        if ( !value.is_done() )
+                        {
+                            return value.then([values](T v) { values->push_back(v); return true; });
+                        }
+                        values->push_back(value.get());
+                    }
+                }
+                catch (...)
+                {
+                    return pplx::task_from_exception<bool>(std::current_exception());
+                }
+                return pplx::task_from_result(false);
+            };
+
+            return pplx::details::do_while(parse_available).then([values](bool)
+            {
+                return std::move(*values);
+            });
+        }
+
     private:
 
         template<typename T>
@@ -1129,6 +1268,69 @@ namespace Concurrency { namespace streams
             }
         };
 
+        /// <summary>
+        /// Finds the first occurrence of a character in a block, or returns the end of the block.
+        /// </summary>
+        static const CharType *_find_char(const CharType *begin, const CharType *end, CharType ch)
+        {
+            return _find_char(begin, end, ch, std::integral_constant<bool, sizeof(CharType) == 1>());
+        }
+
+        static const CharType *_find_char(const CharType *begin, const CharType *end, CharType ch, std::true_type)
+        {
+            const void *found = std::memchr(begin, static_cast<unsigned char>(ch), static_cast<size_t>(end - begin));
+            return found != nullptr ? static_cast<const CharType *>(found) : end;
+        }
+
+        static const CharType *_find_char(const CharType *begin, const CharType *end, CharType ch, std::false_type)
+        {
+            while (begin != end && *begin != ch)
+            {
+                ++begin;
+            }
+            return begin;
+        }
+
+        /// <summary>
+        /// Copies characters from blocks acquired directly from the buffer to the output of a read, up to the
+        /// first character the finder stops at. That character is consumed but not copied.
+        /// </summary>
+        /// <returns>The character the read stopped at, or <c>requires_async</c> once the output is full or the
+        /// buffer has no more data to hand out in blocks. The read then goes on asynchronously.</returns>
+        template<typename Finder>
+        static int_type _read_acquired(streams::streambuf<CharType> buffer, _read_helper &locals, const Finder &find)
+        {
+            while (!locals.is_full())
+            {
+                CharType *data = nullptr;
+                size_t available = 0;
+                if (!buffer.acquire(data, available))
+                {
+                    break;
+                }
+                if (available == 0)
+                {
+                    buffer.release(data, 0);
+                    break;
+                }
+
+                const CharType *end = data + (std::min)(available, buf_size - locals.write_pos);
+                const CharType *stop = find(data, end);
+                const size_t count = static_cast<size_t>(stop - data);
+                std::memcpy(locals.outbuf + locals.write_pos, data, count * sizeof(CharType));
+                locals.write_pos += count;
+
+                if (stop != end)
+                {
+                    const int_type ch = static_cast<int_type>(*stop);
+                    buffer.release(data, count + 1);
+                    return ch;
+                }
+                buffer.release(data, count);
+            }
+            return ::concurrency::streams::char_traits<CharType>::requires_async();
+        }
+
         std::shared_ptr<details::basic_istream_helper<CharType>> m_helper;
     };
 
@@ -1191,6 +1393,75 @@ pplx::task<ReturnType> concurrency::streams::_type_parser_base<CharType>::_parse
 {
     std::shared_ptr<StateType> state = std::make_shared<StateType>();
 
+    // Parse whatever the buffer holds already without scheduling a task for every character, straight out of
+    // its memory where it allows that. Once the value has started, whitespace no longer gets skipped.
+    typedef ::concurrency::streams::char_traits<CharType> traits;
+    typedef typename std::make_unsigned<CharType>::type uchar_type;
+    bool started = false, done = false;
+
+    CharType *ptr;
+    size_t count;
+    while ( !done && buffer.acquire(ptr, count) )
+    {
+        if ( ptr == nullptr )
+        {
+            // The end of the stream.
+            done = true;
+            break;
+        }
+        if ( count == 0 )
+        {
+            buffer.release(ptr, 0);
+            break;
+        }
+
+        size_t pos = 0;
+        if ( !started )
+        {
+            while ( pos < count && isspace(int_type(uchar_type(ptr[pos]))) ) ++pos;
+            started = pos < count;
+        }
+        while ( started && pos < count && accept_character(state, int_type(uchar_type(ptr[pos]))) ) ++pos;
+        done = pos < count;
+
+        buffer.release(ptr, pos);
+    }
+
+    if ( !done )
+    {
+        int_type req_async = traits::requires_async();
+
+        while ( buffer.in_avail() > 0 )
+        {
+            int_type ch = buffer.sgetc();
+            if ( ch == req_async )
+                break;
+
+            if ( !started )
+            {
+                started = !isspace(ch);
+            }
+            if ( started && !accept_character(state, ch) )
+            {
+                done = true;
+                break;
+            }
+            buffer.sbumpc();
+        }
+    }
+
+    if ( done )
+    {
+        try
+        {
+            return extract(state);
+        }
+        catch (...)
+        {
+            return pplx::task_from_exception<ReturnType>(std::current_exception());
+        }
+    }
+
     auto update = [=] (pplx::task<int_type> op) -> pplx::task<bool>
     {
         int_type ch = op.get();
@@ -1231,6 +1502,11 @@ pplx::task<ReturnType> concurrency::streams::_type_parser_base<CharType>::_parse
             return result;
         };
 
+    if ( started )
+    {
+        return pplx::details::do_while(peek_char).then(finish);
+    }
+
     return _skip_whitespace(buffer).then([=](pplx::task<void> op) -> pplx::task<ReturnType>
         {
             op.wait();
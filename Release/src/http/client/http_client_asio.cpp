@@ -56,6 +56,9 @@ namespace client
 namespace details
 {
 
+// Request bodies held in memory are sent without copying, in writes of at most this size.
+const size_t InPlaceWriteSize = 1024 * 1024;
+
 enum class httpclient_errorcode_context
 {
     none = 0,
@@ -982,9 +985,14 @@ private:
             }
         }
 
+        auto readbuf = _get_readbuffer();
+        if (write_body_in_place(readbuf))
+        {
+            return;
+        }
+
         const auto this_request = shared_from_this();
         const auto readSize = static_cast<size_t>(std::min(static_cast<uint64_t>(m_http_client->client_config().chunksize()), m_content_length - m_uploaded));
-        auto readbuf = _get_readbuffer();
         readbuf.getn(boost::asio::buffer_cast<uint8_t *>(m_body_buf.prepare(readSize)), readSize).then([this_request](pplx::task<size_t> op)
         {
             try
@@ -1007,6 +1015,54 @@ private:
         });
     }
 
+    // Sends the next part of the body straight from the memory of its stream buffer, gathering all blocks of a
+    // buffer chain. Returns false if nothing is held in memory, the body is then copied through m_body_buf.
+    bool write_body_in_place(concurrency::streams::streambuf<uint8_t> readbuf)
+    {
+        const auto limit = static_cast<size_t>(std::min(static_cast<uint64_t>(InPlaceWriteSize), m_content_length - m_uploaded));
+        std::vector<boost::asio::const_buffer> buffers;
+        size_t body = 0;
+        uint8_t *block = nullptr;
+        if (auto chain = std::dynamic_pointer_cast<concurrency::streams::details::basic_buffer_chain<uint8_t>>(readbuf.get_base()))
+        {
+            body = chain->peek_blocks(limit, [&buffers](const uint8_t *data, size_t count) { buffers.push_back(boost::asio::buffer(data, count)); });
+        }
+        else
+        {
+            size_t count = 0;
+            if (readbuf.acquire(block, count) && block != nullptr)
+            {
+                body = std::min(count, limit);
+                buffers.push_back(boost::asio::buffer(block, body));
+            }
+        }
+        if (body == 0)
+        {
+            if (block != nullptr)
+            {
+                readbuf.release(block, 0);
+            }
+            return false;
+        }
+
+        const auto this_request = shared_from_this();
+        m_connection->async_write(buffers, [this_request, readbuf, block](const boost::system::error_code& ec, std::size_t written)
+        {
+            auto source = readbuf;
+            if (block != nullptr)
+            {
+                source.release(block, written);
+            }
+            else
+            {
+                source.seekoff(static_cast<concurrency::streams::streambuf<uint8_t>::off_type>(written), std::ios_base::cur, std::ios_base::in);
+            }
+            this_request->m_uploaded += static_cast<uint64_t>(written);
+            this_request->handle_write_large_body(ec);
+        });
+        return true;
+    }
+
     void handle_write_body(const boost::system::error_code& ec)
     {
         if (!ec)
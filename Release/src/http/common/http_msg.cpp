@@ -92,14 +92,16 @@ http_msg_base::http_msg_base()
 {
 }
 
-void http_msg_base::_prepare_to_receive_data()
+void http_msg_base::_prepare_to_receive_data(bool single_reader)
 {
     // See if the user specified an outstream
     if (!outstream())
     {
         // The user did not specify an outstream.
         // We will create one...
-        concurrency::streams::producer_consumer_buffer<uint8_t> buf;
+        auto buf = single_reader
+            ? concurrency::streams::producer_consumer_buffer<uint8_t>::single_producer_consumer(16 * 1024)
+            : concurrency::streams::producer_consumer_buffer<uint8_t>();
         set_outstream(buf.create_ostream(), true);
 
         // Since we are creating the streambuffer, set the input stream
@@ -439,8 +441,56 @@ utility::string_t details::http_msg_base::extract_string(bool ignore_content_typ
     }
 }
 
+// Hands the whole body to a parser as one block of bytes, in place when the stream buffer already holds it in one.
+template <typename Parser>
+static json::value parse_body_bytes(concurrency::streams::streambuf<uint8_t> buf_r, const Parser &parse)
+{
+    const size_t length = buf_r.in_avail();
+    uint8_t *data = nullptr;
+    size_t count = 0;
+    if (buf_r.acquire(data, count) && data != nullptr && count == length)
+    {
+        json::value result;
+        try
+        {
+            result = parse(data, count);
+        }
+        catch (...)
+        {
+            buf_r.release(data, count);
+            throw;
+        }
+        buf_r.release(data, count);
+        return result;
+    }
+    buf_r.release(data, 0);
+
+    std::vector<uint8_t> body(length);
+    buf_r.getn(body.data(), body.size()).get(); // There is no risk of blocking.
+    return parse(body.data(), body.size());
+}
+
 json::value details::http_msg_base::_extract_json(bool ignore_content_type)
 {
+    // Binary encodings are told apart by the Content-Type alone.
+    if (!ignore_content_type && instream())
+    {
+        utility::string_t content, charset;
+        parse_content_type_and_charset(headers().content_type(), content, charset);
+        json::binary_format format;
+        if (json::binary_format_of(content, format))
+        {
+            if (instream().streambuf().in_avail() == 0)
+            {
+                return json::value();
+            }
+            return parse_body_bytes(instream().streambuf(), [format](const uint8_t *data, size_t size)
+            {
+                return json::decode_binary(data, size, format);
+            });
+        }
+    }
+
     const auto &charset = parse_and_check_content_type(ignore_content_type, is_content_type_json);
     if (charset.empty())
     {
@@ -463,10 +513,11 @@ json::value details::http_msg_base::_extract_json(bool ignore_content_type)
             || utility::details::str_icmp(charset, charset_types::usascii)
             || utility::details::str_icmp(charset, charset_types::ascii))
     {
-        std::string body;
-        body.resize(buf_r.in_avail());
-        buf_r.getn(const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(body.data())), body.size()).get(); // There is no risk of blocking.
-        return json::value::parse(to_string_t(std::move(body)));
+        // A body held in a single block, e.g. by a container buffer, is parsed in place.
+        return parse_body_bytes(buf_r, [](const uint8_t *data, size_t size)
+        {
+            return json::value::parse(reinterpret_cast<const char *>(data), size);
+        });
     }
 
     // utf-16.
@@ -668,6 +719,63 @@ void details::http_msg_base::set_body(const concurrency::streams::istream &instr
     m_data_available.set(contentLength);
 }
 
+#if !defined(_WIN32)
+details::_file_body::_file_body(int fd, utility::size64_t offset, utility::size64_t length)
+    : m_fd(fd), m_offset(offset), m_length(length)
+{
+    struct stat info;
+    if (fstat(m_fd, &info) != 0)
+    {
+        const int error = errno;
+        ::close(m_fd);
+        throw http_exception(error, "Error reading the size of the response body file");
+    }
+
+    const auto size = static_cast<utility::size64_t>(info.st_size);
+    if (m_offset > size)
+    {
+        ::close(m_fd);
+        throw std::invalid_argument("The response body offset is past the end of the file");
+    }
+    m_length = (std::min)(m_length, size - m_offset);
+}
+
+details::_file_body::~_file_body()
+{
+    ::close(m_fd);
+}
+
+std::shared_ptr<details::_file_body> details::_file_body::open(const utility::string_t &file_path, utility::size64_t offset, utility::size64_t length)
+{
+    const int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        throw http_exception(errno, "Error opening the response body file");
+    }
+    return std::shared_ptr<_file_body>(new _file_body(fd, offset, length));
+}
+
+std::shared_ptr<details::_file_body> details::_file_body::duplicate(int fd, utility::size64_t offset, utility::size64_t length)
+{
+    const int copy = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy == -1)
+    {
+        throw http_exception(errno, "Error duplicating the response body file descriptor");
+    }
+    return std::shared_ptr<_file_body>(new _file_body(copy, offset, length));
+}
+
+void details::_http_response::set_file_body(std::shared_ptr<_file_body> file, const utility::string_t &contentType)
+{
+    const auto length = file->length();
+    headers().set_content_length(length);
+    set_content_type_if_not_present(headers(), contentType);
+    set_instream(concurrency::streams::istream());
+    m_file_body = std::move(file);
+    m_data_available.set(length);
+}
+#endif
+
 details::_http_request::_http_request(http::method mtd)
   : m_method(std::move(mtd)),
     m_initiated_response(0),
@@ -190,6 +190,93 @@ void details::http_listener_impl::handle_options(http_request message)
     message.reply(response);
 }
 
+
+http_listener_metrics details::http_listener_impl::metrics() const
+{
+    auto server = web::http::experimental::details::http_server_api::server_api();
+    if (m_closed || server == nullptr)
+    {
+        return http_listener_metrics();
+    }
+    return server->metrics(const_cast<http_listener_impl *>(this));
+}
+
+size_t latency_histogram::bucket_index(std::chrono::microseconds latency)
+{
+    const uint64_t value = latency.count() < 0 ? 0 : static_cast<uint64_t>(latency.count());
+    if (value < 16)
+    {
+        return static_cast<size_t>(value);
+    }
+
+    // Find the power of two the value falls in, its next three bits select the linear sub-bucket.
+    size_t exponent = 4;
+    while (exponent < 63 && (value >> (exponent + 1)) != 0)
+    {
+        ++exponent;
+    }
+    const size_t index = 16 + (exponent - 4) * 8 + static_cast<size_t>((value >> (exponent - 3)) & 7);
+    return std::min(index, bucket_count - 1);
+}
+
+std::chrono::microseconds latency_histogram::bucket_upper_bound(size_t index)
+{
+    if (index < 16)
+    {
+        return std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(index));
+    }
+    if (index >= bucket_count - 1)
+    {
+        return std::chrono::microseconds::max();
+    }
+
+    const size_t exponent = 4 + (index - 16) / 8;
+    const uint64_t lower = static_cast<uint64_t>(8 + (index - 16) % 8) << (exponent - 3);
+    return std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(lower + (uint64_t(1) << (exponent - 3)) - 1));
+}
+
+void latency_histogram::record(std::chrono::microseconds latency)
+{
+    const uint64_t value = latency.count() < 0 ? 0 : static_cast<uint64_t>(latency.count());
+    ++m_buckets[bucket_index(latency)];
+    ++m_count;
+    m_total += value;
+    m_max = std::max(m_max, value);
+}
+
+void latency_histogram::merge(const latency_histogram &other)
+{
+    for (size_t i = 0; i < bucket_count; ++i)
+    {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_total += other.m_total;
+    m_max = std::max(m_max, other.m_max);
+}
+
+std::chrono::microseconds latency_histogram::percentile(double percentile) const
+{
+    if (m_count == 0)
+    {
+        return std::chrono::microseconds(0);
+    }
+
+    // Walk the buckets until the requested rank, never reporting more than the largest recorded value.
+    const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(m_count))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i)
+    {
+        seen += m_buckets[i];
+        if (seen >= rank)
+        {
+            return std::min(bucket_upper_bound(i), max());
+        }
+    }
+    return max();
+}
+
 }}}}
 
 #endif
\ No newline at end of file
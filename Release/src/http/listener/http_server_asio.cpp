@@ -26,6 +26,9 @@
 */
 #include "stdafx.h"
 #include <boost/algorithm/string/find.hpp>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 #if defined(__clang__)
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wcast-align"
@@ -163,8 +166,17 @@ namespace experimental
 namespace listener
 {
 
+// Adaptive chunks start at this size, which keeps small messages cheap, and grow up to
+// http_listener_config::chunksize(), 64K unless set.
 const size_t ChunkSize = 4 * 1024;
 
+// File bodies which cannot be handed to sendfile() are read in larger pieces, straight from the file.
+const size_t FileChunkSize = 64 * 1024;
+
+// Bodies held in memory are sent without copying, in writes of at most this size so that the body
+// timeout still covers a bounded amount of data.
+const size_t InPlaceWriteSize = 1024 * 1024;
+
 namespace details
 {
 
@@ -178,45 +190,223 @@ void hostport_listener::start()
 
     m_acceptor.reset(new tcp::acceptor(service, endpoint));
     m_acceptor->set_option(tcp::acceptor::reuse_address(true));
+    m_accept_paused = false;
+
+    m_timeout_timer.reset(new deadline_timer(service));
+    schedule_timeout_check();
+
+    do_accept();
+}
 
-    auto socket = new ip::tcp::socket(service);
+void hostport_listener::do_accept()
+{
+    auto socket = new ip::tcp::socket(crossplat::threadpool::shared_instance().service());
     m_acceptor->async_accept(*socket, boost::bind(&hostport_listener::on_accept, this, socket, placeholders::error));
 }
 
+void hostport_listener::schedule_timeout_check()
+{
+    m_timeout_timer->expires_from_now(boost::posix_time::seconds(1));
+    m_timeout_timer->async_wait(boost::bind(&hostport_listener::on_timeout_check, this, placeholders::error));
+}
+
+void hostport_listener::on_timeout_check(const boost::system::error_code& ec)
+{
+    if (ec)
+    {
+        // the timer was cancelled by stop()
+        return;
+    }
+
+    std::vector<connection*> expired;
+    pplx::scoped_lock<pplx::extensibility::recursive_lock_t> lock(m_connections_lock);
+    if (!m_timeout_timer)
+    {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    for (auto conn : m_connections)
+    {
+        if (conn->is_past_deadline(now))
+        {
+            expired.push_back(conn);
+        }
+    }
+
+    // Closing only cancels the pending operation, the connections remove themselves once its handler runs.
+    for (auto conn : expired)
+    {
+        conn->close_if_past_deadline();
+    }
+
+    schedule_timeout_check();
+}
+
+connection::connection(std::unique_ptr<tcp::socket> socket, http_linux_server* server, hostport_listener* parent, bool is_https, const std::function<void(boost::asio::ssl::context&)>& ssl_context_callback)
+    : m_socket(std::move(socket))
+    , m_strand(crossplat::threadpool::shared_instance().service())
+    , m_request_buf()
+    , m_response_buf()
+    , m_p_server(server)
+    , m_p_parent(parent)
+    , m_close(false)
+    , m_holds_request_slot(false)
+    , m_refs(1)
+    , m_deadline(std::chrono::steady_clock::time_point::max())
+    , m_keep_alive_timeout(parent->m_keep_alive_timeout)
+    , m_header_timeout(parent->m_header_timeout)
+    , m_body_timeout(parent->m_body_timeout)
+    , m_max_chunk_size(parent->m_chunksize)
+    , m_adaptive_chunks(parent->m_adaptive_chunks)
+    , m_read_chunk_size(0)
+    , m_write_chunk_size(0)
+    , m_bytes_received(0)
+    , m_bytes_sent(0)
+    , m_request_start()
+    , m_request_path()
+{
+    // A new client has to complete the handshake and send its request line within the header timeout.
+    arm_timeout(m_header_timeout);
+
+    if (is_https)
+    {
+        boost::asio::ssl::context ssl_context(boost::asio::ssl::context::sslv23);
+        ssl_context_callback(ssl_context);
+        m_ssl_stream = utility::details::make_unique<boost::asio::ssl::stream<boost::asio::ip::tcp::socket&>>(*m_socket, ssl_context);
+        m_ssl_stream->async_handshake(boost::asio::ssl::stream_base::server, m_strand.wrap([this](const boost::system::error_code&) { this->start_request_response(); }));
+    }
+    else
+    {
+        start_request_response();
+    }
+}
+
+void connection::arm_timeout(utility::seconds timeout)
+{
+    m_deadline = std::chrono::steady_clock::now() + timeout;
+}
+
+void connection::disarm_timeout()
+{
+    m_deadline = std::chrono::steady_clock::time_point::max();
+}
+
+size_t connection::initial_chunk_size() const
+{
+    return m_adaptive_chunks ? std::min(ChunkSize, m_max_chunk_size) : m_max_chunk_size;
+}
+
+void connection::grow_chunk_size(size_t &chunk_size, size_t transferred) const
+{
+    // A filled chunk means the data is arriving faster than it is being moved, so use fewer, larger operations.
+    if (m_adaptive_chunks && transferred >= chunk_size)
+    {
+        chunk_size = std::min(chunk_size * 2, m_max_chunk_size);
+    }
+}
+
+void connection::count_received(size_t previously_buffered)
+{
+    // Nothing is consumed from the request buffer while a read is outstanding, so its growth is what arrived.
+    m_bytes_received.fetch_add(m_request_buf.size() - previously_buffered, std::memory_order_relaxed);
+}
+
+void connection::count_sent(size_t sent)
+{
+    m_bytes_sent.fetch_add(sent, std::memory_order_relaxed);
+}
+
 void connection::close()
 {
+    disarm_timeout();
     m_close = true;
-    auto sock = m_socket.get();
-    if (sock != nullptr)
+
+    // Keeps the connection alive until the socket has been closed on the strand.
+    ++m_refs;
+    m_strand.dispatch([this]
     {
-        boost::system::error_code ec;
-        sock->cancel(ec);
-        sock->shutdown(tcp::socket::shutdown_both, ec);
-        sock->close(ec);
-    }
-    m_request._reply_if_not_already(status_codes::InternalError);
+        auto sock = m_socket.get();
+        if (sock != nullptr)
+        {
+            boost::system::error_code ec;
+            sock->cancel(ec);
+            sock->shutdown(tcp::socket::shutdown_both, ec);
+            sock->close(ec);
+        }
+        m_request._reply_if_not_already(status_codes::InternalError);
+        if (--m_refs == 0) delete this;
+    });
+}
+
+void connection::close_if_past_deadline()
+{
+    // The pending operation may have completed since the deadline was checked, look again on the strand.
+    ++m_refs;
+    m_strand.dispatch([this]
+    {
+        if (is_past_deadline(std::chrono::steady_clock::now()))
+        {
+            close();
+        }
+        if (--m_refs == 0) delete this;
+    });
 }
 
 void connection::start_request_response()
 {
     m_read_size = 0;
     m_read = 0;
-    m_request_buf.consume(m_request_buf.size()); // clear the buffer
 
-    if (m_ssl_stream)
+    m_strand.dispatch([this]
     {
-        boost::asio::async_read_until(*m_ssl_stream, m_request_buf, CRLF, [this](const boost::system::error_code& ec, std::size_t)
+        auto handler = m_strand.wrap([this](const boost::system::error_code& ec, std::size_t)
         {
+            this->count_received(0);
             this->handle_http_line(ec);
         });
-    }
-    else
+        if (m_ssl_stream)
+        {
+            boost::asio::async_read_until(*m_ssl_stream, m_request_buf, CRLF, handler);
+        }
+        else
+        {
+            boost::asio::async_read_until(*m_socket, m_request_buf, crlf_nonascii_searcher, handler);
+        }
+    });
+}
+
+void connection::wait_for_next_request()
+{
+    m_request_buf.consume(m_request_buf.size()); // clear the buffer
+
+    // An idle kept-alive connection gets the keep-alive timeout, but once the next request starts
+    // arriving the client only has the header timeout to finish sending the request line and headers.
+    arm_timeout(m_keep_alive_timeout);
+    m_strand.dispatch([this]
     {
-        boost::asio::async_read_until(*m_socket, m_request_buf, crlf_nonascii_searcher, [this](const boost::system::error_code& ec, std::size_t)
+        auto handler = m_strand.wrap([this](const boost::system::error_code& ec, std::size_t)
         {
-            this->handle_http_line(ec);
+            if (ec)
+            {
+                this->count_received(0);
+                this->handle_http_line(ec);
+            }
+            else
+            {
+                this->arm_timeout(m_header_timeout);
+                this->start_request_response();
+            }
         });
-    }
+        if (m_ssl_stream)
+        {
+            boost::asio::async_read(*m_ssl_stream, m_request_buf, boost::asio::transfer_at_least(1), handler);
+        }
+        else
+        {
+            boost::asio::async_read(*m_socket, m_request_buf, boost::asio::transfer_at_least(1), handler);
+        }
+    });
 }
 
 void hostport_listener::on_accept(ip::tcp::socket* socket, const boost::system::error_code& ec)
@@ -229,22 +419,104 @@ void hostport_listener::on_accept(ip::tcp::socket* socket, const boost::system::
     {
         {
             pplx::scoped_lock<pplx::extensibility::recursive_lock_t> lock(m_connections_lock);
+            ++m_connections_accepted;
             m_connections.insert(new connection(std::unique_ptr<tcp::socket>(std::move(socket)), m_p_server, this, m_is_https, m_ssl_context_callback));
             m_all_connections_complete.reset();
 
             if (m_acceptor)
             {
-                // spin off another async accept
-                auto newSocket = new ip::tcp::socket(crossplat::threadpool::shared_instance().service());
-                m_acceptor->async_accept(*newSocket, boost::bind(&hostport_listener::on_accept, this, newSocket, placeholders::error));
+                if (m_max_connections != 0 && m_connections.size() >= m_max_connections)
+                {
+                    // Leave further clients in the socket backlog until a connection is closed.
+                    m_accept_paused = true;
+                }
+                else
+                {
+                    // spin off another async accept
+                    do_accept();
+                }
             }
         }
     }
 }
 
+void hostport_listener::on_connection_closed(connection* conn)
+{
+    pplx::scoped_lock<pplx::extensibility::recursive_lock_t> lock(m_connections_lock);
+    m_connections.erase(conn);
+    ++m_connections_closed;
+    m_closed_bytes_received += conn->bytes_received();
+    m_closed_bytes_sent += conn->bytes_sent();
+    if (m_connections.empty())
+    {
+        m_all_connections_complete.set();
+    }
+
+    if (m_accept_paused && m_acceptor && (m_max_connections == 0 || m_connections.size() < m_max_connections))
+    {
+        m_accept_paused = false;
+        do_accept();
+    }
+}
+
+bool hostport_listener::try_acquire_request_slot()
+{
+    if (++m_concurrent_requests > m_max_concurrent_requests && m_max_concurrent_requests != 0)
+    {
+        --m_concurrent_requests;
+        ++m_requests_rejected;
+        return false;
+    }
+    return true;
+}
+
+void hostport_listener::release_request_slot()
+{
+    --m_concurrent_requests;
+}
+
+void hostport_listener::record_request(const utility::string_t& path, http::status_code status, std::chrono::microseconds latency)
+{
+    auto &shard = m_metrics_shards[std::hash<std::thread::id>()(std::this_thread::get_id()) % MetricsShards];
+    pplx::extensibility::scoped_critical_section_t lock(shard.m_lock);
+    shard.m_paths[path].record(status, latency);
+}
+
+http_listener_metrics hostport_listener::metrics()
+{
+    http_listener_metrics snapshot;
+    {
+        pplx::scoped_lock<pplx::extensibility::recursive_lock_t> lock(m_connections_lock);
+        snapshot.m_connections_accepted = m_connections_accepted;
+        snapshot.m_connections_closed = m_connections_closed;
+        snapshot.m_active_connections = m_connections.size();
+        snapshot.m_bytes_received = m_closed_bytes_received;
+        snapshot.m_bytes_sent = m_closed_bytes_sent;
+        for (auto conn : m_connections)
+        {
+            snapshot.m_bytes_received += conn->bytes_received();
+            snapshot.m_bytes_sent += conn->bytes_sent();
+        }
+    }
+    snapshot.m_active_requests = m_concurrent_requests;
+    snapshot.m_requests_rejected = m_requests_rejected;
+
+    for (auto &shard : m_metrics_shards)
+    {
+        pplx::extensibility::scoped_critical_section_t lock(shard.m_lock);
+        for (const auto &path : shard.m_paths)
+        {
+            snapshot.m_paths[path.first].merge(path.second);
+        }
+    }
+    return snapshot;
+}
+
 void connection::handle_http_line(const boost::system::error_code& ec)
 {
     m_request = http_request::_create_request(std::unique_ptr<http::details::_http_server_context>(new linux_request_context()));
+    m_request_start = std::chrono::steady_clock::now();
+    m_request_path.clear();
     if (ec)
     {
         // client closed connection
@@ -261,6 +533,9 @@ void connection::handle_http_line(const boost::system::error_code& ec)
     }
     else
     {
+        // no deadline while the request is parsed, reading a body or writing the response arms it again
+        disarm_timeout();
+
         // read http status line
         std::istream request_stream(&m_request_buf);
         request_stream.imbue(std::locale::classic());
@@ -394,7 +669,8 @@ void connection::handle_headers()
     else // need to read the sent data
     {
         m_read = 0;
-        async_read_until_buffersize(std::min(ChunkSize, m_read_size), boost::bind(&connection::handle_body, this, placeholders::error));
+        m_read_chunk_size = initial_chunk_size();
+        async_read_until_buffersize(std::min(m_read_chunk_size, m_read_size), boost::bind(&connection::handle_body, this, placeholders::error));
     }
 
     dispatch_request_to_listener();
@@ -415,7 +691,10 @@ void connection::handle_chunked_header(const boost::system::error_code& ec)
         m_request_buf.consume(CRLF.size());
         m_read += len;
         if (len == 0)
+        {
+            disarm_timeout();
             m_request._get_impl()->_complete(m_read);
+        }
         else
             async_read_until_buffersize(len + 2, boost::bind(&connection::handle_chunked_body, this, boost::asio::placeholders::error, len));
     }
@@ -472,56 +751,109 @@ void connection::handle_body(const boost::system::error_code& ec)
             }
             m_read += writtenSize;
             m_request_buf.consume(writtenSize);
-            async_read_until_buffersize(std::min(ChunkSize, m_read_size - m_read), boost::bind(&connection::handle_body, this, placeholders::error));
+            grow_chunk_size(m_read_chunk_size, writtenSize);
+            async_read_until_buffersize(std::min(m_read_chunk_size, m_read_size - m_read), boost::bind(&connection::handle_body, this, placeholders::error));
         });
     }
     else  // have read request body
     {
+        disarm_timeout();
         m_request._get_impl()->_complete(m_read);
     }
 }
 
 void connection::async_write(ResponseFuncPtr response_func_ptr, const http_response &response)
 {
-    if (m_ssl_stream)
+    // The deadline only covers the write itself, not the time spent waiting for the response body stream.
+    arm_timeout(m_body_timeout);
+    m_strand.dispatch([=]
     {
-        boost::asio::async_write(*m_ssl_stream, m_response_buf, [=] (const boost::system::error_code& ec, std::size_t)
+        auto handler = m_strand.wrap([=] (const boost::system::error_code& ec, std::size_t written)
         {
+            disarm_timeout();
+            count_sent(written);
             (this->*response_func_ptr)(response, ec);
         });
-    }
-    else
+        if (m_ssl_stream)
+        {
+            boost::asio::async_write(*m_ssl_stream, m_response_buf, handler);
+        }
+        else
+        {
+            boost::asio::async_write(*m_socket, m_response_buf, handler);
+        }
+    });
+}
+
+template <typename ConstBufferSequence, typename WriteHandler>
+void connection::async_write_buffers(const ConstBufferSequence &buffers, WriteHandler &&write_handler)
+{
+    arm_timeout(m_body_timeout);
+    typename std::decay<WriteHandler>::type handler(std::forward<WriteHandler>(write_handler));
+    m_strand.dispatch([this, buffers, handler]
     {
-        boost::asio::async_write(*m_socket, m_response_buf, [=] (const boost::system::error_code& ec, std::size_t)
+        auto counting_handler = m_strand.wrap([this, handler](const boost::system::error_code& ec, std::size_t written)
         {
-            (this->*response_func_ptr)(response, ec);
+            this->disarm_timeout();
+            this->count_sent(written);
+            handler(ec, written);
         });
-    }
+        if (m_ssl_stream)
+        {
+            boost::asio::async_write(*m_ssl_stream, buffers, counting_handler);
+        }
+        else
+        {
+            boost::asio::async_write(*m_socket, buffers, counting_handler);
+        }
+    });
 }
 
 template <typename CompletionCondition, typename Handler>
 void connection::async_read(CompletionCondition &&condition, Handler &&read_handler)
 {
-    if (m_ssl_stream)
-    {
-        boost::asio::async_read(*m_ssl_stream, m_request_buf, std::forward<CompletionCondition>(condition), std::forward<Handler>(read_handler));
-    }
-    else
+    arm_timeout(m_body_timeout);
+    typename std::decay<CompletionCondition>::type completion_condition(std::forward<CompletionCondition>(condition));
+    typename std::decay<Handler>::type handler(std::forward<Handler>(read_handler));
+    m_strand.dispatch([this, completion_condition, handler]
     {
-        boost::asio::async_read(*m_socket, m_request_buf, std::forward<CompletionCondition>(condition), std::forward<Handler>(read_handler));
-    }
+        const auto buffered = m_request_buf.size();
+        auto counting_handler = m_strand.wrap([this, buffered, handler](const boost::system::error_code& ec, std::size_t)
+        {
+            this->count_received(buffered);
+            handler(ec);
+        });
+        if (m_ssl_stream)
+        {
+            boost::asio::async_read(*m_ssl_stream, m_request_buf, completion_condition, counting_handler);
+        }
+        else
+        {
+            boost::asio::async_read(*m_socket, m_request_buf, completion_condition, counting_handler);
+        }
+    });
 }
 
 void connection::async_read_until()
 {
-    if (m_ssl_stream)
+    arm_timeout(m_body_timeout);
+    m_strand.dispatch([this]
     {
-        boost::asio::async_read_until(*m_ssl_stream, m_request_buf, CRLF, boost::bind(&connection::handle_chunked_header, this, placeholders::error));
-    }
-    else
-    {
-        boost::asio::async_read_until(*m_socket, m_request_buf, CRLF, boost::bind(&connection::handle_chunked_header, this, placeholders::error));
-    }
+        const auto buffered = m_request_buf.size();
+        auto handler = m_strand.wrap([this, buffered](const boost::system::error_code& ec, std::size_t)
+        {
+            this->count_received(buffered);
+            this->handle_chunked_header(ec);
+        });
+        if (m_ssl_stream)
+        {
+            boost::asio::async_read_until(*m_ssl_stream, m_request_buf, CRLF, handler);
+        }
+        else
+        {
+            boost::asio::async_read_until(*m_socket, m_request_buf, CRLF, handler);
+        }
+    });
 }
 
 template <typename ReadHandler>
@@ -558,6 +890,7 @@ void connection::dispatch_request_to_listener()
             if (it != m_p_parent->m_listeners.end())
             {
                 pListener = it->second;
+                m_request_path = pListener->uri().path();
                 break;
             }
         }
@@ -568,8 +901,15 @@ void connection::dispatch_request_to_listener()
         m_request.reply(status_codes::NotFound);
         do_response(false);
     }
+    else if (!m_p_parent->try_acquire_request_slot())
+    {
+        // Too many outstanding requests, reply right away instead of queueing behind them.
+        m_request.reply(status_codes::ServiceUnavailable);
+        do_response(false);
+    }
     else
     {
+        m_holds_request_slot = true;
         m_request._set_listener_path(pListener->uri().path());
         do_response(false);
 
@@ -591,16 +931,22 @@ void connection::dispatch_request_to_listener()
             pListenerLock->lock_read();
         }
 
-        try
+        // The handler may wait for the request body or the response, which are moved on the strand,
+        // so it is called from outside of it.
+        auto request = m_request;
+        crossplat::threadpool::shared_instance().service().post([pListener, pListenerLock, request]() mutable
         {
-            pListener->handle_request(m_request);
-            pListenerLock->unlock();
-        }
-        catch(...)
-        {
-            pListenerLock->unlock();
-            m_request._reply_if_not_already(status_codes::InternalError);
-        }
+            try
+            {
+                pListener->handle_request(request);
+                pListenerLock->unlock();
+            }
+            catch(...)
+            {
+                pListenerLock->unlock();
+                request._reply_if_not_already(status_codes::InternalError);
+            }
+        });
     }
     
     if (--m_refs == 0) delete this;
@@ -648,6 +994,7 @@ void connection::async_process_response(http_response response)
 
     m_chunked = false;
     m_write = m_write_size = 0;
+    m_write_chunk_size = initial_chunk_size();
 
     std::string transferencoding;
     if (response.headers().match(header_names::transfer_encoding, transferencoding) && transferencoding == "chunked")
@@ -659,7 +1006,7 @@ void connection::async_process_response(http_response response)
         m_chunked = true;
         response.headers()[header_names::transfer_encoding] = U("chunked");
     }
-    if (!response.body())
+    if (!response.body() && !response._get_impl()->_get_file_body())
     {
         response.headers().add(header_names::content_length,0);
     }
@@ -678,11 +1025,18 @@ void connection::async_process_response(http_response response)
     }
     os << CRLF;
 
+    // A body which is already in memory goes out in the same write as the headers.
+    if (!m_chunked && m_write_size != 0 && response.body() && !response._get_impl()->_get_file_body() && write_response_body_in_place(response))
+    {
+        return;
+    }
     async_write(&connection::handle_headers_written, response);
 }
 
 void connection::cancel_sending_response_with_error(const http_response &response, const std::exception_ptr &eptr)
 {
+    release_request_slot();
+
     auto * context = static_cast<linux_request_context*>(response._get_server_context());
     context->m_response_completed.set_exception(eptr);
     
@@ -702,9 +1056,10 @@ void connection::handle_write_chunked_response(const http_response &response, co
     {
         return cancel_sending_response_with_error(response, std::make_exception_ptr(http_exception("Response stream close early!")));
     }
-    auto membuf = m_response_buf.prepare(ChunkSize + http::details::chunked_encoding::additional_encoding_space);
+    const size_t chunkSize = m_write_chunk_size;
+    auto membuf = m_response_buf.prepare(chunkSize + http::details::chunked_encoding::additional_encoding_space);
 
-    readbuf.getn(buffer_cast<uint8_t *>(membuf) + http::details::chunked_encoding::data_offset, ChunkSize).then([=](pplx::task<size_t> actualSizeTask)
+    readbuf.getn(buffer_cast<uint8_t *>(membuf) + http::details::chunked_encoding::data_offset, chunkSize).then([=](pplx::task<size_t> actualSizeTask)
     {
         size_t actualSize = 0;
         try
@@ -714,13 +1069,107 @@ void connection::handle_write_chunked_response(const http_response &response, co
         {
             return cancel_sending_response_with_error(response, std::current_exception());
         }
-        size_t offset = http::details::chunked_encoding::add_chunked_delimiters(buffer_cast<uint8_t *>(membuf), ChunkSize+http::details::chunked_encoding::additional_encoding_space, actualSize);
+        size_t offset = http::details::chunked_encoding::add_chunked_delimiters(buffer_cast<uint8_t *>(membuf), chunkSize+http::details::chunked_encoding::additional_encoding_space, actualSize);
         m_response_buf.commit(actualSize + http::details::chunked_encoding::additional_encoding_space);
         m_response_buf.consume(offset);
+        grow_chunk_size(m_write_chunk_size, actualSize);
         async_write(actualSize == 0 ? &connection::handle_response_written : &connection::handle_write_chunked_response, response);
     });
 }
 
+void connection::handle_write_file_response(const http_response &response, const boost::system::error_code& ec)
+{
+    if (ec || m_write == m_write_size)
+        return handle_response_written(response, ec);
+
+    const auto &file = response._get_impl()->_get_file_body();
+#if defined(__linux__)
+    if (!m_ssl_stream)
+    {
+        // Let the kernel copy from the page cache to the socket until the socket buffer is full.
+        boost::system::error_code nonblocking_ec;
+        m_socket->native_non_blocking(true, nonblocking_ec);
+        ssize_t sent = 0;
+        int error = 0;
+        while (m_write < m_write_size)
+        {
+            off_t position = static_cast<off_t>(file->offset() + m_write);
+            sent = ::sendfile(m_socket->native_handle(), file->fd(), &position, m_write_size - m_write);
+            if (sent > 0)
+            {
+                m_write += static_cast<size_t>(sent);
+                count_sent(static_cast<size_t>(sent));
+            }
+            else if (sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                error = sent < 0 ? errno : 0;
+                break;
+            }
+        }
+        // The socket goes back to blocking mode for the other writes of the connection.
+        m_socket->native_non_blocking(false, nonblocking_ec);
+
+        if (m_write == m_write_size)
+        {
+            return handle_response_written(response, ec);
+        }
+        else if (sent == 0)
+        {
+            return cancel_sending_response_with_error(response, std::make_exception_ptr(http_exception("Response file ended early!")));
+        }
+        else if (error == EAGAIN || error == EWOULDBLOCK)
+        {
+            arm_timeout(m_body_timeout);
+            m_socket->async_write_some(null_buffers(), m_strand.wrap([=](const boost::system::error_code& ec, std::size_t)
+            {
+                disarm_timeout();
+                handle_write_file_response(response, ec);
+            }));
+            return;
+        }
+        else
+        {
+            return cancel_sending_response_with_error(response, std::make_exception_ptr(http_exception(error, "error sending response file")));
+        }
+    }
+#endif
+
+    // pread() may block on the disk, so it runs as a task of its own rather than in this handler.
+    const size_t readBytes = std::min(FileChunkSize, m_write_size - m_write);
+    uint8_t *buf = buffer_cast<uint8_t *>(m_response_buf.prepare(readBytes));
+    const off_t position = static_cast<off_t>(file->offset() + m_write);
+    pplx::create_task([file, buf, readBytes, position]() -> size_t
+    {
+        const auto actualSize = ::pread(file->fd(), buf, readBytes, position);
+        if (actualSize < 0)
+        {
+            throw http_exception(errno, "error reading response file");
+        }
+        else if (actualSize == 0)
+        {
+            throw http_exception("Response file ended early!");
+        }
+        return static_cast<size_t>(actualSize);
+    }).then([=](pplx::task<size_t> actualSizeTask)
+    {
+        size_t actualSize = 0;
+        try
+        {
+            actualSize = actualSizeTask.get();
+        } catch (...)
+        {
+            return cancel_sending_response_with_error(response, std::current_exception());
+        }
+        m_write += actualSize;
+        m_response_buf.commit(actualSize);
+        async_write(&connection::handle_write_file_response, response);
+    });
+}
+
 void connection::handle_write_large_response(const http_response &response, const boost::system::error_code& ec)
 {
     if (ec || m_write == m_write_size)
@@ -729,7 +1178,9 @@ void connection::handle_write_large_response(const http_response &response, cons
     auto readbuf = response._get_impl()->instream().streambuf();
     if (readbuf.is_eof())
         return cancel_sending_response_with_error(response, std::make_exception_ptr(http_exception("Response stream close early!")));
-    size_t readBytes = std::min(ChunkSize, m_write_size - m_write);
+    if (write_response_body_in_place(response))
+        return;
+    size_t readBytes = std::min(m_write_chunk_size, m_write_size - m_write);
     readbuf.getn(buffer_cast<uint8_t *>(m_response_buf.prepare(readBytes)), readBytes).then([=](pplx::task<size_t> actualSizeTask)
     {
         size_t actualSize = 0;
@@ -742,10 +1193,63 @@ void connection::handle_write_large_response(const http_response &response, cons
         }
         m_write += actualSize;
         m_response_buf.commit(actualSize);
+        grow_chunk_size(m_write_chunk_size, actualSize);
         async_write(&connection::handle_write_large_response, response);
     });
 }
 
+bool connection::write_response_body_in_place(const http_response &response)
+{
+    auto readbuf = response._get_impl()->instream().streambuf();
+    const size_t limit = std::min(InPlaceWriteSize, m_write_size - m_write);
+
+    // Headers which have not been sent yet lead the write.
+    const size_t headers = m_response_buf.size();
+    std::vector<const_buffer> buffers;
+    if (headers != 0)
+    {
+        buffers.push_back(buffer(m_response_buf.data()));
+    }
+
+    // A buffer chain hands out all of its blocks, any other stream buffer the one block acquire() returns.
+    size_t body = 0;
+    uint8_t *block = nullptr;
+    if (auto chain = std::dynamic_pointer_cast<concurrency::streams::details::basic_buffer_chain<uint8_t>>(readbuf.get_base()))
+    {
+        body = chain->peek_blocks(limit, [&buffers](const uint8_t *data, size_t count) { buffers.push_back(buffer(data, count)); });
+    }
+    else
+    {
+        size_t count = 0;
+        if (readbuf.acquire(block, count) && block != nullptr)
+        {
+            body = std::min(count, limit);
+            buffers.push_back(buffer(block, body));
+        }
+    }
+    if (body == 0)
+    {
+        // Nothing in memory, the body is copied through m_response_buf instead.
+        if (block != nullptr)
+            readbuf.release(block, 0);
+        return false;
+    }
+
+    async_write_buffers(buffers, [=](const boost::system::error_code& ec, std::size_t written)
+    {
+        const size_t sent = written > headers ? written - headers : 0;
+        m_response_buf.consume(std::min(written, headers));
+        auto source = readbuf;
+        if (block != nullptr)
+            source.release(block, sent);
+        else
+            source.seekoff(static_cast<concurrency::streams::streambuf<uint8_t>::off_type>(sent), std::ios_base::cur, std::ios_base::in);
+        m_write += sent;
+        handle_write_large_response(response, ec);
+    });
+    return true;
+}
+
 void connection::handle_headers_written(const http_response &response, const boost::system::error_code& ec)
 {
     if (ec)
@@ -754,7 +1258,9 @@ void connection::handle_headers_written(const http_response &response, const boo
     }
     else
     {
-        if (m_chunked)
+        if (response._get_impl()->_get_file_body())
+            handle_write_file_response(response, ec);
+        else if (m_chunked)
             handle_write_chunked_response(response, ec);
         else
             handle_write_large_response(response, ec);
@@ -770,10 +1276,13 @@ void connection::handle_response_written(const http_response &response, const bo
     }
     else
     {
+        release_request_slot();
+        m_p_parent->record_request(m_request_path, response.status_code(),
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_request_start));
         context->m_response_completed.set();
         if (!m_close)
         {
-            start_request_response();
+            wait_for_next_request();
         }
         else
         {
@@ -782,18 +1291,20 @@ void connection::handle_response_written(const http_response &response, const bo
     }
 }
 
-void connection::finish_request_response()
+void connection::release_request_slot()
 {
-    // kill the connection
+    if (m_holds_request_slot)
     {
-        pplx::scoped_lock<pplx::extensibility::recursive_lock_t> lock(m_p_parent->m_connections_lock);
-        m_p_parent->m_connections.erase(this);
-        if (m_p_parent->m_connections.empty())
-        {
-            m_p_parent->m_all_connections_complete.set();
-        }
+        m_holds_request_slot = false;
+        m_p_parent->release_request_slot();
     }
-    
+}
+
+void connection::finish_request_response()
+{
+    // kill the connection
+    m_p_parent->on_connection_closed(this);
+
     close();
     if (--m_refs == 0) delete this;
 }
@@ -804,6 +1315,7 @@ void hostport_listener::stop()
     {
         pplx::scoped_lock<pplx::extensibility::recursive_lock_t> lock(m_connections_lock);
         m_acceptor.reset();
+        m_timeout_timer.reset();
         for(auto connection : m_connections)
         {
             connection->close();
@@ -819,8 +1331,24 @@ void hostport_listener::add_listener(const std::string& path, web::http::experim
 
     if (m_is_https != (listener->uri().scheme() == U("https")))
         throw std::invalid_argument("Error: http_listener can not simultaneously listen both http and https paths of one host");
-    else if (!m_listeners.insert(std::map<std::string,web::http::experimental::listener::details::http_listener_impl*>::value_type(path, listener)).second)
+
+    // host and port listeners outlive their paths, so limits, timeouts and chunk sizes come from whichever listener now occupies it first
+    const bool first_listener = m_listeners.empty();
+    if (!m_listeners.insert(std::map<std::string,web::http::experimental::listener::details::http_listener_impl*>::value_type(path, listener)).second)
         throw std::invalid_argument("Error: http_listener is already registered for this path");
+
+    if (first_listener)
+    {
+        const auto &config = listener->configuration();
+        pplx::scoped_lock<pplx::extensibility::recursive_lock_t> connections_lock(m_connections_lock);
+        m_max_connections = config.max_connections();
+        m_max_concurrent_requests = config.max_concurrent_requests();
+        m_chunksize = config.chunksize();
+        m_adaptive_chunks = config.is_default_chunksize();
+        m_keep_alive_timeout = config.keep_alive_timeout();
+        m_header_timeout = config.header_timeout();
+        m_body_timeout = config.body_timeout();
+    }
 }
 
 void hostport_listener::remove_listener(const std::string& path, web::http::experimental::listener::details::http_listener_impl*)
@@ -971,6 +1499,19 @@ pplx::task<void> http_linux_server::unregister_listener(details::http_listener_i
     return pplx::task_from_result();
 }
 
+http_listener_metrics http_linux_server::metrics(details::http_listener_impl* listener)
+{
+    auto hostport = canonical_parts(listener->uri()).first;
+
+    pplx::extensibility::scoped_read_lock_t lock(m_listeners_lock);
+    auto itr = m_listeners.find(hostport);
+    if (itr == m_listeners.end())
+    {
+        return http_listener_metrics();
+    }
+    return itr->second->metrics();
+}
+
 pplx::task<void> http_linux_server::respond(http::http_response response)
 {
     details::linux_request_context * p_context = static_cast<details::linux_request_context*>(response._get_server_context());
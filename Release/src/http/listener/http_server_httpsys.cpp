@@ -281,12 +281,13 @@ pplx::task<void> http_windows_server::register_listener(_In_ web::http::experime
 
     // Set timeouts.
     HTTP_TIMEOUT_LIMIT_INFO timeouts;
-    const USHORT secs = static_cast<USHORT>(pListener->configuration().timeout().count());
-    timeouts.EntityBody = secs;
+    const auto &config = pListener->configuration();
+    const USHORT secs = static_cast<USHORT>(config.timeout().count());
+    timeouts.EntityBody = static_cast<USHORT>(config.body_timeout().count());
     timeouts.DrainEntityBody = secs;
     timeouts.RequestQueue = secs;
-    timeouts.IdleConnection = secs;
-    timeouts.HeaderWait = secs;
+    timeouts.IdleConnection = static_cast<USHORT>(config.keep_alive_timeout().count());
+    timeouts.HeaderWait = static_cast<USHORT>(config.header_timeout().count());
     timeouts.Flags.Present = 1;
     errorCode = HttpSetUrlGroupProperty(
         urlGroupId,
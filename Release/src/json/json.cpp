@@ -277,6 +277,99 @@ web::json::value web::json::value::array(std::vector<value> elements)
             );
 }
 
+namespace web { namespace json { namespace details {
+
+// A value of a document made immutable by value::shared(). The document is only read until the value is changed,
+// which copies the object or array into a node of its own; the members of that copy go on sharing the document.
+class _Shared : public _Value
+{
+public:
+    explicit _Shared(std::shared_ptr<const json::value> document) : m_document(std::move(document)) { }
+
+    virtual std::unique_ptr<_Value> _copy_value()
+    {
+        return m_own ? m_own->_copy_value() : utility::details::make_unique<_Shared>(m_document);
+    }
+
+    virtual bool has_field(const utility::string_t &key) const { return current().has_field(key); }
+    virtual value get_field(const utility::string_t &key) const { return current().get_field(key); }
+    virtual value get_element(array::size_type index) const { return current().get_element(index); }
+
+    virtual value &index(const utility::string_t &key) { return own().index(key); }
+    virtual value &index(array::size_type index) { return own().index(index); }
+
+    virtual const value &cnst_index(const utility::string_t &key) const { return current().cnst_index(key); }
+    virtual const value &cnst_index(array::size_type index) const { return current().cnst_index(index); }
+
+    virtual void serialize_impl(std::string& str) const { current().serialize_impl(str); }
+#ifdef _WIN32
+    virtual void serialize_impl(std::wstring& str) const { current().serialize_impl(str); }
+#endif
+
+    virtual utility::string_t to_string() const { return current().to_string(); }
+
+    virtual json::value::value_type type() const { return current().type(); }
+
+    virtual bool is_integer() const { return current().is_integer(); }
+    virtual bool is_double() const { return current().is_double(); }
+
+    // Only reads, despite not being const.
+    virtual const json::number& as_number() { return const_cast<_Value &>(current()).as_number(); }
+    virtual double as_double() const { return current().as_double(); }
+    virtual int as_integer() const { return current().as_integer(); }
+    virtual bool as_bool() const { return current().as_bool(); }
+    virtual json::array& as_array() { return own().as_array(); }
+    virtual const json::array& as_array() const { return current().as_array(); }
+    virtual json::object& as_object() { return own().as_object(); }
+    virtual const json::object& as_object() const { return current().as_object(); }
+    virtual const utility::string_t& as_string() const { return current().as_string(); }
+
+    virtual size_t size() const { return current().size(); }
+
+protected:
+    virtual void format(std::basic_string<char>& str) const { current().format(str); }
+#ifdef _WIN32
+    virtual void format(std::basic_string<wchar_t>& str) const { current().format(str); }
+#endif
+
+private:
+    const _Value &current() const
+    {
+        return m_own ? *m_own : *m_document->m_value;
+    }
+
+    _Value &own()
+    {
+        if (!m_own)
+        {
+            m_own = m_document->m_value->_copy_value();
+        }
+        return *m_own;
+    }
+
+    std::shared_ptr<const json::value> m_document;
+    std::unique_ptr<_Value> m_own;
+};
+
+}}}
+
+web::json::value web::json::value::shared(value document)
+{
+    if (!document.m_value->_share_members())
+    {
+        return document;
+    }
+#ifdef ENABLE_JSON_VALUE_VISUALIZER
+    const auto kind = document.m_kind;
+#endif
+    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Shared>(std::make_shared<value>(std::move(document)));
+    return web::json::value(std::move(ptr)
+#ifdef ENABLE_JSON_VALUE_VISUALIZER
+            ,kind
+#endif
+            );
+}
+
 const web::json::number& web::json::value::as_number() const
 {
     return m_value->as_number();
@@ -396,9 +489,6 @@ bool web::json::details::_Object::has_field(const utility::string_t &key) const
 
 utility::string_t json::value::to_string() const
 {
-#ifndef _WIN32
-    utility::details::scoped_c_thread_locale locale;
-#endif
     return m_value->to_string();
 }
 
@@ -420,9 +510,33 @@ bool json::value::operator==(const json::value &other) const
     case String:
         return this->as_string() == other.as_string();
     case Object:
-        return static_cast<const json::details::_Object*>(this->m_value.get())->is_equal(static_cast<const json::details::_Object*>(other.m_value.get()));
+        {
+            // Compared through the containers, since a lazily parsed value may not be an _Object itself.
+            const auto &thisObject = this->as_object();
+            const auto &otherObject = other.as_object();
+            if (thisObject.size() != otherObject.size())
+            {
+                return false;
+            }
+            const auto thisOrder = thisObject.ordered_fields();
+            const auto otherOrder = otherObject.ordered_fields();
+            for (size_t i = 0; i < thisObject.size(); ++i)
+            {
+                const auto &thisField = thisOrder.empty() ? *(thisObject.begin() + i) : *thisOrder[i];
+                const auto &otherField = otherOrder.empty() ? *(otherObject.begin() + i) : *otherOrder[i];
+                if (thisField != otherField)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
     case Array:
-        return static_cast<const json::details::_Array*>(this->m_value.get())->is_equal(static_cast<const json::details::_Array*>(other.m_value.get()));
+        {
+            const auto &thisArray = this->as_array();
+            const auto &otherArray = other.as_array();
+            return thisArray.size() == otherArray.size() && std::equal(thisArray.begin(), thisArray.end(), otherArray.begin());
+        }
     }
     __assume(0);
 }
@@ -0,0 +1,756 @@
+/***
+* ==++==
+*
+* Copyright (c) Microsoft Corporation. All rights reserved.
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* ==--==
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: CBOR and MessagePack encodings of JSON values
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "stdafx.h"
+#include <cmath>
+#include <cstring>
+
+using namespace web;
+using namespace web::json;
+
+namespace
+{
+    // Same limit as the text parser.
+#if defined(__APPLE__)
+    const size_t max_nesting = 32;
+#else
+    const size_t max_nesting = 128;
+#endif
+
+    const utility::string_t cbor_content_type = _XPLATSTR("application/cbor");
+    const utility::string_t msgpack_content_type = _XPLATSTR("application/msgpack");
+    const utility::string_t xmsgpack_content_type = _XPLATSTR("application/x-msgpack");
+
+    class binary_writer
+    {
+    public:
+        binary_writer(binary_format format, std::vector<unsigned char> &output)
+            : m_cbor(format == binary_format::cbor), m_output(output)
+        {
+        }
+
+        void write(const json::value &value)
+        {
+            switch (value.type())
+            {
+            case json::value::Null:
+                put(m_cbor ? 0xF6 : 0xC0);
+                break;
+            case json::value::Boolean:
+                put(m_cbor ? (value.as_bool() ? 0xF5 : 0xF4) : (value.as_bool() ? 0xC3 : 0xC2));
+                break;
+            case json::value::Number:
+                write_number(value.as_number());
+                break;
+            case json::value::String:
+                write_text(value.as_string());
+                break;
+            case json::value::Array:
+                {
+                    const auto &elements = value.as_array();
+                    write_container(false, elements.size());
+                    for (const auto &element : elements)
+                    {
+                        write(element);
+                    }
+                    break;
+                }
+            case json::value::Object:
+                {
+                    const auto &fields = value.as_object();
+                    const auto ordered = fields.ordered_fields();
+                    write_container(true, fields.size());
+                    for (size_t i = 0; i < fields.size(); ++i)
+                    {
+                        const auto &field = ordered.empty() ? *(fields.begin() + i) : *ordered[i];
+                        write_text(field.first);
+                        write(field.second);
+                    }
+                    break;
+                }
+            }
+        }
+
+    private:
+        void put(unsigned char byte)
+        {
+            m_output.push_back(byte);
+        }
+
+        // Appends the low bytes of a value, most significant first.
+        void put_big_endian(uint64_t value, size_t bytes)
+        {
+            while (bytes-- != 0)
+            {
+                put(static_cast<unsigned char>(value >> (bytes * 8)));
+            }
+        }
+
+        // The initial byte of a CBOR item followed by its argument, in as few bytes as hold it.
+        void put_cbor_head(unsigned char major, uint64_t argument)
+        {
+            major = static_cast<unsigned char>(major << 5);
+            if (argument < 24)
+            {
+                put(static_cast<unsigned char>(major | argument));
+            }
+            else if (argument <= 0xFF)
+            {
+                put(major | 24);
+                put_big_endian(argument, 1);
+            }
+            else if (argument <= 0xFFFF)
+            {
+                put(major | 25);
+                put_big_endian(argument, 2);
+            }
+            else if (argument <= 0xFFFFFFFF)
+            {
+                put(major | 26);
+                put_big_endian(argument, 4);
+            }
+            else
+            {
+                put(major | 27);
+                put_big_endian(argument, 8);
+            }
+        }
+
+        // The MessagePack header of a string, array or map too long for the fixed forms.
+        void put_msgpack_length(unsigned char code16, unsigned char code32, size_t length)
+        {
+            if (length <= 0xFFFF)
+            {
+                put(code16);
+                put_big_endian(length, 2);
+            }
+            else if (static_cast<uint64_t>(length) <= 0xFFFFFFFF)
+            {
+                put(code32);
+                put_big_endian(length, 4);
+            }
+            else
+            {
+                throw json_exception(_XPLATSTR("value too large for MessagePack"));
+            }
+        }
+
+        void write_number(const json::number &number)
+        {
+            if (!number.is_integral())
+            {
+                write_double(number.to_double());
+            }
+            else if (number.is_uint64())
+            {
+                write_unsigned(number.to_uint64());
+            }
+            else
+            {
+                write_negative(number.to_int64());
+            }
+        }
+
+        void write_unsigned(uint64_t value)
+        {
+            if (m_cbor)
+            {
+                put_cbor_head(0, value);
+            }
+            else if (value < 0x80)
+            {
+                put(static_cast<unsigned char>(value));
+            }
+            else if (value <= 0xFF)
+            {
+                put(0xCC);
+                put_big_endian(value, 1);
+            }
+            else if (value <= 0xFFFF)
+            {
+                put(0xCD);
+                put_big_endian(value, 2);
+            }
+            else if (value <= 0xFFFFFFFF)
+            {
+                put(0xCE);
+                put_big_endian(value, 4);
+            }
+            else
+            {
+                put(0xCF);
+                put_big_endian(value, 8);
+            }
+        }
+
+        void write_negative(int64_t value)
+        {
+            if (m_cbor)
+            {
+                put_cbor_head(1, static_cast<uint64_t>(-(value + 1)));
+            }
+            else if (value >= -32)
+            {
+                put(static_cast<unsigned char>(value));
+            }
+            else if (value >= INT8_MIN)
+            {
+                put(0xD0);
+                put_big_endian(static_cast<uint64_t>(value), 1);
+            }
+            else if (value >= INT16_MIN)
+            {
+                put(0xD1);
+                put_big_endian(static_cast<uint64_t>(value), 2);
+            }
+            else if (value >= INT32_MIN)
+            {
+                put(0xD2);
+                put_big_endian(static_cast<uint64_t>(value), 4);
+            }
+            else
+            {
+                put(0xD3);
+                put_big_endian(static_cast<uint64_t>(value), 8);
+            }
+        }
+
+        void write_double(double value)
+        {
+            // Single precision is enough for many values seen in practice, e.g. 0.5 or 1e10.
+            const float single = static_cast<float>(value);
+            if (static_cast<double>(single) == value || value != value)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &single, sizeof(bits));
+                put(m_cbor ? 0xFA : 0xCA);
+                put_big_endian(bits, 4);
+            }
+            else
+            {
+                uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                put(m_cbor ? 0xFB : 0xCB);
+                put_big_endian(bits, 8);
+            }
+        }
+
+        void write_text(const utility::string_t &text)
+        {
+#ifdef _UTF16_STRINGS
+            const std::string utf8 = utility::conversions::to_utf8string(text);
+#else
+            const std::string &utf8 = text;
+#endif
+            if (m_cbor)
+            {
+                put_cbor_head(3, utf8.size());
+            }
+            else if (utf8.size() < 32)
+            {
+                put(static_cast<unsigned char>(0xA0 | utf8.size()));
+            }
+            else if (utf8.size() <= 0xFF)
+            {
+                put(0xD9);
+                put_big_endian(utf8.size(), 1);
+            }
+            else
+            {
+                put_msgpack_length(0xDA, 0xDB, utf8.size());
+            }
+            m_output.insert(m_output.end(), utf8.begin(), utf8.end());
+        }
+
+        void write_container(bool is_object, size_t size)
+        {
+            if (m_cbor)
+            {
+                put_cbor_head(is_object ? 5 : 4, size);
+            }
+            else if (size < 16)
+            {
+                put(static_cast<unsigned char>((is_object ? 0x80 : 0x90) | size));
+            }
+            else
+            {
+                put_msgpack_length(is_object ? 0xDE : 0xDC, is_object ? 0xDF : 0xDD, size);
+            }
+        }
+
+        bool m_cbor;
+        std::vector<unsigned char> &m_output;
+    };
+
+    class binary_reader
+    {
+    public:
+        binary_reader(const unsigned char *data, size_t size, binary_format format)
+            : m_cbor(format == binary_format::cbor), m_position(data), m_end(data + size)
+        {
+        }
+
+        json::value read_document()
+        {
+            auto result = read_value(0);
+            if (m_position != m_end)
+            {
+                throw json_exception(_XPLATSTR("unexpected data after the binary JSON value"));
+            }
+            return result;
+        }
+
+    private:
+        void need(size_t count) const
+        {
+            if (static_cast<size_t>(m_end - m_position) < count)
+            {
+                throw json_exception(_XPLATSTR("unexpected end of binary JSON"));
+            }
+        }
+
+        // Every item takes at least one byte, which bounds the size of containers worth allocating for.
+        size_t item_count(uint64_t count) const
+        {
+            if (count > static_cast<uint64_t>(m_end - m_position))
+            {
+                throw json_exception(_XPLATSTR("unexpected end of binary JSON"));
+            }
+            return static_cast<size_t>(count);
+        }
+
+        unsigned char next()
+        {
+            need(1);
+            return *m_position++;
+        }
+
+        uint64_t read_big_endian(size_t bytes)
+        {
+            need(bytes);
+            uint64_t result = 0;
+            while (bytes-- != 0)
+            {
+                result = (result << 8) | *m_position++;
+            }
+            return result;
+        }
+
+        double read_single()
+        {
+            const uint32_t bits = static_cast<uint32_t>(read_big_endian(4));
+            float single;
+            std::memcpy(&single, &bits, sizeof(single));
+            return single;
+        }
+
+        double read_double()
+        {
+            const uint64_t bits = read_big_endian(8);
+            double result;
+            std::memcpy(&result, &bits, sizeof(result));
+            return result;
+        }
+
+        void append_text(std::string &text, uint64_t length)
+        {
+            need(item_count(length));
+            text.append(reinterpret_cast<const char *>(m_position), static_cast<size_t>(length));
+            m_position += length;
+        }
+
+        utility::string_t read_text(uint64_t length)
+        {
+            std::string text;
+            append_text(text, length);
+            return utility::conversions::to_string_t(std::move(text));
+        }
+
+        json::value read_value(size_t depth)
+        {
+            if (depth > max_nesting)
+            {
+                throw json_exception(_XPLATSTR("binary JSON nested too deeply"));
+            }
+            return m_cbor ? read_cbor(depth) : read_msgpack(depth);
+        }
+
+        json::value make_array(std::vector<json::value> &&elements)
+        {
+            return json::value::array(std::move(elements));
+        }
+
+        json::value make_object(std::vector<std::pair<utility::string_t, json::value>> &&fields)
+        {
+            return json::value::object(std::move(fields), json::details::g_keep_json_object_unsorted);
+        }
+
+        //
+        // CBOR
+        //
+
+        uint64_t read_cbor_argument(unsigned char info)
+        {
+            if (info < 24)
+            {
+                return info;
+            }
+            if (info > 27)
+            {
+                throw json_exception(_XPLATSTR("malformed CBOR item"));
+            }
+            return read_big_endian(static_cast<size_t>(1) << (info - 24));
+        }
+
+        // Indefinite length items end with a 'break' byte.
+        bool at_cbor_break()
+        {
+            need(1);
+            if (*m_position == 0xFF)
+            {
+                ++m_position;
+                return true;
+            }
+            return false;
+        }
+
+        utility::string_t read_cbor_text(unsigned char initial)
+        {
+            if ((initial >> 5) != 3)
+            {
+                throw json_exception(_XPLATSTR("CBOR map keys must be text strings"));
+            }
+            const unsigned char info = initial & 0x1F;
+            if (info != 31)
+            {
+                return read_text(read_cbor_argument(info));
+            }
+
+            std::string text;
+            while (!at_cbor_break())
+            {
+                const unsigned char chunk = next();
+                if ((chunk >> 5) != 3 || (chunk & 0x1F) == 31)
+                {
+                    throw json_exception(_XPLATSTR("malformed CBOR text string"));
+                }
+                append_text(text, read_cbor_argument(chunk & 0x1F));
+            }
+            return utility::conversions::to_string_t(std::move(text));
+        }
+
+        static double half_to_double(uint16_t half)
+        {
+            const int exponent = (half >> 10) & 0x1F;
+            const int mantissa = half & 0x3FF;
+            double result;
+            if (exponent == 0)
+            {
+                result = std::ldexp(static_cast<double>(mantissa), -24);
+            }
+            else if (exponent != 31)
+            {
+                result = std::ldexp(static_cast<double>(mantissa + 1024), exponent - 25);
+            }
+            else
+            {
+                result = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+            }
+            return (half & 0x8000) != 0 ? -result : result;
+        }
+
+        json::value read_cbor(size_t depth)
+        {
+            const unsigned char initial = next();
+            const unsigned char major = initial >> 5;
+            const unsigned char info = initial & 0x1F;
+            const bool indefinite = info == 31;
+            switch (major)
+            {
+            case 0:
+                return json::value::number(read_cbor_argument(info));
+            case 1:
+                {
+                    const uint64_t argument = read_cbor_argument(info);
+                    if (argument <= static_cast<uint64_t>(INT64_MAX))
+                    {
+                        return json::value::number(-1 - static_cast<int64_t>(argument));
+                    }
+                    return json::value::number(-1.0 - static_cast<double>(argument));
+                }
+            case 2:
+                throw json_exception(_XPLATSTR("CBOR byte strings have no JSON counterpart"));
+            case 3:
+                return json::value::string(read_cbor_text(initial));
+            case 4:
+                {
+                    std::vector<json::value> elements;
+                    if (indefinite)
+                    {
+                        while (!at_cbor_break())
+                        {
+                            elements.push_back(read_value(depth + 1));
+                        }
+                    }
+                    else
+                    {
+                        const size_t count = item_count(read_cbor_argument(info));
+                        elements.reserve(count);
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            elements.push_back(read_value(depth + 1));
+                        }
+                    }
+                    return make_array(std::move(elements));
+                }
+            case 5:
+                {
+                    std::vector<std::pair<utility::string_t, json::value>> fields;
+                    size_t count = 0;
+                    if (!indefinite)
+                    {
+                        count = item_count(read_cbor_argument(info));
+                        fields.reserve(count);
+                    }
+                    for (size_t i = 0; indefinite ? !at_cbor_break() : i < count; ++i)
+                    {
+                        auto key = read_cbor_text(next());
+                        fields.emplace_back(std::move(key), read_value(depth + 1));
+                    }
+                    return make_object(std::move(fields));
+                }
+            case 6:
+                // Tags only add meaning to the item which follows.
+                read_cbor_argument(info);
+                return read_value(depth + 1);
+            default:
+                switch (info)
+                {
+                case 20: return json::value::boolean(false);
+                case 21: return json::value::boolean(true);
+                case 22:
+                case 23: return json::value::null();
+                case 25: return json::value::number(half_to_double(static_cast<uint16_t>(read_big_endian(2))));
+                case 26: return json::value::number(read_single());
+                case 27: return json::value::number(read_double());
+                default: throw json_exception(_XPLATSTR("unsupported CBOR simple value"));
+                }
+            }
+        }
+
+        //
+        // MessagePack
+        //
+
+        utility::string_t read_msgpack_text(unsigned char code)
+        {
+            if ((code & 0xE0) == 0xA0)
+            {
+                return read_text(code & 0x1F);
+            }
+            switch (code)
+            {
+            case 0xD9: return read_text(read_big_endian(1));
+            case 0xDA: return read_text(read_big_endian(2));
+            case 0xDB: return read_text(read_big_endian(4));
+            default: throw json_exception(_XPLATSTR("MessagePack map keys must be strings"));
+            }
+        }
+
+        static int64_t sign_extend(uint64_t value, size_t bytes)
+        {
+            const unsigned shift = static_cast<unsigned>(64 - bytes * 8);
+            return static_cast<int64_t>(value << shift) >> shift;
+        }
+
+        json::value read_msgpack_array(size_t count, size_t depth)
+        {
+            count = item_count(count);
+            std::vector<json::value> elements;
+            elements.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                elements.push_back(read_value(depth + 1));
+            }
+            return make_array(std::move(elements));
+        }
+
+        json::value read_msgpack_map(size_t count, size_t depth)
+        {
+            count = item_count(count);
+            std::vector<std::pair<utility::string_t, json::value>> fields;
+            fields.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto key = read_msgpack_text(next());
+                fields.emplace_back(std::move(key), read_value(depth + 1));
+            }
+            return make_object(std::move(fields));
+        }
+
+        json::value read_msgpack(size_t depth)
+        {
+            const unsigned char code = next();
+            if (code <= 0x7F)
+            {
+                return json::value::number(static_cast<uint32_t>(code));
+            }
+            if (code >= 0xE0)
+            {
+                return json::value::number(static_cast<int32_t>(static_cast<signed char>(code)));
+            }
+            switch (code & 0xF0)
+            {
+            case 0x80: return read_msgpack_map(code & 0x0F, depth);
+            case 0x90: return read_msgpack_array(code & 0x0F, depth);
+            case 0xA0:
+            case 0xB0: return json::value::string(read_msgpack_text(code));
+            default: break;
+            }
+
+            switch (code)
+            {
+            case 0xC0: return json::value::null();
+            case 0xC2: return json::value::boolean(false);
+            case 0xC3: return json::value::boolean(true);
+            case 0xCA: return json::value::number(read_single());
+            case 0xCB: return json::value::number(read_double());
+            case 0xCC: return json::value::number(read_big_endian(1));
+            case 0xCD: return json::value::number(read_big_endian(2));
+            case 0xCE: return json::value::number(read_big_endian(4));
+            case 0xCF: return json::value::number(read_big_endian(8));
+            case 0xD0: return json::value::number(sign_extend(read_big_endian(1), 1));
+            case 0xD1: return json::value::number(sign_extend(read_big_endian(2), 2));
+            case 0xD2: return json::value::number(sign_extend(read_big_endian(4), 4));
+            case 0xD3: return json::value::number(static_cast<int64_t>(read_big_endian(8)));
+            case 0xD9:
+            case 0xDA:
+            case 0xDB: return json::value::string(read_msgpack_text(code));
+            case 0xDC: return read_msgpack_array(static_cast<size_t>(read_big_endian(2)), depth);
+            case 0xDD: return read_msgpack_array(static_cast<size_t>(read_big_endian(4)), depth);
+            case 0xDE: return read_msgpack_map(static_cast<size_t>(read_big_endian(2)), depth);
+            case 0xDF: return read_msgpack_map(static_cast<size_t>(read_big_endian(4)), depth);
+            default: throw json_exception(_XPLATSTR("MessagePack binary, extension and reserved types have no JSON counterpart"));
+            }
+        }
+
+        bool m_cbor;
+        const unsigned char *m_position;
+        const unsigned char *m_end;
+    };
+}
+
+void __cdecl web::json::encode_binary(const json::value &value, binary_format format, std::vector<unsigned char> &output)
+{
+    binary_writer(format, output).write(value);
+}
+
+std::vector<unsigned char> __cdecl web::json::encode_binary(const json::value &value, binary_format format)
+{
+    std::vector<unsigned char> output;
+    encode_binary(value, format, output);
+    return output;
+}
+
+json::value __cdecl web::json::decode_binary(const unsigned char *data, size_t size, binary_format format)
+{
+    return binary_reader(data, size, format).read_document();
+}
+
+json::value __cdecl web::json::decode_binary(const std::vector<unsigned char> &data, binary_format format)
+{
+    return decode_binary(data.data(), data.size(), format);
+}
+
+pplx::task<void> __cdecl web::json::write_binary(const json::value &value, binary_format format, concurrency::streams::streambuf<uint8_t> target)
+{
+    auto encoded = std::make_shared<std::vector<unsigned char>>();
+    try
+    {
+        encode_binary(value, format, *encoded);
+    }
+    catch (...)
+    {
+        return pplx::task_from_exception<void>(std::current_exception());
+    }
+
+    return target.putn_nocopy(encoded->data(), encoded->size()).then([encoded](size_t written)
+    {
+        if (written != encoded->size())
+        {
+            throw std::runtime_error("failed to write all bytes");
+        }
+    });
+}
+
+pplx::task<json::value> __cdecl web::json::read_binary(concurrency::streams::streambuf<uint8_t> source, binary_format format)
+{
+    // Collects the rest of the stream, then decodes it in one go.
+    struct read_state
+    {
+        concurrency::streams::streambuf<uint8_t> m_source;
+        std::vector<unsigned char> m_data;
+        size_t m_size;
+    };
+    auto state = std::make_shared<read_state>();
+    state->m_source = std::move(source);
+    state->m_size = 0;
+
+    auto read_chunk = [state]() -> pplx::task<bool>
+    {
+        const size_t chunk_size = (std::max)(static_cast<size_t>(4096), state->m_source.in_avail());
+        state->m_data.resize(state->m_size + chunk_size);
+        return state->m_source.getn(&state->m_data[state->m_size], chunk_size).then([state](size_t count)
+        {
+            state->m_size += count;
+            return count != 0;
+        });
+    };
+
+    return pplx::details::do_while(read_chunk).then([state, format](bool)
+    {
+        return decode_binary(state->m_data.data(), state->m_size, format);
+    });
+}
+
+const utility::string_t & __cdecl web::json::binary_content_type(binary_format format)
+{
+    return format == binary_format::cbor ? cbor_content_type : msgpack_content_type;
+}
+
+bool __cdecl web::json::binary_format_of(const utility::string_t &content_type, binary_format &format)
+{
+    if (utility::details::str_icmp(content_type, cbor_content_type))
+    {
+        format = binary_format::cbor;
+        return true;
+    }
+    if (utility::details::str_icmp(content_type, msgpack_content_type) || utility::details::str_icmp(content_type, xmsgpack_content_type))
+    {
+        format = binary_format::msgpack;
+        return true;
+    }
+    return false;
+}
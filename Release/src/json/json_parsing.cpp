@@ -25,6 +25,23 @@
 
 #include "stdafx.h"
 #include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <atomic>
+
+// String literals are scanned for the characters that need attention with SSE2 wherever the target has it,
+// and with AVX2 when the processor supports it and the compiler can target it per function.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPPREST_JSON_SCAN_SSE2
+#if defined(__x86_64__) && defined(__linux__) && !defined(__ANDROID__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CPPREST_JSON_SCAN_AVX2
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
 
 #if defined(_MSC_VER)
 #pragma warning(disable : 4127) // allow expressions like while(true) pass
@@ -72,6 +89,113 @@ void SetErrorCode(Token &tk, json_error jsonErrorCode)
     tk.m_error = std::error_code(jsonErrorCode, json_error_category());
 }
 
+// Monotonic allocator holding the nodes of one document parsed with parse_options::use_arena().
+// Every node keeps a reference, as does the parser until it is done, and the blocks are all freed
+// together when the last reference goes away. Only the parser allocates, but nodes can be released
+// from any thread.
+class json_arena
+{
+public:
+    json_arena()
+        : m_refs(1),
+          m_next(nullptr),
+          m_end(nullptr),
+          m_next_block_size(InitialBlockSize)
+    { }
+
+    // Returns storage for a node of the given size and alignment, preceded by a pointer back to the arena.
+    void *allocate_node(size_t size, size_t alignment)
+    {
+        auto node = align_up(m_next + sizeof(json_arena *), alignment);
+        if (m_next == nullptr || node + size > m_end)
+        {
+            add_block(size + sizeof(json_arena *) + alignment);
+            node = align_up(m_next + sizeof(json_arena *), alignment);
+        }
+        m_next = node + size;
+
+        *reinterpret_cast<json_arena **>(node - sizeof(json_arena *)) = this;
+        m_refs.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+
+    static void release_node(void *node)
+    {
+        (*reinterpret_cast<json_arena **>(static_cast<char *>(node) - sizeof(json_arena *)))->release();
+    }
+
+    void release()
+    {
+        if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+
+private:
+    // Blocks start small so tiny documents stay cheap, and double for large ones.
+    static const size_t InitialBlockSize = 4 * 1024;
+    static const size_t MaxBlockSize = 1024 * 1024;
+
+    ~json_arena()
+    {
+        for (auto block : m_blocks)
+        {
+            ::operator delete(block);
+        }
+    }
+
+    json_arena(const json_arena &);
+    json_arena &operator=(const json_arena &);
+
+    static char *align_up(char *p, size_t alignment)
+    {
+        return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(p) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+    }
+
+    void add_block(size_t minimum)
+    {
+        const size_t size = std::max(m_next_block_size, minimum);
+        m_next_block_size = m_next_block_size * 2 < MaxBlockSize ? m_next_block_size * 2 : MaxBlockSize;
+
+        m_blocks.push_back(nullptr);
+        m_blocks.back() = ::operator new(size);
+        m_next = static_cast<char *>(m_blocks.back());
+        m_end = m_next + size;
+    }
+
+    std::atomic<size_t> m_refs;
+    std::vector<void *> m_blocks;
+    char *m_next;
+    char *m_end;
+    size_t m_next_block_size;
+};
+
+// A node allocated from a json_arena. Deleting it through a pointer to _Value runs the destructor as usual
+// and then hands the memory back to the arena instead of the heap.
+template <typename Node>
+class _Arena_node : public Node
+{
+public:
+    template <typename... Args>
+    _Arena_node(Args&&... args) : Node(std::forward<Args>(args)...) { }
+
+    static void *operator new(size_t size, json_arena &arena)
+    {
+        return arena.allocate_node(size, std::alignment_of<_Arena_node>::value);
+    }
+
+    static void operator delete(void *p, json_arena &)
+    {
+        json_arena::release_node(p);
+    }
+
+    static void operator delete(void *p)
+    {
+        json_arena::release_node(p);
+    }
+};
+
 template <typename CharType>
 class JSON_Parser
 {
@@ -79,9 +203,31 @@ public:
     JSON_Parser()
         : m_currentLine(1),
           m_currentColumn(1),
-          m_currentParsingDepth(0)
+          m_currentParsingDepth(0),
+          m_arena(nullptr),
+          m_intern_keys(false),
+          m_position(nullptr),
+          m_startpos(nullptr),
+          m_endpos(nullptr)
     { }
 
+    virtual ~JSON_Parser()
+    {
+        if (m_arena != nullptr)
+        {
+            m_arena->release();
+        }
+    }
+
+    void ApplyOptions(const web::json::parse_options &options)
+    {
+        if (options.use_arena() && m_arena == nullptr)
+        {
+            m_arena = new json_arena();
+        }
+        m_intern_keys = options.intern_keys();
+    }
+
     struct Location
     {
         size_t m_line;
@@ -133,10 +279,6 @@ public:
 
     web::json::value ParseValue(typename JSON_Parser<CharType>::Token &first)
     {
-#ifndef _WIN32
-        utility::details::scoped_c_thread_locale locale;
-#endif
-
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
         auto _value = _ParseValue(first);
         auto type = _value->type();
@@ -148,13 +290,65 @@ public:
 
 protected:
     typedef typename std::char_traits<CharType>::int_type int_type;
-    virtual int_type NextCharacter() = 0;
-    virtual int_type PeekCharacter() = 0;
+
+    // Characters are taken straight from the part of the input held in memory, [m_position, m_endpos),
+    // so that parsing a string or buffer involves no virtual call per character.
+    int_type NextCharacter()
+    {
+        if (m_position == m_endpos)
+            return NextUnbufferedCharacter();
+
+        CharType ch = *m_position;
+        m_position += 1;
+
+        if ( ch == '\n' )
+        {
+            m_currentLine += 1;
+            m_currentColumn = 0;
+        }
+        else
+        {
+            m_currentColumn += 1;
+        }
+
+        return ch;
+    }
+
+    int_type PeekCharacter()
+    {
+        if ( m_position == m_endpos ) return PeekUnbufferedCharacter();
+
+        return *m_position;
+    }
+
+    // Reads input which isn't held in memory, such as the rest of a stream.
+    virtual int_type NextUnbufferedCharacter() { return std::char_traits<CharType>::eof(); }
+    virtual int_type PeekUnbufferedCharacter() { return std::char_traits<CharType>::eof(); }
 
     virtual bool CompleteComment(Token &token);
     virtual bool CompleteStringLiteral(Token &token);
     bool handle_unescape_char(Token &token);
 
+    // Lets a parser replace a value nested in an object or array with a node which parses it later.
+    // Returns null to have the value parsed right away; otherwise the token following the value has been read.
+    virtual std::unique_ptr<web::json::details::_Value> DeferValue(Token &)
+    {
+        return nullptr;
+    }
+
+    // Checks the syntax of the value starting at the given token without building it, stopping at its last token.
+    bool SkipValue(Token &tkn);
+
+    template <typename Node, typename... Args>
+    std::unique_ptr<Node> CreateNode(Args&&... args)
+    {
+        if (m_arena != nullptr)
+        {
+            return std::unique_ptr<Node>(new (*m_arena) _Arena_node<Node>(std::forward<Args>(args)...));
+        }
+        return utility::details::make_unique<Node>(std::forward<Args>(args)...);
+    }
+
 private:
 
     bool CompleteNumberLiteral(CharType first, Token &token);
@@ -165,6 +359,8 @@ private:
     std::unique_ptr<web::json::details::_Value> _ParseValue(typename JSON_Parser<CharType>::Token &first);
     std::unique_ptr<web::json::details::_Value> _ParseObject(typename JSON_Parser<CharType>::Token &tkn);
     std::unique_ptr<web::json::details::_Value> _ParseArray(typename JSON_Parser<CharType>::Token &tkn);
+    const utility::string_t &InternKey(size_t depth, size_t position, const std::basic_string<CharType> &name, bool &matches);
+    void SortFields(size_t depth, bool matches, json::object::storage_type &elems);
 
     JSON_Parser& operator=(const JSON_Parser&);
 
@@ -190,6 +386,22 @@ protected:
     size_t m_currentLine;
     size_t m_currentColumn;
     size_t m_currentParsingDepth;
+    json_arena *m_arena;
+
+    // With parse_options::intern_keys(), the field names of the last object parsed at each depth, in the
+    // order they appeared, and the positions they take once sorted.
+    struct ObjectLayout
+    {
+        std::vector<std::basic_string<CharType>> m_names;
+        std::vector<utility::string_t> m_keys;
+        std::vector<size_t> m_sorted;
+    };
+    bool m_intern_keys;
+    std::vector<ObjectLayout> m_layouts;
+
+    const CharType* m_position;
+    const CharType* m_startpos;
+    const CharType* m_endpos;
 
 // The DEBUG macro is defined in XCode but we don't in our CMakeList
 // so for now we will keep the same on debug and release. In the future
@@ -219,8 +431,8 @@ public:
 
 protected:
 
-    virtual typename JSON_Parser<CharType>::int_type NextCharacter();
-    virtual typename JSON_Parser<CharType>::int_type PeekCharacter();
+    virtual typename JSON_Parser<CharType>::int_type NextUnbufferedCharacter();
+    virtual typename JSON_Parser<CharType>::int_type PeekUnbufferedCharacter();
 
 private:
     typename std::basic_streambuf<CharType, std::char_traits<CharType>>* m_streambuf;
@@ -231,62 +443,71 @@ class JSON_StringParser : public JSON_Parser<CharType>
 {
 public:
     JSON_StringParser(const std::basic_string<CharType>& string)
-        : m_position(&string[0])
     {
-        m_startpos = m_position;
-        m_endpos = m_position+string.size();
+        this->m_position = this->m_startpos = string.data();
+        this->m_endpos = this->m_position + string.size();
     }
 
-protected:
+    JSON_StringParser(const CharType* begin, const CharType* end)
+    {
+        this->m_position = this->m_startpos = begin;
+        this->m_endpos = end;
+    }
 
-    virtual typename JSON_Parser<CharType>::int_type NextCharacter();
-    virtual typename JSON_Parser<CharType>::int_type PeekCharacter();
+protected:
 
-    virtual bool CompleteComment(typename JSON_Parser<CharType>::Token &token);
     virtual bool CompleteStringLiteral(typename JSON_Parser<CharType>::Token &token);
 
 private:
     bool finish_parsing_string_with_unescape_char(typename JSON_Parser<CharType>::Token &token);
-    const CharType* m_position;
-    const CharType* m_startpos;
-    const CharType* m_endpos;
 };
 
-
-template <typename CharType>
-typename JSON_Parser<CharType>::int_type JSON_StreamParser<CharType>::NextCharacter()
+// Tokenizes the part of a json_reader's input which has arrived so far. A token running into the end of
+// that input may have been cut short, so the reader rewinds and tokenizes it again once more has arrived.
+class JSON_ReaderParser : public JSON_StringParser<char>
 {
-    auto ch = m_streambuf->sbumpc();
+public:
+    JSON_ReaderParser()
+        : JSON_StringParser<char>(nullptr, nullptr)
+    {
+    }
 
-    if (ch == '\n')
+    struct Checkpoint
     {
-        this->m_currentLine += 1;
-        this->m_currentColumn = 0;
+        size_t m_line;
+        size_t m_column;
+        size_t m_depth;
+    };
+
+    Checkpoint Save() const
+    {
+        Checkpoint checkpoint = { m_currentLine, m_currentColumn, m_currentParsingDepth };
+        return checkpoint;
     }
-    else
+
+    void Restore(const Checkpoint &checkpoint)
     {
-        this->m_currentColumn += 1;
+        m_currentLine = checkpoint.m_line;
+        m_currentColumn = checkpoint.m_column;
+        m_currentParsingDepth = checkpoint.m_depth;
     }
 
-    return ch;
-}
+    void SetInput(const char *begin, const char *end)
+    {
+        m_position = m_startpos = begin;
+        m_endpos = end;
+    }
+
+    const char *Position() const { return m_position; }
+};
 
-template <typename CharType>
-typename JSON_Parser<CharType>::int_type JSON_StreamParser<CharType>::PeekCharacter()
-{
-    return m_streambuf->sgetc();
-}
 
 template <typename CharType>
-typename JSON_Parser<CharType>::int_type JSON_StringParser<CharType>::NextCharacter()
+typename JSON_Parser<CharType>::int_type JSON_StreamParser<CharType>::NextUnbufferedCharacter()
 {
-    if (m_position == m_endpos)
-        return eof<CharType>();
-
-    CharType ch = *m_position;
-    m_position += 1;
+    auto ch = m_streambuf->sbumpc();
 
-    if ( ch == '\n' )
+    if (ch == '\n')
     {
         this->m_currentLine += 1;
         this->m_currentColumn = 0;
@@ -300,11 +521,9 @@ typename JSON_Parser<CharType>::int_type JSON_StringParser<CharType>::NextCharac
 }
 
 template <typename CharType>
-typename JSON_Parser<CharType>::int_type JSON_StringParser<CharType>::PeekCharacter()
+typename JSON_Parser<CharType>::int_type JSON_StreamParser<CharType>::PeekUnbufferedCharacter()
 {
-    if ( m_position == m_endpos ) return eof<CharType>();
-
-    return *m_position;
+    return m_streambuf->sgetc();
 }
 
 //
@@ -390,42 +609,495 @@ inline bool JSON_Parser<CharType>::ParseInt64(CharType first, uint64_t& value)
 // This namespace hides the x-plat helper functions
 namespace
 {
-#if defined(_WIN32)
-    static int print_llu(char* ptr, size_t n, uint64_t val64)
+    // Significands of 5^q for q in [smallest_power_of_five, largest_power_of_five], normalized to 128 bits
+    // (truncated, or rounded up for negative q) and stored as two words, most significant first.
+    const int smallest_power_of_five = -342;
+    const int largest_power_of_five = 308;
+    const uint64_t power_of_five_128[] = {
+    0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL, 0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL,
+    0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL, 0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL,
+    0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL, 0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL,
+    0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL, 0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL,
+    0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL, 0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL,
+    0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL, 0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL,
+    0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL, 0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL,
+    0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL, 0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL,
+    0x84a57695fe98746dULL, 0x014bb630f7604b57ULL, 0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL,
+    0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL, 0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL,
+    0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL, 0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL,
+    0xfd00b897478238d0ULL, 0x8920b098955522b4ULL, 0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL,
+    0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL, 0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL,
+    0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL, 0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL,
+    0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL, 0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL,
+    0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL, 0xeba09271e88d976bULL, 0xf7864a44c633682eULL,
+    0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL, 0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL,
+    0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL, 0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL,
+    0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL, 0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL,
+    0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL, 0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL,
+    0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL, 0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL,
+    0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL, 0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL,
+    0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL, 0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL,
+    0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL, 0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL,
+    0xa37fce126597973cULL, 0xe50ff107bab528a0ULL, 0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL,
+    0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL, 0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL,
+    0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL, 0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL,
+    0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL, 0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL,
+    0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL, 0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL,
+    0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL, 0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL,
+    0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL, 0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL,
+    0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL, 0x91376c36d99995beULL, 0x23100809b9c21fa1ULL,
+    0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL, 0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL,
+    0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL, 0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL,
+    0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL, 0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL,
+    0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL, 0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL,
+    0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL, 0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL,
+    0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL, 0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL,
+    0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL, 0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL,
+    0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL, 0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL,
+    0xc987434744ac874eULL, 0xa327ffb266b56220ULL, 0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL,
+    0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL, 0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL,
+    0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL, 0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL,
+    0xc0314325637a1939ULL, 0xfa911155fefb5308ULL, 0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL,
+    0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL, 0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL,
+    0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL, 0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL,
+    0xb749faed14125d36ULL, 0xcef980ec671f667bULL, 0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL,
+    0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL, 0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL,
+    0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL, 0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL,
+    0xaecc49914078536dULL, 0x58fae9f773886e18ULL, 0xda7f5bf590966848ULL, 0xaf39a475506a899eULL,
+    0x888f99797a5e012dULL, 0x6d8406c952429603ULL, 0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL,
+    0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL, 0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL,
+    0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL, 0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL,
+    0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL, 0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL,
+    0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL, 0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL,
+    0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL, 0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL,
+    0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL, 0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL,
+    0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL, 0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL,
+    0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL, 0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL,
+    0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL, 0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL,
+    0xb913179899f68584ULL, 0x28e2557b59846e3fULL, 0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL,
+    0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL, 0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL,
+    0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL, 0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL,
+    0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL, 0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL,
+    0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL, 0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL,
+    0xd77485cb25823ac7ULL, 0x7d633293366b828bULL, 0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL,
+    0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL, 0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL,
+    0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL, 0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL,
+    0xcd795be870516656ULL, 0x67902e276c921f8bULL, 0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL,
+    0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL, 0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL,
+    0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL, 0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL,
+    0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL, 0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL,
+    0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL, 0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL,
+    0xef340a98172aace4ULL, 0x86fb897116c87c34ULL, 0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL,
+    0xbae0a846d2195712ULL, 0x8974836059cca109ULL, 0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL,
+    0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL, 0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL,
+    0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL, 0x8e938662882af53eULL, 0x547eb47b7282ee9cULL,
+    0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL, 0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL,
+    0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL, 0xae0b158b4738705eULL, 0x9624ab50b148d445ULL,
+    0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL, 0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL,
+    0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL, 0xd47487cc8470652bULL, 0x7647c3200069671fULL,
+    0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL, 0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL,
+    0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL, 0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL,
+    0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL, 0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL,
+    0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL, 0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL,
+    0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL, 0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL,
+    0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL, 0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL,
+    0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL, 0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL,
+    0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL, 0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL,
+    0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL, 0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL,
+    0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL, 0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL,
+    0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL, 0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL,
+    0x8c974f7383725573ULL, 0x1e414218c73a13fbULL, 0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL,
+    0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL, 0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL,
+    0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL, 0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL,
+    0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL, 0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL,
+    0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL, 0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL,
+    0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL, 0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL,
+    0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL, 0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL,
+    0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL, 0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL,
+    0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL, 0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL,
+    0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL, 0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL,
+    0xbe89523386091465ULL, 0xf6bbb397f1135823ULL, 0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL,
+    0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL, 0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL,
+    0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL, 0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL,
+    0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL, 0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL,
+    0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL, 0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL,
+    0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL, 0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL,
+    0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL, 0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL,
+    0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL, 0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL,
+    0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL, 0x843610cb4bf160cbULL, 0xcedf722a585139baULL,
+    0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL, 0xce947a3da6a9273eULL, 0x733d226229feea32ULL,
+    0x811ccc668829b887ULL, 0x0806357d5a3f525fULL, 0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL,
+    0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL, 0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL,
+    0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL, 0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL,
+    0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL, 0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL,
+    0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL, 0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL,
+    0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL, 0xbbe226efb628afeaULL, 0x890489f70a55368bULL,
+    0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL, 0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL,
+    0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL, 0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL,
+    0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL, 0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL,
+    0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL, 0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL,
+    0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL, 0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL,
+    0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL, 0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL,
+    0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL, 0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL,
+    0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL, 0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL,
+    0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL, 0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL,
+    0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL, 0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL,
+    0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL, 0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL,
+    0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL, 0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL,
+    0xc24452da229b021bULL, 0xfbe85badce996168ULL, 0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL,
+    0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL, 0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL,
+    0xed246723473e3813ULL, 0x290123e9aab23b68ULL, 0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL,
+    0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL, 0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL,
+    0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL, 0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL,
+    0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL, 0x8d590723948a535fULL, 0x579c487e5a38ad0eULL,
+    0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL, 0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL,
+    0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL, 0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL,
+    0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL, 0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL,
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL, 0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL, 0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL, 0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL, 0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL, 0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL, 0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL, 0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL, 0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL, 0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL, 0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL, 0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL, 0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL, 0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL, 0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL, 0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL, 0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL, 0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL, 0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL, 0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+    0xc612062576589ddaULL, 0x95364afe032a819eULL, 0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL, 0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL, 0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL, 0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL, 0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL, 0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL, 0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL, 0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL, 0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL, 0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL, 0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL, 0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL, 0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL, 0xa000000000000000ULL, 0x0000000000000000ULL,
+    0xc800000000000000ULL, 0x0000000000000000ULL, 0xfa00000000000000ULL, 0x0000000000000000ULL,
+    0x9c40000000000000ULL, 0x0000000000000000ULL, 0xc350000000000000ULL, 0x0000000000000000ULL,
+    0xf424000000000000ULL, 0x0000000000000000ULL, 0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xbebc200000000000ULL, 0x0000000000000000ULL, 0xee6b280000000000ULL, 0x0000000000000000ULL,
+    0x9502f90000000000ULL, 0x0000000000000000ULL, 0xba43b74000000000ULL, 0x0000000000000000ULL,
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL, 0x9184e72a00000000ULL, 0x0000000000000000ULL,
+    0xb5e620f480000000ULL, 0x0000000000000000ULL, 0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL, 0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL, 0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL, 0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+    0x878678326eac9000ULL, 0x0000000000000000ULL, 0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL, 0x84595161401484a0ULL, 0x0000000000000000ULL,
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL, 0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+    0x813f3978f8940984ULL, 0x4000000000000000ULL, 0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL, 0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL, 0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL, 0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL, 0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL, 0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL, 0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL, 0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL, 0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL, 0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL, 0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL, 0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL, 0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL, 0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL, 0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL, 0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL, 0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL, 0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL, 0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL,
+    0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL, 0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL,
+    0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL, 0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL,
+    0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL, 0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL,
+    0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL, 0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL,
+    0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL, 0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL,
+    0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL, 0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL,
+    0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL, 0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL,
+    0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL, 0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL,
+    0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL, 0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL,
+    0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL, 0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL,
+    0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL, 0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL,
+    0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL, 0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL,
+    0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL, 0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL,
+    0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL, 0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL,
+    0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL, 0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL,
+    0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL, 0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL,
+    0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL, 0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL,
+    0x924d692ca61be758ULL, 0x593c2626705f9c56ULL, 0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL,
+    0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL, 0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL,
+    0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL, 0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL,
+    0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL, 0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL,
+    0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL, 0x884134fe908658b2ULL, 0x3109058d147fdcddULL,
+    0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL, 0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL,
+    0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL, 0xa6539930bf6bff45ULL, 0x84db8346b786151cULL,
+    0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL, 0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL,
+    0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL, 0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL,
+    0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL, 0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL,
+    0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL, 0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL,
+    0x9ae757596946075fULL, 0x3375788de9b06958ULL, 0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL,
+    0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL, 0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL,
+    0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL, 0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL,
+    0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL, 0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL,
+    0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL, 0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL,
+    0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL, 0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL,
+    0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL, 0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL,
+    0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL, 0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL,
+    0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL, 0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL,
+    0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL, 0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL,
+    0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL, 0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL,
+    0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL, 0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL,
+    0x802221226be55a64ULL, 0xc2494954da2c9789ULL, 0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL,
+    0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL, 0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL,
+    0x9c69a97284b578d7ULL, 0xff2a760414536efbULL, 0xc38413cf25e2d70dULL, 0xfef5138519684abaULL,
+    0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL, 0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL,
+    0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL, 0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL,
+    0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL, 0xba756174393d88dfULL, 0x94f971119aeef9e4ULL,
+    0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL, 0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL,
+    0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL, 0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL,
+    0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL, 0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL,
+    0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL, 0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL,
+    0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL, 0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL,
+    0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL, 0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL,
+    0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL, 0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL,
+    0xa59bc234db398c25ULL, 0x43fab9837e699095ULL, 0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL,
+    0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL, 0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL,
+    0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL, 0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL,
+    0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL, 0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL,
+    0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL, 0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL,
+    0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL, 0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL,
+    0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL, 0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL,
+    0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL, 0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL,
+    0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL, 0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL,
+    0x8fa475791a569d10ULL, 0xf96e017d694487bcULL, 0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL,
+    0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL, 0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL,
+    0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL, 0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL,
+    0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL, 0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL,
+    0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL, 0x85c7056562757456ULL, 0xf6872d5667844e49ULL,
+    0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL, 0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL,
+    0x82a45b450226b39cULL, 0xecc0024661173473ULL, 0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL,
+    0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL, 0xff290242c83396ceULL, 0x7e67047175a15271ULL,
+    0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL, 0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL,
+    0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL, 0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL,
+    0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL, 0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL,
+    0x98165af37b2153deULL, 0xc3727a337a8b704aULL, 0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL,
+    0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL, 0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL,
+    0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL, 0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL,
+    0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL, 0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL,
+    0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL, 0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL,
+    0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL, 0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL,
+    0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL, 0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL,
+    0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL, 0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL,
+    0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL, 0xd31045a8341ca07cULL, 0x1ede48111209a050ULL,
+    0x83ea2b892091e44dULL, 0x934aed0aab460432ULL, 0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL,
+    0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL, 0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL,
+    0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL, 0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL,
+    0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL, 0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL,
+    0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL, 0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL,
+    0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL, 0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL,
+    0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL, 0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL,
+    0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL, 0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL,
+    0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL, 0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL,
+    0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL, 0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL,
+    0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL, 0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL,
+    0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL, 0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL,
+    0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL, 0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL,
+    0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL, 0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL,
+    0x8533285c936b35deULL, 0xd53a88958f87275fULL, 0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL,
+    0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL, 0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL,
+    0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL, 0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL,
+    0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL, 0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL,
+    0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL, 0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL,
+    0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL, 0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL,
+    0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL, 0x976e41088617ca01ULL, 0xd5be0503e085d813ULL,
+    0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL, 0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL,
+    0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL, 0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL,
+    0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL, 0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL,
+    0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL, 0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL,
+    0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL, 0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL,
+    0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL, 0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL,
+    0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL, 0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL,
+    0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL, 0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL,
+    0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL, 0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL,
+    0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL, 0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL,
+    0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL, 0xa0555e361951c366ULL, 0xd7e105bcc332621fULL,
+    0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL, 0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL,
+    0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL, 0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL,
+    0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL, 0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL,
+    0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL, 0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL,
+    0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL, 0xbaa718e68396cffdULL, 0xd30560258f54e6baULL,
+    0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL, 0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL,
+    0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL, 0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL,
+    0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL
+    };
+
+    const double exact_powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    struct uint128_parts
     {
-        return _snprintf_s_l(ptr, n, _TRUNCATE, "%I64u", utility::details::scoped_c_thread_locale::c_locale(), val64);
-    }
+        uint64_t low;
+        uint64_t high;
+    };
 
-    static int print_llu(wchar_t* ptr, size_t n, uint64_t val64)
+    inline uint128_parts full_multiplication(uint64_t a, uint64_t b)
     {
-        return _snwprintf_s_l(ptr, n, _TRUNCATE, L"%I64u", utility::details::scoped_c_thread_locale::c_locale(), val64);
+        uint128_parts result;
+#if defined(__SIZEOF_INT128__)
+        // __extension__ keeps -pedantic builds quiet about the non-standard type.
+        __extension__ typedef unsigned __int128 uint128_type;
+        const uint128_type product = static_cast<uint128_type>(a) * b;
+        result.low = static_cast<uint64_t>(product);
+        result.high = static_cast<uint64_t>(product >> 64);
+#else
+        const uint64_t a_low = a & 0xFFFFFFFF, a_high = a >> 32;
+        const uint64_t b_low = b & 0xFFFFFFFF, b_high = b >> 32;
+        const uint64_t low_low = a_low * b_low;
+        const uint64_t high_low = a_high * b_low;
+        const uint64_t cross = (low_low >> 32) + (high_low & 0xFFFFFFFF) + a_low * b_high;
+        result.high = a_high * b_high + (high_low >> 32) + (cross >> 32);
+        result.low = (cross << 32) | (low_low & 0xFFFFFFFF);
+#endif
+        return result;
     }
-    static double anystod(const char* str)
+
+    inline int leading_zeroes(uint64_t value)
     {
-        return _strtod_l(str, nullptr, utility::details::scoped_c_thread_locale::c_locale());
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(value);
+#else
+        int count = 0;
+        while ((value >> 63) == 0)
+        {
+            value <<= 1;
+            ++count;
+        }
+        return count;
+#endif
     }
-    static double anystod(const wchar_t* str)
+
+    // Converts significand * 10^exponent exactly when both fit in a double, as then a single rounding happens.
+    inline bool fast_path_to_double(uint64_t significand, int64_t exponent, double &result)
     {
-        return _wcstod_l(str, nullptr, utility::details::scoped_c_thread_locale::c_locale());
-    }
+#if (defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0) || defined(_M_X64) || defined(_M_ARM64)
+        if (significand <= (static_cast<uint64_t>(1) << 53) && exponent >= -22 && exponent <= 22)
+        {
+            result = static_cast<double>(significand);
+            result = exponent < 0 ? result / exact_powers_of_ten[-exponent] : result * exact_powers_of_ten[exponent];
+            return true;
+        }
 #else
-    static int __attribute__((__unused__)) print_llu(char* ptr, size_t n, unsigned long long val64)
-    {
-        return snprintf(ptr, n, "%llu", val64);
+        (void)significand; (void)exponent; (void)result;
+#endif
+        return false;
     }
-    static int __attribute__((__unused__)) print_llu(char* ptr, size_t n, unsigned long val64)
+
+    // Converts significand * 10^exponent to the nearest double with the Eisel-Lemire algorithm. Returns false
+    // for the rare products too close to a halfway point to decide, and for subnormal results.
+    bool eisel_lemire_to_double(uint64_t significand, int64_t exponent, double &result)
     {
-        return snprintf(ptr, n, "%lu", val64);
+        if (significand == 0 || exponent < smallest_power_of_five)
+        {
+            result = 0.0;
+            return true;
+        }
+        if (exponent > largest_power_of_five)
+        {
+            result = std::numeric_limits<double>::infinity();
+            return true;
+        }
+
+        const int shift = leading_zeroes(significand);
+        significand <<= shift;
+
+        // The top 55 bits of the product decide the result, the second word is only needed when the bits below them are all ones.
+        const size_t index = 2 * static_cast<size_t>(exponent - smallest_power_of_five);
+        auto product = full_multiplication(significand, power_of_five_128[index]);
+        const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> 55;
+        if ((product.high & precision_mask) == precision_mask)
+        {
+            const auto second = full_multiplication(significand, power_of_five_128[index + 1]);
+            product.low += second.high;
+            if (second.high > product.low)
+            {
+                ++product.high;
+            }
+        }
+        if (product.low == 0xFFFFFFFFFFFFFFFFULL)
+        {
+            return false;
+        }
+
+        const int upper_bit = static_cast<int>(product.high >> 63);
+        uint64_t mantissa = product.high >> (upper_bit + 9);
+        int64_t power2 = (((152170 + 65536) * exponent) >> 16) + 63 + upper_bit - shift + 1023;
+        if (power2 <= 0)
+        {
+            return false;
+        }
+
+        // Exactly halfway between two doubles, which can only happen for small exponents: round to even.
+        if (product.low <= 1 && exponent >= -4 && exponent <= 23 && (mantissa & 3) == 1
+            && (mantissa << (upper_bit + 9)) == product.high)
+        {
+            mantissa &= ~static_cast<uint64_t>(1);
+        }
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        if (mantissa >= (static_cast<uint64_t>(2) << 52))
+        {
+            mantissa = static_cast<uint64_t>(1) << 52;
+            ++power2;
+        }
+        mantissa &= ~(static_cast<uint64_t>(1) << 52);
+        if (power2 >= 0x7FF)
+        {
+            result = std::numeric_limits<double>::infinity();
+            return true;
+        }
+
+        const uint64_t bits = mantissa | (static_cast<uint64_t>(power2) << 52);
+        std::memcpy(&result, &bits, sizeof(result));
+        return true;
     }
-    static double __attribute__((__unused__)) anystod(const char* str)
+
+    double strtod_c_locale(const char* str)
     {
+#if defined(_WIN32)
+        return _strtod_l(str, nullptr, utility::details::scoped_c_thread_locale::c_locale());
+#elif defined(ANDROID) || defined(__ANDROID__)
         return strtod(str, nullptr);
+#else
+        return strtod_l(str, nullptr, utility::details::scoped_c_thread_locale::c_locale());
+#endif
     }
-    static double __attribute__((__unused__)) anystod(const wchar_t* str)
+
+    void append_decimal(std::string &str, uint64_t value)
     {
-        return wcstod(str, nullptr);
+        char digits[20];
+        size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (count != 0)
+        {
+            str.push_back(digits[--count]);
+        }
     }
-#endif
 }
 
 template <typename CharType>
@@ -486,13 +1158,13 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token &token)
         return true;
     }
 
-    // Magic number 5 leaves room for decimal point, null terminator, etc (in most cases)
-    ::std::vector<CharType> buf(::std::numeric_limits<uint64_t>::digits10 + 5);
-    int count = print_llu(buf.data(), buf.size(), val64);
-    _ASSERTE(count >= 0);
-    _ASSERTE((size_t)count < buf.size());
-    // Resize to cut off the null terminator
-    buf.resize(count);
+    // The number is significand * 10^exponent. Digits which no longer fit in the significand are kept as
+    // text so that strtod can convert the number exactly, which is also used in the rare cases the fast
+    // conversions can't decide.
+    uint64_t significand = val64;
+    int64_t exponent = 0;
+    bool truncated = !complete;
+    std::string extra_digits;
 
     bool decimal = false;
 
@@ -501,7 +1173,20 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token &token)
         // Digit encountered?
         if (ch >= '0' && ch <= '9')
         {
-            buf.push_back(static_cast<CharType>(ch));
+            const unsigned int digit = static_cast<unsigned int>(ch - '0');
+            if (!truncated && significand <= (ULLONG_MAX - digit) / 10)
+            {
+                significand = significand * 10 + digit;
+            }
+            else
+            {
+                truncated = true;
+                extra_digits.push_back(static_cast<char>(ch));
+            }
+            if (decimal)
+            {
+                --exponent;
+            }
             NextCharacter();
             ch = PeekCharacter();
         }
@@ -513,7 +1198,6 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token &token)
                 return false;
 
             decimal = true;
-            buf.push_back(static_cast<CharType>(ch));
 
             NextCharacter();
             ch = PeekCharacter();
@@ -521,49 +1205,44 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token &token)
             // Check that the following char is a digit
             if (ch < '0' || ch > '9')
             return false;
-
-            buf.push_back(static_cast<CharType>(ch));
-            NextCharacter();
-            ch = PeekCharacter();
         }
 
         // Exponent?
         else if (ch == 'E' || ch == 'e')
         {
-            buf.push_back(static_cast<CharType>(ch));
             NextCharacter();
             ch = PeekCharacter();
 
             // Check for the exponent sign
+            bool negative_exponent = false;
             if (ch == '+')
             {
-                buf.push_back(static_cast<CharType>(ch));
                 NextCharacter();
                 ch = PeekCharacter();
             }
             else if (ch == '-')
             {
-                buf.push_back(static_cast<CharType>(ch));
+                negative_exponent = true;
                 NextCharacter();
                 ch = PeekCharacter();
             }
 
             // First number of the exponent
-            if (ch >= '0' && ch <= '9')
-            {
-                buf.push_back(static_cast<CharType>(ch));
-                NextCharacter();
-                ch = PeekCharacter();
-            }
-            else return false;
+            if (ch < '0' || ch > '9')
+                return false;
 
-            // The rest of the exponent
+            // The exponent saturates far beyond the range of a double
+            int64_t exponent_value = 0;
             while (ch >= '0' && ch <= '9')
             {
-                buf.push_back(static_cast<CharType>(ch));
+                if (exponent_value < 100000000)
+                {
+                    exponent_value = exponent_value * 10 + (ch - '0');
+                }
                 NextCharacter();
                 ch = PeekCharacter();
             }
+            exponent += negative_exponent ? -exponent_value : exponent_value;
 
             // The peeked character is not a number, so we can break from the loop and construct the number
             break;
@@ -575,12 +1254,21 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token &token)
         }
     };
 
-    buf.push_back('\0');
-    token.double_val = anystod(buf.data());
-    if (minus_sign)
+    double value;
+    if (truncated || !(fast_path_to_double(significand, exponent, value) || eisel_lemire_to_double(significand, exponent, value)))
     {
-        token.double_val = -token.double_val;
+        std::string text;
+        append_decimal(text, significand);
+        text += extra_digits;
+        text.push_back('e');
+        if (exponent < 0)
+        {
+            text.push_back('-');
+        }
+        append_decimal(text, static_cast<uint64_t>(exponent < 0 ? -exponent : exponent));
+        value = strtod_c_locale(text.c_str());
     }
+    token.double_val = minus_sign ? -value : value;
     token.kind = (JSON_Parser<CharType>::Token::TKN_NumberLiteral);
 
     return true;
@@ -644,84 +1332,25 @@ bool JSON_Parser<CharType>::CompleteComment(Token &token)
     return true;
 }
 
-template <typename CharType>
-bool JSON_StringParser<CharType>::CompleteComment(typename JSON_Parser<CharType>::Token &token)
+void convert_append_unicode_code_unit(JSON_Parser<wchar_t>::Token &token, utf16char value)
 {
-    // This function is specialized for the string parser, since we can be slightly more
-    // efficient in copying data from the input to the token: do a memcpy() rather than
-    // one character at a time.
-
-    auto ch = JSON_StringParser<CharType>::NextCharacter();
-
-    if ( ch == eof<CharType>() || (ch != '/' && ch != '*') )
-        return false;
-
-    if ( ch == '/' )
-    {
-        // Line comment -- look for a newline or EOF to terminate.
+    token.string_val.push_back(value);
+}
+void convert_append_unicode_code_unit(JSON_Parser<char>::Token &token, utf16char value)
+{
+    utf16string utf16(reinterpret_cast<utf16char *>(&value), 1);
+    token.string_val.append(::utility::conversions::utf16_to_utf8(utf16));
+}
 
-        ch = JSON_StringParser<CharType>::NextCharacter();
+template <typename CharType>
+inline bool JSON_Parser<CharType>::handle_unescape_char(Token &token)
+{
+    token.has_unescape_symbol = true;
 
-        while ( ch != eof<CharType>() && ch != '\n')
-        {
-            ch = JSON_StringParser<CharType>::NextCharacter();
-        }
-    }
-    else
-    {
-        // Block comment -- look for a terminating "*/" sequence.
-
-        ch = JSON_StringParser<CharType>::NextCharacter();
-
-        while ( true )
-        {
-            if ( ch == eof<CharType>())
-                return false;
-
-            if ( ch == '*' )
-            {
-                ch = JSON_StringParser<CharType>::PeekCharacter();
-
-                if ( ch == eof<CharType>())
-                    return false;
-
-                if ( ch == '/' )
-                {
-                    // Consume the character
-                    JSON_StringParser<CharType>::NextCharacter();
-                    break;
-                }
-
-            }
-
-            ch = JSON_StringParser<CharType>::NextCharacter();
-        }
-    }
-
-    token.kind = JSON_Parser<CharType>::Token::TKN_Comment;
-
-    return true;
-}
-
-void convert_append_unicode_code_unit(JSON_Parser<wchar_t>::Token &token, utf16char value)
-{
-    token.string_val.push_back(value);
-}
-void convert_append_unicode_code_unit(JSON_Parser<char>::Token &token, utf16char value)
-{
-    utf16string utf16(reinterpret_cast<utf16char *>(&value), 1);
-    token.string_val.append(::utility::conversions::utf16_to_utf8(utf16));
-}
-
-template <typename CharType>
-inline bool JSON_Parser<CharType>::handle_unescape_char(Token &token)
-{
-    token.has_unescape_symbol = true;
-
-    // This function converts unescaped character pairs (e.g. "\t") into their ASCII or Unicode representations (e.g. tab sign)
-    // Also it handles \u + 4 hexadecimal digits
-    auto ch = NextCharacter();
-    switch (ch)
+    // This function converts unescaped character pairs (e.g. "\t") into their ASCII or Unicode representations (e.g. tab sign)
+    // Also it handles \u + 4 hexadecimal digits
+    auto ch = NextCharacter();
+    switch (ch)
     {
         case '\"':
             token.string_val.push_back('\"');
@@ -758,16 +1387,9 @@ inline bool JSON_Parser<CharType>::handle_unescape_char(Token &token)
                 int ch_int = static_cast<int>(ch);
                 if (ch_int < 0 || ch_int > 127)
                     return false;
-#ifdef _WIN32
-                const int isxdigitResult = _isxdigit_l(ch_int, utility::details::scoped_c_thread_locale::c_locale());
-#else
-                const int isxdigitResult = isxdigit(ch_int);
-#endif
-                if (!isxdigitResult)
-                    return false;
-
                 int val = _hexval[static_cast<size_t>(ch_int)];
-                _ASSERTE(val != -1);
+                if (val == -1)
+                    return false;
 
                 // Add the input char to the decoded number
                 decoded |= (val << (4 * (3 - i)));
@@ -820,47 +1442,154 @@ bool JSON_Parser<CharType>::CompleteStringLiteral(Token &token)
     return true;
 }
 
+// Returns the first character in [first, last) that a string literal cannot simply copy: a quote, a backslash,
+// a control character, or one which reads back as eof() through NextCharacter().
+template <typename CharType>
+inline const CharType* find_string_special_scalar(const CharType* first, const CharType* last)
+{
+    for (; first != last; ++first)
+    {
+        const CharType ch = *first;
+        if (ch == '"' || ch == '\\' || (ch >= CharType(0x0) && ch < CharType(0x20))
+            || static_cast<typename std::char_traits<CharType>::int_type>(ch) == eof<CharType>())
+        {
+            return first;
+        }
+    }
+    return last;
+}
+
+#if defined(CPPREST_JSON_SCAN_SSE2)
+inline size_t count_trailing_zeros(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+}
+
+// Skips whole 16 byte blocks without a character of interest. Bytes are flagged when they are a quote, a backslash,
+// no greater than 0x1F, or 0xFF (eof() where char is signed); the scalar code sorts out what they really are.
+inline const char* skip_plain_string_sse2(const char* first, const char* last)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    const __m128i all_ones = _mm_set1_epi8(-1);
+    while (last - first >= 16)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(chars, control), chars));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(chars, all_ones));
+        const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(special));
+        if (mask != 0)
+        {
+            return first + count_trailing_zeros(mask);
+        }
+        first += 16;
+    }
+    return first;
+}
+#endif
+
+#if defined(CPPREST_JSON_SCAN_AVX2)
+// Same as skip_plain_string_sse2() on 32 byte blocks, only called once the processor is known to support AVX2.
+__attribute__((target("avx2")))
+inline const char* skip_plain_string_avx2(const char* first, const char* last)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    const __m256i all_ones = _mm256_set1_epi8(-1);
+    while (last - first >= 32)
+    {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chars, quote), _mm256_cmpeq_epi8(chars, backslash));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(_mm256_min_epu8(chars, control), chars));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(chars, all_ones));
+        const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(special));
+        if (mask != 0)
+        {
+            return first + count_trailing_zeros(mask);
+        }
+        first += 32;
+    }
+    return first;
+}
+#endif
+
+template <typename CharType>
+inline const CharType* find_string_special(const CharType* first, const CharType* last)
+{
+    return find_string_special_scalar(first, last);
+}
+
+template <>
+inline const char* find_string_special<char>(const char* first, const char* last)
+{
+#if defined(CPPREST_JSON_SCAN_AVX2)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2") != 0;
+    if (has_avx2)
+    {
+        first = skip_plain_string_avx2(first, last);
+    }
+#endif
+#if defined(CPPREST_JSON_SCAN_SSE2)
+    first = skip_plain_string_sse2(first, last);
+#endif
+    return find_string_special_scalar(first, last);
+}
+
 template <typename CharType>
 bool JSON_StringParser<CharType>::CompleteStringLiteral(typename JSON_Parser<CharType>::Token &token)
 {
     // This function is specialized for the string parser, since we can be slightly more
-    // efficient in copying data from the input to the token: do a memcpy() rather than
-    // one character at a time.
+    // efficient in copying data from the input to the token: find the next character which
+    // needs attention in one pass, then memcpy() everything before it.
 
-    auto start = m_position;
+    auto start = this->m_position;
     token.has_unescape_symbol = false;
 
-    auto ch = JSON_StringParser<CharType>::NextCharacter();
-
-    while (ch != '"')
+    while (true)
     {
+        // Runs of plain characters can't contain a newline, so only the column moves.
+        const CharType* special = find_string_special(this->m_position, this->m_endpos);
+        this->m_currentColumn += static_cast<size_t>(special - this->m_position);
+        this->m_position = special;
+
+        auto ch = this->NextCharacter();
+        if (ch == '"')
+            break;
+
         if (ch == eof<CharType>())
             return false;
 
         if (ch == '\\')
         {
-            const size_t numChars = m_position - start - 1;
+            const size_t numChars = this->m_position - start - 1;
             const size_t prevSize = token.string_val.size();
             token.string_val.resize(prevSize + numChars);
             memcpy(const_cast<CharType *>(token.string_val.c_str() + prevSize), start, numChars * sizeof(CharType));
 
-            if (!JSON_StringParser<CharType>::handle_unescape_char(token))
+            if (!this->handle_unescape_char(token))
             {
                 return false;
             }
 
             // Reset start position and continue.
-            start = m_position;
+            start = this->m_position;
         }
         else if (ch >= CharType(0x0) && ch < CharType(0x20))
         {
             return false;
         }
-
-        ch = JSON_StringParser<CharType>::NextCharacter();
     }
 
-    const size_t numChars = m_position - start - 1;
+    const size_t numChars = this->m_position - start - 1;
     const size_t prevSize = token.string_val.size();
     token.string_val.resize(prevSize + numChars);
     memcpy(const_cast<CharType *>(token.string_val.c_str() + prevSize), start, numChars * sizeof(CharType));
@@ -974,9 +1703,21 @@ try_again:
 template <typename CharType>
 std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(typename JSON_Parser<CharType>::Token &tkn)
 {
-    auto obj = utility::details::make_unique<web::json::details::_Object>(g_keep_json_object_unsorted);
+    auto obj = CreateNode<web::json::details::_Object>(g_keep_json_object_unsorted);
     auto& elems = obj->m_object.m_elements;
 
+    const size_t depth = m_currentParsingDepth;
+    bool matchesLayout = false;
+    if (m_intern_keys)
+    {
+        if (m_layouts.size() < depth)
+        {
+            m_layouts.resize(depth);
+        }
+        matchesLayout = !m_layouts[depth - 1].m_names.empty();
+        elems.reserve(m_layouts[depth - 1].m_names.size());
+    }
+
     GetNextToken(tkn);
     if (tkn.m_error) goto error;
 
@@ -985,11 +1726,18 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
         while (true)
         {
             // State 1: New field or end of object, looking for field name or closing brace
-            std::basic_string<CharType> fieldName;
+            utility::string_t fieldName;
             switch (tkn.kind)
             {
             case JSON_Parser<CharType>::Token::TKN_StringLiteral:
-                fieldName = std::move(tkn.string_val);
+                if (m_intern_keys)
+                {
+                    fieldName = InternKey(depth, elems.size(), tkn.string_val, matchesLayout);
+                }
+                else
+                {
+                    fieldName = utility::conversions::to_string_t(std::move(tkn.string_val));
+                }
                 break;
             default:
                 goto error;
@@ -1005,12 +1753,16 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
             if (tkn.m_error) goto error;
 
             // State 3: Looking for an expression.
+            auto fieldValue = DeferValue(tkn);
+            if (!fieldValue)
+            {
+                fieldValue = _ParseValue(tkn);
+            }
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
-            auto fieldValue = _ParseValue(tkn);
             auto type = fieldValue->type();
-            elems.emplace_back(utility::conversions::to_string_t(std::move(fieldName)), json::value(std::move(fieldValue), type));
+            elems.emplace_back(std::move(fieldName), json::value(std::move(fieldValue), type));
 #else
-            elems.emplace_back(utility::conversions::to_string_t(std::move(fieldName)), json::value(_ParseValue(tkn)));
+            elems.emplace_back(std::move(fieldName), json::value(std::move(fieldValue)));
 #endif
             if (tkn.m_error) goto error;
 
@@ -1031,9 +1783,13 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
 
 done:
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return CreateNode<web::json::details::_Null>();
 
-    if (!g_keep_json_object_unsorted) {
+    if (m_intern_keys)
+    {
+        SortFields(depth, matchesLayout, elems);
+    }
+    else if (!g_keep_json_object_unsorted) {
         ::std::sort(elems.begin(), elems.end(), json::object::compare_pairs);
     }
 
@@ -1044,45 +1800,121 @@ error:
     {
         SetErrorCode(tkn, json_error::malformed_object_literal);
     }
-    return utility::details::make_unique<web::json::details::_Null>();
+    return CreateNode<web::json::details::_Null>();
+}
+
+template <typename CharType>
+const utility::string_t &JSON_Parser<CharType>::InternKey(size_t depth, size_t position, const std::basic_string<CharType> &name, bool &matches)
+{
+    auto &layout = m_layouts[depth - 1];
+    if (matches && position < layout.m_names.size() && layout.m_names[position] == name)
+    {
+        return layout.m_keys[position];
+    }
+
+    // This object differs from the last one at its depth from here on, so it replaces that one's layout.
+    matches = false;
+    layout.m_names.resize(position);
+    layout.m_keys.resize(position);
+    layout.m_names.push_back(name);
+    layout.m_keys.push_back(utility::conversions::to_string_t(name));
+    return layout.m_keys.back();
+}
+
+template <typename CharType>
+void JSON_Parser<CharType>::SortFields(size_t depth, bool matches, json::object::storage_type &elems)
+{
+    auto &layout = m_layouts[depth - 1];
+    if (!matches || elems.size() != layout.m_names.size())
+    {
+        layout.m_names.resize(elems.size());
+        layout.m_keys.resize(elems.size());
+        layout.m_sorted.clear();
+    }
+    if (g_keep_json_object_unsorted)
+    {
+        return;
+    }
+
+    if (layout.m_sorted.size() != elems.size())
+    {
+        layout.m_sorted.resize(elems.size());
+        for (size_t i = 0; i < layout.m_sorted.size(); ++i)
+        {
+            layout.m_sorted[i] = i;
+        }
+        const auto &keys = layout.m_keys;
+        std::sort(layout.m_sorted.begin(), layout.m_sorted.end(), [&keys](size_t left, size_t right)
+        {
+            return keys[left] < keys[right];
+        });
+    }
+
+    // Moves the field which appeared at m_sorted[i] into place i, following where earlier swaps took it.
+    const auto &sorted = layout.m_sorted;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        size_t from = sorted[i];
+        while (from < i)
+        {
+            from = sorted[from];
+        }
+        if (from != i)
+        {
+            std::swap(elems[i], elems[from]);
+        }
+    }
 }
 
 template <typename CharType>
 std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseArray(typename JSON_Parser<CharType>::Token &tkn)
 {
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return CreateNode<web::json::details::_Null>();
 
-    auto result = utility::details::make_unique<web::json::details::_Array>();
+    auto result = CreateNode<web::json::details::_Array>();
 
     if (tkn.kind != JSON_Parser<CharType>::Token::TKN_CloseBracket)
     {
         while (true)
         {
             // State 1: Looking for an expression.
-            result->m_array.m_elements.emplace_back(ParseValue(tkn));
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+            auto element = DeferValue(tkn);
+            if (element)
+            {
+#ifdef ENABLE_JSON_VALUE_VISUALIZER
+                auto type = element->type();
+                result->m_array.m_elements.emplace_back(json::value(std::move(element), type));
+#else
+                result->m_array.m_elements.emplace_back(json::value(std::move(element)));
+#endif
+            }
+            else
+            {
+                result->m_array.m_elements.emplace_back(ParseValue(tkn));
+            }
+            if (tkn.m_error) return CreateNode<web::json::details::_Null>();
 
             // State 4: Looking for a comma or a closing bracket
             switch (tkn.kind)
             {
             case JSON_Parser<CharType>::Token::TKN_Comma:
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                if (tkn.m_error) return CreateNode<web::json::details::_Null>();
                 break;
             case JSON_Parser<CharType>::Token::TKN_CloseBracket:
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                if (tkn.m_error) return CreateNode<web::json::details::_Null>();
                 return std::move(result);
             default:
                 SetErrorCode(tkn, json_error::malformed_array_literal);
-                return utility::details::make_unique<web::json::details::_Null>();
+                return CreateNode<web::json::details::_Null>();
             }
         }
     }
 
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return CreateNode<web::json::details::_Null>();
 
     return std::move(result);
 }
@@ -1102,150 +1934,1120 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseValue(t
             }
         case JSON_Parser<CharType>::Token::TKN_StringLiteral:
             {
-                auto value = utility::details::make_unique<web::json::details::_String>(std::move(tkn.string_val), tkn.has_unescape_symbol);
+                auto value = CreateNode<web::json::details::_String>(std::move(tkn.string_val), tkn.has_unescape_symbol);
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                if (tkn.m_error) return CreateNode<web::json::details::_Null>();
                 return std::move(value);
             }
         case JSON_Parser<CharType>::Token::TKN_IntegerLiteral:
             {
                 std::unique_ptr<web::json::details::_Number> value;
                 if (tkn.signed_number)
-                    value = utility::details::make_unique<web::json::details::_Number>(tkn.int64_val);
+                    value = CreateNode<web::json::details::_Number>(tkn.int64_val);
                 else
-                    value = utility::details::make_unique<web::json::details::_Number>(tkn.uint64_val);
+                    value = CreateNode<web::json::details::_Number>(tkn.uint64_val);
 
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                if (tkn.m_error) return CreateNode<web::json::details::_Null>();
                 return std::move(value);
             }
         case JSON_Parser<CharType>::Token::TKN_NumberLiteral:
             {
-                auto value = utility::details::make_unique<web::json::details::_Number>(tkn.double_val);
+                auto value = CreateNode<web::json::details::_Number>(tkn.double_val);
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                if (tkn.m_error) return CreateNode<web::json::details::_Null>();
                 return std::move(value);
             }
         case JSON_Parser<CharType>::Token::TKN_BooleanLiteral:
             {
-                auto value = utility::details::make_unique<web::json::details::_Boolean>(tkn.boolean_val);
+                auto value = CreateNode<web::json::details::_Boolean>(tkn.boolean_val);
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                if (tkn.m_error) return CreateNode<web::json::details::_Null>();
                 return std::move(value);
             }
         case JSON_Parser<CharType>::Token::TKN_NullLiteral:
             {
                 GetNextToken(tkn);
                 // Returning a null value whether or not an error occurred.
-                return utility::details::make_unique<web::json::details::_Null>();
+                return CreateNode<web::json::details::_Null>();
             }
         default:
             {
                 SetErrorCode(tkn, json_error::malformed_token);
-                return utility::details::make_unique<web::json::details::_Null>();
+                return CreateNode<web::json::details::_Null>();
             }
     }
 }
 
-}}}
-
-static web::json::value _parse_stream(utility::istream_t &stream)
+template <typename CharType>
+bool JSON_Parser<CharType>::SkipValue(typename JSON_Parser<CharType>::Token &tkn)
 {
-    web::json::details::JSON_StreamParser<utility::char_t> parser(stream);
-    web::json::details::JSON_Parser<utility::char_t>::Token tkn;
-
-    parser.GetNextToken(tkn);
-    if (tkn.m_error)
+    switch (tkn.kind)
     {
-        web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
-    }
+    case JSON_Parser<CharType>::Token::TKN_OpenBrace:
+        GetNextToken(tkn);
+        if (tkn.m_error) return false;
+        if (tkn.kind == JSON_Parser<CharType>::Token::TKN_CloseBrace) return true;
 
-    auto value = parser.ParseValue(tkn);
-    if (tkn.m_error)
-    {
-        web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
-    }
-    else if (tkn.kind != web::json::details::JSON_Parser<utility::char_t>::Token::TKN_EOF)
-    {
-        web::json::details::CreateException(tkn, _XPLATSTR("Left-over characters in stream after parsing a JSON value"));
+        while (true)
+        {
+            if (tkn.kind != JSON_Parser<CharType>::Token::TKN_StringLiteral) break;
+
+            GetNextToken(tkn);
+            if (tkn.m_error) return false;
+            if (tkn.kind != JSON_Parser<CharType>::Token::TKN_Colon) break;
+
+            GetNextToken(tkn);
+            if (tkn.m_error || !SkipValue(tkn)) return false;
+
+            GetNextToken(tkn);
+            if (tkn.m_error) return false;
+            if (tkn.kind == JSON_Parser<CharType>::Token::TKN_CloseBrace) return true;
+            if (tkn.kind != JSON_Parser<CharType>::Token::TKN_Comma) break;
+
+            GetNextToken(tkn);
+            if (tkn.m_error) return false;
+        }
+        SetErrorCode(tkn, json_error::malformed_object_literal);
+        return false;
+
+    case JSON_Parser<CharType>::Token::TKN_OpenBracket:
+        GetNextToken(tkn);
+        if (tkn.m_error) return false;
+        if (tkn.kind == JSON_Parser<CharType>::Token::TKN_CloseBracket) return true;
+
+        while (true)
+        {
+            if (!SkipValue(tkn)) return false;
+
+            GetNextToken(tkn);
+            if (tkn.m_error) return false;
+            if (tkn.kind == JSON_Parser<CharType>::Token::TKN_CloseBracket) return true;
+            if (tkn.kind != JSON_Parser<CharType>::Token::TKN_Comma) break;
+
+            GetNextToken(tkn);
+            if (tkn.m_error) return false;
+        }
+        SetErrorCode(tkn, json_error::malformed_array_literal);
+        return false;
+
+    case JSON_Parser<CharType>::Token::TKN_StringLiteral:
+    case JSON_Parser<CharType>::Token::TKN_IntegerLiteral:
+    case JSON_Parser<CharType>::Token::TKN_NumberLiteral:
+    case JSON_Parser<CharType>::Token::TKN_BooleanLiteral:
+    case JSON_Parser<CharType>::Token::TKN_NullLiteral:
+        return true;
+
+    default:
+        SetErrorCode(tkn, json_error::malformed_token);
+        return false;
     }
-    return value;
 }
 
-static web::json::value _parse_stream(utility::istream_t &stream, std::error_code& error)
+// Placeholder for a value of a document parsed with parse_options::lazy(), holding the range of the
+// document's text the value was read from. The value is parsed the first time anything but its type is needed.
+class _Deferred : public _Value
 {
-    web::json::details::JSON_StreamParser<utility::char_t> parser(stream);
-    web::json::details::JSON_Parser<utility::char_t>::Token tkn;
-
-    parser.GetNextToken(tkn);
-    if (tkn.m_error)
+public:
+    _Deferred(std::shared_ptr<const utility::string_t> source, const utility::char_t *begin, const utility::char_t *end,
+              const parse_options &options)
+        : m_source(std::move(source)),
+          m_begin(begin),
+          m_end(end),
+          m_type(*begin == '{' ? json::value::Object : (*begin == '[' ? json::value::Array : json::value::String)),
+          m_options(options),
+          m_parsed(false)
     {
-        error = std::move(tkn.m_error);
-        return web::json::value();
     }
 
-    auto returnObject = parser.ParseValue(tkn);
-    if (tkn.kind != web::json::details::JSON_Parser<utility::char_t>::Token::TKN_EOF)
+    virtual std::unique_ptr<_Value> _copy_value()
     {
-        web::json::details::SetErrorCode(tkn, web::json::details::json_error::left_over_character_in_stream);
+        if (m_parsed.load(std::memory_order_acquire))
+        {
+            return m_value.m_value->_copy_value();
+        }
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_parsed.load(std::memory_order_relaxed))
+        {
+            return m_value.m_value->_copy_value();
+        }
+        return utility::details::make_unique<_Deferred>(m_source, m_begin, m_end, m_options);
     }
 
-    error = std::move(tkn.m_error);
-    return returnObject;
-}
+    // Shared as a whole, so that the copies parse it only once between them.
+    virtual bool _share_members() { return true; }
+
+    virtual bool has_field(const utility::string_t &key) const { return parsed()->has_field(key); }
+    virtual value get_field(const utility::string_t &key) const { return parsed()->get_field(key); }
+    virtual value get_element(array::size_type index) const { return parsed()->get_element(index); }
+
+    virtual value &index(const utility::string_t &key) { return parsed()->index(key); }
+    virtual value &index(array::size_type index) { return parsed()->index(index); }
 
+    virtual const value &cnst_index(const utility::string_t &key) const { return parsed()->cnst_index(key); }
+    virtual const value &cnst_index(array::size_type index) const { return parsed()->cnst_index(index); }
+
+    virtual void serialize_impl(std::string& str) const { parsed()->serialize_impl(str); }
 #ifdef _WIN32
-static web::json::value _parse_narrow_stream(std::istream &stream)
-{
-    web::json::details::JSON_StreamParser<char> parser(stream);
-    web::json::details::JSON_StreamParser<char>::Token tkn;
+    virtual void serialize_impl(std::wstring& str) const { parsed()->serialize_impl(str); }
+#endif
 
-    parser.GetNextToken(tkn);
-    if (tkn.m_error)
-    {
-        web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
-    }
+    virtual utility::string_t to_string() const { return parsed()->to_string(); }
 
-    auto value = parser.ParseValue(tkn);
-    if (tkn.m_error)
+    virtual json::value::value_type type() const { return m_type; }
+
+    virtual bool is_integer() const { return parsed()->is_integer(); }
+    virtual bool is_double() const { return parsed()->is_double(); }
+
+    virtual const json::number& as_number() { return parsed()->as_number(); }
+    virtual double as_double() const { return parsed()->as_double(); }
+    virtual int as_integer() const { return parsed()->as_integer(); }
+    virtual bool as_bool() const { return parsed()->as_bool(); }
+    virtual json::array& as_array() { return parsed()->as_array(); }
+    virtual const json::array& as_array() const { return parsed()->as_array(); }
+    virtual json::object& as_object() { return parsed()->as_object(); }
+    virtual const json::object& as_object() const { return parsed()->as_object(); }
+    virtual const utility::string_t& as_string() const { return parsed()->as_string(); }
+
+    virtual size_t size() const { return parsed()->size(); }
+
+protected:
+    virtual void format(std::basic_string<char>& str) const
     {
-        web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+        parsed();
+        m_value.format(str);
     }
-    else if (tkn.kind != web::json::details::JSON_Parser<char>::Token::TKN_EOF)
+#ifdef _WIN32
+    virtual void format(std::basic_string<wchar_t>& str) const
     {
-        web::json::details::CreateException(tkn, _XPLATSTR("Left-over characters in stream after parsing a JSON value"));
+        parsed();
+        m_value.format(str);
     }
-    return value;
-}
+#endif
 
-static web::json::value _parse_narrow_stream(std::istream &stream, std::error_code& error)
-{
-    web::json::details::JSON_StreamParser<char> parser(stream);
-    web::json::details::JSON_StreamParser<char>::Token tkn;
+private:
+    _Value *parsed() const;
 
-    parser.GetNextToken(tkn);
-    if (tkn.m_error)
+    mutable std::shared_ptr<const utility::string_t> m_source;
+    const utility::char_t *m_begin;
+    const utility::char_t *m_end;
+    json::value::value_type m_type;
+    parse_options m_options;
+
+    mutable json::value m_value;
+    mutable std::atomic<bool> m_parsed;
+    mutable std::mutex m_lock;
+};
+
+// Parses a document for parse_options::lazy(). The objects, arrays and strings held by the top-level object
+// or array are only checked and turned into _Deferred nodes sharing the text of the document.
+class JSON_LazyParser : public JSON_StringParser<utility::char_t>
+{
+public:
+    JSON_LazyParser(std::shared_ptr<const utility::string_t> source, const utility::char_t *begin, const utility::char_t *end,
+                    const parse_options &options)
+        : JSON_StringParser<utility::char_t>(begin, end),
+          m_source(std::move(source)),
+          m_options(options),
+          m_literal_start(nullptr)
     {
-        error = std::move(tkn.m_error);
-        return web::json::value();
+        ApplyOptions(options);
     }
 
-    auto returnObject = parser.ParseValue(tkn);
-    if (tkn.kind != web::json::details::JSON_Parser<utility::char_t>::Token::TKN_EOF)
+protected:
+    virtual bool CompleteStringLiteral(Token &token)
     {
-        returnObject = web::json::value();
-        web::json::details::SetErrorCode(tkn, web::json::details::json_error::left_over_character_in_stream);
+        // The opening quote has already been consumed.
+        m_literal_start = m_position - 1;
+        return JSON_StringParser<utility::char_t>::CompleteStringLiteral(token);
     }
 
-    error = std::move(tkn.m_error);
-    return returnObject;
-}
-#endif
+    virtual std::unique_ptr<_Value> DeferValue(Token &tkn)
+    {
+        const utility::char_t *begin;
+        switch (tkn.kind)
+        {
+        case Token::TKN_OpenBrace:
+        case Token::TKN_OpenBracket:
+            begin = m_position - 1;
+            break;
+        case Token::TKN_StringLiteral:
+            // The text of short strings has already been copied into the token, and a _Deferred node is larger.
+            if (tkn.string_val.size() < 64) return nullptr;
+            begin = m_literal_start;
+            break;
+        default:
+            return nullptr;
+        }
+
+        if (!SkipValue(tkn))
+        {
+            return CreateNode<_Null>();
+        }
+        const auto end = m_position;
+
+        GetNextToken(tkn);
+        if (tkn.m_error) return CreateNode<_Null>();
+        return CreateNode<_Deferred>(m_source, begin, end, m_options);
+    }
+
+private:
+    std::shared_ptr<const utility::string_t> m_source;
+    parse_options m_options;
+    const utility::char_t *m_literal_start;
+};
+
+_Value *_Deferred::parsed() const
+{
+    if (!m_parsed.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_parsed.load(std::memory_order_relaxed))
+        {
+            JSON_LazyParser parser(m_source, m_begin, m_end, m_options);
+            JSON_LazyParser::Token tkn;
+            parser.GetNextToken(tkn);
+            auto value = parser.ParseValue(tkn);
+            if (tkn.m_error || tkn.kind != JSON_LazyParser::Token::TKN_EOF)
+            {
+                // The text was checked when the document was parsed.
+                throw json_exception(_XPLATSTR("Malformed JSON in lazily parsed document"));
+            }
+            m_value = std::move(value);
+            m_source.reset();
+            m_parsed.store(true, std::memory_order_release);
+        }
+    }
+    return m_value.m_value.get();
+}
+
+}}}
+
+namespace web {
+namespace json
+{
+namespace details
+{
+
+// Walks through the tokens of a UTF-8 document, checking its structure and stopping at each token
+// a json_reader reports. Derived classes provide the raw tokens of the input.
+class json_token_walker
+{
+public:
+    json_token_walker()
+        : m_token(json_token::none),
+          m_depth(0),
+          m_boolean(false),
+          m_expect(expect_value)
+    {
+    }
+
+    virtual ~json_token_walker() { }
+
+protected:
+    typedef JSON_Parser<char>::Token Token;
+
+    enum read_result
+    {
+        token_read,
+        document_ended,
+        needs_input
+    };
+
+    // What the document structure allows next.
+    enum expectation
+    {
+        expect_value,
+        expect_value_or_end,
+        expect_property,
+        expect_property_or_end,
+        expect_colon,
+        expect_comma_or_end,
+        expect_end_of_document
+    };
+
+    // Reads the next raw token into m_raw, returns false if it hasn't fully arrived yet.
+    virtual bool next_raw_token() = 0;
+
+    void fail(json_error error)
+    {
+        if (!m_raw.m_error)
+        {
+            SetErrorCode(m_raw, error);
+        }
+        CreateException(m_raw, utility::conversions::to_string_t(m_raw.m_error.message()));
+    }
+
+    void value_completed()
+    {
+        m_expect = m_stack.empty() ? expect_end_of_document : expect_comma_or_end;
+    }
+
+    read_result try_read()
+    {
+        while (true)
+        {
+            if (!next_raw_token())
+            {
+                return needs_input;
+            }
+            if (m_raw.m_error)
+            {
+                fail(json_error::malformed_token);
+            }
+
+            const bool in_object = !m_stack.empty() && m_stack.back();
+            const bool value_allowed = m_expect == expect_value || m_expect == expect_value_or_end;
+            switch (m_raw.kind)
+            {
+            case Token::TKN_EOF:
+                if (m_expect != expect_end_of_document)
+                {
+                    fail(m_stack.empty() ? json_error::malformed_token : (in_object ? json_error::malformed_object_literal : json_error::malformed_array_literal));
+                }
+                m_token = json_token::none;
+                m_depth = 0;
+                return document_ended;
+
+            case Token::TKN_OpenBrace:
+            case Token::TKN_OpenBracket:
+                if (!value_allowed)
+                {
+                    break;
+                }
+                m_stack.push_back(m_raw.kind == Token::TKN_OpenBrace);
+                m_expect = m_stack.back() ? expect_property_or_end : expect_value_or_end;
+                m_token = m_stack.back() ? json_token::start_object : json_token::start_array;
+                m_depth = m_stack.size();
+                return token_read;
+
+            case Token::TKN_CloseBrace:
+            case Token::TKN_CloseBracket:
+                {
+                    const bool closes_object = m_raw.kind == Token::TKN_CloseBrace;
+                    if (m_stack.empty() || in_object != closes_object
+                        || (m_expect != expect_comma_or_end && m_expect != (closes_object ? expect_property_or_end : expect_value_or_end)))
+                    {
+                        fail(json_error::mismatched_brances);
+                    }
+                    m_depth = m_stack.size();
+                    m_stack.pop_back();
+                    value_completed();
+                    m_token = closes_object ? json_token::end_object : json_token::end_array;
+                    return token_read;
+                }
+
+            case Token::TKN_Comma:
+                if (m_expect != expect_comma_or_end)
+                {
+                    break;
+                }
+                m_expect = in_object ? expect_property : expect_value;
+                continue;
+
+            case Token::TKN_Colon:
+                if (m_expect != expect_colon)
+                {
+                    break;
+                }
+                m_expect = expect_value;
+                continue;
+
+            case Token::TKN_StringLiteral:
+                if (m_expect == expect_property || m_expect == expect_property_or_end)
+                {
+                    m_string = utility::conversions::to_string_t(std::move(m_raw.string_val));
+                    m_expect = expect_colon;
+                    m_token = json_token::property_name;
+                    m_depth = m_stack.size();
+                    return token_read;
+                }
+                if (!value_allowed)
+                {
+                    break;
+                }
+                m_string = utility::conversions::to_string_t(std::move(m_raw.string_val));
+                m_token = json_token::string;
+                m_depth = m_stack.size();
+                value_completed();
+                return token_read;
+
+            case Token::TKN_IntegerLiteral:
+            case Token::TKN_NumberLiteral:
+                if (!value_allowed)
+                {
+                    break;
+                }
+                m_token = json_token::number;
+                m_depth = m_stack.size();
+                value_completed();
+                return token_read;
+
+            case Token::TKN_BooleanLiteral:
+            case Token::TKN_NullLiteral:
+                if (!value_allowed)
+                {
+                    break;
+                }
+                m_boolean = m_raw.kind == Token::TKN_BooleanLiteral && m_raw.boolean_val;
+                m_token = m_raw.kind == Token::TKN_BooleanLiteral ? json_token::boolean : json_token::null;
+                m_depth = m_stack.size();
+                value_completed();
+                return token_read;
+
+            default:
+                break;
+            }
+
+            fail(m_expect == expect_end_of_document ? json_error::left_over_character_in_stream : json_error::unexpected_token);
+        }
+    }
+
+    json::value raw_number() const
+    {
+        if (m_raw.kind == Token::TKN_NumberLiteral)
+        {
+            return json::value(m_raw.double_val);
+        }
+        return m_raw.signed_number ? json::value(m_raw.int64_val) : json::value(m_raw.uint64_val);
+    }
+
+    Token m_raw;
+
+    json_token m_token;
+    size_t m_depth;
+    utility::string_t m_string;
+    bool m_boolean;
+
+    // One entry per open container, true for objects.
+    std::vector<bool> m_stack;
+    expectation m_expect;
+};
+
+class json_reader_impl : public json_token_walker, public std::enable_shared_from_this<json_reader_impl>
+{
+public:
+    json_reader_impl(concurrency::streams::streambuf<uint8_t> source, size_t chunk_size)
+        : m_source(std::move(source)),
+          m_chunk_size(chunk_size == 0 ? 1 : chunk_size),
+          m_consumed(0),
+          m_scanned(0),
+          m_end_of_input(false),
+          m_advance(false),
+          m_build(false),
+          m_skip_depth(0)
+    {
+    }
+
+    pplx::task<bool> read()
+    {
+        try
+        {
+            switch (read_token())
+            {
+            case needs_input:
+                {
+                    auto self = shared_from_this();
+                    return fill().then([self]()
+                    {
+                        return self->read();
+                    });
+                }
+            case document_ended:
+                return pplx::task_from_result(false);
+            default:
+                return pplx::task_from_result(true);
+            }
+        }
+        catch (...)
+        {
+            return pplx::task_from_exception<bool>(std::current_exception());
+        }
+    }
+
+    pplx::task<json::value> read_value()
+    {
+        auto self = shared_from_this();
+        return walk_value(true).then([self]()
+        {
+            return std::move(self->m_built);
+        });
+    }
+
+    pplx::task<void> skip()
+    {
+        return walk_value(false);
+    }
+
+    json_token token() const { return m_token; }
+
+    size_t depth() const { return m_depth; }
+
+    const utility::string_t &string_value() const
+    {
+        if (m_token != json_token::property_name && m_token != json_token::string)
+        {
+            throw json_exception(_XPLATSTR("json_reader is not at a string or property name"));
+        }
+        return m_string;
+    }
+
+    const json::number &number_value() const
+    {
+        if (m_token != json_token::number)
+        {
+            throw json_exception(_XPLATSTR("json_reader is not at a number"));
+        }
+        return m_number.as_number();
+    }
+
+    bool bool_value() const
+    {
+        if (m_token != json_token::boolean)
+        {
+            throw json_exception(_XPLATSTR("json_reader is not at a boolean"));
+        }
+        return m_boolean;
+    }
+
+private:
+    // An object or array being built by read_value().
+    struct builder_frame
+    {
+        builder_frame(bool is_object) : m_is_object(is_object) { }
+
+        bool m_is_object;
+        utility::string_t m_key;
+        std::vector<std::pair<utility::string_t, json::value>> m_fields;
+        std::vector<json::value> m_elements;
+    };
+
+    pplx::task<void> fill()
+    {
+        // Only the token which was cut short is kept.
+        m_buffer.erase(0, m_consumed);
+        m_consumed = 0;
+
+        // A long token doubles the input each time, so it is rescanned a logarithmic number of times.
+        const size_t previous = m_buffer.size();
+        const size_t wanted = (std::max)(m_chunk_size, previous);
+        m_buffer.resize(previous + wanted);
+        auto self = shared_from_this();
+        return m_source.getn(reinterpret_cast<uint8_t *>(&m_buffer[previous]), wanted).then([self, previous](size_t count)
+        {
+            self->m_buffer.resize(previous + count);
+            if (count == 0)
+            {
+                self->m_end_of_input = true;
+            }
+        });
+    }
+
+    read_result read_token()
+    {
+        const auto result = try_read();
+        if (result == token_read && m_token == json_token::number)
+        {
+            m_number = raw_number();
+        }
+        return result;
+    }
+
+    // Tokenizes the next token if it has fully arrived.
+    virtual bool next_raw_token()
+    {
+        // A string cut short cannot end before another quote, so only the new input is searched for one.
+        if (m_scanned != 0 && !m_end_of_input)
+        {
+            const auto start = m_buffer.find_first_not_of(" \t\r\n", m_consumed);
+            if (start != std::string::npos && m_buffer[start] == '"'
+                && m_buffer.find('"', (std::max)(start + 1, m_consumed + m_scanned)) == std::string::npos)
+            {
+                m_scanned = m_buffer.size() - m_consumed;
+                return false;
+            }
+        }
+
+        const char *end = m_buffer.data() + m_buffer.size();
+        m_parser.SetInput(m_buffer.data() + m_consumed, end);
+        const auto checkpoint = m_parser.Save();
+
+        m_raw.m_error.clear();
+        m_parser.GetNextToken(m_raw);
+
+        // Numbers, whitespace and anything invalid may continue in input that hasn't arrived yet.
+        if (!m_end_of_input && m_parser.Position() == end
+            && (m_raw.m_error || m_raw.kind == Token::TKN_EOF || m_raw.kind == Token::TKN_NumberLiteral || m_raw.kind == Token::TKN_IntegerLiteral))
+        {
+            m_parser.Restore(checkpoint);
+            m_scanned = m_buffer.size() - m_consumed;
+            return false;
+        }
+
+        m_consumed = static_cast<size_t>(m_parser.Position() - m_buffer.data());
+        m_scanned = 0;
+        return true;
+    }
+
+    // Adds the current token to the value being built or skipped, returns whether the value is complete.
+    bool consume_token()
+    {
+        switch (m_token)
+        {
+        case json_token::start_object:
+        case json_token::start_array:
+            if (m_build)
+            {
+                m_builder.push_back(builder_frame(m_token == json_token::start_object));
+            }
+            ++m_skip_depth;
+            return false;
+        case json_token::property_name:
+            if (m_build)
+            {
+                m_builder.back().m_key = std::move(m_string);
+            }
+            return false;
+        case json_token::end_object:
+        case json_token::end_array:
+            --m_skip_depth;
+            if (m_build)
+            {
+                auto &frame = m_builder.back();
+                auto completed = frame.m_is_object
+                    ? json::value::object(std::move(frame.m_fields), g_keep_json_object_unsorted)
+                    : json::value::array(std::move(frame.m_elements));
+                m_builder.pop_back();
+                add_to_builder(std::move(completed));
+            }
+            return m_skip_depth == 0;
+        case json_token::string:
+            if (m_build) add_to_builder(json::value::string(m_string));
+            return m_skip_depth == 0;
+        case json_token::number:
+            if (m_build) add_to_builder(m_number);
+            return m_skip_depth == 0;
+        case json_token::boolean:
+            if (m_build) add_to_builder(json::value::boolean(m_boolean));
+            return m_skip_depth == 0;
+        case json_token::null:
+            if (m_build) add_to_builder(json::value::null());
+            return m_skip_depth == 0;
+        default:
+            throw json_exception(_XPLATSTR("json_reader is not at a value"));
+        }
+    }
+
+    void add_to_builder(json::value value)
+    {
+        if (m_builder.empty())
+        {
+            m_built = std::move(value);
+        }
+        else if (m_builder.back().m_is_object)
+        {
+            m_builder.back().m_fields.emplace_back(std::move(m_builder.back().m_key), std::move(value));
+        }
+        else
+        {
+            m_builder.back().m_elements.push_back(std::move(value));
+        }
+    }
+
+    pplx::task<void> walk_value(bool build)
+    {
+        try
+        {
+            if (m_token == json_token::end_object || m_token == json_token::end_array)
+            {
+                throw json_exception(_XPLATSTR("json_reader is not at a value"));
+            }
+            m_build = build;
+            m_builder.clear();
+            m_built = json::value();
+            m_skip_depth = 0;
+
+            // Move to the value first when at a property name or at the very start of the document.
+            m_advance = m_token == json_token::property_name || (m_token == json_token::none && m_expect == expect_value);
+            return continue_walk();
+        }
+        catch (...)
+        {
+            return pplx::task_from_exception<void>(std::current_exception());
+        }
+    }
+
+    pplx::task<void> continue_walk()
+    {
+        try
+        {
+            while (true)
+            {
+                if (m_advance)
+                {
+                    const auto result = read_token();
+                    if (result == needs_input)
+                    {
+                        auto self = shared_from_this();
+                        return fill().then([self]()
+                        {
+                            return self->continue_walk();
+                        });
+                    }
+                    if (result == document_ended)
+                    {
+                        throw json_exception(_XPLATSTR("json_reader is not at a value"));
+                    }
+                }
+
+                m_advance = true;
+                if (consume_token())
+                {
+                    return pplx::task_from_result();
+                }
+            }
+        }
+        catch (...)
+        {
+            return pplx::task_from_exception<void>(std::current_exception());
+        }
+    }
+
+    concurrency::streams::streambuf<uint8_t> m_source;
+    size_t m_chunk_size;
+
+    // Input which has arrived, everything before m_consumed has been tokenized.
+    std::string m_buffer;
+    size_t m_consumed;
+    // Length of the token cut short at m_consumed which was already scanned.
+    size_t m_scanned;
+    bool m_end_of_input;
+
+    JSON_ReaderParser m_parser;
+    json::value m_number;
+
+    // State of read_value() and skip() across refills.
+    bool m_advance;
+    bool m_build;
+    size_t m_skip_depth;
+    std::vector<builder_frame> m_builder;
+    json::value m_built;
+};
+
+}
+
+json_reader::json_reader(concurrency::streams::streambuf<uint8_t> buffer, size_t chunk_size)
+    : m_impl(std::make_shared<details::json_reader_impl>(std::move(buffer), chunk_size))
+{
+}
+
+json_reader::json_reader(concurrency::streams::istream stream, size_t chunk_size)
+    : m_impl(std::make_shared<details::json_reader_impl>(stream.streambuf(), chunk_size))
+{
+}
+
+pplx::task<bool> json_reader::read()
+{
+    return m_impl->read();
+}
+
+pplx::task<json::value> json_reader::read_value()
+{
+    return m_impl->read_value();
+}
+
+pplx::task<void> json_reader::skip()
+{
+    return m_impl->skip();
+}
+
+json_token json_reader::token() const
+{
+    return m_impl->token();
+}
+
+size_t json_reader::depth() const
+{
+    return m_impl->depth();
+}
+
+const utility::string_t &json_reader::string_value() const
+{
+    return m_impl->string_value();
+}
+
+const json::number &json_reader::number_value() const
+{
+    return m_impl->number_value();
+}
+
+bool json_reader::bool_value() const
+{
+    return m_impl->bool_value();
+}
+
+namespace details
+{
+
+// Walks through a complete document held in memory, for parse_fields().
+class json_mapping_reader_impl : public json_token_walker
+{
+public:
+    json_mapping_reader_impl(const char *begin, const char *end)
+        : m_parser(begin, end)
+    {
+    }
+
+    bool read()
+    {
+        return try_read() == token_read;
+    }
+
+    json_token token() const { return m_token; }
+
+    void expect(json_token token) const
+    {
+        if (m_token == token)
+        {
+            return;
+        }
+        switch (token)
+        {
+        case json_token::start_object: throw json_exception(_XPLATSTR("not an object"));
+        case json_token::start_array: throw json_exception(_XPLATSTR("not an array"));
+        case json_token::string: throw json_exception(_XPLATSTR("not a string"));
+        case json_token::number: throw json_exception(_XPLATSTR("not a number"));
+        case json_token::boolean: throw json_exception(_XPLATSTR("not a boolean"));
+        default: throw json_exception(_XPLATSTR("unexpected token"));
+        }
+    }
 
-web::json::value web::json::value::parse(const utility::string_t& str)
+    bool name_is(const char *name) const
+    {
+#ifdef _UTF16_STRINGS
+        return m_token == json_token::property_name && utility::conversions::to_utf8string(m_string) == name;
+#else
+        return m_token == json_token::property_name && m_string == name;
+#endif
+    }
+
+    void skip()
+    {
+        if (m_token == json_token::property_name)
+        {
+            read();
+        }
+        size_t depth = 0;
+        do
+        {
+            switch (m_token)
+            {
+            case json_token::start_object:
+            case json_token::start_array:
+                ++depth;
+                break;
+            case json_token::end_object:
+            case json_token::end_array:
+                if (depth == 0)
+                {
+                    throw json_exception(_XPLATSTR("not at a value"));
+                }
+                --depth;
+                break;
+            case json_token::none:
+                throw json_exception(_XPLATSTR("not at a value"));
+            default:
+                break;
+            }
+        } while (depth != 0 && read());
+    }
+
+    // The tokenizer limits the nesting, which bounds the recursion.
+    json::value read_value()
+    {
+        if (m_token == json_token::property_name)
+        {
+            read();
+        }
+        switch (m_token)
+        {
+        case json_token::start_object:
+            {
+                std::vector<std::pair<utility::string_t, json::value>> fields;
+                while (read() && m_token == json_token::property_name)
+                {
+                    utility::string_t name = std::move(m_string);
+                    read();
+                    fields.emplace_back(std::move(name), read_value());
+                }
+                return json::value::object(std::move(fields), g_keep_json_object_unsorted);
+            }
+        case json_token::start_array:
+            {
+                std::vector<json::value> elements;
+                while (read() && m_token != json_token::end_array)
+                {
+                    elements.push_back(read_value());
+                }
+                return json::value::array(std::move(elements));
+            }
+        case json_token::string:
+            return json::value::string(std::move(m_string));
+        case json_token::number:
+            return raw_number();
+        case json_token::boolean:
+            return json::value::boolean(m_boolean);
+        case json_token::null:
+            return json::value::null();
+        default:
+            throw json_exception(_XPLATSTR("not at a value"));
+        }
+    }
+
+    const utility::string_t &string_value() const
+    {
+        expect(json_token::string);
+        return m_string;
+    }
+
+    bool bool_value() const
+    {
+        expect(json_token::boolean);
+        return m_boolean;
+    }
+
+    // Numbers convert like json::number's accessors do, doubles are truncated. Numbers which don't fit throw.
+    int64_t int64_value() const
+    {
+        expect(json_token::number);
+        if (m_raw.kind == Token::TKN_NumberLiteral)
+        {
+            // The bounds are -2^63 and 2^63, which doubles represent exactly.
+            if (!(m_raw.double_val >= -9223372036854775808.0 && m_raw.double_val < 9223372036854775808.0))
+            {
+                throw json_exception(_XPLATSTR("number out of range"));
+            }
+            return static_cast<int64_t>(m_raw.double_val);
+        }
+        if (!m_raw.signed_number && m_raw.uint64_val > static_cast<uint64_t>((std::numeric_limits<int64_t>::max)()))
+        {
+            throw json_exception(_XPLATSTR("number out of range"));
+        }
+        return m_raw.signed_number ? m_raw.int64_val : static_cast<int64_t>(m_raw.uint64_val);
+    }
+
+    uint64_t uint64_value() const
+    {
+        expect(json_token::number);
+        if (m_raw.kind == Token::TKN_NumberLiteral)
+        {
+            if (!(m_raw.double_val > -1.0 && m_raw.double_val < 18446744073709551616.0))
+            {
+                throw json_exception(_XPLATSTR("number out of range"));
+            }
+            return static_cast<uint64_t>(m_raw.double_val);
+        }
+        if (m_raw.signed_number && m_raw.int64_val < 0)
+        {
+            throw json_exception(_XPLATSTR("number out of range"));
+        }
+        return m_raw.signed_number ? static_cast<uint64_t>(m_raw.int64_val) : m_raw.uint64_val;
+    }
+
+    double double_value() const
+    {
+        expect(json_token::number);
+        if (m_raw.kind == Token::TKN_NumberLiteral)
+        {
+            return m_raw.double_val;
+        }
+        return m_raw.signed_number ? static_cast<double>(m_raw.int64_val) : static_cast<double>(m_raw.uint64_val);
+    }
+
+private:
+    virtual bool next_raw_token()
+    {
+        m_raw.m_error.clear();
+        m_parser.GetNextToken(m_raw);
+        return true;
+    }
+
+    JSON_StringParser<char> m_parser;
+};
+
+json_mapping_reader::json_mapping_reader(const char *begin, const char *end)
+    : m_impl(new json_mapping_reader_impl(begin, end))
 {
-    web::json::details::JSON_StringParser<utility::char_t> parser(str);
+}
+
+json_mapping_reader::~json_mapping_reader()
+{
+}
+
+bool json_mapping_reader::read()
+{
+    return m_impl->read();
+}
+
+json_token json_mapping_reader::token() const
+{
+    return m_impl->token();
+}
+
+void json_mapping_reader::expect(json_token token) const
+{
+    m_impl->expect(token);
+}
+
+bool json_mapping_reader::name_is(const char *name) const
+{
+    return m_impl->name_is(name);
+}
+
+void json_mapping_reader::skip()
+{
+    m_impl->skip();
+}
+
+json::value json_mapping_reader::read_value()
+{
+    return m_impl->read_value();
+}
+
+const utility::string_t &json_mapping_reader::string_value() const
+{
+    return m_impl->string_value();
+}
+
+bool json_mapping_reader::bool_value() const
+{
+    return m_impl->bool_value();
+}
+
+int64_t json_mapping_reader::int64_value() const
+{
+    return m_impl->int64_value();
+}
+
+uint64_t json_mapping_reader::uint64_value() const
+{
+    return m_impl->uint64_value();
+}
+
+double json_mapping_reader::double_value() const
+{
+    return m_impl->double_value();
+}
+
+}
+
+}}
+
+static web::json::value _parse_stream(utility::istream_t &stream, const web::json::parse_options &options)
+{
+    web::json::details::JSON_StreamParser<utility::char_t> parser(stream);
     web::json::details::JSON_Parser<utility::char_t>::Token tkn;
+    parser.ApplyOptions(options);
 
     parser.GetNextToken(tkn);
     if (tkn.m_error)
@@ -1265,10 +3067,57 @@ web::json::value web::json::value::parse(const utility::string_t& str)
     return value;
 }
 
-web::json::value web::json::value::parse(const utility::string_t& str, std::error_code& error)
+static web::json::value _parse_stream(utility::istream_t &stream, const web::json::parse_options &options, std::error_code& error)
 {
-    web::json::details::JSON_StringParser<utility::char_t> parser(str);
+    web::json::details::JSON_StreamParser<utility::char_t> parser(stream);
     web::json::details::JSON_Parser<utility::char_t>::Token tkn;
+    parser.ApplyOptions(options);
+
+    parser.GetNextToken(tkn);
+    if (tkn.m_error)
+    {
+        error = std::move(tkn.m_error);
+        return web::json::value();
+    }
+
+    auto returnObject = parser.ParseValue(tkn);
+    if (tkn.kind != web::json::details::JSON_Parser<utility::char_t>::Token::TKN_EOF)
+    {
+        web::json::details::SetErrorCode(tkn, web::json::details::json_error::left_over_character_in_stream);
+    }
+
+    error = std::move(tkn.m_error);
+    return returnObject;
+}
+
+#ifdef _WIN32
+static web::json::value _parse_narrow_stream(std::istream &stream)
+{
+    web::json::details::JSON_StreamParser<char> parser(stream);
+    web::json::details::JSON_StreamParser<char>::Token tkn;
+
+    parser.GetNextToken(tkn);
+    if (tkn.m_error)
+    {
+        web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+    }
+
+    auto value = parser.ParseValue(tkn);
+    if (tkn.m_error)
+    {
+        web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+    }
+    else if (tkn.kind != web::json::details::JSON_Parser<char>::Token::TKN_EOF)
+    {
+        web::json::details::CreateException(tkn, _XPLATSTR("Left-over characters in stream after parsing a JSON value"));
+    }
+    return value;
+}
+
+static web::json::value _parse_narrow_stream(std::istream &stream, std::error_code& error)
+{
+    web::json::details::JSON_StreamParser<char> parser(stream);
+    web::json::details::JSON_StreamParser<char>::Token tkn;
 
     parser.GetNextToken(tkn);
     if (tkn.m_error)
@@ -1287,15 +3136,144 @@ web::json::value web::json::value::parse(const utility::string_t& str, std::erro
     error = std::move(tkn.m_error);
     return returnObject;
 }
+#endif
+
+template <typename CharType>
+static web::json::value _parse_string(web::json::details::JSON_Parser<CharType> &parser)
+{
+    typename web::json::details::JSON_Parser<CharType>::Token tkn;
+
+    parser.GetNextToken(tkn);
+    if (tkn.m_error)
+    {
+        web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+    }
+
+    auto value = parser.ParseValue(tkn);
+    if (tkn.m_error)
+    {
+        web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+    }
+    else if (tkn.kind != web::json::details::JSON_Parser<CharType>::Token::TKN_EOF)
+    {
+        web::json::details::CreateException(tkn, _XPLATSTR("Left-over characters in stream after parsing a JSON value"));
+    }
+    return value;
+}
+
+template <typename CharType>
+static web::json::value _parse_string(web::json::details::JSON_Parser<CharType> &parser, std::error_code& error)
+{
+    typename web::json::details::JSON_Parser<CharType>::Token tkn;
+
+    parser.GetNextToken(tkn);
+    if (tkn.m_error)
+    {
+        error = std::move(tkn.m_error);
+        return web::json::value();
+    }
+
+    auto returnObject = parser.ParseValue(tkn);
+    if (tkn.kind != web::json::details::JSON_Parser<CharType>::Token::TKN_EOF)
+    {
+        returnObject = web::json::value();
+        web::json::details::SetErrorCode(tkn, web::json::details::json_error::left_over_character_in_stream);
+    }
+
+    error = std::move(tkn.m_error);
+    return returnObject;
+}
+
+web::json::value web::json::value::parse(const utility::string_t& str)
+{
+    return parse(str, parse_options());
+}
+
+web::json::value web::json::value::parse(const utility::string_t& str, const parse_options& options)
+{
+    if (options.lazy())
+    {
+        auto source = std::make_shared<const utility::string_t>(str);
+        web::json::details::JSON_LazyParser parser(source, source->data(), source->data() + source->size(), options);
+        return _parse_string(parser);
+    }
+
+    web::json::details::JSON_StringParser<utility::char_t> parser(str);
+    parser.ApplyOptions(options);
+    return _parse_string(parser);
+}
+
+web::json::value web::json::value::parse(const utility::string_t& str, std::error_code& error)
+{
+    return parse(str, parse_options(), error);
+}
+
+web::json::value web::json::value::parse(const utility::string_t& str, const parse_options& options, std::error_code& error)
+{
+    if (options.lazy())
+    {
+        auto source = std::make_shared<const utility::string_t>(str);
+        web::json::details::JSON_LazyParser parser(source, source->data(), source->data() + source->size(), options);
+        return _parse_string(parser, error);
+    }
+
+    web::json::details::JSON_StringParser<utility::char_t> parser(str);
+    parser.ApplyOptions(options);
+    return _parse_string(parser, error);
+}
+
+web::json::value web::json::value::parse(const char *data, size_t length)
+{
+    return parse(data, length, parse_options());
+}
+
+web::json::value web::json::value::parse(const char *data, size_t length, const parse_options& options)
+{
+    if (options.lazy())
+    {
+        return parse(utility::conversions::to_string_t(std::string(data, length)), options);
+    }
+
+    web::json::details::JSON_StringParser<char> parser(data, data + length);
+    parser.ApplyOptions(options);
+    return _parse_string(parser);
+}
+
+web::json::value web::json::value::parse(const char *data, size_t length, std::error_code& error)
+{
+    return parse(data, length, parse_options(), error);
+}
+
+web::json::value web::json::value::parse(const char *data, size_t length, const parse_options& options, std::error_code& error)
+{
+    if (options.lazy())
+    {
+        return parse(utility::conversions::to_string_t(std::string(data, length)), options, error);
+    }
+
+    web::json::details::JSON_StringParser<char> parser(data, data + length);
+    parser.ApplyOptions(options);
+    return _parse_string(parser, error);
+}
 
 web::json::value web::json::value::parse(utility::istream_t &stream)
 {
-    return _parse_stream(stream);
+    return _parse_stream(stream, parse_options());
 }
 
 web::json::value web::json::value::parse(utility::istream_t &stream, std::error_code& error)
 {
-    return _parse_stream(stream, error);
+    return _parse_stream(stream, parse_options(), error);
+}
+
+web::json::value web::json::value::parse(utility::istream_t &stream, const parse_options& options)
+{
+    return _parse_stream(stream, options);
+}
+
+web::json::value web::json::value::parse(utility::istream_t &stream, const parse_options& options, std::error_code& error)
+{
+    return _parse_stream(stream, options, error);
 }
 
 #ifdef _WIN32
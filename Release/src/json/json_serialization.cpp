@@ -24,12 +24,8 @@
 ****/
 
 #include "stdafx.h"
-#include <stdio.h>
-
-#ifndef _WIN32
-#define __STDC_FORMAT_MACROS
-#include <inttypes.h>
-#endif
+#include <cmath>
+#include <cstring>
 
 using namespace web;
 using namespace web::json;
@@ -56,10 +52,6 @@ void web::json::value::format(std::basic_string<wchar_t> &string) const
 
 void web::json::value::serialize(utility::ostream_t &stream) const
 {
-#ifndef _WIN32
-    utility::details::scoped_c_thread_locale locale;
-#endif
-
     // This has better performance than writing directly to stream.
     utility::string_t str;
     m_value->serialize_impl(str);
@@ -159,49 +151,368 @@ void web::json::details::_String::format(std::basic_string<char>& str) const
     str.push_back('"');
 }
 
-void web::json::details::_Number::format(std::basic_string<char>& stream) const
+// This namespace hides the number formatting helpers
+namespace
 {
-    if(m_number.m_type != number::type::double_type)
+    // Doubles are printed with the shortest digits that read back to the same value, found with the Grisu2
+    // algorithm of Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers".
+    struct diy_fp
     {
-        // #digits + 1 to avoid loss + 1 for the sign + 1 for null terminator.
-        const size_t tempSize = std::numeric_limits<uint64_t>::digits10 + 3;
-        char tempBuffer[tempSize];
+        diy_fp(uint64_t f, int e) : f(f), e(e) { }
 
-#ifdef _WIN32
-        // This can be improved performance-wise if we implement our own routine
-        if (m_number.m_type == number::type::signed_type)
-            _i64toa_s(m_number.m_intval, tempBuffer, tempSize, 10);
-        else
-            _ui64toa_s(m_number.m_uintval, tempBuffer, tempSize, 10);
+        uint64_t f;
+        int e;
+    };
 
-        const auto numChars = strnlen_s(tempBuffer, tempSize);
-#else
-        int numChars;
-        if (m_number.m_type == number::type::signed_type)
-            numChars = snprintf(tempBuffer, tempSize, "%" PRId64, m_number.m_intval);
-        else
-            numChars = snprintf(tempBuffer, tempSize, "%" PRIu64, m_number.m_uintval);
-#endif
-        stream.append(tempBuffer, numChars);
+    // The product rounded to 64 bits.
+    diy_fp multiply(const diy_fp &x, const diy_fp &y)
+    {
+        const uint64_t x_low = x.f & 0xFFFFFFFF, x_high = x.f >> 32;
+        const uint64_t y_low = y.f & 0xFFFFFFFF, y_high = y.f >> 32;
+        const uint64_t low_low = x_low * y_low;
+        const uint64_t low_high = x_low * y_high;
+        const uint64_t high_low = x_high * y_low;
+        const uint64_t high_high = x_high * y_high;
+        uint64_t middle = (low_low >> 32) + (low_high & 0xFFFFFFFF) + (high_low & 0xFFFFFFFF);
+        middle += static_cast<uint64_t>(1) << 31;
+        return diy_fp(high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32), x.e + y.e + 64);
     }
-    else
+
+    diy_fp normalize(diy_fp x)
     {
-        // #digits + 2 to avoid loss + 1 for the sign + 1 for decimal point + 5 for exponent (e+xxx) + 1 for null terminator
-        const size_t tempSize = std::numeric_limits<double>::digits10 + 10;
-        char tempBuffer[tempSize];
-#ifdef _WIN32
-        const auto numChars = _sprintf_s_l(
-            tempBuffer,
-            tempSize,
-            "%.*g",
-            utility::details::scoped_c_thread_locale::c_locale(),
-            std::numeric_limits<double>::digits10 + 2,
-            m_number.m_value);
-#else
-        const auto numChars = snprintf(tempBuffer, tempSize, "%.*g", std::numeric_limits<double>::digits10 + 2, m_number.m_value);
-#endif
-        stream.append(tempBuffer, numChars);
+        while ((x.f >> 63) == 0)
+        {
+            x.f <<= 1;
+            --x.e;
+        }
+        return x;
+    }
+
+    struct cached_power
+    {
+        uint64_t f;
+        int e;
+        int k;
+    };
+
+    // Normalized 64-bit significands of 10^k for k = -300, -292, ..., 324.
+    const cached_power cached_powers[] = {
+        { 0xAB70FE17C79AC6CAULL, -1060, -300 },
+        { 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+        { 0xBE5691EF416BD60CULL, -1007, -284 },
+        { 0x8DD01FAD907FFC3CULL,  -980, -276 },
+        { 0xD3515C2831559A83ULL,  -954, -268 },
+        { 0x9D71AC8FADA6C9B5ULL,  -927, -260 },
+        { 0xEA9C227723EE8BCBULL,  -901, -252 },
+        { 0xAECC49914078536DULL,  -874, -244 },
+        { 0x823C12795DB6CE57ULL,  -847, -236 },
+        { 0xC21094364DFB5637ULL,  -821, -228 },
+        { 0x9096EA6F3848984FULL,  -794, -220 },
+        { 0xD77485CB25823AC7ULL,  -768, -212 },
+        { 0xA086CFCD97BF97F4ULL,  -741, -204 },
+        { 0xEF340A98172AACE5ULL,  -715, -196 },
+        { 0xB23867FB2A35B28EULL,  -688, -188 },
+        { 0x84C8D4DFD2C63F3BULL,  -661, -180 },
+        { 0xC5DD44271AD3CDBAULL,  -635, -172 },
+        { 0x936B9FCEBB25C996ULL,  -608, -164 },
+        { 0xDBAC6C247D62A584ULL,  -582, -156 },
+        { 0xA3AB66580D5FDAF6ULL,  -555, -148 },
+        { 0xF3E2F893DEC3F126ULL,  -529, -140 },
+        { 0xB5B5ADA8AAFF80B8ULL,  -502, -132 },
+        { 0x87625F056C7C4A8BULL,  -475, -124 },
+        { 0xC9BCFF6034C13053ULL,  -449, -116 },
+        { 0x964E858C91BA2655ULL,  -422, -108 },
+        { 0xDFF9772470297EBDULL,  -396, -100 },
+        { 0xA6DFBD9FB8E5B88FULL,  -369,  -92 },
+        { 0xF8A95FCF88747D94ULL,  -343,  -84 },
+        { 0xB94470938FA89BCFULL,  -316,  -76 },
+        { 0x8A08F0F8BF0F156BULL,  -289,  -68 },
+        { 0xCDB02555653131B6ULL,  -263,  -60 },
+        { 0x993FE2C6D07B7FACULL,  -236,  -52 },
+        { 0xE45C10C42A2B3B06ULL,  -210,  -44 },
+        { 0xAA242499697392D3ULL,  -183,  -36 },
+        { 0xFD87B5F28300CA0EULL,  -157,  -28 },
+        { 0xBCE5086492111AEBULL,  -130,  -20 },
+        { 0x8CBCCC096F5088CCULL,  -103,  -12 },
+        { 0xD1B71758E219652CULL,   -77,   -4 },
+        { 0x9C40000000000000ULL,   -50,    4 },
+        { 0xE8D4A51000000000ULL,   -24,   12 },
+        { 0xAD78EBC5AC620000ULL,     3,   20 },
+        { 0x813F3978F8940984ULL,    30,   28 },
+        { 0xC097CE7BC90715B3ULL,    56,   36 },
+        { 0x8F7E32CE7BEA5C70ULL,    83,   44 },
+        { 0xD5D238A4ABE98068ULL,   109,   52 },
+        { 0x9F4F2726179A2245ULL,   136,   60 },
+        { 0xED63A231D4C4FB27ULL,   162,   68 },
+        { 0xB0DE65388CC8ADA8ULL,   189,   76 },
+        { 0x83C7088E1AAB65DBULL,   216,   84 },
+        { 0xC45D1DF942711D9AULL,   242,   92 },
+        { 0x924D692CA61BE758ULL,   269,  100 },
+        { 0xDA01EE641A708DEAULL,   295,  108 },
+        { 0xA26DA3999AEF774AULL,   322,  116 },
+        { 0xF209787BB47D6B85ULL,   348,  124 },
+        { 0xB454E4A179DD1877ULL,   375,  132 },
+        { 0x865B86925B9BC5C2ULL,   402,  140 },
+        { 0xC83553C5C8965D3DULL,   428,  148 },
+        { 0x952AB45CFA97A0B3ULL,   455,  156 },
+        { 0xDE469FBD99A05FE3ULL,   481,  164 },
+        { 0xA59BC234DB398C25ULL,   508,  172 },
+        { 0xF6C69A72A3989F5CULL,   534,  180 },
+        { 0xB7DCBF5354E9BECEULL,   561,  188 },
+        { 0x88FCF317F22241E2ULL,   588,  196 },
+        { 0xCC20CE9BD35C78A5ULL,   614,  204 },
+        { 0x98165AF37B2153DFULL,   641,  212 },
+        { 0xE2A0B5DC971F303AULL,   667,  220 },
+        { 0xA8D9D1535CE3B396ULL,   694,  228 },
+        { 0xFB9B7CD9A4A7443CULL,   720,  236 },
+        { 0xBB764C4CA7A44410ULL,   747,  244 },
+        { 0x8BAB8EEFB6409C1AULL,   774,  252 },
+        { 0xD01FEF10A657842CULL,   800,  260 },
+        { 0x9B10A4E5E9913129ULL,   827,  268 },
+        { 0xE7109BFBA19C0C9DULL,   853,  276 },
+        { 0xAC2820D9623BF429ULL,   880,  284 },
+        { 0x80444B5E7AA7CF85ULL,   907,  292 },
+        { 0xBF21E44003ACDD2DULL,   933,  300 },
+        { 0x8E679C2F5E44FF8FULL,   960,  308 },
+        { 0xD433179D9C8CB841ULL,   986,  316 },
+        { 0x9E19DB92B4E31BA9ULL,  1013,  324 }
+    };
+
+    // Digits are generated from a scaled value whose binary exponent lies within [min_exponent, max_exponent].
+    const int min_exponent = -60;
+    const int max_exponent = -32;
+
+    const cached_power &cached_power_for_binary_exponent(int e)
+    {
+        const int f = min_exponent - e - 1;
+        const int k = (f * 78913) / (1 << 18) + (f > 0);
+        const int index = (300 + k + 7) / 8;
+        return cached_powers[index];
+    }
+
+    void grisu2_round(char *buffer, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t ten_k)
+    {
+        // Move the last digit towards the exact value while the result stays inside the rounding interval.
+        while (rest < distance && delta - rest >= ten_k && (rest + ten_k < distance || distance - rest > rest + ten_k - distance))
+        {
+            --buffer[length - 1];
+            rest += ten_k;
+        }
+    }
+
+    // Generates the digits of a value within (low, high), the closer to w the better.
+    void grisu2_digits(char *buffer, int &length, int &decimal_exponent, diy_fp low, diy_fp w, diy_fp high)
+    {
+        static const uint32_t powers_of_ten[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+        uint64_t delta = high.f - low.f;
+        uint64_t distance = high.f - w.f;
+
+        const int shift = -high.e;
+        const uint64_t one = static_cast<uint64_t>(1) << shift;
+        uint32_t integral = static_cast<uint32_t>(high.f >> shift);
+        uint64_t fractional = high.f & (one - 1);
+
+        int digits = 10;
+        while (digits > 1 && integral < powers_of_ten[digits - 1])
+        {
+            --digits;
+        }
+
+        length = 0;
+        while (digits > 0)
+        {
+            const uint32_t divisor = powers_of_ten[digits - 1];
+            buffer[length++] = static_cast<char>('0' + integral / divisor);
+            integral %= divisor;
+            --digits;
+
+            const uint64_t rest = (static_cast<uint64_t>(integral) << shift) + fractional;
+            if (rest <= delta)
+            {
+                decimal_exponent += digits;
+                grisu2_round(buffer, length, distance, delta, rest, static_cast<uint64_t>(divisor) << shift);
+                return;
+            }
+        }
+
+        while (true)
+        {
+            fractional *= 10;
+            buffer[length++] = static_cast<char>('0' + (fractional >> shift));
+            fractional &= one - 1;
+            delta *= 10;
+            distance *= 10;
+            --decimal_exponent;
+            if (fractional <= delta)
+            {
+                break;
+            }
+        }
+        grisu2_round(buffer, length, distance, delta, fractional, one);
+    }
+
+    // Produces the digits of a positive finite double, which is then buffer * 10^decimal_exponent.
+    void grisu2(double value, char *buffer, int &length, int &decimal_exponent)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        const uint64_t hidden_bit = static_cast<uint64_t>(1) << 52;
+        const uint64_t fraction = bits & (hidden_bit - 1);
+        const int biased_exponent = static_cast<int>(bits >> 52);
+
+        const diy_fp v = biased_exponent == 0
+            ? diy_fp(fraction, 1 - 1075)
+            : diy_fp(fraction + hidden_bit, biased_exponent - 1075);
+
+        // The boundaries halfway to the neighbouring doubles, the lower one is closer at powers of two.
+        const diy_fp upper = normalize(diy_fp(2 * v.f + 1, v.e - 1));
+        diy_fp lower = (fraction == 0 && biased_exponent > 1) ? diy_fp(4 * v.f - 1, v.e - 2) : diy_fp(2 * v.f - 1, v.e - 1);
+        lower.f <<= lower.e - upper.e;
+        lower.e = upper.e;
+
+        const cached_power &power = cached_power_for_binary_exponent(upper.e);
+        const diy_fp c_minus_k(power.f, power.e);
+        const diy_fp w = multiply(normalize(v), c_minus_k);
+        const diy_fp scaled_lower = multiply(lower, c_minus_k);
+        const diy_fp scaled_upper = multiply(upper, c_minus_k);
+
+        decimal_exponent = -power.k;
+        grisu2_digits(buffer, length, decimal_exponent,
+            diy_fp(scaled_lower.f + 1, scaled_lower.e), w, diy_fp(scaled_upper.f - 1, scaled_upper.e));
+    }
+
+    size_t format_unsigned(char *buffer, uint64_t value)
+    {
+        char digits[20];
+        size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        for (size_t i = 0; i < count; ++i)
+        {
+            buffer[i] = digits[count - 1 - i];
+        }
+        return count;
+    }
+
+    size_t format_signed(char *buffer, int64_t value)
+    {
+        if (value >= 0)
+        {
+            return format_unsigned(buffer, static_cast<uint64_t>(value));
+        }
+        buffer[0] = '-';
+        return 1 + format_unsigned(buffer + 1, 0 - static_cast<uint64_t>(value));
+    }
+
+    size_t format_integer(char *buffer, const json::number &number)
+    {
+        return number.is_uint64() ? format_unsigned(buffer, number.to_uint64()) : format_signed(buffer, number.to_int64());
+    }
+
+    // Formats like printf's "%.17g", with the shortest digits that round-trip.
+    size_t format_double(char *buffer, double value)
+    {
+        if (value != value)
+        {
+            // NaN and infinities aren't valid JSON, they are printed as printf does.
+            std::memcpy(buffer, "nan", 3);
+            return 3;
+        }
+        if (value - value != 0)
+        {
+            std::memcpy(buffer, value < 0 ? "-inf" : "inf", value < 0 ? 4 : 3);
+            return value < 0 ? 4 : 3;
+        }
+
+        char *out = buffer;
+        if (std::signbit(value))
+        {
+            *out++ = '-';
+            value = -value;
+        }
+        if (value == 0)
+        {
+            *out++ = '0';
+            return static_cast<size_t>(out - buffer);
+        }
+
+        char digits[18];
+        int length;
+        int decimal_exponent;
+        grisu2(value, digits, length, decimal_exponent);
+        while (length > 1 && digits[length - 1] == '0')
+        {
+            --length;
+            ++decimal_exponent;
+        }
+
+        // The exponent of the first digit decides between the fixed and scientific notations.
+        const int exponent = length + decimal_exponent - 1;
+        if (exponent < -4 || exponent >= 17)
+        {
+            *out++ = digits[0];
+            if (length > 1)
+            {
+                *out++ = '.';
+                std::memcpy(out, digits + 1, static_cast<size_t>(length - 1));
+                out += length - 1;
+            }
+            *out++ = 'e';
+            *out++ = exponent < 0 ? '-' : '+';
+            const int magnitude = exponent < 0 ? -exponent : exponent;
+            if (magnitude >= 100)
+            {
+                *out++ = static_cast<char>('0' + magnitude / 100);
+            }
+            *out++ = static_cast<char>('0' + magnitude / 10 % 10);
+            *out++ = static_cast<char>('0' + magnitude % 10);
+        }
+        else if (exponent < 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = -1; i > exponent; --i)
+            {
+                *out++ = '0';
+            }
+            std::memcpy(out, digits, static_cast<size_t>(length));
+            out += length;
+        }
+        else if (length <= exponent + 1)
+        {
+            std::memcpy(out, digits, static_cast<size_t>(length));
+            out += length;
+            for (int i = length; i <= exponent; ++i)
+            {
+                *out++ = '0';
+            }
+        }
+        else
+        {
+            std::memcpy(out, digits, static_cast<size_t>(exponent + 1));
+            out += exponent + 1;
+            *out++ = '.';
+            std::memcpy(out, digits + exponent + 1, static_cast<size_t>(length - exponent - 1));
+            out += length - exponent - 1;
+        }
+        return static_cast<size_t>(out - buffer);
     }
+
+    // Large enough for any integer or double.
+    const size_t max_number_length = 32;
+}
+
+void web::json::details::_Number::format(std::basic_string<char>& stream) const
+{
+    char buffer[max_number_length];
+    const size_t length = m_number.m_type != number::type::double_type
+        ? format_integer(buffer, m_number)
+        : format_double(buffer, m_number.m_value);
+    stream.append(buffer, length);
 }
 
 #ifdef _WIN32
@@ -224,33 +535,11 @@ void web::json::details::_String::format(std::basic_string<wchar_t>& str) const
 
 void web::json::details::_Number::format(std::basic_string<wchar_t>& stream) const
 {
-    if(m_number.m_type != number::type::double_type)
-    {
-        // #digits + 1 to avoid loss + 1 for the sign + 1 for null terminator.
-        const size_t tempSize = std::numeric_limits<uint64_t>::digits10 + 3;
-        wchar_t tempBuffer[tempSize];
-
-        if (m_number.m_type == number::type::signed_type)
-            _i64tow_s(m_number.m_intval, tempBuffer, tempSize, 10);
-        else
-            _ui64tow_s(m_number.m_uintval, tempBuffer, tempSize, 10);
-
-        stream.append(tempBuffer, wcsnlen_s(tempBuffer, tempSize));
-    }
-    else
-    {
-        // #digits + 2 to avoid loss + 1 for the sign + 1 for decimal point + 5 for exponent (e+xxx) + 1 for null terminator
-        const size_t tempSize = std::numeric_limits<double>::digits10 + 10;
-        wchar_t tempBuffer[tempSize];
-        const int numChars = _swprintf_s_l(
-            tempBuffer,
-            tempSize,
-            L"%.*g",
-            utility::details::scoped_c_thread_locale::c_locale(),
-            std::numeric_limits<double>::digits10 + 2,
-            m_number.m_value);
-        stream.append(tempBuffer, numChars);
-    }
+    char buffer[max_number_length];
+    const size_t length = m_number.m_type != number::type::double_type
+        ? format_integer(buffer, m_number)
+        : format_double(buffer, m_number.m_value);
+    stream.append(buffer, buffer + length);
 }
 
 #endif
@@ -267,8 +556,434 @@ const utility::string_t & web::json::value::as_string() const
 
 utility::string_t json::value::serialize() const
 {
-#ifndef _WIN32
-    utility::details::scoped_c_thread_locale locale;
-#endif
     return m_value->to_string();
 }
+
+//
+// Streaming JSON writer
+//
+
+namespace web {
+namespace json
+{
+namespace details
+{
+
+class json_writer_impl : public std::enable_shared_from_this<json_writer_impl>
+{
+public:
+    json_writer_impl(concurrency::streams::streambuf<uint8_t> target, size_t chunk_size)
+        : m_target(std::move(target)),
+          m_chunk_size(chunk_size == 0 ? 1 : chunk_size),
+          m_pending(pplx::task_from_result()),
+          m_after_property(false),
+          m_complete(false)
+    {
+    }
+
+    void write_start_container(bool is_object)
+    {
+        begin_value();
+        m_buffer.push_back(is_object ? '{' : '[');
+        m_stack.push_back(container(is_object));
+    }
+
+    void write_end_container(bool is_object)
+    {
+        if (m_stack.empty() || m_stack.back().m_is_object != is_object || m_after_property)
+        {
+            throw json_exception(is_object ? _XPLATSTR("json_writer is not in an object awaiting its end")
+                                           : _XPLATSTR("json_writer is not in an array awaiting its end"));
+        }
+        m_buffer.push_back(is_object ? '}' : ']');
+        m_stack.pop_back();
+        end_value();
+    }
+
+    void write_property_name(const utility::string_t &name)
+    {
+        if (m_stack.empty() || !m_stack.back().m_is_object || m_after_property)
+        {
+            throw json_exception(_XPLATSTR("json_writer is not in an object awaiting a property name"));
+        }
+        if (m_stack.back().m_has_members)
+        {
+            m_buffer.push_back(',');
+        }
+        m_stack.back().m_has_members = true;
+        format_string(name, m_buffer);
+        m_buffer.push_back(':');
+        m_after_property = true;
+    }
+
+    void write_string(const utility::string_t &value)
+    {
+        begin_value();
+        format_string(value, m_buffer);
+        end_value();
+    }
+
+    void write_scalar(const json::value &value)
+    {
+        begin_value();
+        value.format(m_buffer);
+        end_value();
+    }
+
+    pplx::task<void> write_value(const json::value &value)
+    {
+        try
+        {
+            if (!value.is_object() && !value.is_array())
+            {
+                write_scalar(value);
+                return m_pending;
+            }
+
+            m_walk.clear();
+            write_start_container(value.is_object());
+            m_walk.push_back(walk_frame(value));
+            return continue_walk();
+        }
+        catch (...)
+        {
+            return pplx::task_from_exception<void>(std::current_exception());
+        }
+    }
+
+    pplx::task<void> flush()
+    {
+        hand_off();
+        return m_pending;
+    }
+
+    bool is_complete() const { return m_complete; }
+
+private:
+    struct container
+    {
+        container(bool is_object) : m_is_object(is_object), m_has_members(false) { }
+
+        bool m_is_object;
+        bool m_has_members;
+    };
+
+    // An object or array being written by write_value().
+    struct walk_frame
+    {
+        walk_frame(const json::value &value) : m_value(&value), m_index(0)
+        {
+            if (value.is_object())
+            {
+                m_order = value.as_object().ordered_fields();
+            }
+        }
+
+        const json::value *m_value;
+        size_t m_index;
+
+        // The fields of an object in key order, when they aren't stored in it.
+        std::vector<json::object::const_iterator> m_order;
+    };
+
+    // Adds the separator needed before a value and checks that one is allowed here.
+    void begin_value()
+    {
+        if (m_complete)
+        {
+            throw json_exception(_XPLATSTR("json_writer has already written a complete document"));
+        }
+        if (!m_stack.empty())
+        {
+            auto &current = m_stack.back();
+            if (current.m_is_object)
+            {
+                if (!m_after_property)
+                {
+                    throw json_exception(_XPLATSTR("json_writer expects a property name before a value in an object"));
+                }
+                m_after_property = false;
+            }
+            else
+            {
+                if (current.m_has_members)
+                {
+                    m_buffer.push_back(',');
+                }
+                current.m_has_members = true;
+            }
+        }
+    }
+
+    void end_value()
+    {
+        m_complete = m_stack.empty();
+        if (m_buffer.size() >= m_chunk_size)
+        {
+            hand_off();
+        }
+    }
+
+    // Queues the collected output to be written after the chunks before it.
+    void hand_off()
+    {
+        if (m_buffer.empty())
+        {
+            return;
+        }
+
+        auto chunk = std::make_shared<std::string>();
+        chunk->reserve(m_chunk_size + m_chunk_size / 4);
+        chunk->swap(m_buffer);
+        auto target = m_target;
+        m_pending = m_pending.then([target, chunk]() mutable
+        {
+            return target.putn_nocopy(reinterpret_cast<const uint8_t *>(chunk->data()), chunk->size()).then([chunk](size_t written)
+            {
+                if (written != chunk->size())
+                {
+                    throw std::runtime_error("failed to write all bytes");
+                }
+            });
+        });
+    }
+
+    // Writes members of the value being walked until a chunk is full, then waits for the stream.
+    pplx::task<void> continue_walk()
+    {
+        try
+        {
+            while (!m_walk.empty())
+            {
+                if (m_buffer.size() >= m_chunk_size)
+                {
+                    hand_off();
+                    auto self = shared_from_this();
+                    return m_pending.then([self]()
+                    {
+                        return self->continue_walk();
+                    });
+                }
+
+                auto &frame = m_walk.back();
+                const json::value *member;
+                if (frame.m_value->is_object())
+                {
+                    const auto &fields = frame.m_value->as_object();
+                    if (frame.m_index == fields.size())
+                    {
+                        m_walk.pop_back();
+                        write_end_container(true);
+                        continue;
+                    }
+                    const auto &field = frame.m_order.empty() ? *(fields.begin() + frame.m_index) : *frame.m_order[frame.m_index];
+                    ++frame.m_index;
+                    write_property_name(field.first);
+                    member = &field.second;
+                }
+                else
+                {
+                    const auto &elements = frame.m_value->as_array();
+                    if (frame.m_index == elements.size())
+                    {
+                        m_walk.pop_back();
+                        write_end_container(false);
+                        continue;
+                    }
+                    member = &*(elements.begin() + frame.m_index++);
+                }
+
+                if (member->is_object() || member->is_array())
+                {
+                    write_start_container(member->is_object());
+                    m_walk.push_back(walk_frame(*member));
+                }
+                else
+                {
+                    begin_value();
+                    member->format(m_buffer);
+                    m_complete = m_stack.empty();
+                }
+            }
+            return m_pending;
+        }
+        catch (...)
+        {
+            return pplx::task_from_exception<void>(std::current_exception());
+        }
+    }
+
+    concurrency::streams::streambuf<uint8_t> m_target;
+    size_t m_chunk_size;
+
+    // Output not yet handed to the stream, and the writes of everything before it.
+    std::string m_buffer;
+    pplx::task<void> m_pending;
+
+    std::vector<container> m_stack;
+    bool m_after_property;
+    bool m_complete;
+
+    std::vector<walk_frame> m_walk;
+};
+
+}
+
+json_writer::json_writer(concurrency::streams::streambuf<uint8_t> buffer, size_t chunk_size)
+    : m_impl(std::make_shared<details::json_writer_impl>(std::move(buffer), chunk_size))
+{
+}
+
+json_writer::json_writer(concurrency::streams::ostream stream, size_t chunk_size)
+    : m_impl(std::make_shared<details::json_writer_impl>(stream.streambuf(), chunk_size))
+{
+}
+
+void json_writer::write_start_object()
+{
+    m_impl->write_start_container(true);
+}
+
+void json_writer::write_end_object()
+{
+    m_impl->write_end_container(true);
+}
+
+void json_writer::write_start_array()
+{
+    m_impl->write_start_container(false);
+}
+
+void json_writer::write_end_array()
+{
+    m_impl->write_end_container(false);
+}
+
+void json_writer::write_property_name(const utility::string_t &name)
+{
+    m_impl->write_property_name(name);
+}
+
+void json_writer::write_string(const utility::string_t &value)
+{
+    m_impl->write_string(value);
+}
+
+void json_writer::write_number(double value)
+{
+    m_impl->write_scalar(json::value::number(value));
+}
+
+void json_writer::write_number(int32_t value)
+{
+    m_impl->write_scalar(json::value::number(value));
+}
+
+void json_writer::write_number(uint32_t value)
+{
+    m_impl->write_scalar(json::value::number(value));
+}
+
+void json_writer::write_number(int64_t value)
+{
+    m_impl->write_scalar(json::value::number(value));
+}
+
+void json_writer::write_number(uint64_t value)
+{
+    m_impl->write_scalar(json::value::number(value));
+}
+
+void json_writer::write_boolean(bool value)
+{
+    m_impl->write_scalar(json::value::boolean(value));
+}
+
+void json_writer::write_null()
+{
+    m_impl->write_scalar(json::value::null());
+}
+
+pplx::task<void> json_writer::write_value(const json::value &value)
+{
+    return m_impl->write_value(value);
+}
+
+pplx::task<void> json_writer::flush()
+{
+    return m_impl->flush();
+}
+
+bool json_writer::is_complete() const
+{
+    return m_impl->is_complete();
+}
+
+}}
+
+//
+// Direct mapping of C++ types to JSON
+//
+
+namespace
+{
+    // Appends a quoted UTF-8 string, copying it in one go up to the first character which needs escaping.
+    void append_quoted(std::string &out, const char *begin, const char *end)
+    {
+        out.push_back('"');
+        const char *clean = begin;
+        while (clean != end && *clean != '"' && *clean != '\\' && static_cast<unsigned char>(*clean) >= 0x20)
+        {
+            ++clean;
+        }
+        out.append(begin, clean);
+        if (clean != end)
+        {
+            json::details::append_escape_string(out, std::string(clean, end));
+        }
+        out.push_back('"');
+    }
+}
+
+void json::details::json_mapping_writer::write_name(const char *name)
+{
+    append_quoted(m_out, name, name + std::strlen(name));
+    m_out.push_back(':');
+}
+
+void json::details::json_mapping_writer::write_string(const utility::string_t &value)
+{
+#ifdef _UTF16_STRINGS
+    write_string(utility::conversions::to_utf8string(value));
+}
+
+void json::details::json_mapping_writer::write_string(const std::string &utf8)
+{
+    append_quoted(m_out, utf8.data(), utf8.data() + utf8.size());
+#else
+    append_quoted(m_out, value.data(), value.data() + value.size());
+#endif
+}
+
+void json::details::json_mapping_writer::write_number(int64_t value)
+{
+    char buffer[max_number_length];
+    m_out.append(buffer, format_signed(buffer, value));
+}
+
+void json::details::json_mapping_writer::write_number(uint64_t value)
+{
+    char buffer[max_number_length];
+    m_out.append(buffer, format_unsigned(buffer, value));
+}
+
+void json::details::json_mapping_writer::write_number(double value)
+{
+    char buffer[max_number_length];
+    m_out.append(buffer, format_double(buffer, value));
+}
+
+void json::details::json_mapping_writer::write_value(const json::value &value)
+{
+    value.format(m_out);
+}
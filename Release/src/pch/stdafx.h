@@ -114,9 +114,14 @@
 #include "cpprest/rawptrstream.h"
 #include "cpprest/interopstream.h"
 #include "cpprest/producerconsumerstream.h"
+#include "cpprest/bufferchainstream.h"
 
 // json
 #include "cpprest/json.h"
+#include "cpprest/json_binary.h"
+#include "cpprest/json_mapping.h"
+#include "cpprest/json_reader.h"
+#include "cpprest/json_writer.h"
 
 // uri
 #include "cpprest/base_uri.h"
@@ -30,6 +30,20 @@
 #include "stdafx.h"
 #include "cpprest/details/fileio.h"
 
+#include <deque>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(CPPREST_USE_IO_URING)
+#include <linux/io_uring.h>
+#include <linux/magic.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+#if !defined(__NR_io_uring_setup)
+#undef CPPREST_USE_IO_URING
+#endif
+#endif
+
 using namespace boost::asio;
 using namespace Concurrency::streams::details;
 
@@ -43,6 +57,30 @@ namespace Concurrency { namespace streams { namespace details {
 * =-=-=-
 ****/
 
+/// <summary>
+/// A block of a file read ahead of the read buffer, while the application is busy with what is in it.
+/// </summary>
+struct _read_ahead_block
+{
+    _read_ahead_block(char *data, size_t size, size_t offset) :
+        m_data(data),
+        m_size(size),
+        m_offset(offset),
+        m_fill(0),
+        m_done(false),
+        m_dropped(false)
+    {
+    }
+
+    char   *m_data;
+    size_t m_size;      // Allocated size, in bytes.
+    size_t m_offset;    // File position the block was read from, in bytes.
+    size_t m_fill;      // Bytes actually read, once done.
+    bool   m_done;      // The read has completed.
+    bool   m_dropped;   // No longer wanted; the block is freed once its read completes.
+    std::exception_ptr m_error;
+};
+
 /// <summary>
 /// The public parts of the file information record contain only what is implementation-
 /// independent. The actual allocated record is larger and has details that the implementation
@@ -54,7 +92,22 @@ struct _file_info_impl : _file_info
         _file_info(mode, 512),
         m_handle(handle),
         m_buffer_reads(buffer_reads),
-        m_outstanding_writes(0)
+        m_outstanding_writes(0),
+        m_use_io_uring(false),
+        m_buffer_index(-1),
+        m_sequential_reads(0),
+        m_read_ahead_size(0),
+        m_read_ahead_depth(0),
+        m_read_ahead_next(0),
+        m_read_ahead_spare(nullptr),
+        m_read_ahead_waiter(nullptr),
+        m_reads_in_flight(0),
+        m_advised(false),
+        m_write_buffer(nullptr),
+        m_write_capacity(0),
+        m_write_fill(0),
+        m_write_pos(0),
+        m_appending(false)
     {
     }
 
@@ -71,10 +124,556 @@ struct _file_info_impl : _file_info
     std::vector<_filestream_callback *> m_sync_waiters;
 
     std::atomic<long> m_outstanding_writes;
+
+    /// <summary>
+    /// Whether reads and writes go through the io_uring rather than the thread pool.
+    /// </summary>
+    bool m_use_io_uring;
+
+    /// <summary>
+    /// The slot the read buffer is registered in with the io_uring, or -1 if it isn't registered.
+    /// </summary>
+    int m_buffer_index;
+
+    /// <summary>
+    /// The number of refills in a row that continued where the read buffer ended.
+    /// </summary>
+    size_t m_sequential_reads;
+
+    /// <summary>
+    /// The size (in bytes) of read-ahead blocks, 0 while reads don't look sequential.
+    /// </summary>
+    size_t m_read_ahead_size;
+
+    /// <summary>
+    /// How many blocks to keep reading ahead; raised when the application catches up with them.
+    /// </summary>
+    size_t m_read_ahead_depth;
+
+    /// <summary>
+    /// The file position (in bytes) the next read-ahead block starts at.
+    /// </summary>
+    size_t m_read_ahead_next;
+
+    /// <summary>
+    /// Blocks read, or being read, ahead of the read buffer, in file order.
+    /// </summary>
+    std::deque<_read_ahead_block *> m_read_ahead;
+
+    /// <summary>
+    /// A retired read buffer of the read-ahead block size, kept for the next block.
+    /// </summary>
+    char *m_read_ahead_spare;
+
+    /// <summary>
+    /// A refill waiting for the first read-ahead block to arrive.
+    /// </summary>
+    _filestream_callback *m_read_ahead_waiter;
+    size_t m_read_ahead_waiter_char_size;
+
+    /// <summary>
+    /// Read-ahead blocks still being read, including dropped ones. The file can't be closed before they're done.
+    /// </summary>
+    size_t m_reads_in_flight;
+    std::function<void()> m_on_reads_done;
+
+    /// <summary>
+    /// Whether the kernel has been told that the file is read sequentially.
+    /// </summary>
+    bool m_advised;
+
+    /// <summary>
+    /// Small writes gathered into one, the file position (in bytes, or -1 to append) they go to, and the
+    /// error of a gathered write that failed, which is reported by the next write or flush.
+    /// </summary>
+    char *m_write_buffer;
+    size_t m_write_capacity;
+    size_t m_write_fill;
+    size_t m_write_pos;
+    std::exception_ptr m_write_error;
+
+    /// <summary>
+    /// Whether an append is being written, and the appends queued behind it, which go out one at a time
+    /// so they reach the file in the order they were made.
+    /// </summary>
+    bool m_appending;
+    std::deque<std::function<void()>> m_appends;
+};
+
+#if defined(CPPREST_USE_IO_URING)
+
+/// <summary>
+/// An io_uring shared by all file streams. Reads and writes are queued on the submission ring and handed
+/// to the kernel in batches, so no thread blocks while they run. Requests the kernel completes right away,
+/// like reads from the page cache, are passed on by the thread pool; a single thread waits for the others.
+/// Read buffers can be registered, which saves the kernel from mapping their pages for every request.
+/// </summary>
+/// <remarks>
+/// Nothing waits for room in the rings: when every entry is in use, requests go to the thread pool as
+/// they do on kernels without io_uring. Setting the CPPREST_NO_IO_URING environment variable turns the
+/// ring off.
+/// </remarks>
+class _io_uring
+{
+public:
+    typedef std::function<void(int)> completion_handler;
+
+    /// <summary>
+    /// Gets the ring, or null if io_uring isn't available.
+    /// </summary>
+    static _io_uring *instance()
+    {
+        static _io_uring s_ring;
+        return s_ring.m_fd != -1 ? &s_ring : nullptr;
+    }
+
+    ~_io_uring()
+    {
+        if (m_fd == -1) return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_wait_lock);
+            m_stopping = true;
+        }
+        m_wait.notify_one();
+
+        // Wakes the completion thread if it is waiting for the kernel.
+        push(IORING_OP_NOP, -1, nullptr, 0, 0, -1, nullptr);
+        m_completion_thread.join();
+
+        munmap(m_sqes, m_sqes_size);
+        if (m_cq_ring != m_sq_ring)
+        {
+            munmap(m_cq_ring, m_cq_ring_size);
+        }
+        munmap(m_sq_ring, m_sq_ring_size);
+        close(m_fd);
+    }
+
+    /// <summary>
+    /// Starts a read or write.
+    /// </summary>
+    /// <param name="opcode">IORING_OP_READ, IORING_OP_WRITE or IORING_OP_READ_FIXED.</param>
+    /// <param name="fd">The file descriptor.</param>
+    /// <param name="ptr">The data to write or the buffer to read into.</param>
+    /// <param name="count">The number of bytes.</param>
+    /// <param name="offset">The offset in the file.</param>
+    /// <param name="buffer_index">The registered buffer holding <paramref name="ptr"/>, for IORING_OP_READ_FIXED.</param>
+    /// <param name="handler">Called with the number of bytes transferred or a negated errno.</param>
+    /// <returns>False if the ring is full, in which case the request has to be done some other way.</returns>
+    bool submit(uint8_t opcode, int fd, void *ptr, size_t count, size_t offset, int buffer_index, completion_handler handler)
+    {
+        if (count > static_cast<size_t>(INT_MAX)) return false;
+
+        // Keeping the requests in flight within the size of the submission ring means neither ring
+        // can overflow.
+        if (++m_in_flight > m_entries)
+        {
+            --m_in_flight;
+            return false;
+        }
+
+        push(opcode, fd, ptr, count, offset, buffer_index, new completion_handler(std::move(handler)));
+        return true;
+    }
+
+    /// <summary>
+    /// Registers a buffer, so reads into it can use IORING_OP_READ_FIXED.
+    /// </summary>
+    /// <returns>The index of the buffer or -1 if it couldn't be registered.</returns>
+    int register_buffer(void *ptr, size_t size)
+    {
+        int index;
+        {
+            std::lock_guard<std::mutex> lock(m_buffers_lock);
+            if (m_free_buffers.empty()) return -1;
+            index = m_free_buffers.back();
+            m_free_buffers.pop_back();
+        }
+
+        if (!update_buffer(index, ptr, size))
+        {
+            release_index(index);
+            return -1;
+        }
+        return index;
+    }
+
+    /// <summary>
+    /// Releases a buffer registered with <see cref="register_buffer"/>, before it is freed.
+    /// </summary>
+    void unregister_buffer(int index)
+    {
+        update_buffer(index, nullptr, 0);
+        release_index(index);
+    }
+
+private:
+    static const unsigned ring_entries = 256;
+    static const unsigned buffer_slots = 64;
+
+    _io_uring() : m_fd(-1), m_sq_ring(MAP_FAILED), m_sqes(nullptr), m_cq_ring(MAP_FAILED), m_in_flight(0), m_submitting(false), m_stopping(false)
+    {
+        if (getenv("CPPREST_NO_IO_URING") != nullptr) return;
+
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, ring_entries, &params));
+        if (fd < 0) return;
+
+        m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            m_sq_ring_size = m_cq_ring_size = (std::max)(m_sq_ring_size, m_cq_ring_size);
+        }
+
+        m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (m_sq_ring != MAP_FAILED)
+        {
+            m_cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? m_sq_ring
+                : mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        }
+        void *sqes = m_cq_ring == MAP_FAILED ? MAP_FAILED
+            : mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) munmap(m_cq_ring, m_cq_ring_size);
+            if (m_sq_ring != MAP_FAILED) munmap(m_sq_ring, m_sq_ring_size);
+            close(fd);
+            return;
+        }
+
+        auto sq = static_cast<char *>(m_sq_ring);
+        auto cq = static_cast<char *>(m_cq_ring);
+        m_sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        m_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        m_sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        m_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        m_sqes = static_cast<io_uring_sqe *>(sqes);
+        m_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        m_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        m_cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        m_entries = params.sq_entries;
+
+        // Reserve an empty table for registered buffers; kernels which can't do that simply don't get
+        // any registered buffers.
+        io_uring_rsrc_register buffers;
+        memset(&buffers, 0, sizeof(buffers));
+        buffers.nr = buffer_slots;
+        buffers.flags = IORING_RSRC_REGISTER_SPARSE;
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS2, &buffers, sizeof(buffers)) == 0)
+        {
+            for (int i = buffer_slots - 1; i >= 0; --i)
+            {
+                m_free_buffers.push_back(i);
+            }
+        }
+
+        m_fd = fd;
+        m_completion_thread = std::thread([this]() { complete(); });
+    }
+
+    void push(uint8_t opcode, int fd, void *ptr, size_t count, size_t offset, int buffer_index, completion_handler *handler)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_submit_lock);
+
+            // Submitters move the tail under the lock, the kernel moves the head.
+            unsigned tail = *m_sq_tail;
+            unsigned index = tail & m_sq_mask;
+            io_uring_sqe &sqe = m_sqes[index];
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            sqe.fd = fd;
+            sqe.addr = reinterpret_cast<uintptr_t>(ptr);
+            sqe.len = static_cast<uint32_t>(count);
+            sqe.off = offset;
+            sqe.user_data = reinterpret_cast<uintptr_t>(handler);
+            if (buffer_index >= 0)
+            {
+                sqe.buf_index = static_cast<uint16_t>(buffer_index);
+            }
+            m_sq_array[index] = index;
+            __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+            // Whoever is already submitting picks up this entry as well; otherwise this thread takes
+            // over and submits everything that gets queued meanwhile in as few calls as possible.
+            if (m_submitting) return;
+            m_submitting = true;
+        }
+
+        for (;;)
+        {
+            unsigned pending;
+            {
+                std::lock_guard<std::mutex> lock(m_submit_lock);
+                pending = *m_sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+                if (pending == 0)
+                {
+                    m_submitting = false;
+                    break;
+                }
+            }
+
+            if (syscall(__NR_io_uring_enter, m_fd, pending, 0, 0, nullptr, 0) < 0)
+            {
+                if (errno == EAGAIN || errno == EBUSY)
+                {
+                    std::this_thread::yield();
+                }
+                else if (errno != EINTR)
+                {
+                    redo_unsubmitted();
+                    break;
+                }
+            }
+        }
+
+        // Whatever completed during submission is passed on by the thread pool, as the caller may hold
+        // locks the handlers take. This is usually picked up by the same thread, once the caller is done.
+        auto completed = std::make_shared<std::vector<std::pair<completion_handler *, int>>>();
+        reap(*completed);
+        if (!completed->empty())
+        {
+            pplx::create_task([completed]()
+            {
+                dispatch(*completed);
+            });
+        }
+
+        // Anything still in flight is left to the completion thread.
+        if (m_in_flight > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_wait_lock);
+            m_wait.notify_one();
+        }
+    }
+
+    // Takes back the entries the kernel refused to accept and does them on the thread pool instead.
+    void redo_unsubmitted()
+    {
+        auto requests = std::make_shared<std::vector<io_uring_sqe>>();
+        {
+            // Without a polling thread the kernel only reads the ring from io_uring_enter, so nobody else
+            // looks at the entries between the head and the tail.
+            std::lock_guard<std::mutex> lock(m_submit_lock);
+            const unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+            for (unsigned i = head; i != *m_sq_tail; ++i)
+            {
+                requests->push_back(m_sqes[m_sq_array[i & m_sq_mask]]);
+            }
+            __atomic_store_n(m_sq_tail, head, __ATOMIC_RELEASE);
+            m_submitting = false;
+        }
+        m_in_flight -= static_cast<unsigned>(requests->size());
+
+        pplx::create_task([requests]()
+        {
+            std::vector<std::pair<completion_handler *, int>> completed;
+            for (const auto &sqe : *requests)
+            {
+                void *ptr = reinterpret_cast<void *>(static_cast<uintptr_t>(sqe.addr));
+                const auto result = sqe.opcode == IORING_OP_WRITE
+                    ? pwrite(sqe.fd, ptr, sqe.len, static_cast<off_t>(sqe.off))
+                    : pread(sqe.fd, ptr, sqe.len, static_cast<off_t>(sqe.off));
+                completed.push_back(std::make_pair(reinterpret_cast<completion_handler *>(static_cast<uintptr_t>(sqe.user_data)),
+                    result < 0 ? -errno : static_cast<int>(result)));
+            }
+            dispatch(completed);
+        });
+    }
+
+    void reap(std::vector<std::pair<completion_handler *, int>> &completed)
+    {
+        std::lock_guard<std::mutex> lock(m_reap_lock);
+
+        unsigned head = *m_cq_head;
+        unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe &cqe = m_cqes[head & m_cq_mask];
+            auto handler = reinterpret_cast<completion_handler *>(static_cast<uintptr_t>(cqe.user_data));
+            if (handler != nullptr)
+            {
+                completed.push_back(std::make_pair(handler, cqe.res));
+                --m_in_flight;
+            }
+        }
+        __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    static void dispatch(const std::vector<std::pair<completion_handler *, int>> &completed)
+    {
+        for (const auto &request : completed)
+        {
+            (*request.first)(request.second);
+            delete request.first;
+        }
+    }
+
+    void complete()
+    {
+        std::vector<std::pair<completion_handler *, int>> completed;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_wait_lock);
+                m_wait.wait(lock, [this]() { return m_in_flight > 0 || m_stopping; });
+                if (m_stopping) return;
+            }
+
+            syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+            reap(completed);
+            dispatch(completed);
+            completed.clear();
+        }
+    }
+
+    bool update_buffer(int index, void *ptr, size_t size)
+    {
+        iovec buffer;
+        buffer.iov_base = ptr;
+        buffer.iov_len = size;
+
+        io_uring_rsrc_update2 update;
+        memset(&update, 0, sizeof(update));
+        update.offset = static_cast<uint32_t>(index);
+        update.data = reinterpret_cast<uintptr_t>(&buffer);
+        update.nr = 1;
+        return syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) == 1;
+    }
+
+    void release_index(int index)
+    {
+        std::lock_guard<std::mutex> lock(m_buffers_lock);
+        m_free_buffers.push_back(index);
+    }
+
+    int m_fd;
+
+    void *m_sq_ring;
+    size_t m_sq_ring_size;
+    unsigned *m_sq_head;
+    unsigned *m_sq_tail;
+    unsigned m_sq_mask;
+    unsigned *m_sq_array;
+    io_uring_sqe *m_sqes;
+    size_t m_sqes_size;
+
+    void *m_cq_ring;
+    size_t m_cq_ring_size;
+    unsigned *m_cq_head;
+    unsigned *m_cq_tail;
+    unsigned m_cq_mask;
+    io_uring_cqe *m_cqes;
+
+    unsigned m_entries;
+    std::atomic<unsigned> m_in_flight;
+
+    std::mutex m_submit_lock;
+    bool m_submitting;
+
+    std::mutex m_reap_lock;
+
+    std::mutex m_wait_lock;
+    std::condition_variable m_wait;
+    bool m_stopping;
+
+    std::mutex m_buffers_lock;
+    std::vector<int> m_free_buffers;
+
+    std::thread m_completion_thread;
 };
 
+#endif
+
+/// <summary>
+/// Replaces the read buffer of a file, dropping the io_uring registration of the old one, or the mapping
+/// of the file.
+/// </summary>
+/// <param name="fInfo">The file info record of the file</param>
+/// <param name="buffer">The new buffer, or null to just free the current one</param>
+/// <param name="size">The size (in bytes) of the new buffer</param>
+static void _set_buffer(_file_info_impl *fInfo, char *buffer, size_t size)
+{
+#if defined(CPPREST_USE_IO_URING)
+    if (fInfo->m_buffer_index != -1)
+    {
+        _io_uring::instance()->unregister_buffer(fInfo->m_buffer_index);
+        fInfo->m_buffer_index = -1;
+    }
+#endif
+
+    if (fInfo->m_mapped)
+    {
+        if (fInfo->m_buffer != nullptr)
+        {
+            munmap(fInfo->m_buffer, fInfo->m_bufsize);
+        }
+        fInfo->m_mapped = false;
+    }
+    else
+    {
+        delete[] fInfo->m_buffer;
+    }
+    fInfo->m_buffer = buffer;
+    fInfo->m_bufsize = size;
+}
+
+/// <summary>
+/// Registers the read buffer of a file with the io_uring. This is done once the buffer gets refilled, as
+/// registering costs more than it saves on a single read.
+/// </summary>
+/// <param name="fInfo">The file info record of the file</param>
+static void _register_buffer(_file_info_impl *fInfo)
+{
+#if defined(CPPREST_USE_IO_URING)
+    if (fInfo->m_use_io_uring && fInfo->m_buffer_index == -1)
+    {
+        fInfo->m_buffer_index = _io_uring::instance()->register_buffer(fInfo->m_buffer, fInfo->m_bufsize);
+    }
+#else
+    (void)fInfo;
+#endif
+}
+
+/// <summary>
+/// Drops the blocks read ahead of the read buffer and stops reading ahead until reads look sequential again.
+/// Blocks still being read are freed when their read completes.
+/// </summary>
+/// <param name="fInfo">The file info record of the file</param>
+static void _drop_read_ahead(_file_info_impl *fInfo)
+{
+    for (auto block : fInfo->m_read_ahead)
+    {
+        if (block->m_done)
+        {
+            delete[] block->m_data;
+            delete block;
+        }
+        else
+        {
+            block->m_dropped = true;
+        }
+    }
+    fInfo->m_read_ahead.clear();
+    fInfo->m_read_ahead_size = 0;
+    fInfo->m_sequential_reads = 0;
+}
+
 }}}
 
+/// <summary>
+/// The size (in bytes) of the buffer small writes are gathered in, and the smallest block read ahead of
+/// sequential reads.
+/// </summary>
+static const size_t WriteBufferSize = 64 * 1024;
+static const size_t ReadAheadSize = 64 * 1024;
+
 /// <summary>
 /// Perform post-CreateFile processing.
 /// </summary>
@@ -100,11 +699,25 @@ bool _finish_create(int fh, _filestream_callback *callback, std::ios_base::openm
 
         auto info = new _file_info_impl(fh, mode, buffer);
 
+#if defined(CPPREST_USE_IO_URING)
+        // tmpfs can't read or write without blocking, so io_uring would hand every request to a worker
+        // thread of its own; the thread pool does that more cheaply.
+        struct statfs fs;
+        info->m_use_io_uring = _io_uring::instance() != nullptr &&
+            (fstatfs(fh, &fs) != 0 || fs.f_type != TMPFS_MAGIC);
+#endif
+
         if (mode & std::ios_base::app || mode & std::ios_base::ate)
         {
             info->m_wrpos = static_cast<size_t>(-1); // Start at the end of the file.
         }
 
+        // Gather small writes, unless the file is read too, where reads would have to look for them.
+        if ((mode & std::ios_base::out) && !(mode & std::ios_base::in))
+        {
+            info->m_write_buffer_size = WriteBufferSize;
+        }
+
         callback->on_opened(info);
         return true;
     }
@@ -180,6 +793,59 @@ bool _open_fsb_str(_filestream_callback *callback, const char *filename, std::io
     return true;
 }
 
+/// <summary>
+/// Open a file for reading and map all of it into memory, so that reads never wait for I/O.
+/// </summary>
+/// <param name="callback">A pointer to the callback interface to invoke when the file has been opened.</param>
+/// <param name="filename">The name of the file to open</param>
+/// <param name="char_size">The size of the character type used for this stream</param>
+/// <returns>True if the opening operation could be initiated, false otherwise.</returns>
+bool _open_fsb_mapped_str(_filestream_callback *callback, const char *filename, size_t char_size)
+{
+    if ( callback == nullptr || filename == nullptr ) return false;
+
+    std::string name(filename);
+
+    pplx::create_task([=]() -> void
+    {
+        int f = open(name.c_str(), O_RDONLY);
+
+        struct stat st;
+        if ( f == -1 || fstat(f, &st) == -1 )
+        {
+            int error = errno;
+            if ( f != -1 ) close(f);
+            callback->on_error(std::make_exception_ptr(utility::details::create_system_error(error)));
+            return;
+        }
+
+        // An empty file can't be mapped, and doesn't need to be.
+        size_t size = static_cast<size_t>(st.st_size);
+        void *data = nullptr;
+        if ( size > 0 )
+        {
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, f, 0);
+            if ( data == MAP_FAILED )
+            {
+                int error = errno;
+                close(f);
+                callback->on_error(std::make_exception_ptr(utility::details::create_system_error(error)));
+                return;
+            }
+        }
+
+        auto info = new _file_info_impl(f, std::ios_base::in, true);
+        info->m_buffer = static_cast<char *>(data);
+        info->m_bufsize = size;
+        info->m_buffill = size / char_size;
+        info->m_mapped = true;
+
+        callback->on_opened(info);
+    });
+
+    return true;
+}
+
 /// <summary>
 /// Close a file stream buffer.
 /// </summary>
@@ -201,34 +867,63 @@ bool _close_fsb_nolock(_file_info **info, Concurrency::streams::details::_filest
     // Since closing a file may involve waiting for outstanding writes which can take some time
     // if the file is on a network share, the close action is done in a separate task, as
     // CloseHandle doesn't have I/O completion events.
-    pplx::create_task([=] () -> void
+    auto close_file = [=] () -> void
         {
-            bool result = false;
+            int error = 0;
 
             {
                 pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
 
                 if ( fInfo->m_handle != -1 )
                 {
-                    result = close(fInfo->m_handle) != -1;
+                    // Writes still gathered in the write buffer go out now.
+                    if ( fInfo->m_write_fill > 0 )
+                    {
+                        off_t position = fInfo->m_write_pos == static_cast<size_t>(-1) ?
+                            lseek(fInfo->m_handle, 0, SEEK_END) : static_cast<off_t>(fInfo->m_write_pos);
+                        if ( pwrite(fInfo->m_handle, fInfo->m_write_buffer, fInfo->m_write_fill, position) != static_cast<ssize_t>(fInfo->m_write_fill) )
+                        {
+                            error = errno;
+                        }
+                    }
+
+                    if ( close(fInfo->m_handle) == -1 && error == 0 )
+                    {
+                        error = errno;
+                    }
                 }
 
-                if ( fInfo->m_buffer != nullptr )
-                {
-                    delete[] fInfo->m_buffer;
-                }
+                _set_buffer(fInfo, nullptr, 0);
+                _drop_read_ahead(fInfo);
+                delete[] fInfo->m_read_ahead_spare;
+                delete[] fInfo->m_write_buffer;
             }
 
             delete fInfo;
-            if (result)
+            if (error == 0)
             {
                 callback->on_closed();
             }
             else
             {
-                callback->on_error(std::make_exception_ptr(utility::details::create_system_error(errno)));
+                callback->on_error(std::make_exception_ptr(utility::details::create_system_error(error)));
             }
-        });
+        };
+
+    // Blocks still being read ahead hold on to the file, so closing waits for them.
+    {
+        pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
+
+        _drop_read_ahead(fInfo);
+        if ( fInfo->m_reads_in_flight > 0 )
+        {
+            fInfo->m_on_reads_done = [=]() { pplx::create_task(close_file); };
+        }
+        else
+        {
+            pplx::create_task(close_file);
+        }
+    }
 
     *info = nullptr;
 
@@ -245,6 +940,64 @@ bool _close_fsb(_file_info **info, Concurrency::streams::details::_filestream_ca
     return _close_fsb_nolock(info, callback);
 }
 
+/// <summary>
+/// Report a finished write and signal the callbacks waiting for the last outstanding one.
+/// </summary>
+/// <param name="info">The file info record of the file</param>
+/// <param name="callback">A pointer to the callback interface to invoke when the write request is completed.</param>
+/// <param name="bytes_written">The number of bytes written, or -1 if the write failed and the callback has
+/// been given the error already</param>
+static void _finish_write(_file_info_impl *fInfo, _filestream_callback *callback, size_t bytes_written, bool append)
+{
+    if ( bytes_written != static_cast<size_t>(-1) )
+    {
+        callback->on_completed(bytes_written);
+    }
+
+    pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
+
+    // Start the next append, if one is queued.
+    if ( append )
+    {
+        if ( fInfo->m_appends.empty() )
+        {
+            fInfo->m_appending = false;
+        }
+        else
+        {
+            auto next = std::move(fInfo->m_appends.front());
+            fInfo->m_appends.pop_front();
+            next();
+        }
+    }
+
+    // Decrement the counter of outstanding write events.
+    if ( --fInfo->m_outstanding_writes == 0 )
+    {
+        // If this was the last one, signal all objects waiting for it to complete, with the error of
+        // a gathered write if there was one.
+
+        auto error = fInfo->m_write_error;
+        if ( error && !fInfo->m_sync_waiters.empty() )
+        {
+            fInfo->m_write_error = nullptr;
+        }
+
+        for (auto iter = fInfo->m_sync_waiters.begin(); iter != fInfo->m_sync_waiters.end(); iter++)
+        {
+            if ( error )
+            {
+                (*iter)->on_error(error);
+            }
+            else
+            {
+                (*iter)->on_completed(0);
+            }
+        }
+        fInfo->m_sync_waiters.clear();
+    }
+}
+
 /// <summary>
 /// Initiate an asynchronous (overlapped) write to the file stream.
 /// </summary>
@@ -253,10 +1006,51 @@ bool _close_fsb(_file_info **info, Concurrency::streams::details::_filestream_ca
 /// <param name="ptr">A pointer to the data to write</param>
 /// <param name="count">The size (in bytes) of the data</param>
 /// <returns>0 if the write request is still outstanding, -1 if the request failed, otherwise the size of the data written</returns>
+static void _start_write(_file_info_impl *fInfo, _filestream_callback *callback, const void *ptr, size_t count, size_t position);
+
 size_t _write_file_async(Concurrency::streams::details::_file_info_impl *fInfo, Concurrency::streams::details::_filestream_callback *callback, const void *ptr, size_t count, size_t position)
 {
     ++fInfo->m_outstanding_writes;
- 
+
+    // Appends go to wherever the file ends when they run, so each waits for the one before it to finish.
+    if ( position == static_cast<size_t>(-1) )
+    {
+        pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
+
+        if ( fInfo->m_appending )
+        {
+            fInfo->m_appends.push_back([=]() { _start_write(fInfo, callback, ptr, count, position); });
+            return 0;
+        }
+        fInfo->m_appending = true;
+    }
+
+    _start_write(fInfo, callback, ptr, count, position);
+    return 0;
+}
+
+/// <summary>
+/// Starts a write counted by _write_file_async.
+/// </summary>
+static void _start_write(_file_info_impl *fInfo, _filestream_callback *callback, const void *ptr, size_t count, size_t position)
+{
+#if defined(CPPREST_USE_IO_URING)
+    // Appending needs the file position moved around the write, which only the thread pool path does.
+    if (fInfo->m_use_io_uring && position != static_cast<size_t>(-1) &&
+        _io_uring::instance()->submit(IORING_OP_WRITE, fInfo->m_handle, const_cast<void *>(ptr), count, position, -1,
+            [=](int result)
+            {
+                if (result < 0)
+                {
+                    callback->on_error(std::make_exception_ptr(utility::details::create_system_error(-result)));
+                }
+                _finish_write(fInfo, callback, result < 0 ? static_cast<size_t>(-1) : static_cast<size_t>(result), false);
+            }))
+    {
+        return;
+    }
+#endif
+
     pplx::create_task([=]() -> void
     {
         off_t abs_position;
@@ -286,26 +1080,61 @@ size_t _write_file_async(Concurrency::streams::details::_file_info_impl *fInfo,
             lseek(fInfo->m_handle, orig_pos, SEEK_SET);
         }
 
-        callback->on_completed(bytes_written);
+        _finish_write(fInfo, callback, bytes_written, must_restore_pos);
+    });
+}
+
+/// <summary>
+/// Frees the write buffer handed to a gathered write once it is done, and keeps its error for the next
+/// write or flush to report.
+/// </summary>
+class _write_buffer_callback : public _filestream_callback
+{
+public:
+    _write_buffer_callback(_file_info_impl *info, char *data, size_t count) : m_info(info), m_data(data), m_count(count) { }
 
+    virtual void on_completed(size_t written) override
+    {
+        if ( written != m_count )
+        {
+            on_error(std::make_exception_ptr(utility::details::create_system_error(EIO)));
+            return;
+        }
+        delete[] m_data;
+        delete this;
+    }
+    virtual void on_error(const std::exception_ptr &e) override
+    {
         {
-            pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
+            pplx::extensibility::scoped_recursive_lock_t lock(m_info->m_lock);
+            m_info->m_write_error = e;
+        }
+        delete[] m_data;
+        delete this;
+    }
+private:
+    _file_info_impl *m_info;
+    char *m_data;
+    size_t m_count;
+};
 
-            // Decrement the counter of outstanding write events.
-            if ( --fInfo->m_outstanding_writes == 0 )
-            {
-                // If this was the last one, signal all objects waiting for it to complete.
+/// <summary>
+/// Writes out the writes gathered in the write buffer, which is handed to the write. A sync waits for
+/// it like any other outstanding write, and appends queue behind it.
+/// </summary>
+/// <param name="fInfo">The file info record of the file</param>
+static void _flush_write_buffer(_file_info_impl *fInfo)
+{
+    if ( fInfo->m_write_fill == 0 ) return;
 
-                for (auto iter = fInfo->m_sync_waiters.begin(); iter != fInfo->m_sync_waiters.end(); iter++)
-                {
-                    (*iter)->on_completed(0);
-                }
-                fInfo->m_sync_waiters.clear();
-            }
-        }
-    });
+    auto count = fInfo->m_write_fill;
+    fInfo->m_write_fill = 0;
 
-    return 0;
+    auto data = fInfo->m_write_buffer;
+    fInfo->m_write_buffer = nullptr;
+    fInfo->m_write_capacity = 0;
+
+    _write_file_async(fInfo, new _write_buffer_callback(fInfo, data, count), data, count, fInfo->m_write_pos);
 }
 
 /// <summary>
@@ -319,6 +1148,33 @@ size_t _write_file_async(Concurrency::streams::details::_file_info_impl *fInfo,
 /// <returns>0 if the read request is still outstanding, -1 if the request failed, otherwise the size of the data read into the buffer</returns>
 size_t _read_file_async(Concurrency::streams::details::_file_info_impl *fInfo, Concurrency::streams::details::_filestream_callback *callback, void *ptr, size_t count, size_t offset)
 {
+#if defined(CPPREST_USE_IO_URING)
+    if (fInfo->m_use_io_uring)
+    {
+        // Reads into the registered read buffer don't need their pages mapped again.
+        auto target = static_cast<char *>(ptr);
+        bool fixed = fInfo->m_buffer_index != -1 && target >= fInfo->m_buffer &&
+            target + count <= fInfo->m_buffer + static_cast<size_t>(fInfo->m_bufsize);
+
+        if (_io_uring::instance()->submit(fixed ? IORING_OP_READ_FIXED : IORING_OP_READ, fInfo->m_handle, ptr, count, offset,
+                fixed ? fInfo->m_buffer_index : -1,
+                [=](int result)
+                {
+                    if (result < 0)
+                    {
+                        callback->on_error(std::make_exception_ptr(utility::details::create_system_error(-result)));
+                    }
+                    else
+                    {
+                        callback->on_completed(static_cast<size_t>(result));
+                    }
+                }))
+        {
+            return 0;
+        }
+    }
+#endif
+
     pplx::create_task([=]() -> void
     {
         auto bytes_read = pread(fInfo->m_handle, ptr, count, offset);
@@ -335,6 +1191,196 @@ size_t _read_file_async(Concurrency::streams::details::_file_info_impl *fInfo, C
     return 0;
 }
 
+static void _complete_read_ahead(_file_info_impl *fInfo, _read_ahead_block *block, size_t result, const std::exception_ptr &error);
+
+/// <summary>
+/// Passes the completion of a read-ahead block on to the file.
+/// </summary>
+class _read_ahead_callback : public _filestream_callback
+{
+public:
+    _read_ahead_callback(_file_info_impl *info, _read_ahead_block *block) : m_info(info), m_block(block) { }
+
+    virtual void on_completed(size_t result) override
+    {
+        _complete_read_ahead(m_info, m_block, result, nullptr);
+        delete this;
+    }
+    virtual void on_error(const std::exception_ptr &e) override
+    {
+        _complete_read_ahead(m_info, m_block, 0, e);
+        delete this;
+    }
+private:
+    _file_info_impl *m_info;
+    _read_ahead_block *m_block;
+};
+
+/// <summary>
+/// Starts reading blocks ahead of the read buffer, until as many as wanted are on their way. Must be called
+/// with the file lock held.
+/// </summary>
+/// <param name="fInfo">The file info record of the file</param>
+static void _issue_read_ahead(_file_info_impl *fInfo)
+{
+    if ( fInfo->m_read_ahead_size == 0 ) return;
+
+    while ( fInfo->m_read_ahead.size() < fInfo->m_read_ahead_depth )
+    {
+        // Nothing more to read once a block came back short.
+        if ( !fInfo->m_read_ahead.empty() )
+        {
+            auto last = fInfo->m_read_ahead.back();
+            if ( last->m_done && last->m_fill < last->m_size ) return;
+        }
+
+        char *data = fInfo->m_read_ahead_spare;
+        fInfo->m_read_ahead_spare = nullptr;
+        if ( data == nullptr )
+        {
+            data = new char[fInfo->m_read_ahead_size];
+        }
+
+        auto block = new _read_ahead_block(data, fInfo->m_read_ahead_size, fInfo->m_read_ahead_next);
+        fInfo->m_read_ahead_next += block->m_size;
+        fInfo->m_read_ahead.push_back(block);
+        ++fInfo->m_reads_in_flight;
+
+        _read_file_async(fInfo, new _read_ahead_callback(fInfo, block), block->m_data, block->m_size, block->m_offset);
+    }
+}
+
+/// <summary>
+/// Makes the first read-ahead block, which must be done, the read buffer, behind what is left unread in the
+/// current one. Must be called with the file lock held.
+/// </summary>
+/// <param name="fInfo">The file info record of the file</param>
+/// <param name="callback">The callback of the refill, which is only invoked if the block holds an error or
+/// no data at all</param>
+/// <param name="charSize">The size of the character type used for this stream</param>
+/// <returns>The number of bytes now in the read buffer, or 0 if the callback has been invoked</returns>
+static size_t _use_read_ahead(_file_info_impl *fInfo, _filestream_callback *callback, size_t charSize)
+{
+    auto block = fInfo->m_read_ahead.front();
+    fInfo->m_read_ahead.pop_front();
+
+    if ( block->m_error )
+    {
+        auto error = block->m_error;
+        delete[] block->m_data;
+        delete block;
+        _drop_read_ahead(fInfo);
+        callback->on_error(error);
+        return 0;
+    }
+
+    size_t bufrem = fInfo->m_buffer == nullptr ? 0 : (fInfo->m_buffill - (fInfo->m_rdpos - fInfo->m_bufoff)) * charSize;
+    size_t total = bufrem + block->m_fill;
+
+    if ( bufrem == 0 )
+    {
+        // The usual case: the read buffer has been used up, so the block takes its place and the old
+        // buffer is kept for the next block.
+        char *old = fInfo->m_buffer;
+        size_t oldsize = fInfo->m_bufsize;
+        fInfo->m_buffer = nullptr;
+        _set_buffer(fInfo, block->m_data, block->m_size);
+
+        if ( old != nullptr && oldsize == fInfo->m_read_ahead_size && fInfo->m_read_ahead_spare == nullptr )
+        {
+            fInfo->m_read_ahead_spare = old;
+        }
+        else
+        {
+            delete[] old;
+        }
+    }
+    else
+    {
+        // Otherwise, the block goes behind the unread part, moved to the front of the buffer.
+        char *unread = fInfo->m_buffer + (fInfo->m_rdpos - fInfo->m_bufoff) * charSize;
+        if ( total <= fInfo->m_bufsize )
+        {
+            memmove(fInfo->m_buffer, unread, bufrem);
+        }
+        else
+        {
+            char *newbuf = new char[total];
+            memcpy(newbuf, unread, bufrem);
+            _set_buffer(fInfo, newbuf, total);
+        }
+        memcpy(fInfo->m_buffer + bufrem, block->m_data, block->m_fill);
+
+        if ( fInfo->m_read_ahead_spare == nullptr && block->m_size == fInfo->m_read_ahead_size )
+        {
+            fInfo->m_read_ahead_spare = block->m_data;
+        }
+        else
+        {
+            delete[] block->m_data;
+        }
+    }
+
+    fInfo->m_bufoff = fInfo->m_rdpos;
+    fInfo->m_buffill = total / charSize;
+    delete block;
+
+    _issue_read_ahead(fInfo);
+
+    if ( total == 0 )
+    {
+        callback->on_completed(0);
+    }
+    return total;
+}
+
+/// <summary>
+/// Records the completion of a read-ahead block, handing it to a refill waiting for it, and closes the file
+/// if that waits for the last block.
+/// </summary>
+static void _complete_read_ahead(_file_info_impl *fInfo, _read_ahead_block *block, size_t result, const std::exception_ptr &error)
+{
+    std::function<void()> on_reads_done;
+
+    {
+        pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
+
+        if ( block->m_dropped )
+        {
+            delete[] block->m_data;
+            delete block;
+        }
+        else
+        {
+            block->m_done = true;
+            block->m_fill = result;
+            block->m_error = error;
+
+            if ( fInfo->m_read_ahead_waiter != nullptr && !fInfo->m_read_ahead.empty() && fInfo->m_read_ahead.front() == block )
+            {
+                auto callback = fInfo->m_read_ahead_waiter;
+                fInfo->m_read_ahead_waiter = nullptr;
+
+                size_t read = _use_read_ahead(fInfo, callback, fInfo->m_read_ahead_waiter_char_size);
+                if ( read > 0 )
+                {
+                    callback->on_completed(read);
+                }
+            }
+        }
+
+        if ( --fInfo->m_reads_in_flight == 0 )
+        {
+            on_reads_done.swap(fInfo->m_on_reads_done);
+        }
+    }
+
+    if ( on_reads_done )
+    {
+        on_reads_done();
+    }
+}
+
 template<typename Func>
 class _filestream_callback_fill_buffer : public _filestream_callback
 {
@@ -369,10 +1415,28 @@ static const size_t PageSize = 512;
 size_t _fill_buffer_fsb(_file_info_impl *fInfo, _filestream_callback *callback, size_t count, size_t charSize)
 {
     size_t byteCount = count * charSize;
+
+    if ( fInfo->m_mapped )
+    {
+        // The whole file is in the buffer already, whatever isn't there is past the end.
+        size_t bufrem = fInfo->m_rdpos < fInfo->m_buffill ? fInfo->m_buffill - fInfo->m_rdpos : 0;
+        if ( bufrem == 0 )
+        {
+            callback->on_completed(0);
+        }
+        return bufrem * charSize;
+    }
+
     if ( fInfo->m_buffer == nullptr )
     {
-        fInfo->m_bufsize = std::max(PageSize, byteCount);
-        fInfo->m_buffer = new char[static_cast<size_t>(fInfo->m_bufsize)];
+        if ( !fInfo->m_read_ahead.empty() )
+        {
+            _drop_read_ahead(fInfo);
+        }
+        fInfo->m_sequential_reads = 0;
+
+        size_t bufsize = std::max(PageSize, byteCount);
+        _set_buffer(fInfo, new char[bufsize], bufsize);
         fInfo->m_bufoff = fInfo->m_rdpos;
 
         auto cb = create_callback(fInfo, callback,
@@ -394,32 +1458,94 @@ size_t _fill_buffer_fsb(_file_info_impl *fInfo, _filestream_callback *callback,
 
     if ( bufrem < count )
     {
-        fInfo->m_bufsize = std::max(PageSize, byteCount);
+        size_t bufsize = std::max(PageSize, byteCount);
+
+        // The refill continues where the buffer ends. Blocks read ahead are used if they start right there
+        // and hold enough; otherwise, after a few refills like this one, reading ahead starts.
+        if ( !fInfo->m_read_ahead.empty() )
+        {
+            auto block = fInfo->m_read_ahead.front();
+            if ( block->m_offset == (fInfo->m_bufoff + fInfo->m_buffill) * charSize && bufrem * charSize + block->m_size >= byteCount )
+            {
+                if ( block->m_done )
+                {
+                    return _use_read_ahead(fInfo, callback, charSize);
+                }
+
+                // The application is catching up with the reads, so read further ahead.
+                fInfo->m_read_ahead_depth = 2;
+                fInfo->m_read_ahead_waiter = callback;
+                fInfo->m_read_ahead_waiter_char_size = charSize;
+                return 0;
+            }
+
+            _drop_read_ahead(fInfo);
+        }
+        else if ( ++fInfo->m_sequential_reads >= 2 && fInfo->m_read_ahead_size == 0 && fInfo->m_buffer_size > 0 )
+        {
+            if ( !fInfo->m_advised )
+            {
+                posix_fadvise(fInfo->m_handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+                fInfo->m_advised = true;
+            }
+            fInfo->m_read_ahead_size = std::max(std::max(ReadAheadSize, fInfo->m_buffer_size), bufsize);
+            fInfo->m_read_ahead_depth = 1;
+            if ( fInfo->m_read_ahead_spare != nullptr )
+            {
+                delete[] fInfo->m_read_ahead_spare;
+                fInfo->m_read_ahead_spare = nullptr;
+            }
+        }
 
-        // Then, we allocate a new buffer.
+        if ( bufsize <= fInfo->m_bufsize )
+        {
+            // The buffer is big enough, so we keep it (and its registration), moving the unread part
+            // to the front.
+
+            if ( bufrem > 0 )
+                memmove(fInfo->m_buffer, fInfo->m_buffer + bufpos * charSize, bufrem * charSize);
+
+            // Buffers come and go while reading ahead, registering them isn't worth it.
+            if ( fInfo->m_read_ahead_size == 0 )
+                _register_buffer(fInfo);
+        }
+        else
+        {
+            // Then, we allocate a new buffer.
 
-        char *newbuf = new char[static_cast<size_t>(fInfo->m_bufsize)];
+            char *newbuf = new char[bufsize];
 
-        // Then, we copy the unread part to the new buffer and delete the old buffer
+            // Then, we copy the unread part to the new buffer and delete the old buffer
 
-        if ( bufrem > 0 )
-            memcpy(newbuf, fInfo->m_buffer + bufpos * charSize, bufrem * charSize);
+            if ( bufrem > 0 )
+                memcpy(newbuf, fInfo->m_buffer + bufpos * charSize, bufrem * charSize);
 
-        delete[] fInfo->m_buffer;
-        fInfo->m_buffer = newbuf;
+            _set_buffer(fInfo, newbuf, bufsize);
+        }
 
         // Then, we read the remainder of the count into the new buffer
         fInfo->m_bufoff = fInfo->m_rdpos;
 
+        size_t offset = (fInfo->m_rdpos + bufrem) * charSize;
+        size_t size = fInfo->m_bufsize - bufrem * charSize;
+
         auto cb = create_callback(fInfo, callback,
             [=] (size_t result)
             {
                 pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
-                fInfo->m_buffill = result / charSize;
+                fInfo->m_buffill = bufrem + result / charSize;
+
+                // Start reading ahead from where this read ended, unless it hit the end of the file.
+                if ( fInfo->m_read_ahead_size > 0 && fInfo->m_read_ahead.empty() && result == size )
+                {
+                    fInfo->m_read_ahead_next = offset + result;
+                    _issue_read_ahead(fInfo);
+                }
+
                 callback->on_completed(result + bufrem * charSize);
             });
 
-        return _read_file_async(fInfo, cb, (uint8_t*)fInfo->m_buffer + bufrem * charSize, fInfo->m_bufsize - bufrem * charSize, (fInfo->m_rdpos+bufrem)*charSize);
+        return _read_file_async(fInfo, cb, (uint8_t*)fInfo->m_buffer + bufrem * charSize, size, offset);
     }
     else
         return byteCount;
@@ -495,6 +1621,15 @@ size_t _putn_fsb(Concurrency::streams::details::_file_info *info, Concurrency::s
 
     if ( fInfo->m_handle == -1 ) return static_cast<size_t>(-1);
 
+    // A gathered write that failed fails the next write.
+    if ( fInfo->m_write_error )
+    {
+        auto error = fInfo->m_write_error;
+        fInfo->m_write_error = nullptr;
+        callback->on_error(error);
+        return 0;
+    }
+
     size_t byteSize = count * charSize;
 
     // To preserve the async write order, we have to move the write head before read.
@@ -505,6 +1640,41 @@ size_t _putn_fsb(Concurrency::streams::details::_file_info *info, Concurrency::s
         lastPos *= charSize;
     }
 
+    // Writes smaller than the write buffer are gathered in it, as long as each continues where the one
+    // before ended. The buffer is written out first when the next write doesn't fit, doesn't follow on,
+    // or isn't gathered.
+    bool gather = byteSize > 0 && byteSize < fInfo->m_write_buffer_size && !(fInfo->m_mode & std::ios_base::in);
+
+    if ( fInfo->m_write_fill > 0 )
+    {
+        bool follows = fInfo->m_write_pos == static_cast<size_t>(-1) ?
+            lastPos == static_cast<size_t>(-1) :
+            lastPos == fInfo->m_write_pos + fInfo->m_write_fill;
+
+        if ( !gather || !follows || fInfo->m_write_fill + byteSize > fInfo->m_write_capacity )
+        {
+            _flush_write_buffer(fInfo);
+        }
+    }
+
+    if ( gather )
+    {
+        if ( fInfo->m_write_fill == 0 )
+        {
+            if ( fInfo->m_write_capacity != fInfo->m_write_buffer_size )
+            {
+                delete[] fInfo->m_write_buffer;
+                fInfo->m_write_buffer = new char[fInfo->m_write_buffer_size];
+                fInfo->m_write_capacity = fInfo->m_write_buffer_size;
+            }
+            fInfo->m_write_pos = lastPos;
+        }
+
+        memcpy(fInfo->m_write_buffer + fInfo->m_write_fill, ptr, byteSize);
+        fInfo->m_write_fill += byteSize;
+        return byteSize;
+    }
+
     return _write_file_async(fInfo, callback, ptr, byteSize, lastPos);
 }
 
@@ -525,8 +1695,16 @@ bool _sync_fsb(Concurrency::streams::details::_file_info *info, Concurrency::str
 
     if ( fInfo->m_handle == -1 ) return false;
 
+    _flush_write_buffer(fInfo);
+
     if ( fInfo->m_outstanding_writes > 0 )
         fInfo->m_sync_waiters.push_back(callback);
+    else if ( fInfo->m_write_error )
+    {
+        auto error = fInfo->m_write_error;
+        fInfo->m_write_error = nullptr;
+        callback->on_error(error);
+    }
     else
         callback->on_completed(0);
 
@@ -549,11 +1727,10 @@ size_t _seekrdtoend_fsb(Concurrency::streams::details::_file_info *info, int64_t
 
     if ( fInfo->m_handle == -1 ) return static_cast<size_t>(-1);
 
-    if ( fInfo->m_buffer != nullptr )
+    if ( fInfo->m_buffer != nullptr && !fInfo->m_mapped )
     {
-        delete[] fInfo->m_buffer;
-        fInfo->m_buffer = nullptr;
-        fInfo->m_bufoff = fInfo->m_buffill = fInfo->m_bufsize = 0;
+        _set_buffer(fInfo, nullptr, 0);
+        fInfo->m_bufoff = fInfo->m_buffill = 0;
     }
 
     auto newpos = lseek(fInfo->m_handle, static_cast<off_t>(offset * char_size), SEEK_END);
@@ -574,11 +1751,10 @@ utility::size64_t _get_size(_In_ concurrency::streams::details::_file_info *info
 
     if ( fInfo->m_handle == -1 ) return static_cast<size_t>(-1);
 
-    if ( fInfo->m_buffer != nullptr )
+    if ( fInfo->m_buffer != nullptr && !fInfo->m_mapped )
     {
-        delete[] fInfo->m_buffer;
-        fInfo->m_buffer = nullptr;
-        fInfo->m_bufoff = fInfo->m_buffill = fInfo->m_bufsize = 0;
+        _set_buffer(fInfo, nullptr, 0);
+        fInfo->m_bufoff = fInfo->m_buffill = 0;
     }
 
     auto oldpos = lseek(fInfo->m_handle, 0, SEEK_CUR);
@@ -591,7 +1767,16 @@ utility::size64_t _get_size(_In_ concurrency::streams::details::_file_info *info
 
     lseek(fInfo->m_handle, oldpos, SEEK_SET);
 
-    return utility::size64_t(newpos / char_size);
+    // Gathered writes that haven't been written yet count too.
+    utility::size64_t size = newpos;
+    if ( fInfo->m_write_fill > 0 )
+    {
+        size = fInfo->m_write_pos == static_cast<size_t>(-1) ?
+            size + fInfo->m_write_fill :
+            (std::max)(size, utility::size64_t(fInfo->m_write_pos + fInfo->m_write_fill));
+    }
+
+    return utility::size64_t(size / char_size);
 }
 
 /// <summary>
@@ -610,11 +1795,10 @@ size_t _seekrdpos_fsb(Concurrency::streams::details::_file_info *info, size_t po
 
     if ( fInfo->m_handle == -1 ) return static_cast<size_t>(-1);
 
-    if ( pos < fInfo->m_bufoff || pos > (fInfo->m_bufoff+fInfo->m_buffill) )
+    if ( !fInfo->m_mapped && (pos < fInfo->m_bufoff || pos > (fInfo->m_bufoff+fInfo->m_buffill)) )
     {
-        delete[] fInfo->m_buffer;
-        fInfo->m_buffer = nullptr;
-        fInfo->m_bufoff = fInfo->m_buffill = fInfo->m_bufsize = 0;
+        _set_buffer(fInfo, nullptr, 0);
+        fInfo->m_bufoff = fInfo->m_buffill = 0;
     }
 
     fInfo->m_rdpos = pos;
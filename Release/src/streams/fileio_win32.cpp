@@ -257,6 +257,80 @@ bool __cdecl _open_fsb_str(_In_ _filestream_callback *callback, const utility::c
     return true;
 }
 
+/// <summary>
+/// Open a file for reading, mapping all of it into memory, and create a streambuf instance to represent it.
+/// </summary>
+/// <param name="callback">A pointer to the callback interface to invoke when the file has been opened.</param>
+/// <param name="filename">The name of the file to open</param>
+/// <param name="char_size">The size of the character type used for this stream</param>
+/// <returns><c>true</c> if the opening operation could be initiated, <c>false</c> otherwise.</returns>
+/// <remarks>
+/// True does not signal that the file will eventually be successfully opened, just that the process was started.
+/// </remarks>
+bool __cdecl _open_fsb_mapped_str(_In_ _filestream_callback *callback, const utility::char_t *filename, size_t char_size)
+{
+    _ASSERTE(callback != nullptr);
+    _ASSERTE(filename != nullptr);
+
+    std::wstring name(filename);
+
+    pplx::create_task([=]()
+    {
+        HANDLE fh = ::CreateFileW(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+        LARGE_INTEGER size;
+        DWORD error = ERROR_SUCCESS;
+        void *data = nullptr;
+
+        if (fh == INVALID_HANDLE_VALUE || !GetFileSizeEx(fh, &size))
+        {
+            error = GetLastError();
+        }
+        else if (static_cast<uint64_t>(size.QuadPart) > (std::numeric_limits<size_t>::max)())
+        {
+            error = ERROR_FILE_TOO_LARGE;
+        }
+        else if (size.QuadPart > 0)
+        {
+            // An empty file can't be mapped, and doesn't need to be. The view keeps the mapping
+            // object alive, so its handle can be closed right away.
+            HANDLE mapping = CreateFileMappingW(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr)
+            {
+                data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            }
+            if (data == nullptr)
+            {
+                error = GetLastError();
+            }
+            if (mapping != nullptr)
+            {
+                CloseHandle(mapping);
+            }
+        }
+
+        if (error != ERROR_SUCCESS)
+        {
+            if (fh != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(fh);
+            }
+            callback->on_error(std::make_exception_ptr(utility::details::create_system_error(error)));
+            return;
+        }
+
+        auto info = new _file_info_impl(fh, nullptr, std::ios_base::in, 512);
+        info->m_buffer = static_cast<char *>(data);
+        info->m_bufsize = static_cast<size_t>(size.QuadPart) / char_size;
+        info->m_buffill = static_cast<size_t>(size.QuadPart) / char_size;
+        info->m_mapped = true;
+
+        callback->on_opened(info);
+    });
+
+    return true;
+}
+
 /// <summary>
 /// Close a file stream buffer.
 /// </summary>
@@ -289,13 +363,27 @@ bool __cdecl _close_fsb_nolock(_In_ _file_info **info, _In_ streams::details::_f
             if (fInfo->m_handle != INVALID_HANDLE_VALUE)
             {
 #if _WIN32_WINNT >= _WIN32_WINNT_VISTA
-                CloseThreadpoolIo(static_cast<PTP_IO>(fInfo->m_io_context));
+                // Mapped files don't do overlapped I/O.
+                if (fInfo->m_io_context != nullptr)
+                {
+                    CloseThreadpoolIo(static_cast<PTP_IO>(fInfo->m_io_context));
+                }
 #endif // _WIN32_WINNT >= _WIN32_WINNT_VISTA
 
                 result = CloseHandle(fInfo->m_handle) != FALSE;
             }
 
-            delete fInfo->m_buffer;
+            if (fInfo->m_mapped)
+            {
+                if (fInfo->m_buffer != nullptr)
+                {
+                    UnmapViewOfFile(fInfo->m_buffer);
+                }
+            }
+            else
+            {
+                delete fInfo->m_buffer;
+            }
         }
 
         delete fInfo;
@@ -582,6 +670,17 @@ _filestream_callback_fill_buffer<Func> *create_callback(_In_ _file_info *info, c
 
 size_t _fill_buffer_fsb(_In_ _file_info_impl *fInfo, _In_ _filestream_callback *callback, size_t count, size_t char_size)
 {
+    if ( fInfo->m_mapped )
+    {
+        // The whole file is in the buffer already, whatever isn't there is past the end.
+        size_t bufrem = fInfo->m_rdpos < fInfo->m_buffill ? fInfo->m_buffill - fInfo->m_rdpos : 0;
+        if ( bufrem == 0 )
+        {
+            callback->on_completed(0);
+        }
+        return bufrem*char_size;
+    }
+
     msl::safeint3::SafeInt<size_t> safeCount = count;
 
     if ( fInfo->m_buffer == nullptr || safeCount > fInfo->m_bufsize )
@@ -852,7 +951,7 @@ size_t __cdecl _seekrdpos_fsb(_In_ streams::details::_file_info *info, size_t po
 
     if (fInfo->m_handle == INVALID_HANDLE_VALUE) return static_cast<size_t>(-1);
 
-    if ( pos < fInfo->m_bufoff || pos > (fInfo->m_bufoff+fInfo->m_buffill) )
+    if ( !fInfo->m_mapped && (pos < fInfo->m_bufoff || pos > (fInfo->m_bufoff+fInfo->m_buffill)) )
     {
         delete fInfo->m_buffer;
         fInfo->m_buffer = nullptr;
@@ -880,7 +979,7 @@ size_t __cdecl _seekrdtoend_fsb(_In_ streams::details::_file_info *info, int64_t
 
     if (fInfo->m_handle == INVALID_HANDLE_VALUE) return static_cast<size_t>(-1);
 
-    if ( fInfo->m_buffer != nullptr )
+    if ( fInfo->m_buffer != nullptr && !fInfo->m_mapped )
     {
         // Clear the internal buffer.
         delete fInfo->m_buffer;
@@ -22,6 +22,7 @@
 ****/
 
 #include "stdafx.h"
+#include "cpprest/bufferchainstream.h"
 
 #if defined(__cplusplus_winrt)
 using namespace Windows::Storage;
@@ -243,6 +244,34 @@ TEST_FIXTURE(uri_address, producer_consumer_buffer_with_content_length)
     http_asserts::assert_response_equals(client.request(msg).get(), status_codes::OK);
 }
 
+TEST_FIXTURE(uri_address, buffer_chain_with_content_length)
+{
+    auto head = std::make_shared<std::string>("abcdefghij");
+    const std::string letters = "klmnopqrstuvwxyz";
+    auto tail = std::make_shared<std::vector<uint8_t>>(letters.begin(), letters.end());
+
+    streams::buffer_chain<uint8_t> chain;
+    chain.append(head);
+    chain.append(tail);
+
+    test_http_server::scoped_server scoped(m_uri);
+    test_http_server * p_server = scoped.server();
+    http_client client(m_uri);
+
+    http_request msg(methods::POST);
+    msg.set_body(chain.create_istream(), 26);
+
+    p_server->next_request().then([&](test_request *p_request)
+    {
+        http_asserts::assert_test_request_equals(p_request, methods::POST, U("/"));
+        std::string str_body(std::begin(p_request->m_body), std::end(p_request->m_body));
+        VERIFY_ARE_EQUAL("abcdefghijklmnopqrstuvwxyz", str_body);
+        p_request->reply(200);
+    });
+    http_asserts::assert_response_equals(client.request(msg).get(), status_codes::OK);
+    VERIFY_ARE_EQUAL(0u, chain.in_avail());
+}
+
 TEST_FIXTURE(uri_address, stream_partial_from_start)
 {
     utility::string_t fname = U("stream_partial_from_start.txt");
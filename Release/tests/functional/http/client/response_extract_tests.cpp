@@ -363,6 +363,15 @@ TEST_FIXTURE(uri_address, extract_json)
     rsp = send_request_response(scoped.server(), &client, U("application/json; charset  =  UTF-8"), to_utf8string((data.serialize())));
     VERIFY_ARE_EQUAL(data.serialize(), rsp.extract_json().get().serialize());
 
+    // A body too large to arrive in one piece.
+    json::value large = json::value::array();
+    for (int i = 0; i < 5000; ++i)
+    {
+        large[i] = json::value::string(U("element ") + utility::conversions::print_string(i));
+    }
+    rsp = send_request_response(scoped.server(), &client, U("application/json"), to_utf8string(large.serialize()));
+    VERIFY_ARE_EQUAL(large, rsp.extract_json().get());
+
     rsp = send_request_response(scoped.server(), &client, U(""), utility::string_t());
     auto str = rsp.to_string();
     // If there is no Content-Type in the response, make sure it won't throw when we ask for json
@@ -445,6 +454,33 @@ TEST_FIXTURE(uri_address, extract_json_incorrect)
     VERIFY_THROWS(rsp.extract_json().get(), http_exception);
 }
 
+TEST_FIXTURE(uri_address, extract_binary_json)
+{
+    test_http_server::scoped_server scoped(m_uri);
+    http_client client(m_uri);
+
+    const json::value data = json::value::parse(U("{\"id\":7,\"tags\":[\"a\",\"b\"],\"score\":-0.5,\"next\":null}"));
+    for (const auto format : { json::binary_format::cbor, json::binary_format::msgpack })
+    {
+        const auto bytes = json::encode_binary(data, format);
+        http_response rsp = send_request_response(scoped.server(), &client, json::binary_content_type(format), std::string(bytes.begin(), bytes.end()));
+        VERIFY_ARE_EQUAL(data, rsp.extract_json().get());
+    }
+
+    const auto bytes = json::encode_binary(data, json::binary_format::msgpack);
+    http_response rsp = send_request_response(scoped.server(), &client, U("application/x-msgpack"), std::string(bytes.begin(), bytes.end()));
+    VERIFY_ARE_EQUAL(data, rsp.extract_json().get());
+
+    // Not text, so it can't be read as JSON text.
+    rsp = send_request_response(scoped.server(), &client, U("application/x-msgpack"), std::string(bytes.begin(), bytes.end()));
+    VERIFY_THROWS(rsp.extract_json(true).get(), json::json_exception);
+
+    http_response local;
+    local.set_body(data, json::binary_format::cbor);
+    VERIFY_ARE_EQUAL(U("application/cbor"), local.headers().content_type());
+    VERIFY_ARE_EQUAL(data, local.extract_json().get());
+}
+
 TEST_FIXTURE(uri_address, set_stream_try_extract_json)
 {
     test_http_server::scoped_server scoped(m_uri);
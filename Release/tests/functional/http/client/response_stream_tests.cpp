@@ -442,6 +442,33 @@ TEST_FIXTURE(uri_address, get_resp_stream)
     listener.close().wait();
 }
 
+TEST_FIXTURE(uri_address, single_reader_response_body)
+{
+    http_client_config config;
+    VERIFY_IS_FALSE(config.single_reader_response_body());
+    config.set_single_reader_response_body(true);
+    http_client client(m_uri, config);
+
+    // Large enough to arrive in many pieces.
+    std::string responseData;
+    for (int i = 0; responseData.size() < 1024 * 1024; ++i)
+    {
+        responseData += std::to_string(i) + ",";
+    }
+
+    web::http::experimental::listener::http_listener listener(m_uri);
+    listener.open().wait();
+    listener.support([responseData](http_request request)
+    {
+        request.reply(status_codes::OK, responseData).wait();
+    });
+
+    http_response rsp = client.request(methods::GET).get();
+    VERIFY_IS_TRUE(responseData == rsp.extract_utf8string().get());
+
+    listener.close().wait();
+}
+
 TEST_FIXTURE(uri_address, xfer_chunked_multiple_chunks)
 {
     // With chunked transfer-encoding, send 2 chunks of different sizes in the response
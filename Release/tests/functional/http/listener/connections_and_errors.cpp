@@ -17,6 +17,12 @@
 
 #include <cpprest/http_client.h>
 
+#include <atomic>
+
+#if !defined(_WIN32)
+#include <boost/asio.hpp>
+#endif
+
 // For single_core test case.
 #if defined(_WIN32) && _MSC_VER < 1900
 #include <concrt.h>
@@ -360,6 +366,99 @@ TEST_FIXTURE(uri_address, close_stream_with_exception)
     close_stream_early_impl(m_uri, false);
 }
 
+TEST_FIXTURE(uri_address, max_concurrent_requests_rejects_excess)
+{
+    http_listener_config config;
+    config.set_max_concurrent_requests(1);
+    http_listener listener(m_uri, config);
+
+    pplx::extensibility::event_t request_event;
+    http_request pending;
+    listener.support([&](http_request r)
+    {
+        pending = r;
+        request_event.set();
+    });
+    listener.open().wait();
+
+    ::web::http::client::http_client first(m_uri);
+    ::web::http::client::http_client second(m_uri);
+    auto firstResponse = first.request(methods::GET);
+    request_event.wait();
+
+    // The first request is still outstanding so the second is shed without reaching the handler.
+    VERIFY_ARE_EQUAL(status_codes::ServiceUnavailable, second.request(methods::GET).get().status_code());
+
+    pending.reply(status_codes::OK).wait();
+    VERIFY_ARE_EQUAL(status_codes::OK, firstResponse.get().status_code());
+
+    // Once the response has been sent the slot is available again.
+    request_event.reset();
+    auto thirdResponse = second.request(methods::GET);
+    request_event.wait();
+    pending.reply(status_codes::OK).wait();
+    VERIFY_ARE_EQUAL(status_codes::OK, thirdResponse.get().status_code());
+
+    listener.close().wait();
+}
+
+TEST_FIXTURE(uri_address, max_connections_defers_accept)
+{
+    http_listener_config config;
+    config.set_max_connections(2);
+    config.set_max_concurrent_requests(1);
+    http_listener listener(m_uri, config);
+
+    pplx::extensibility::event_t request_event;
+    std::atomic<int> handled(0);
+    http_request pending;
+    listener.support([&](http_request r)
+    {
+        if (handled++ == 0)
+        {
+            // Hold the first request so its connection and request slot stay in use.
+            pending = r;
+            request_event.set();
+        }
+        else
+        {
+            r.reply(status_codes::OK);
+        }
+    });
+    listener.open().wait();
+
+    // Each http_client keeps its own connection alive until it is destroyed.
+    ::web::http::client::http_client first(m_uri);
+    std::unique_ptr<::web::http::client::http_client> second(new ::web::http::client::http_client(m_uri));
+    ::web::http::client::http_client third(m_uri);
+
+    auto firstResponse = first.request(methods::GET);
+    request_event.wait();
+
+    // The second connection is accepted but its request is past the queue depth, so it is shed.
+    VERIFY_ARE_EQUAL(status_codes::ServiceUnavailable, second->request(methods::GET).get().status_code());
+
+    // Both connection slots are now held, the third client stays in the socket backlog.
+    auto thirdResponse = third.request(methods::GET);
+    tests::common::utilities::os_utilities::sleep(500);
+    VERIFY_IS_FALSE(thirdResponse.is_done());
+    VERIFY_ARE_EQUAL(1, handled.load());
+
+    // Finishing a request alone does not free a connection slot.
+    pending.reply(status_codes::OK).wait();
+    VERIFY_ARE_EQUAL(status_codes::OK, firstResponse.get().status_code());
+    tests::common::utilities::os_utilities::sleep(500);
+    VERIFY_IS_FALSE(thirdResponse.is_done());
+    VERIFY_ARE_EQUAL(1, handled.load());
+
+    // Closing the second connection lets the third be accepted and served.
+    second.reset();
+    VERIFY_ARE_EQUAL(status_codes::OK, thirdResponse.get().status_code());
+    VERIFY_ARE_EQUAL(2, handled.load());
+
+    listener.close().wait();
+}
+
 // Helper function to verify http_exception and return the error code value.
 template <typename Func>
 int verify_http_exception(Func f)
@@ -376,6 +475,49 @@ int verify_http_exception(Func f)
     return errorCode;
 }
 
+#if !defined(_WIN32)
+TEST_FIXTURE(uri_address, listener_metrics)
+{
+    http_listener listener(m_uri);
+    listener.support([](http_request r)
+    {
+        r.reply(r.relative_uri().path() == U("/missing") ? status_codes::NotFound : status_codes::OK, U("body"));
+    });
+    VERIFY_ARE_EQUAL(0u, listener.metrics().connections_accepted());
+    listener.open().wait();
+
+    // Counters are cumulative for the host and port, so only compare against what was there before.
+    const auto before = listener.metrics();
+    const auto path = m_uri.path();
+    const auto before_ok = before.paths().count(path) ? before.paths().at(path).latency(2).count() : 0;
+    const auto before_not_found = before.paths().count(path) ? before.paths().at(path).latency(4).count() : 0;
+    {
+        test_http_client::scoped_client client(m_uri);
+        for (int i = 0; i < 3; ++i)
+        {
+            VERIFY_ARE_EQUAL(0, client.client()->request(methods::GET, U("")));
+            http_asserts::assert_test_response_equals(client.client()->wait_for_response(), status_codes::OK);
+        }
+        VERIFY_ARE_EQUAL(0, client.client()->request(methods::GET, U("missing")));
+        http_asserts::assert_test_response_equals(client.client()->wait_for_response(), status_codes::NotFound);
+
+        const auto during = listener.metrics();
+        VERIFY_IS_TRUE(during.connections_accepted() > before.connections_accepted());
+        VERIFY_IS_TRUE(during.active_connections() >= 1);
+        VERIFY_IS_TRUE(during.bytes_received() > before.bytes_received());
+        VERIFY_IS_TRUE(during.bytes_sent() > before.bytes_sent());
+    }
+
+    const auto after = listener.metrics();
+    VERIFY_ARE_EQUAL(before_ok + 3, after.paths().at(path).latency(2).count());
+    VERIFY_ARE_EQUAL(before_not_found + 1, after.paths().at(path).latency(4).count());
+    VERIFY_IS_TRUE(after.paths().at(path).latency(2).percentile(99) >= after.paths().at(path).latency(2).mean());
+    VERIFY_ARE_EQUAL(0u, after.active_requests());
+
+    listener.close().wait();
+}
+#endif
+
 TEST_FIXTURE(uri_address, request_content_ready_timeout, "Ignore:Linux", "Unsuitable until 813276", "Ignore:Apple", "Unsuitable until 813276")
 {
     http_listener_config config;
@@ -405,6 +547,71 @@ TEST_FIXTURE(uri_address, request_content_ready_timeout, "Ignore:Linux", "Unsuit
     listener.close().wait();
 }
 
+TEST_FIXTURE(uri_address, request_body_timeout)
+{
+    http_listener_config config;
+    config.set_body_timeout(utility::seconds(1));
+    http_listener listener(m_uri, config);
+    pplx::extensibility::event_t timedOutEvent;
+    listener.support([&](http_request req)
+    {
+        // The client never sends the body, so the connection is dropped once the body timeout passes.
+        VERIFY_THROWS(req.content_ready().wait(), http_exception);
+        timedOutEvent.set();
+    });
+    listener.open().wait();
+
+    ::web::http::client::http_client client(m_uri);
+    concurrency::streams::producer_consumer_buffer<unsigned char> body;
+    auto responseTask = client.request(methods::PUT, U(""), body.create_istream());
+    timedOutEvent.wait();
+    body.close().wait();
+    VERIFY_THROWS(responseTask.get(), http_exception);
+
+    listener.close().wait();
+}
+
+#if !defined(_WIN32)
+TEST_FIXTURE(uri_address, keep_alive_request_header_timeout)
+{
+    http_listener_config config;
+    config.set_keep_alive_timeout(utility::seconds(60));
+    config.set_header_timeout(utility::seconds(1));
+    http_listener listener(m_uri, config);
+    listener.support([](http_request r)
+    {
+        r.reply(status_codes::OK);
+    });
+    listener.open().wait();
+
+    boost::asio::io_service service;
+    boost::asio::ip::tcp::resolver resolver(service);
+    boost::asio::ip::tcp::socket socket(service);
+    boost::asio::connect(socket, resolver.resolve(boost::asio::ip::tcp::resolver::query(
+        utility::conversions::to_utf8string(m_uri.host()), std::to_string(m_uri.port()))));
+
+    const std::string request_line = "GET " + utility::conversions::to_utf8string(m_uri.path()) + " HTTP/1.1\r\n";
+    boost::asio::write(socket, boost::asio::buffer(request_line + "Host: localhost\r\n\r\n"));
+    boost::asio::streambuf response;
+    boost::asio::read_until(socket, response, "\r\n\r\n");
+    std::istream response_stream(&response);
+    std::string status_line;
+    std::getline(response_stream, status_line);
+    VERIFY_ARE_EQUAL("HTTP/1.1 200 OK\r", status_line);
+
+    // The next request starts on the kept-alive connection but its headers never finish, so it is
+    // dropped after the header timeout rather than the much longer keep-alive timeout.
+    const auto start = std::chrono::steady_clock::now();
+    boost::asio::write(socket, boost::asio::buffer(request_line + "Host"));
+    boost::system::error_code ec;
+    boost::asio::read(socket, response, boost::asio::transfer_all(), ec);
+    VERIFY_IS_TRUE(ec == boost::asio::error::eof || ec == boost::asio::error::connection_reset);
+    VERIFY_IS_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+
+    listener.close().wait();
+}
+#endif
+
 }
 
 }}}}
@@ -377,6 +377,13 @@ TEST_FIXTURE(uri_address, get_listener_config)
     {
         http_listener listener(m_uri);
         VERIFY_ARE_EQUAL(utility::seconds(120), listener.configuration().timeout());
+        VERIFY_ARE_EQUAL(0, listener.configuration().max_connections());
+        VERIFY_ARE_EQUAL(0, listener.configuration().max_concurrent_requests());
+        VERIFY_ARE_EQUAL(utility::seconds(120), listener.configuration().keep_alive_timeout());
+        VERIFY_ARE_EQUAL(utility::seconds(120), listener.configuration().header_timeout());
+        VERIFY_ARE_EQUAL(utility::seconds(120), listener.configuration().body_timeout());
+        VERIFY_IS_TRUE(listener.configuration().is_default_chunksize());
+        VERIFY_ARE_EQUAL(64 * 1024, listener.configuration().chunksize());
         listener.open().wait();
         listener.close().wait();
     }
@@ -386,10 +393,20 @@ TEST_FIXTURE(uri_address, get_listener_config)
         http_listener_config config;
         utility::seconds t(1);
         config.set_timeout(t);
+        config.set_max_connections(16);
+        config.set_max_concurrent_requests(4);
+        config.set_header_timeout(utility::seconds(5));
+        config.set_chunksize(1024);
         http_listener listener(m_uri, config);
         listener.open().wait();
         listener.close().wait();
         VERIFY_ARE_EQUAL(t, listener.configuration().timeout());
+        VERIFY_ARE_EQUAL(16, listener.configuration().max_connections());
+        VERIFY_ARE_EQUAL(4, listener.configuration().max_concurrent_requests());
+        VERIFY_ARE_EQUAL(t, listener.configuration().keep_alive_timeout());
+        VERIFY_ARE_EQUAL(utility::seconds(5), listener.configuration().header_timeout());
+        VERIFY_ARE_EQUAL(1024, listener.configuration().chunksize());
+        VERIFY_IS_FALSE(listener.configuration().is_default_chunksize());
     }
 }
 
@@ -430,6 +447,40 @@ TEST_FIXTURE(uri_address, listener_config_creation)
     }
 }
 
+TEST(latency_histogram_buckets)
+{
+    // Small latencies are exact, larger ones land in one of eight buckets per power of two.
+    VERIFY_ARE_EQUAL(0u, latency_histogram::bucket_index(std::chrono::microseconds(0)));
+    VERIFY_ARE_EQUAL(15u, latency_histogram::bucket_index(std::chrono::microseconds(15)));
+    VERIFY_ARE_EQUAL(16u, latency_histogram::bucket_index(std::chrono::microseconds(16)));
+    VERIFY_ARE_EQUAL(23u, latency_histogram::bucket_index(std::chrono::microseconds(31)));
+    VERIFY_ARE_EQUAL(24u, latency_histogram::bucket_index(std::chrono::microseconds(32)));
+    VERIFY_ARE_EQUAL(latency_histogram::bucket_count - 1, latency_histogram::bucket_index(std::chrono::microseconds::max()));
+    for (size_t i = 0; i + 1 < latency_histogram::bucket_count; ++i)
+    {
+        VERIFY_ARE_EQUAL(i, latency_histogram::bucket_index(latency_histogram::bucket_upper_bound(i)));
+        VERIFY_ARE_EQUAL(i + 1, latency_histogram::bucket_index(latency_histogram::bucket_upper_bound(i) + std::chrono::microseconds(1)));
+    }
+
+    latency_histogram histogram;
+    VERIFY_ARE_EQUAL(0, histogram.percentile(50).count());
+    for (int i = 1; i <= 1000; ++i)
+    {
+        histogram.record(std::chrono::milliseconds(i));
+    }
+    VERIFY_ARE_EQUAL(1000u, histogram.count());
+    VERIFY_ARE_EQUAL(500500, histogram.mean().count());
+    VERIFY_ARE_EQUAL(1000000, histogram.max().count());
+    VERIFY_IS_TRUE(histogram.percentile(50).count() >= 500000 && histogram.percentile(50).count() <= 500000 * 9 / 8);
+    VERIFY_IS_TRUE(histogram.percentile(99).count() >= 990000 && histogram.percentile(99).count() <= 1000000);
+
+    latency_histogram other;
+    other.record(std::chrono::seconds(5));
+    histogram.merge(other);
+    VERIFY_ARE_EQUAL(1001u, histogram.count());
+    VERIFY_ARE_EQUAL(5000000, histogram.percentile(100).count());
+}
+
 #if !defined(_WIN32) && !defined(__cplusplus_winrt)
 
 TEST_FIXTURE(uri_address, create_https_listener_get)
@@ -62,6 +62,41 @@ TEST_FIXTURE(uri_address, large_body)
     listener.close().wait();
 }
 
+TEST_FIXTURE(uri_address, large_body_chunksizes)
+{
+    std::string send_data;
+    for(int i = 0; i < 1024 * 1024; ++i)
+    {
+        send_data.push_back(static_cast<char>('a' + i % 26));
+    }
+
+    // The default grows from small chunks, the fixed size does not divide the body evenly.
+    for (size_t chunksize : {size_t(0), size_t(1000)})
+    {
+        http_listener_config config;
+        config.set_chunksize(chunksize);
+        http_listener listener(m_uri, config);
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client * p_client = client.client();
+
+        listener.support([&](http_request request)
+        {
+            streams::stringstreambuf strbuf;
+            VERIFY_ARE_EQUAL(request.body().read_to_end(strbuf).get(), send_data.size());
+            VERIFY_IS_TRUE(strbuf.collection() == send_data);
+            request.reply(status_codes::OK);
+        });
+        VERIFY_ARE_EQUAL(0, p_client->request(methods::PUT, U(""), U("text/plain"), send_data));
+        p_client->next_response().then([](test_response *p_response)
+        {
+            http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+        }).wait();
+
+        listener.close().wait();
+    }
+}
+
 TEST_FIXTURE(uri_address, test_chunked_transfer)
 {
     const size_t num_bytes = 1024 * 1024 * 10;
@@ -15,6 +15,7 @@
 
 #include "stdafx.h"
 #include "cpprest/rawptrstream.h"
+#include "cpprest/bufferchainstream.h"
 
 using namespace web;
 using namespace utility;
@@ -152,6 +153,94 @@ TEST_FIXTURE(uri_address, set_body_stream_partial)
     stream.close().get();
 }
 
+#if !defined(_WIN32)
+TEST_FIXTURE(uri_address, set_body_from_file_large)
+{
+    utility::string_t fname = U("set_response_from_file_large.txt");
+    fill_file(fname, 20000);
+
+    http_listener listener(m_uri);
+    listener.open().wait();
+    test_http_client::scoped_client client(m_uri);
+    test_http_client * p_client = client.client();
+
+    listener.support([&](http_request request)
+    {
+        http_response response(status_codes::OK);
+        response.set_body_from_file(fname, 0, std::numeric_limits<utility::size64_t>::max(), U("text/plain"));
+        request.reply(response).wait();
+    });
+    VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U("")));
+    p_client->next_response().then([&](test_response *p_response)
+    {
+        http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+        VERIFY_ARE_EQUAL(26u * 20000, p_response->m_data.size());
+        VERIFY_ARE_EQUAL('a', p_response->m_data.front());
+        VERIFY_ARE_EQUAL('z', p_response->m_data.back());
+    }).wait();
+
+    listener.close().wait();
+}
+
+TEST_FIXTURE(uri_address, set_body_from_file_range)
+{
+    utility::string_t fname = U("set_response_from_file_range.txt");
+    fill_file(fname, 10);
+
+    http_listener listener(m_uri);
+    listener.open().wait();
+    test_http_client::scoped_client client(m_uri);
+    test_http_client * p_client = client.client();
+
+    listener.support([&](http_request request)
+    {
+        http_response response(status_codes::PartialContent);
+        response.set_body_from_file(fname, 27, 3, U("text/plain; charset=utf-8"));
+        response.headers().add(header_names::content_range, U("bytes 27-29/260"));
+        request.reply(response).wait();
+    });
+    VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U("")));
+    p_client->next_response().then([&](test_response *p_response)
+    {
+        http_asserts::assert_test_response_equals(p_response, status_codes::PartialContent, U("text/plain; charset=utf-8"), U("bcd"));
+    }).wait();
+
+    // A range starting past the end of the file is rejected.
+    http_response response;
+    VERIFY_THROWS(response.set_body_from_file(fname, 261), std::invalid_argument);
+    VERIFY_THROWS(response.set_body_from_file(U("set_response_from_file_missing.txt")), http_exception);
+
+    listener.close().wait();
+}
+
+TEST_FIXTURE(uri_address, set_body_after_set_body_from_file)
+{
+    utility::string_t fname = U("set_body_after_set_body_from_file.txt");
+    fill_file(fname, 10);
+
+    http_listener listener(m_uri);
+    listener.open().wait();
+    test_http_client::scoped_client client(m_uri);
+    test_http_client * p_client = client.client();
+
+    listener.support([&](http_request request)
+    {
+        http_response response(status_codes::OK);
+        response.set_body_from_file(fname);
+        response.set_body("replaced");
+        request.reply(response).wait();
+    });
+    VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U("")));
+    p_client->next_response().then([&](test_response *p_response)
+    {
+        http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+        VERIFY_ARE_EQUAL("replaced", std::string(p_response->m_data.begin(), p_response->m_data.end()));
+    }).wait();
+
+    listener.close().wait();
+}
+#endif
+
 TEST_FIXTURE(uri_address, set_body_filestream_chunked)
 {
     utility::string_t fname = U("set_response_stream_chunked.txt");
@@ -189,6 +278,47 @@ TEST_FIXTURE(uri_address, set_body_filestream_chunked)
     stream.close().get();
 }
 
+TEST_FIXTURE(uri_address, set_body_stream_chunksizes)
+{
+    std::vector<uint8_t> data;
+    for(int i = 0; i < 1024 * 1024; ++i)
+    {
+        data.push_back(static_cast<uint8_t>('a' + i % 26));
+    }
+
+    // Send the same body with and without a Content-Length, using the adaptive and a fixed chunk size.
+    for (size_t chunksize : {size_t(0), size_t(3000)})
+    {
+        for (bool chunked : {false, true})
+        {
+            http_listener_config config;
+            config.set_chunksize(chunksize);
+            http_listener listener(m_uri, config);
+            listener.open().wait();
+
+            listener.support([&](http_request request)
+            {
+                http_response response(status_codes::OK);
+                if (chunked)
+                {
+                    response.set_body(streams::bytestream::open_istream(data));
+                }
+                else
+                {
+                    response.set_body(streams::bytestream::open_istream(data), data.size());
+                }
+                request.reply(response).wait();
+            });
+
+            ::http::client::http_client client(m_uri);
+            auto body = client.request(methods::GET).get().extract_vector().get();
+            VERIFY_IS_TRUE(body == data);
+
+            listener.close().wait();
+        }
+    }
+}
+
 TEST_FIXTURE(uri_address, set_body_memorystream_chunked)
 {
     http_listener listener(m_uri);
@@ -235,6 +365,43 @@ TEST_FIXTURE(uri_address, set_body_memorystream_chunked)
     }).wait();
 }
 
+TEST_FIXTURE(uri_address, set_body_buffer_chain)
+{
+    http_listener listener(m_uri);
+    listener.open().wait();
+    test_http_client::scoped_client client(m_uri);
+    test_http_client * p_client = client.client();
+
+    // The blocks are sent in place, the large one takes more than one write.
+    auto prefix = std::make_shared<std::string>("{\"data\":\"");
+    auto data = std::make_shared<std::vector<uint8_t>>(3 * 1024 * 1024, static_cast<uint8_t>('d'));
+    auto suffix = std::make_shared<std::string>("\"}");
+    std::string expected = *prefix + std::string(data->begin(), data->end()) + *suffix;
+
+    streams::buffer_chain<uint8_t> chain;
+    chain.append(prefix);
+    chain.append(data);
+    chain.append(suffix);
+
+    http_response response(status_codes::OK);
+    response.set_body(chain.create_istream(), expected.size(), U("application/json"));
+
+    listener.support([&](http_request request)
+    {
+        http_asserts::assert_request_equals(request, methods::POST, U("/"));
+        request.reply(response).wait();
+    });
+    VERIFY_ARE_EQUAL(0u, p_client->request(methods::POST, U("")));
+    p_client->next_response().then([&](test_response *p_response)
+    {
+        http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+        VERIFY_IS_TRUE(std::string(p_response->m_data.begin(), p_response->m_data.end()) == expected);
+    }).wait();
+    VERIFY_ARE_EQUAL(0u, chain.in_avail());
+
+    listener.close().wait();
+}
+
 TEST_FIXTURE(uri_address, reply_transfer_encoding_4k)
 {
     web::http::experimental::listener::http_listener listener(m_uri);
@@ -25,6 +25,10 @@
 
 #include "stdafx.h"
 
+#include <algorithm>
+#include <set>
+#include <thread>
+
 using namespace web; using namespace utility;
 
 namespace tests { namespace functional { namespace json_tests {
@@ -498,6 +502,276 @@ TEST(object_test)
     VERIFY_ARE_EQUAL(cobject.size(), count);
 }
 
+static utility::string_t numbered_key(size_t i)
+{
+    return U("id-") + utility::conversions::print_string(i);
+}
+
+TEST(large_object_test)
+{
+    const size_t count = 500;
+    std::vector<size_t> ids(count);
+    for (size_t i = 0; i < count; ++i) ids[i] = i;
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(3));
+
+    for (bool keep_order : { false, true })
+    {
+        json::value obj = json::value::object(keep_order);
+        json::object& object = obj.as_object();
+        const json::object& cobject = object;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            obj[numbered_key(ids[i])] = json::value::number(static_cast<uint64_t>(ids[i]));
+            // Lookups between insertions of fields see all of them.
+            VERIFY_IS_TRUE(obj.has_field(numbered_key(ids[i])));
+            VERIFY_ARE_EQUAL(ids[i / 2], object.at(numbered_key(ids[i / 2])).as_number().to_uint64());
+        }
+        VERIFY_ARE_EQUAL(count, object.size());
+        VERIFY_IS_FALSE(obj.has_field(U("missing")));
+        VERIFY_ARE_EQUAL(cobject.end(), cobject.find(U("missing")));
+        VERIFY_THROWS(cobject.at(U("missing")), json::json_exception);
+
+        // Sorted objects come out in order, the others in insertion order.
+        size_t position = 0;
+        utility::string_t previous;
+        for (json::object::const_iterator iter = object.begin(); iter != cobject.end(); ++iter, ++position)
+        {
+            if (keep_order)
+            {
+                VERIFY_ARE_EQUAL(numbered_key(ids[position]), iter->first);
+            }
+            else
+            {
+                VERIFY_IS_TRUE(previous < iter->first);
+                previous = iter->first;
+            }
+            VERIFY_ARE_EQUAL(iter->first, numbered_key(static_cast<size_t>(iter->second.as_number().to_uint64())));
+            VERIFY_ARE_EQUAL(iter, cobject.find(iter->first));
+        }
+        VERIFY_ARE_EQUAL(count, position);
+
+        // Fields added after iterating are sorted in as well, and the index follows erased fields.
+        for (size_t i = count; i < count + 10; ++i)
+        {
+            object[numbered_key(i)] = json::value::number(static_cast<uint64_t>(i));
+        }
+        object.erase(numbered_key(7));
+        object.erase(std::find_if(object.begin(), object.end(),
+            [](const std::pair<utility::string_t, json::value> &field) { return field.first == numbered_key(8); }));
+        VERIFY_ARE_EQUAL(count + 8, object.size());
+        VERIFY_IS_FALSE(obj.has_field(numbered_key(7)));
+        VERIFY_IS_FALSE(obj.has_field(numbered_key(8)));
+        for (size_t i = 0; i < count + 10; ++i)
+        {
+            if (i != 7 && i != 8)
+            {
+                VERIFY_ARE_EQUAL(i, cobject.at(numbered_key(i)).as_number().to_uint64());
+            }
+        }
+
+        // Copies and parsed documents are indexed too.
+        json::value copy = obj;
+        VERIFY_ARE_EQUAL(obj, copy);
+        VERIFY_ARE_EQUAL(42u, copy.at(numbered_key(42)).as_number().to_uint64());
+        auto parsed = json::value::parse(obj.serialize());
+        VERIFY_ARE_EQUAL(obj.size(), parsed.size());
+        VERIFY_ARE_EQUAL(505u, parsed.at(numbered_key(505)).as_number().to_uint64());
+        VERIFY_IS_TRUE(parsed.has_field(numbered_key(0)));
+    }
+}
+
+TEST(large_object_const_access_test)
+{
+    const size_t count = 2000;
+    json::value obj = json::value::object();
+    for (size_t i = 0; i < count; ++i)
+    {
+        obj[numbered_key(i * 7919 % count)] = json::value::number(static_cast<uint64_t>(i * 7919 % count));
+    }
+
+    // Reading the object through const members never moves its fields. The fields appended once it was
+    // indexed aren't in key order yet, but it is serialized in that order.
+    const json::value &cobj = obj;
+    const json::value *first = &cobj.at(numbered_key(0));
+    const json::value *last = &cobj.at(numbered_key(count - 1));
+    std::set<utility::string_t> keys;
+    for (const auto &field : cobj.as_object())
+    {
+        keys.insert(field.first);
+    }
+    VERIFY_ARE_EQUAL(count, keys.size());
+    const auto ordered = cobj.as_object().ordered_fields();
+    VERIFY_ARE_EQUAL(count, ordered.size());
+    VERIFY_IS_TRUE(std::equal(keys.begin(), keys.end(), ordered.begin(),
+        [](const utility::string_t &key, json::object::const_iterator field) { return key == field->first; }));
+    VERIFY_IS_TRUE(first == &cobj.at(numbered_key(0)));
+    VERIFY_IS_TRUE(last == &cobj.at(numbered_key(count - 1)));
+    VERIFY_ARE_EQUAL(0u, first->as_number().to_uint64());
+    VERIFY_ARE_EQUAL(count - 1, last->as_number().to_uint64());
+
+    const auto parsed = json::value::parse(obj.serialize());
+    VERIFY_ARE_EQUAL(obj, parsed);
+    VERIFY_IS_TRUE(parsed.as_object().ordered_fields().empty());
+    VERIFY_ARE_EQUAL(parsed.serialize(), obj.serialize());
+
+    // Iterating the object itself puts it in key order.
+    VERIFY_IS_TRUE(std::equal(keys.begin(), keys.end(), obj.as_object().begin(),
+        [](const utility::string_t &key, const std::pair<utility::string_t, json::value> &field) { return key == field.first; }));
+    VERIFY_IS_TRUE(cobj.as_object().ordered_fields().empty());
+    VERIFY_ARE_EQUAL(count - 1, cobj.at(numbered_key(count - 1)).as_number().to_uint64());
+}
+
+TEST(large_object_erase_test)
+{
+    const size_t count = 3000;
+    for (bool keep_order : { false, true })
+    {
+        json::value obj = json::value::object(keep_order);
+        for (size_t i = 0; i < count; ++i)
+        {
+            obj[numbered_key(i)] = json::value::number(static_cast<uint64_t>(i));
+        }
+
+        // Erasing every other field, by key and through iterators, keeps the rest reachable.
+        json::object &object = obj.as_object();
+        for (size_t i = 0; i < count; i += 4)
+        {
+            object.erase(numbered_key(i));
+        }
+        for (auto iter = object.begin(); iter != object.end(); )
+        {
+            iter = iter->second.as_number().to_uint64() % 4 == 2 ? object.erase(iter) : iter + 1;
+        }
+        VERIFY_ARE_EQUAL(count / 2, object.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            VERIFY_ARE_EQUAL(i % 2 == 1, obj.has_field(numbered_key(i)));
+            if (i % 2 == 1)
+            {
+                VERIFY_ARE_EQUAL(i, obj.at(numbered_key(i)).as_number().to_uint64());
+            }
+        }
+
+        // Kept order survives erasing; a copy has its own index and compares equal.
+        if (keep_order)
+        {
+            VERIFY_ARE_EQUAL(numbered_key(1), object.begin()->first);
+            VERIFY_ARE_EQUAL(numbered_key(count - 1), object.rbegin()->first);
+        }
+        json::value copy = obj;
+        copy[U("extra")] = json::value::null();
+        copy.erase(numbered_key(1));
+        VERIFY_IS_TRUE(obj.has_field(numbered_key(1)));
+        VERIFY_IS_FALSE(obj.has_field(U("extra")));
+        copy.erase(U("extra"));
+        copy[numbered_key(1)] = json::value::number(1);
+        if (!keep_order)
+        {
+            VERIFY_ARE_EQUAL(obj, copy);
+        }
+    }
+}
+
+TEST(shared_value_test)
+{
+    const auto text = U("{\"name\":\"catalog\",\"items\":[{\"id\":1,\"tags\":[\"a\",\"b\"]},{\"id\":2,\"tags\":[]}],\"meta\":{\"version\":3,\"owner\":null}}");
+    const json::value expected = json::value::parse(text);
+    const json::value shared = json::value::shared(json::value::parse(text));
+    VERIFY_ARE_EQUAL(expected, shared);
+    VERIFY_ARE_EQUAL(expected.serialize(), shared.serialize());
+    VERIFY_IS_TRUE(shared.is_object());
+    VERIFY_ARE_EQUAL(3u, shared.size());
+    VERIFY_ARE_EQUAL(2, shared.at(U("items")).at(1).at(U("id")).as_integer());
+
+    // Changes to a copy, or to copies of the values inside it, stay with that copy.
+    json::value copy = shared;
+    copy[U("items")][0][U("tags")][1] = json::value::string(U("changed"));
+    copy[U("meta")].erase(U("owner"));
+    copy[U("added")] = json::value::boolean(true);
+    json::value items = shared.at(U("items"));
+    items.as_array().erase(0);
+    json::value nested = copy.at(U("meta"));
+    nested[U("version")] = json::value::number(4);
+
+    VERIFY_ARE_EQUAL(expected, shared);
+    VERIFY_ARE_EQUAL(U("changed"), copy.at(U("items")).at(0).at(U("tags")).at(1).as_string());
+    VERIFY_ARE_EQUAL(expected.at(U("items")).at(1), copy.at(U("items")).at(1));
+    VERIFY_IS_FALSE(copy.at(U("meta")).has_field(U("owner")));
+    VERIFY_ARE_EQUAL(3, copy.at(U("meta")).at(U("version")).as_integer());
+    VERIFY_ARE_EQUAL(4, nested.at(U("version")).as_integer());
+    VERIFY_ARE_EQUAL(1u, items.size());
+
+    json::value recopied = copy;
+    recopied[U("added")] = json::value::boolean(false);
+    VERIFY_IS_TRUE(copy.at(U("added")).as_bool());
+
+    // Sharing a document again, or sharing a scalar, changes nothing visible.
+    VERIFY_ARE_EQUAL(expected, json::value::shared(shared));
+    VERIFY_ARE_EQUAL(json::value::number(7), json::value::shared(json::value::number(7)));
+    json::value assigned;
+    assigned = shared;
+    assigned = json::value::shared(std::move(assigned));
+    VERIFY_ARE_EQUAL(expected, assigned);
+
+    json::parse_options lazy;
+    lazy.set_lazy(true);
+    const json::value lazyShared = json::value::shared(json::value::parse(text, lazy));
+    VERIFY_ARE_EQUAL(expected, json::value(lazyShared));
+
+    // Copies are read and made on several threads at once.
+    std::vector<std::thread> readers;
+    std::vector<int> matches(8, 0);
+    for (size_t t = 0; t < matches.size(); ++t)
+    {
+        readers.push_back(std::thread([&, t]()
+        {
+            for (int i = 0; i < 200; ++i)
+            {
+                json::value mine = shared;
+                mine[U("items")][0][U("id")] = json::value::number(static_cast<int>(t));
+                if (mine.at(U("items")).at(0).at(U("id")).as_integer() == static_cast<int>(t) && shared == expected)
+                {
+                    ++matches[t];
+                }
+            }
+        }));
+    }
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    for (const int count : matches)
+    {
+        VERIFY_ARE_EQUAL(200, count);
+    }
+}
+
+TEST(shared_value_large_document)
+{
+    json::value document = json::value::array();
+    for (int i = 0; i < 2000; ++i)
+    {
+        auto &record = document[i];
+        record[U("id")] = json::value::number(i);
+        record[U("name")] = json::value::string(U("user ") + utility::conversions::print_string(i));
+        record[U("tags")][0] = json::value::string(U("alpha"));
+        record[U("address")][U("city")] = json::value::string(U("Springfield"));
+    }
+    const json::value shared = json::value::shared(document);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        // A handler changing one field of its own copy.
+        json::value copy = shared;
+        copy[i][U("name")] = json::value::string(U("changed"));
+        VERIFY_ARE_EQUAL(2000u, copy.size());
+        VERIFY_ARE_EQUAL(U("changed"), copy.at(i).at(U("name")).as_string());
+        VERIFY_ARE_EQUAL(document.at(i + 1), copy.at(i + 1));
+    }
+    VERIFY_ARE_EQUAL(document, shared);
+}
+
 } // SUITE(construction_tests)
 
 }}}
@@ -24,8 +24,9 @@
 ****/
 
 #include "stdafx.h"
-#include <iomanip>
 #include <clocale>
+#include <cstring>
+#include <iomanip>
 
 using namespace web; using namespace utility;
 
@@ -191,9 +192,7 @@ TEST(parsing_doubles)
     test_double(0 - pow(2.0, 63.0) * 1.5);  // between 0-ULLONG_MAX and LLONGMIN
 }
 
-TEST(parsing_doubles_setlocale, "Ignore:Android", "Locale not supported on Android",
-                                "Ignore:Linux", "Fails due to double conversion issues",
-                                "Ignore:Apple", "Fails due to double conversion issues")
+TEST(parsing_doubles_setlocale, "Ignore:Android", "Locale not supported on Android")
 {
     // JSON uses the C locale always and should therefore not be impacted by the process locale
 #ifdef _WIN32
@@ -207,6 +206,7 @@ TEST(parsing_doubles_setlocale, "Ignore:Android", "Locale not supported on Andro
     {
         test_double(1.91563);
         test_double(2.0e93);
+        VERIFY_ARE_EQUAL(U("1.91563"), json::value(1.91563).serialize());
         setlocale(LC_ALL, "C");
     }
 }
@@ -315,6 +315,109 @@ TEST(compare_numbers)
     VERIFY_ARE_EQUAL(json::value::parse(U("0")), json::value::parse(U("-0")));
 }
 
+// The reference conversion the parser has to agree with.
+static double reference_strtod(const std::string &text)
+{
+#if defined(_WIN32)
+    return _strtod_l(text.c_str(), nullptr, utility::details::scoped_c_thread_locale::c_locale());
+#else
+    utility::details::scoped_c_thread_locale locale;
+    return strtod(text.c_str(), nullptr);
+#endif
+}
+
+static uint64_t double_bits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+TEST(serializing_shortest_doubles)
+{
+    VERIFY_ARE_EQUAL(U("0.1"), json::value(0.1).serialize());
+    VERIFY_ARE_EQUAL(U("-0.3"), json::value(-0.3).serialize());
+    VERIFY_ARE_EQUAL(U("0.30000000000000004"), json::value(0.1 + 0.2).serialize());
+    VERIFY_ARE_EQUAL(U("123.456"), json::value(123.456).serialize());
+    VERIFY_ARE_EQUAL(U("0.0001"), json::value(1e-4).serialize());
+    VERIFY_ARE_EQUAL(U("1e-05"), json::value(1e-5).serialize());
+    VERIFY_ARE_EQUAL(U("1e+17"), json::value(1e17).serialize());
+    VERIFY_ARE_EQUAL(U("12345678901234568"), json::value(12345678901234567.0).serialize());
+    VERIFY_ARE_EQUAL(U("5e-324"), json::value(5e-324).serialize());
+    VERIFY_ARE_EQUAL(U("1.7976931348623157e+308"), json::value(1.7976931348623157e308).serialize());
+    VERIFY_ARE_EQUAL(U("0"), json::value(0.0).serialize());
+    VERIFY_ARE_EQUAL(U("-0"), json::value(-0.0).serialize());
+
+    // Every double reads back to itself.
+    std::mt19937_64 random(42);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const uint64_t bits = random();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (value != value || value - value != 0)
+        {
+            continue;
+        }
+
+        const auto text = json::value(value).serialize();
+        VERIFY_ARE_EQUAL(bits, double_bits(reference_strtod(utility::conversions::to_utf8string(text))));
+        VERIFY_ARE_EQUAL(bits, double_bits(json::value::parse(text).as_double()));
+    }
+}
+
+TEST(parsing_doubles_matches_strtod)
+{
+    const char *cases[] = {
+        "0.1", "1.7976931348623157e308", "1.7976931348623159e308", "2.2250738585072011e-308", "2.2250738585072014e-308",
+        "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400", "1e400",
+        "9007199254740993", "9007199254740993.0", "9007199254740992.5", "0.000000000000000000000000000001e30",
+        "7.2057594037927933e16", "3.0540412499784680e-8", "123456789012345678901234567890.123456789e-20",
+        "18446744073709551616.5", "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124", "1.00000000000000011102230246251565404236316680908203126" };
+    for (const auto text : cases)
+    {
+        const auto parsed = json::value::parse(utility::conversions::to_string_t(text));
+        VERIFY_ARE_EQUAL(double_bits(reference_strtod(text)), double_bits(parsed.as_double()));
+    }
+
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 100000; ++i)
+    {
+        std::string text = "0.";
+        const int digits = 1 + static_cast<int>(random() % 25);
+        for (int d = 0; d < digits; ++d)
+        {
+            text.push_back(static_cast<char>('0' + random() % 10));
+        }
+        text[0] = static_cast<char>('1' + random() % 9);
+        text += "e";
+        text += std::to_string(static_cast<int>(random() % 640) - 330);
+
+        const auto parsed = json::value::parse(utility::conversions::to_string_t(text));
+        VERIFY_ARE_EQUAL(double_bits(reference_strtod(text)), double_bits(parsed.as_double()));
+    }
+}
+
+TEST(number_conversion_round_trip_array)
+{
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> distribution(-1000.0, 1000.0);
+    auto telemetry = json::value::array(20000);
+    for (size_t i = 0; i < telemetry.size(); ++i)
+    {
+        telemetry[i] = json::value(distribution(random));
+    }
+
+    // Every double comes back with the same bits after serializing and parsing.
+    const auto parsed = json::value::parse(telemetry.serialize());
+    VERIFY_ARE_EQUAL(telemetry.size(), parsed.size());
+    for (size_t i = 0; i < telemetry.size(); ++i)
+    {
+        VERIFY_ARE_EQUAL(double_bits(telemetry.at(i).as_double()), double_bits(parsed.at(i).as_double()));
+    }
+}
+
 } // SUITE(json_numbers_tests)
 
 }}}
\ No newline at end of file
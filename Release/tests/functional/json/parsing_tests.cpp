@@ -23,8 +23,12 @@
 
 #include "stdafx.h"
 
+#include "cpprest/containerstream.h"
+#include "cpprest/json_reader.h"
+
 #include <array>
 #include <iomanip>
+#include <thread>
 
 #if defined(_WIN32) || defined(__APPLE__)
 #include <regex>
@@ -285,6 +289,45 @@ TEST(escaping_control_characters)
     }
 }
 
+TEST(long_string_literals)
+{
+    // Place escapes, control characters and multi-byte characters at every offset around the
+    // block sizes used when scanning strings, and compare against parsing from a stream.
+    for (size_t length = 0; length < 80; ++length)
+    {
+        const utility::string_t plain(length, U('a'));
+
+        auto escaped = json::value::parse(U("\"") + plain + U("\\n") + plain + U("\""));
+        VERIFY_ARE_EQUAL(plain + U("\n") + plain, escaped.as_string());
+
+        const auto multibyte = plain + to_string_t("\xE2\x82\xAC") + plain;
+        VERIFY_ARE_EQUAL(multibyte, json::value::parse(U("\"") + multibyte + U("\"")).as_string());
+
+        utility::stringstream_t stream;
+        stream << U("[\"") << plain << U("\\\"") << plain << U("\", 1]");
+        const auto fromString = json::value::parse(stream.str());
+        VERIFY_ARE_EQUAL(plain + U("\"") + plain, fromString.at(0).as_string());
+        VERIFY_ARE_EQUAL(fromString, json::value::parse(stream));
+
+        std::error_code ec;
+        json::value::parse(U("\"") + plain + U("\t") + plain + U("\""), ec);
+        VERIFY_IS_TRUE(ec.value() > 0);
+        json::value::parse(U("\"") + plain, ec);
+        VERIFY_IS_TRUE(ec.value() > 0);
+    }
+
+    // Skipping over a string still keeps track of the column for error messages.
+    try
+    {
+        json::value::parse(U("[\"") + utility::string_t(40, U('a')) + U("\" x]"));
+        VERIFY_IS_TRUE(false);
+    }
+    catch (const json::json_exception &e)
+    {
+        VERIFY_IS_TRUE(std::string(e.what()).find("Column 46") != std::string::npos);
+    }
+}
+
 TEST(comments_string)
 {
     // Nothing but a comment
@@ -515,6 +558,28 @@ TEST(byte_ptr_parsing_object)
     VERIFY_ARE_EQUAL(s2, to_string_t(os.str()));
 }
 
+TEST(byte_span_parsing)
+{
+    // The document is not followed by a terminating null character.
+    const std::string buffer = "{\"test1\": [true, 1.5, \"caf\xc3\xa9\"], \"test2\": null}trailing";
+    const size_t length = buffer.find("trailing");
+    json::value v = json::value::parse(buffer.data(), length);
+    VERIFY_ARE_EQUAL(json::value::parse(to_string_t(buffer.substr(0, length))), v);
+    VERIFY_ARE_EQUAL(U("caf\u00e9"), v[U("test1")][2].as_string());
+
+    json::parse_options options;
+    options.set_lazy(true);
+    VERIFY_ARE_EQUAL(v, json::value::parse(buffer.data(), length, options));
+
+    std::error_code ec;
+    VERIFY_ARE_EQUAL(v, json::value::parse(buffer.data(), length, ec));
+    VERIFY_IS_FALSE(ec.value() > 0);
+    VERIFY_IS_TRUE(json::value::parse(buffer.data(), buffer.size(), ec).is_null());
+    VERIFY_IS_TRUE(ec.value() > 0);
+    VERIFY_PARSING_THROW(json::value::parse(buffer.data(), length - 1));
+    VERIFY_PARSING_THROW(json::value::parse(buffer.data(), 0));
+}
+
 TEST(Japanese)
 {
     utility::string_t ws = U("\"こんにちは\"");
@@ -758,6 +823,438 @@ TEST(parse_overload_failed)
 #endif
 }
 
+// An array of records shaped like a typical REST API listing.
+static utility::string_t make_api_payload(size_t records)
+{
+    utility::ostringstream_t os;
+    os << U("[");
+    for (size_t i = 0; i < records; ++i)
+    {
+        if (i != 0) os << U(",");
+        os << U("{\"id\":") << i
+           << U(",\"name\":\"user ") << i << U("\",\"email\":\"user") << i << U("@example.com\"")
+           << U(",\"active\":") << (i % 2 == 0 ? U("true") : U("false"))
+           << U(",\"score\":") << (i * 0.25)
+           << U(",\"manager\":null")
+           << U(",\"tags\":[\"alpha\",\"beta\",\"a rather longer tag which does not fit in place\"]")
+           << U(",\"address\":{\"street\":\"") << i << U(" Main Street\",\"city\":\"Springfield\",\"zip\":\"12345\"}}");
+    }
+    os << U("]");
+    return os.str();
+}
+
+TEST(arena_parsing)
+{
+    const auto payload = make_api_payload(100);
+    json::parse_options options;
+    VERIFY_IS_FALSE(options.use_arena());
+    options.set_use_arena(true);
+    VERIFY_IS_TRUE(options.use_arena());
+
+    auto arenaValue = json::value::parse(payload, options);
+    VERIFY_ARE_EQUAL(json::value::parse(payload), arenaValue);
+
+    utility::stringstream_t stream;
+    stream << payload;
+    VERIFY_ARE_EQUAL(arenaValue, json::value::parse(stream, options));
+
+    std::error_code ec;
+    json::value::parse(U("[1, 2, {\"a\": \"b\" }"), options, ec);
+    VERIFY_IS_TRUE(ec.value() > 0);
+    VERIFY_PARSING_THROW(json::value::parse(U("{\"a\": [true, false}"), options));
+
+    // Nodes taken out of the document keep working after the rest of it is gone.
+    json::value record, copied;
+    {
+        auto document = json::value::parse(payload, options);
+        record = std::move(document[42]);
+        copied = document[7][U("address")];
+        document[8][U("tags")] = json::value::string(U("replaced"));
+        VERIFY_ARE_EQUAL(U("replaced"), document[8][U("tags")].as_string());
+        document[9] = json::value::parse(U("{\"nested\": [1, 2, 3]}"), options);
+        VERIFY_ARE_EQUAL(3u, document[9][U("nested")].size());
+    }
+    VERIFY_ARE_EQUAL(42, record[U("id")].as_integer());
+    VERIFY_ARE_EQUAL(U("42 Main Street"), record[U("address")][U("street")].as_string());
+    VERIFY_ARE_EQUAL(U("a rather longer tag which does not fit in place"), record[U("tags")][2].as_string());
+    VERIFY_ARE_EQUAL(U("Springfield"), copied[U("city")].as_string());
+    record[U("name")] = json::value::string(U("renamed"));
+    VERIFY_ARE_EQUAL(U("renamed"), record[U("name")].as_string());
+
+    // Values can be released on other threads than the one which parsed them.
+    auto shared = std::make_shared<json::value>(json::value::parse(payload, options));
+    std::thread([shared]() mutable { shared.reset(); }).join();
+}
+
+TEST(arena_parsing_large_payload)
+{
+    // Large enough for the arena to chain several blocks.
+    const auto payload = make_api_payload(5000);
+    json::parse_options arena;
+    arena.set_use_arena(true);
+
+    const auto expected = json::value::parse(payload);
+    auto value = json::value::parse(payload, arena);
+    VERIFY_ARE_EQUAL(5000u, value.size());
+    VERIFY_ARE_EQUAL(expected, value);
+    VERIFY_ARE_EQUAL(expected.serialize(), value.serialize());
+    VERIFY_ARE_EQUAL(4999, value[4999][U("id")].as_integer());
+    VERIFY_ARE_EQUAL(U("user4999@example.com"), value[4999][U("email")].as_string());
+    VERIFY_ARE_EQUAL(U("4999 Main Street"), value[4999][U("address")][U("street")].as_string());
+}
+
+TEST(lazy_parsing)
+{
+    const auto payload = make_api_payload(100);
+    json::parse_options options;
+    VERIFY_IS_FALSE(options.lazy());
+    options.set_lazy(true);
+    VERIFY_IS_TRUE(options.lazy());
+
+    auto lazyValue = json::value::parse(payload, options);
+    VERIFY_ARE_EQUAL(100u, lazyValue.size());
+    VERIFY_IS_TRUE(lazyValue[5].is_object());
+    VERIFY_ARE_EQUAL(json::value::parse(payload), lazyValue);
+    VERIFY_ARE_EQUAL(json::value::parse(payload).serialize(), json::value::parse(payload, options).serialize());
+
+    const utility::string_t longText(100, U('x'));
+    const auto document = U("{ \"items\": ") + payload + U(", \"text\": \"") + longText + U("\", \"escaped\": \"") + longText
+        + U("\\n\\u00e9\", \"count\": 100, \"flag\": true, \"none\": null, \"empty\": {} }");
+    auto value = json::value::parse(document, options);
+    VERIFY_IS_TRUE(value[U("items")].is_array());
+    VERIFY_IS_TRUE(value[U("text")].is_string());
+    VERIFY_IS_TRUE(value[U("empty")].is_object());
+    VERIFY_IS_TRUE(value[U("none")].is_null());
+    VERIFY_ARE_EQUAL(100, value[U("count")].as_integer());
+    VERIFY_IS_TRUE(value[U("flag")].as_bool());
+    VERIFY_ARE_EQUAL(longText, value[U("text")].as_string());
+    VERIFY_ARE_EQUAL(longText + U("\n\u00e9"), value[U("escaped")].as_string());
+    VERIFY_ARE_EQUAL(0u, value[U("empty")].size());
+    VERIFY_ARE_EQUAL(json::value::parse(document), value);
+
+    // Values taken out of the document before or after they are parsed are independent of it.
+    json::value copied = value[U("items")][3];
+    json::value record = value[U("items")][42];
+    VERIFY_ARE_EQUAL(U("42 Main Street"), record[U("address")][U("street")].as_string());
+    value[U("items")][42][U("address")][U("city")] = json::value::string(U("Shelbyville"));
+    value[U("items")][3][U("tags")][0] = json::value::number(1);
+    VERIFY_ARE_EQUAL(U("Springfield"), record[U("address")][U("city")].as_string());
+    VERIFY_ARE_EQUAL(U("alpha"), copied[U("tags")][0].as_string());
+    VERIFY_ARE_EQUAL(U("Shelbyville"), value.at(U("items")).at(42).at(U("address")).at(U("city")).as_string());
+    VERIFY_ARE_EQUAL(1, value[U("items")][3][U("tags")][0].as_integer());
+    VERIFY_ARE_NOT_EQUAL(json::value::parse(document), value);
+
+    // Nested values are parsed when first needed, also when several threads need them at once.
+    const auto shared = json::value::parse(payload, options);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&shared]()
+        {
+            for (size_t j = 0; j < shared.size(); ++j)
+            {
+                VERIFY_ARE_EQUAL(static_cast<int>(j), shared.at(j).at(U("id")).as_integer());
+                VERIFY_ARE_EQUAL(U("Springfield"), shared.at(j).at(U("address")).at(U("city")).as_string());
+            }
+        });
+    }
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    options.set_use_arena(true);
+    VERIFY_ARE_EQUAL(json::value::parse(document), json::value::parse(document, options));
+}
+
+TEST(lazy_parsing_errors)
+{
+    json::parse_options options;
+    options.set_lazy(true);
+
+    // Errors anywhere in the document are reported right away.
+    VERIFY_PARSING_THROW(json::value::parse(U("{\"a\": {\"b\": 1,}}"), options));
+    VERIFY_PARSING_THROW(json::value::parse(U("{\"a\": {\"b\" 1}}"), options));
+    VERIFY_PARSING_THROW(json::value::parse(U("[1, [2, 3}"), options));
+    VERIFY_PARSING_THROW(json::value::parse(U("[1, [2, 3,]]"), options));
+    VERIFY_PARSING_THROW(json::value::parse(U("[{\"a\": [\"\\q\"]}]"), options));
+    VERIFY_PARSING_THROW(json::value::parse(U("[[tru]]"), options));
+    VERIFY_PARSING_THROW(json::value::parse(U("{\"a\": [] } ]"), options));
+
+    std::error_code ec;
+    auto value = json::value::parse(U("[{\"a\": [1, 2}]"), options, ec);
+    VERIFY_IS_TRUE(ec.value() > 0);
+    VERIFY_IS_TRUE(value.is_null());
+
+    value = json::value::parse(U("[{\"a\": [1, 2]}]"), options, ec);
+    VERIFY_IS_FALSE(ec.value() > 0);
+    VERIFY_ARE_EQUAL(2, value[0][U("a")][1].as_integer());
+
+    // Nesting is limited the same way it is for other documents.
+    utility::string_t deep(200, U('['));
+    deep.append(200, U(']'));
+    VERIFY_PARSING_THROW(json::value::parse(deep, options));
+}
+
+TEST(lazy_parsing_large_payload)
+{
+    const auto payload = make_api_payload(5000);
+    json::parse_options lazy;
+    lazy.set_lazy(true);
+
+    // Only a couple of fields of a large response are used.
+    auto value = json::value::parse(payload, lazy);
+    VERIFY_ARE_EQUAL(5000u, value.size());
+    VERIFY_ARE_EQUAL(U("user 10"), value[10][U("name")].as_string());
+    VERIFY_ARE_EQUAL(U("Springfield"), value[4999][U("address")][U("city")].as_string());
+
+    // The parts which were never looked at still compare and serialize like an eager parse.
+    const auto expected = json::value::parse(payload);
+    VERIFY_ARE_EQUAL(expected, value);
+    VERIFY_ARE_EQUAL(expected.serialize(), json::value::parse(payload, lazy).serialize());
+}
+
+TEST(interned_key_parsing)
+{
+    json::parse_options options;
+    VERIFY_IS_FALSE(options.intern_keys());
+    options.set_intern_keys(true);
+    VERIFY_IS_TRUE(options.intern_keys());
+
+    const auto payload = make_api_payload(100);
+    VERIFY_ARE_EQUAL(json::value::parse(payload), json::value::parse(payload, options));
+
+    // Objects which share all, some or none of the fields of the one before them.
+    const utility::string_t documents[] =
+    {
+        U("[{\"b\":1,\"a\":2,\"c\":3},{\"b\":4,\"a\":5,\"c\":6},{\"b\":7,\"a\":8},{\"b\":9,\"a\":10,\"c\":11,\"d\":12},{\"b\":13,\"a\":14,\"c\":15,\"d\":16}]"),
+        U("[{\"z\":1,\"y\":2,\"x\":3,\"w\":4},{\"x\":1,\"z\":2,\"w\":3,\"y\":4},{},{\"z\":1},{\"z\":1,\"y\":2,\"x\":3,\"w\":4}]"),
+        U("{\"outer\":[{\"k\":{\"q\":1,\"p\":2},\"j\":[{\"q\":1,\"p\":2}]},{\"k\":{\"q\":3,\"p\":4},\"j\":[{\"p\":3,\"q\":4}]}],\"a\":{\"k\":1}}"),
+        U("[{\"e\":5,\"d\":4,\"c\":3,\"b\":2,\"a\":1,\"f\":6},{\"e\":5,\"d\":4,\"c\":3,\"b\":2,\"a\":1,\"f\":6},{\"e\":5,\"d\":4,\"c\":3,\"b\":2,\"a\":1,\"f\":6}]"),
+    };
+    for (const auto &document : documents)
+    {
+        const auto expected = json::value::parse(document);
+        auto value = json::value::parse(document, options);
+        VERIFY_ARE_EQUAL(expected, value);
+        VERIFY_ARE_EQUAL(expected.serialize(), value.serialize());
+    }
+
+    {
+        json::keep_object_element_order(true);
+        struct restore {
+            ~restore() {
+                json::keep_object_element_order(false);
+            }
+        }_;
+
+        for (const auto &document : documents)
+        {
+            VERIFY_ARE_EQUAL(json::value::parse(document).serialize(), json::value::parse(document, options).serialize());
+        }
+    }
+
+    auto value = json::value::parse(documents[0], options);
+    VERIFY_ARE_EQUAL(5, value[1][U("a")].as_integer());
+    VERIFY_IS_FALSE(value[2].has_field(U("c")));
+    VERIFY_ARE_EQUAL(16, value[4].at(U("d")).as_integer());
+}
+
+TEST(interned_key_parsing_large_payload)
+{
+    // Thousands of records sharing the same keys.
+    const auto payload = make_api_payload(5000);
+    json::parse_options interned;
+    interned.set_intern_keys(true);
+
+    const auto expected = json::value::parse(payload);
+    auto value = json::value::parse(payload, interned);
+    VERIFY_ARE_EQUAL(5000u, value.size());
+    VERIFY_ARE_EQUAL(expected, value);
+    VERIFY_ARE_EQUAL(expected.serialize(), value.serialize());
+
+    // Keys of one record can be changed without affecting the others.
+    value[0][U("name")] = json::value::string(U("renamed"));
+    value[1].erase(U("email"));
+    VERIFY_ARE_EQUAL(U("renamed"), value[0][U("name")].as_string());
+    VERIFY_ARE_EQUAL(U("user 2"), value[2][U("name")].as_string());
+    VERIFY_IS_FALSE(value[1].has_field(U("email")));
+    VERIFY_IS_TRUE(value[2].has_field(U("email")));
+}
+
+// Reads the whole document through a json_reader, rebuilding it token by token.
+static json::value read_tokens(json::json_reader &reader)
+{
+    std::vector<json::value> containers;
+    std::vector<utility::string_t> keys;
+    json::value result;
+    auto add = [&](json::value v)
+    {
+        if (containers.empty()) result = std::move(v);
+        else if (containers.back().is_object()) { containers.back()[keys.back()] = std::move(v); }
+        else { auto &arr = containers.back(); arr[arr.size()] = std::move(v); }
+    };
+
+    while (reader.read().get())
+    {
+        switch (reader.token())
+        {
+        case json::json_token::start_object: containers.push_back(json::value::object()); keys.push_back(U("")); break;
+        case json::json_token::start_array: containers.push_back(json::value::array()); keys.push_back(U("")); break;
+        case json::json_token::end_object:
+        case json::json_token::end_array:
+            {
+                auto completed = std::move(containers.back());
+                containers.pop_back();
+                keys.pop_back();
+                add(std::move(completed));
+                break;
+            }
+        case json::json_token::property_name: keys.back() = reader.string_value(); break;
+        case json::json_token::string: add(json::value::string(reader.string_value())); break;
+        case json::json_token::number:
+            {
+                const auto &number = reader.number_value();
+                add(number.is_int64() ? json::value::number(number.to_int64()) : json::value::number(number.to_double()));
+                break;
+            }
+        case json::json_token::boolean: add(json::value::boolean(reader.bool_value())); break;
+        case json::json_token::null: add(json::value::null()); break;
+        default: VERIFY_IS_TRUE(false);
+        }
+    }
+    VERIFY_ARE_EQUAL(json::json_token::none, reader.token());
+    return result;
+}
+
+static concurrency::streams::streambuf<uint8_t> make_reader_input(const utility::string_t &text)
+{
+    return concurrency::streams::container_buffer<std::string>(utility::conversions::to_utf8string(text));
+}
+
+TEST(json_reader_tokens)
+{
+    json::json_reader reader(make_reader_input(U(" {\"a\" : [1, -2.5, \"x\"], \"b\": {\"c\": true, \"d\": null}, \"e\": false} ")), 3);
+
+    const json::json_token expected[] = {
+        json::json_token::start_object,
+        json::json_token::property_name, json::json_token::start_array,
+        json::json_token::number, json::json_token::number, json::json_token::string, json::json_token::end_array,
+        json::json_token::property_name, json::json_token::start_object,
+        json::json_token::property_name, json::json_token::boolean, json::json_token::property_name, json::json_token::null,
+        json::json_token::end_object,
+        json::json_token::property_name, json::json_token::boolean,
+        json::json_token::end_object };
+    const size_t depths[] = { 1, 1, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 1, 1, 1 };
+
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i)
+    {
+        VERIFY_IS_TRUE(reader.read().get());
+        VERIFY_ARE_EQUAL(expected[i], reader.token());
+        VERIFY_ARE_EQUAL(depths[i], reader.depth());
+        if (i == 4)
+        {
+            VERIFY_ARE_EQUAL(-2.5, reader.number_value().to_double());
+            VERIFY_THROWS(reader.string_value(), json::json_exception);
+        }
+        if (i == 5) VERIFY_ARE_EQUAL(U("x"), reader.string_value());
+        if (i == 9) VERIFY_ARE_EQUAL(U("c"), reader.string_value());
+    }
+    VERIFY_IS_FALSE(reader.read().get());
+    VERIFY_IS_FALSE(reader.read().get());
+
+    // Every token straddles chunk boundaries for some chunk size.
+    const auto payload = make_api_payload(20);
+    const auto expectedValue = json::value::parse(payload);
+    for (size_t chunk_size : { 1, 2, 7, 64, 4096 })
+    {
+        json::json_reader chunked(make_reader_input(payload), chunk_size);
+        VERIFY_ARE_EQUAL(expectedValue, read_tokens(chunked));
+    }
+
+    json::json_reader scalar(make_reader_input(U("12345")), 2);
+    VERIFY_IS_TRUE(scalar.read().get());
+    VERIFY_ARE_EQUAL(12345, scalar.number_value().to_int32());
+    VERIFY_IS_FALSE(scalar.read().get());
+}
+
+TEST(json_reader_long_tokens)
+{
+    // Strings and numbers much longer than a chunk, with escaped quotes and whitespace in the way.
+    const utility::string_t longText(200000, U('x'));
+    const utility::string_t digits(5000, U('1'));
+    const auto document = U("[ \"") + longText + U("\", \"") + longText + U("\\\"") + longText + U("\", ") + digits + U(".5, \"end\" ]");
+    const auto expected = json::value::parse(document);
+    for (size_t chunk_size : { 1, 3, 64 })
+    {
+        json::json_reader reader(make_reader_input(document), chunk_size);
+        VERIFY_ARE_EQUAL(expected, reader.read_value().get());
+        VERIFY_IS_FALSE(reader.read().get());
+    }
+    VERIFY_ARE_EQUAL(longText + U("\"") + longText, expected.at(1).as_string());
+}
+
+TEST(json_reader_read_value_and_skip)
+{
+    const auto payload = make_api_payload(50);
+    auto document = json::value::parse(payload);
+
+    json::json_reader whole(make_reader_input(payload), 5);
+    VERIFY_ARE_EQUAL(document, whole.read_value().get());
+    VERIFY_IS_FALSE(whole.read().get());
+
+    // Stream the records one at a time, skipping what isn't needed.
+    json::json_reader reader(make_reader_input(payload), 16);
+    VERIFY_IS_TRUE(reader.read().get());
+    VERIFY_ARE_EQUAL(json::json_token::start_array, reader.token());
+    size_t index = 0;
+    while (reader.read().get() && reader.token() != json::json_token::end_array)
+    {
+        VERIFY_ARE_EQUAL(json::json_token::start_object, reader.token());
+        while (reader.read().get() && reader.token() == json::json_token::property_name)
+        {
+            if (reader.string_value() == U("address"))
+            {
+                VERIFY_ARE_EQUAL(document[index][U("address")], reader.read_value().get());
+                VERIFY_ARE_EQUAL(json::json_token::end_object, reader.token());
+            }
+            else
+            {
+                reader.skip().wait();
+            }
+        }
+        VERIFY_ARE_EQUAL(json::json_token::end_object, reader.token());
+        VERIFY_ARE_EQUAL(2u, reader.depth());
+        ++index;
+    }
+    VERIFY_ARE_EQUAL(50u, index);
+    VERIFY_IS_FALSE(reader.read().get());
+}
+
+TEST(json_reader_errors)
+{
+    const utility::string_t malformed[] = {
+        U(""), U("{"), U("[1, 2"), U("[1 2]"), U("{\"a\" 1}"), U("{\"a\": 1,}"), U("[1,]"),
+        U("{1: 2}"), U("[}"), U("{]"), U("1 2"), U("\"unterminated"), U("tru"), U("[1] ]"), U(":") };
+    for (const auto &text : malformed)
+    {
+        json::json_reader reader(make_reader_input(text), 2);
+        VERIFY_THROWS(while (reader.read().get()) { }, json::json_exception);
+    }
+
+    json::json_reader reader(make_reader_input(U("[1, [2, 3]]")), 4);
+    VERIFY_IS_TRUE(reader.read().get());
+    VERIFY_IS_TRUE(reader.read().get());
+    VERIFY_IS_TRUE(reader.read().get());
+    VERIFY_ARE_EQUAL(json::json_token::start_array, reader.token());
+    VERIFY_IS_TRUE(reader.read().get());
+    VERIFY_IS_TRUE(reader.read().get());
+    VERIFY_IS_TRUE(reader.read().get());
+    VERIFY_ARE_EQUAL(json::json_token::end_array, reader.token());
+    VERIFY_THROWS(reader.read_value().get(), json::json_exception);
+    VERIFY_THROWS(reader.bool_value(), json::json_exception);
+}
+
 } // SUITE(parsing_tests)
 
 }}}
@@ -23,10 +23,72 @@
 
 #include "stdafx.h"
 
+#include "cpprest/containerstream.h"
+#include "cpprest/json_binary.h"
+#include "cpprest/json_mapping.h"
+#include "cpprest/json_writer.h"
+#include "cpprest/producerconsumerstream.h"
+
 using namespace web; using namespace utility;
 
 namespace tests { namespace functional { namespace json_tests {
 
+struct mapped_address
+{
+    utility::string_t street;
+    utility::string_t city;
+
+    template <typename Fields>
+    void json_fields(Fields &fields)
+    {
+        fields("street", street)("city", city);
+    }
+};
+
+struct mapped_user
+{
+    mapped_user() : id(0), active(false), score(0) { }
+
+    uint64_t id;
+    utility::string_t name;
+    bool active;
+    double score;
+    std::vector<utility::string_t> tags;
+    mapped_address address;
+    json::value extra;
+
+    template <typename Fields>
+    void json_fields(Fields &fields)
+    {
+        fields("id", id)("name", name)("active", active)("score", score)("tags", tags)("address", address)("extra", extra);
+    }
+};
+
+// A type which knows nothing about JSON, mapped from the outside.
+struct plain_point
+{
+    int x;
+    int y;
+};
+
+}}}
+
+namespace web { namespace json {
+
+template <>
+struct field_mapping<tests::functional::json_tests::plain_point>
+{
+    template <typename Fields>
+    static void fields(Fields &fields, tests::functional::json_tests::plain_point &point)
+    {
+        fields("x", point.x)("y", point.y);
+    }
+};
+
+}}
+
+namespace tests { namespace functional { namespace json_tests {
+
 SUITE(to_as_and_operators_tests)
 {
 
@@ -446,7 +508,8 @@ TEST(floating_number_serialize)
 {
     // This number will have the longest serializaton possible (lenght of the string):
     // Sign, exponent, decimal comma, longest mantisa and exponent make so.
-    auto value = json::value(-3.123456789012345678901234567890E-123);
+    // Doubles are printed with the shortest digits that round-trip, this one needs all 17.
+    auto value = json::value(-2.2250738585072014E-308);
 
     // #digits + 2 to avoid loss + 1 for the sign + 1 for decimal point + 5 for exponent (e+xxx)
     const auto len = std::numeric_limits<double>::digits10 + 9;
@@ -464,6 +527,348 @@ TEST(floating_number_serialize)
 #endif
 }
 
+TEST(json_writer_tokens)
+{
+    concurrency::streams::container_buffer<std::string> output;
+    json::json_writer writer(output, 4);
+
+    writer.write_start_object();
+    writer.write_property_name(U("name"));
+    writer.write_string(U("quote\" tab\t"));
+    writer.write_property_name(U("values"));
+    writer.write_start_array();
+    writer.write_number(1);
+    writer.write_number(-2.5);
+    writer.write_number(static_cast<uint64_t>(18446744073709551615ULL));
+    writer.write_boolean(true);
+    writer.write_null();
+    writer.write_start_object();
+    writer.write_end_object();
+    writer.write_end_array();
+    writer.write_property_name(U("nested"));
+    writer.write_value(json::value::parse(U("{\"a\":[1,{\"b\":\"c\"}],\"d\":[]}"))).wait();
+    VERIFY_IS_FALSE(writer.is_complete());
+    writer.write_end_object();
+    VERIFY_IS_TRUE(writer.is_complete());
+    writer.flush().wait();
+
+    VERIFY_ARE_EQUAL("{\"name\":\"quote\\\" tab\\t\",\"values\":[1,-2.5,18446744073709551615,true,null,{}],\"nested\":{\"a\":[1,{\"b\":\"c\"}],\"d\":[]}}",
+        output.collection());
+    VERIFY_ARE_EQUAL(json::value::parse(utility::conversions::to_string_t(output.collection()))[U("values")][1].as_double(), -2.5);
+}
+
+TEST(json_writer_write_value)
+{
+    auto document = json::value::array();
+    for (int i = 0; i < 200; ++i)
+    {
+        document[i][U("id")] = json::value::number(i);
+        document[i][U("name")] = json::value::string(U("record ") + utility::conversions::print_string(i));
+        document[i][U("tags")] = json::value::parse(U("[\"alpha\", true, null, 0.5, {}]"));
+    }
+
+    for (size_t chunk_size : { 1, 7, 100, 1 << 20 })
+    {
+        concurrency::streams::container_buffer<std::string> output;
+        json::json_writer writer(output, chunk_size);
+        writer.write_value(document).wait();
+        VERIFY_IS_TRUE(writer.is_complete());
+        writer.flush().wait();
+        VERIFY_ARE_EQUAL(utility::conversions::to_utf8string(document.serialize()), output.collection());
+    }
+
+    concurrency::streams::container_buffer<std::string> scalar;
+    json::json_writer scalarWriter(scalar);
+    scalarWriter.write_value(json::value::string(U("x"))).wait();
+    scalarWriter.flush().wait();
+    VERIFY_ARE_EQUAL("\"x\"", scalar.collection());
+}
+
+TEST(json_writer_invalid_documents)
+{
+    concurrency::streams::container_buffer<std::string> output;
+    json::json_writer writer(output);
+    VERIFY_THROWS(writer.write_end_object(), json::json_exception);
+    VERIFY_THROWS(writer.write_property_name(U("a")), json::json_exception);
+
+    writer.write_start_object();
+    VERIFY_THROWS(writer.write_number(1), json::json_exception);
+    VERIFY_THROWS(writer.write_end_array(), json::json_exception);
+    writer.write_property_name(U("a"));
+    VERIFY_THROWS(writer.write_property_name(U("b")), json::json_exception);
+    VERIFY_THROWS(writer.write_end_object(), json::json_exception);
+    writer.write_start_array();
+    VERIFY_THROWS(writer.write_property_name(U("b")), json::json_exception);
+    writer.write_end_array();
+    writer.write_end_object();
+    VERIFY_THROWS(writer.write_null(), json::json_exception);
+    VERIFY_THROWS(writer.write_value(json::value::array()).wait(), json::json_exception);
+
+    writer.flush().wait();
+    VERIFY_ARE_EQUAL("{\"a\":[]}", output.collection());
+}
+
+TEST(field_mapping_round_trip)
+{
+    mapped_user user;
+    user.id = 18446744073709551615ULL;
+    user.name = U("Jane \"JD\" Doe\n");
+    user.active = true;
+    user.score = 0.1;
+    user.tags.push_back(U("alpha"));
+    user.tags.push_back(U("beta"));
+    user.address.street = U("1 Main Street");
+    user.address.city = U("Springfield");
+    user.extra = json::value::parse(U("{\"nested\":[1,null,\"x\"]}"));
+
+    const auto text = json::serialize_fields(user);
+    VERIFY_ARE_EQUAL(U("{\"id\":18446744073709551615,\"name\":\"Jane \\\"JD\\\" Doe\\n\",\"active\":true,\"score\":0.1,")
+        U("\"tags\":[\"alpha\",\"beta\"],\"address\":{\"street\":\"1 Main Street\",\"city\":\"Springfield\"},")
+        U("\"extra\":{\"nested\":[1,null,\"x\"]}}"), text);
+
+    // Field order doesn't matter when reading back, the DOM sorts the fields.
+    mapped_user parsed;
+    json::parse_fields(json::value::parse(text).serialize(), parsed);
+    VERIFY_ARE_EQUAL(user.id, parsed.id);
+    VERIFY_ARE_EQUAL(user.name, parsed.name);
+    VERIFY_IS_TRUE(parsed.active);
+    VERIFY_ARE_EQUAL(user.score, parsed.score);
+    VERIFY_ARE_EQUAL(user.tags, parsed.tags);
+    VERIFY_ARE_EQUAL(user.address.street, parsed.address.street);
+    VERIFY_ARE_EQUAL(user.address.city, parsed.address.city);
+    VERIFY_ARE_EQUAL(user.extra, parsed.extra);
+
+    plain_point point = { -3, 4 };
+    std::string utf8 = "[";
+    json::serialize_fields(point, utf8);
+    VERIFY_ARE_EQUAL("[{\"x\":-3,\"y\":4}", utf8);
+    std::vector<plain_point> points;
+    const std::string input = "[{\"y\":2,\"x\":1}, {\"x\":5.0}]";
+    json::parse_fields(input.data(), input.size(), points);
+    VERIFY_ARE_EQUAL(2u, points.size());
+    VERIFY_ARE_EQUAL(1, points[0].x);
+    VERIFY_ARE_EQUAL(2, points[0].y);
+    VERIFY_ARE_EQUAL(5, points[1].x);
+}
+
+TEST(field_mapping_parse_rules)
+{
+    mapped_user user;
+    user.name = U("unchanged");
+    user.tags.push_back(U("replaced"));
+    json::parse_fields(U("{\"unknown\":{\"a\":[1,{\"b\":2}]},\"name\":null,\"id\":7,\"tags\":[],\"also unknown\":[true],\"extra\":null}"), user);
+    VERIFY_ARE_EQUAL(U("unchanged"), user.name);
+    VERIFY_ARE_EQUAL(7u, user.id);
+    VERIFY_IS_TRUE(user.tags.empty());
+    VERIFY_IS_TRUE(user.extra.is_null());
+
+    VERIFY_THROWS(json::parse_fields(U("{\"id\":\"7\"}"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"address\":[]}"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"tags\":\"alpha\"}"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("[]"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"id\":1} {}"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"id\":1"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"name\":\"a\" \"id\":1}"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U(""), user), json::json_exception);
+}
+
+TEST(field_mapping_number_ranges)
+{
+    plain_point point = { 0, 0 };
+    json::parse_fields(U("{\"x\":2147483647,\"y\":-2147483648}"), point);
+    VERIFY_ARE_EQUAL(2147483647, point.x);
+    VERIFY_ARE_EQUAL((std::numeric_limits<int>::min)(), point.y);
+    json::parse_fields(U("{\"x\":19.9,\"y\":-1e3}"), point);
+    VERIFY_ARE_EQUAL(19, point.x);
+    VERIFY_ARE_EQUAL(-1000, point.y);
+
+    // Numbers which don't fit the field throw instead of wrapping around.
+    VERIFY_THROWS(json::parse_fields(U("{\"x\":2147483648}"), point), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"y\":-2147483649}"), point), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"x\":9223372036854775808}"), point), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"x\":1e300}"), point), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"x\":-1e300}"), point), json::json_exception);
+
+    mapped_user user;
+    json::parse_fields(U("{\"id\":1.8e19}"), user);
+    VERIFY_ARE_EQUAL(18000000000000000000ULL, user.id);
+    VERIFY_THROWS(json::parse_fields(U("{\"id\":-1}"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"id\":-1.5}"), user), json::json_exception);
+    VERIFY_THROWS(json::parse_fields(U("{\"id\":1.9e19}"), user), json::json_exception);
+}
+
+TEST(field_mapping_large_document)
+{
+    std::vector<mapped_user> users(2000);
+    for (size_t i = 0; i < users.size(); ++i)
+    {
+        users[i].id = i;
+        users[i].name = U("user ") + utility::conversions::print_string(i);
+        users[i].active = i % 2 == 0;
+        users[i].score = i * 0.25;
+        users[i].tags.push_back(U("alpha"));
+        users[i].tags.push_back(U("a rather longer tag which does not fit in place"));
+        users[i].address.street = utility::conversions::print_string(i) + U(" Main Street");
+        users[i].address.city = U("Springfield");
+    }
+    const auto text = json::serialize_fields(users);
+    VERIFY_ARE_EQUAL(users.size(), json::value::parse(text).size());
+
+    // Reads back the same records as going through a json::value does.
+    std::vector<mapped_user> parsed;
+    json::parse_fields(text, parsed);
+    VERIFY_ARE_EQUAL(users.size(), parsed.size());
+    for (size_t i = 0; i < users.size(); ++i)
+    {
+        VERIFY_ARE_EQUAL(users[i].id, parsed[i].id);
+        VERIFY_ARE_EQUAL(users[i].name, parsed[i].name);
+        VERIFY_ARE_EQUAL(users[i].active, parsed[i].active);
+        VERIFY_ARE_EQUAL(users[i].score, parsed[i].score);
+        VERIFY_ARE_EQUAL(users[i].tags, parsed[i].tags);
+        VERIFY_ARE_EQUAL(users[i].address.street, parsed[i].address.street);
+        VERIFY_ARE_EQUAL(users[i].address.city, parsed[i].address.city);
+    }
+    VERIFY_ARE_EQUAL(text, json::serialize_fields(parsed));
+}
+
+static std::vector<unsigned char> bytes(std::initializer_list<int> values)
+{
+    std::vector<unsigned char> result;
+    for (const int value : values)
+    {
+        result.push_back(static_cast<unsigned char>(value));
+    }
+    return result;
+}
+
+TEST(binary_round_trip)
+{
+    json::value document = json::value::parse(U("{\"small\":[0,1,23,24,255,256,65535,65536,4294967295,4294967296,18446744073709551615],")
+        U("\"negative\":[-1,-24,-25,-32,-33,-128,-129,-32768,-32769,-2147483648,-2147483649,-9223372036854775808],")
+        U("\"doubles\":[0.5,0.1,-2.0,1e300,-1e-300,3.4028234663852886e38],")
+        U("\"literals\":[true,false,null],\"text\":[\"\",\"\\u00e9\\u4e2d\\ud83d\\ude00\"],\"empty\":{},\"none\":[]}"));
+    document[U("text")][2] = json::value::string(utility::string_t(300, U('x')));
+    document[U("text")][3] = json::value::string(utility::string_t(70000, U('y')));
+    for (int i = 0; i < 40; ++i)
+    {
+        document[U("wide")][utility::conversions::print_string(i)] = json::value::number(i);
+        document[U("long")][i] = json::value::array();
+    }
+
+    for (const auto format : { json::binary_format::cbor, json::binary_format::msgpack })
+    {
+        const auto encoded = json::encode_binary(document, format);
+        VERIFY_ARE_EQUAL(document, json::decode_binary(encoded, format));
+
+        std::vector<unsigned char> appended(1, 0x42);
+        json::encode_binary(document, format, appended);
+        VERIFY_ARE_EQUAL(encoded.size() + 1, appended.size());
+        VERIFY_IS_TRUE(std::equal(encoded.begin(), encoded.end(), appended.begin() + 1));
+    }
+
+    // Examples of RFC 8949 and the MessagePack specification.
+    const auto sample = json::value::parse(U("{\"a\":1,\"b\":[2,3]}"));
+    VERIFY_IS_TRUE(bytes({ 0xA2, 0x61, 0x61, 0x01, 0x61, 0x62, 0x82, 0x02, 0x03 }) == json::encode_binary(sample, json::binary_format::cbor));
+    VERIFY_IS_TRUE(bytes({ 0x82, 0xA1, 0x61, 0x01, 0xA1, 0x62, 0x92, 0x02, 0x03 }) == json::encode_binary(sample, json::binary_format::msgpack));
+    VERIFY_IS_TRUE(bytes({ 0x39, 0x03, 0xE7 }) == json::encode_binary(json::value::number(-1000), json::binary_format::cbor));
+    VERIFY_IS_TRUE(bytes({ 0xFB, 0x3F, 0xF1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9A }) == json::encode_binary(json::value::number(1.1), json::binary_format::cbor));
+    VERIFY_IS_TRUE(bytes({ 0xCA, 0x3F, 0xC0, 0x00, 0x00 }) == json::encode_binary(json::value::number(1.5), json::binary_format::msgpack));
+    VERIFY_ARE_EQUAL(1.5, json::decode_binary(bytes({ 0xF9, 0x3E, 0x00 }), json::binary_format::cbor).as_double());
+    VERIFY_ARE_EQUAL(-4.0, json::decode_binary(bytes({ 0xF9, 0xC4, 0x00 }), json::binary_format::cbor).as_double());
+    VERIFY_ARE_EQUAL(json::value::parse(U("[1,[2,3],{\"a\":\"streaming\"}]")), json::decode_binary(bytes({ 0x9F, 0x01, 0x82, 0x02, 0x03, 0xBF, 0x61, 0x61,
+        0x7F, 0x65, 0x73, 0x74, 0x72, 0x65, 0x61, 0x64, 0x6D, 0x69, 0x6E, 0x67, 0xFF, 0xFF, 0xFF }), json::binary_format::cbor));
+    VERIFY_ARE_EQUAL(1363896240, json::decode_binary(bytes({ 0xC1, 0x1A, 0x51, 0x4B, 0x67, 0xB0 }), json::binary_format::cbor).as_integer());
+    VERIFY_ARE_EQUAL(-2, json::decode_binary(bytes({ 0xD1, 0xFF, 0xFE }), json::binary_format::msgpack).as_integer());
+}
+
+TEST(binary_errors)
+{
+    for (const auto format : { json::binary_format::cbor, json::binary_format::msgpack })
+    {
+        auto encoded = json::encode_binary(json::value::parse(U("{\"a\":[1,2,\"three\"]}")), format);
+        for (size_t length = 0; length < encoded.size(); ++length)
+        {
+            VERIFY_THROWS(json::decode_binary(encoded.data(), length, format), json::json_exception);
+        }
+        encoded.push_back(0);
+        VERIFY_THROWS(json::decode_binary(encoded, format), json::json_exception);
+    }
+
+    // Byte strings, keys which aren't text, reserved values and claimed sizes beyond the input.
+    VERIFY_THROWS(json::decode_binary(bytes({ 0x41, 0x00 }), json::binary_format::cbor), json::json_exception);
+    VERIFY_THROWS(json::decode_binary(bytes({ 0xA1, 0x01, 0x02 }), json::binary_format::cbor), json::json_exception);
+    VERIFY_THROWS(json::decode_binary(bytes({ 0xFC }), json::binary_format::cbor), json::json_exception);
+    VERIFY_THROWS(json::decode_binary(bytes({ 0x9B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }), json::binary_format::cbor), json::json_exception);
+    VERIFY_THROWS(json::decode_binary(bytes({ 0xC4, 0x01, 0x00 }), json::binary_format::msgpack), json::json_exception);
+    VERIFY_THROWS(json::decode_binary(bytes({ 0x81, 0x01, 0x02 }), json::binary_format::msgpack), json::json_exception);
+    VERIFY_THROWS(json::decode_binary(bytes({ 0xC1 }), json::binary_format::msgpack), json::json_exception);
+    VERIFY_THROWS(json::decode_binary(bytes({ 0xDD, 0xFF, 0xFF, 0xFF, 0xFF }), json::binary_format::msgpack), json::json_exception);
+
+    // Arrays holding one array each.
+    VERIFY_THROWS(json::decode_binary(std::vector<unsigned char>(1000, 0x81), json::binary_format::cbor), json::json_exception);
+    VERIFY_THROWS(json::decode_binary(std::vector<unsigned char>(1000, 0x91), json::binary_format::msgpack), json::json_exception);
+}
+
+TEST(binary_streams)
+{
+    json::value document;
+    for (int i = 0; i < 2000; ++i)
+    {
+        document[i][U("index")] = json::value::number(i);
+        document[i][U("name")] = json::value::string(U("element ") + utility::conversions::print_string(i));
+    }
+
+    for (const auto format : { json::binary_format::cbor, json::binary_format::msgpack })
+    {
+        concurrency::streams::producer_consumer_buffer<uint8_t> buffer;
+        auto reading = json::read_binary(buffer, format);
+        json::write_binary(document, format, buffer).wait();
+        buffer.close(std::ios_base::out).wait();
+        VERIFY_ARE_EQUAL(document, reading.get());
+
+        concurrency::streams::container_buffer<std::vector<uint8_t>> broken;
+        json::write_binary(json::value::array(), format, broken).wait();
+        broken.putc(0).wait();
+        broken.close(std::ios_base::out).wait();
+        VERIFY_THROWS(json::read_binary(broken, format).get(), json::json_exception);
+    }
+
+    json::binary_format format;
+    VERIFY_IS_TRUE(json::binary_format_of(U("Application/CBOR"), format));
+    VERIFY_IS_TRUE(format == json::binary_format::cbor);
+    VERIFY_IS_TRUE(json::binary_format_of(U("application/x-msgpack"), format));
+    VERIFY_IS_TRUE(format == json::binary_format::msgpack);
+    VERIFY_IS_FALSE(json::binary_format_of(U("application/json"), format));
+    VERIFY_ARE_EQUAL(U("application/msgpack"), json::binary_content_type(json::binary_format::msgpack));
+}
+
+TEST(binary_large_document)
+{
+    json::value document = json::value::array();
+    for (int i = 0; i < 2000; ++i)
+    {
+        auto &record = document[i];
+        record[U("id")] = json::value::number(i);
+        record[U("name")] = json::value::string(U("user ") + utility::conversions::print_string(i));
+        record[U("active")] = json::value::boolean(i % 2 == 0);
+        record[U("score")] = json::value::number(i * 0.25);
+        record[U("ratio")] = json::value::number(i / 3.0);
+        record[U("tags")][0] = json::value::string(U("alpha"));
+        record[U("tags")][1] = json::value::string(U("beta"));
+    }
+
+    // Both encodings are smaller than the text and decode to the same document.
+    const auto text = utility::conversions::to_utf8string(document.serialize());
+    for (const auto format : { json::binary_format::cbor, json::binary_format::msgpack })
+    {
+        const auto binary = json::encode_binary(document, format);
+        VERIFY_IS_TRUE(binary.size() < text.size());
+        const auto decoded = json::decode_binary(binary, format);
+        VERIFY_ARE_EQUAL(document, decoded);
+        VERIFY_ARE_EQUAL(1999.0 / 3.0, decoded.at(1999).at(U("ratio")).as_double());
+    }
+}
+
 } // SUITE(to_as_and_operators_tests)
 
 }}}
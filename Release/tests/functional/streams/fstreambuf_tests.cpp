@@ -22,6 +22,9 @@
 ****/
 #include "stdafx.h"
 
+#include <algorithm>
+#include <fstream>
+
 #ifdef _WIN32
 #include "CppSparseFile.h"
 #endif
@@ -1073,6 +1076,392 @@ TEST(read_alloc_acquire_not_supported)
     file_buf2.close().wait();
 }
 
+TEST(ManyOutstandingWrites)
+{
+    // More writes than the asynchronous I/O backend has room for, all in flight at once.
+    const size_t chunks = 1000, chunk_size = 1024;
+    std::vector<std::vector<char>> data(chunks);
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        data[i].assign(chunk_size, static_cast<char>('a' + i % 26));
+    }
+
+    auto stream = OPEN_W<char>(U("ManyOutstandingWrites.txt")).get();
+    // Small writes would be gathered otherwise.
+    stream.set_buffer_size(0, std::ios_base::out);
+    std::vector<pplx::task<size_t>> writes;
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        writes.push_back(stream.putn_nocopy(&data[i][0], chunk_size));
+    }
+    stream.sync().get();
+    for (auto &write : writes)
+    {
+        VERIFY_ARE_EQUAL(chunk_size, write.get());
+    }
+    stream.close().get();
+
+    stream = OPEN_R<char>(U("ManyOutstandingWrites.txt")).get();
+    std::vector<char> chunk(chunk_size);
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        VERIFY_ARE_EQUAL(chunk_size, stream.getn(&chunk[0], chunk_size).get());
+        VERIFY_IS_TRUE(chunk == data[i]);
+    }
+    VERIFY_ARE_EQUAL(0, stream.getn(&chunk[0], chunk_size).get());
+    stream.close().get();
+}
+
+TEST(SequentialReadTest)
+{
+    utility::string_t fname = U("SequentialReadTest.txt");
+    fill_file(fname, 10000);
+    const std::string alphabet = "abcdefghijklmnopqrstuvwxyz";
+
+    // Reads far enough for blocks to be read ahead, in chunks that don't divide them evenly.
+    auto stream = OPEN_R<char>(fname).get();
+    std::vector<char> chunk(1000);
+    size_t pos = 0;
+    auto verify_chunk = [&](size_t read)
+    {
+        for (size_t i = 0; i < read; ++i)
+        {
+            if (chunk[i] != alphabet[(pos + i) % 26])
+            {
+                VERIFY_ARE_EQUAL(alphabet[(pos + i) % 26], chunk[i]);
+                break;
+            }
+        }
+        pos += read;
+    };
+
+    while (pos < 100000)
+    {
+        size_t read = stream.getn(&chunk[0], chunk.size()).get();
+        VERIFY_ARE_EQUAL(chunk.size(), read);
+        verify_chunk(read);
+    }
+
+    // Jumping back and forth drops what was read ahead.
+    pos = 5;
+    stream.seekpos(pos, std::ios_base::in);
+    for (int i = 0; i < 3; ++i)
+    {
+        verify_chunk(stream.getn(&chunk[0], chunk.size()).get());
+    }
+    pos = 150001;
+    stream.seekpos(pos, std::ios_base::in);
+    VERIFY_ARE_EQUAL(alphabet[pos % 26], (char)stream.bumpc().get());
+    ++pos;
+
+    size_t read;
+    while ((read = stream.getn(&chunk[0], chunk.size()).get()) > 0)
+    {
+        verify_chunk(read);
+    }
+    VERIFY_ARE_EQUAL(260000, pos);
+    stream.close().get();
+
+    // Closing waits for blocks still being read.
+    stream = OPEN_R<char>(fname).get();
+    for (int i = 0; i < 4; ++i)
+    {
+        VERIFY_ARE_EQUAL(chunk.size(), stream.getn(&chunk[0], chunk.size()).get());
+    }
+    stream.close().get();
+    VERIFY_IS_FALSE(stream.is_open());
+}
+
+TEST(GatheredWriteTest)
+{
+    utility::string_t fname = U("GatheredWriteTest.txt");
+    auto stream = OPEN_W<char>(fname).get();
+#if !defined(_WIN32)
+    VERIFY_ARE_EQUAL(64 * 1024, stream.buffer_size(std::ios_base::out));
+#endif
+
+    // Small writes, a large one, and one which doesn't follow on from the others.
+    std::string expected;
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        std::string record(i % 100 + 1, static_cast<char>('a' + i % 26));
+        VERIFY_ARE_EQUAL(record.size(), stream.putn_nocopy(record.c_str(), record.size()).get());
+        expected += record;
+    }
+    std::string large(100000, 'L');
+    VERIFY_ARE_EQUAL(large.size(), stream.putn_nocopy(large.c_str(), large.size()).get());
+    expected += large;
+    VERIFY_ARE_EQUAL('!', stream.putc('!').get());
+    expected += '!';
+    VERIFY_ARE_EQUAL(expected.size(), stream.size());
+
+    stream.seekpos(10, std::ios_base::out);
+    VERIFY_ARE_EQUAL(3, stream.putn_nocopy("XYZ", 3).get());
+    expected.replace(10, 3, "XYZ");
+    stream.sync().get();
+    VERIFY_ARE_EQUAL(expected.size(), stream.size());
+    stream.close().get();
+
+    // Appending, and writing through.
+    stream = OPEN<char>(fname, std::ios_base::out | std::ios_base::app).get();
+    for (int i = 0; i < 10; ++i)
+    {
+        VERIFY_ARE_EQUAL(5, stream.putn_nocopy("tail.", 5).get());
+        expected += "tail.";
+    }
+    stream.set_buffer_size(0, std::ios_base::out);
+#if !defined(_WIN32)
+    VERIFY_ARE_EQUAL(0, stream.buffer_size(std::ios_base::out));
+#endif
+    VERIFY_ARE_EQUAL(4, stream.putn_nocopy("end.", 4).get());
+    expected += "end.";
+    stream.close().get();
+
+    auto in = OPEN_R<char>(fname).get();
+    std::string actual(expected.size() + 1, '\0');
+    VERIFY_ARE_EQUAL(expected.size(), in.getn(&actual[0], actual.size()).get());
+    actual.resize(expected.size());
+    VERIFY_IS_TRUE(expected == actual);
+    in.close().get();
+}
+
+TEST(concurrent_file_streams)
+{
+    const size_t files = 4, file_size = 2 * 1024 * 1024, chunk_size = 64 * 1024;
+    std::vector<utility::string_t> names;
+    std::vector<std::vector<char>> contents(files, std::vector<char>(file_size));
+    for (size_t i = 0; i < files; ++i)
+    {
+        names.push_back(U("concurrent_file_streams") + utility::conversions::print_string(i) + U(".txt"));
+        for (size_t j = 0; j < file_size; ++j)
+        {
+            contents[i][j] = static_cast<char>('a' + (i + j / 1000) % 26);
+        }
+    }
+
+    // Every chunk of every file is written, then read, without waiting in between.
+    std::vector<pplx::task<void>> tasks;
+    for (size_t i = 0; i < files; ++i)
+    {
+        auto stream = OPEN_W<char>(names[i]).get();
+        for (size_t written = 0; written < file_size; written += chunk_size)
+        {
+            stream.putn_nocopy(&contents[i][written], chunk_size);
+        }
+        tasks.push_back(stream.close());
+    }
+    pplx::when_all(tasks.begin(), tasks.end()).wait();
+
+    std::vector<std::vector<char>> buffers(files, std::vector<char>(file_size));
+    tasks.clear();
+    for (size_t i = 0; i < files; ++i)
+    {
+        auto stream = OPEN_R<char>(names[i]).get();
+        auto target = &buffers[i][0];
+        auto offset = std::make_shared<size_t>(0);
+        tasks.push_back(pplx::details::do_while([stream, target, offset]() mutable
+        {
+            return stream.getn(target + *offset, chunk_size).then([offset](size_t read)
+            {
+                *offset += read;
+                return read == chunk_size && *offset < file_size;
+            });
+        }).then([stream](bool) mutable { return stream.close(); }));
+    }
+    pplx::when_all(tasks.begin(), tasks.end()).wait();
+    for (size_t i = 0; i < files; ++i)
+    {
+        VERIFY_IS_TRUE(contents[i] == buffers[i]);
+    }
+
+    // Small reads, one at a time, at scattered positions.
+    auto stream = OPEN_R<char>(names[1]).get();
+    char small[512];
+    for (size_t i = 0; i < 200; ++i)
+    {
+        const size_t position = (i * 7919 * sizeof(small)) % (file_size - sizeof(small));
+        stream.seekpos(position, std::ios_base::in);
+        VERIFY_ARE_EQUAL(sizeof(small), stream.getn(small, sizeof(small)).get());
+        VERIFY_IS_TRUE(std::equal(small, small + sizeof(small), contents[1].begin() + position));
+    }
+    stream.close().wait();
+
+    for (const auto &name : names)
+    {
+        std::remove(utility::conversions::to_utf8string(name).c_str());
+    }
+}
+
+TEST(gathered_writes_in_order)
+{
+    utility::string_t fname = U("gathered_writes_in_order.txt");
+    std::vector<std::string> records;
+    std::string expected;
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        // Mostly small writes, which are gathered, with some too large for the write buffer in between.
+        records.push_back(std::string(i % 7 == 0 ? 5000 : 100 + i % 50, static_cast<char>('a' + i % 26)));
+        expected += records.back();
+    }
+
+    for (auto mode : { std::ios_base::out | std::ios_base::app, std::ios_base::out | std::ios_base::trunc })
+    {
+        // Nothing is waited for until the stream is closed, so the writes and flushes all overlap.
+        std::remove(utility::conversions::to_utf8string(get_full_name(fname)).c_str());
+        auto stream = OPEN<char>(fname, mode).get();
+        stream.set_buffer_size(4096, std::ios_base::out);
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            stream.putn_nocopy(&records[i][0], records[i].size());
+            if (i % 300 == 0)
+            {
+                stream.sync();
+            }
+        }
+        stream.close().wait();
+
+        std::ifstream file(utility::conversions::to_utf8string(get_full_name(fname)), std::ios_base::binary);
+        std::string written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        VERIFY_IS_TRUE(expected == written);
+    }
+
+    // Small chunks read one at a time, with reading ahead.
+    auto stream = OPEN_R<char>(fname).get();
+    stream.set_buffer_size(512);
+    std::string read;
+    char chunk[300];
+    size_t count;
+    while ((count = stream.getn(chunk, sizeof(chunk)).get()) > 0)
+    {
+        read.append(chunk, count);
+    }
+    stream.close().wait();
+    VERIFY_IS_TRUE(expected == read);
+
+    std::remove(utility::conversions::to_utf8string(get_full_name(fname)).c_str());
+}
+
+#if !defined(__cplusplus_winrt)
+TEST(MappedReadTest)
+{
+    utility::string_t fname = U("MappedReadTest.txt");
+    fill_file(fname, 100);
+
+    auto stream = concurrency::streams::file_buffer<char>::open_mapped(fname).get();
+    VERIFY_IS_TRUE(stream.is_open());
+    VERIFY_IS_TRUE(stream.can_read());
+    VERIFY_IS_FALSE(stream.can_write());
+    VERIFY_ARE_EQUAL(2600, stream.in_avail());
+    VERIFY_ARE_EQUAL('a', stream.sbumpc());
+
+    // acquire() hands out the rest of the file.
+    char *data;
+    size_t count;
+    VERIFY_IS_TRUE(stream.acquire(data, count));
+    VERIFY_ARE_EQUAL(2599, count);
+    VERIFY_ARE_EQUAL('b', data[0]);
+    stream.release(data, 25);
+
+    char buf[26];
+    VERIFY_ARE_EQUAL(26, stream.getn(buf, sizeof(buf)).get());
+    VERIFY_ARE_EQUAL(0, memcmp(buf, "abcdefghijklmnopqrstuvwxyz", sizeof(buf)));
+
+    stream.seekoff(-10, std::ios_base::end, std::ios_base::in);
+    VERIFY_ARE_EQUAL(10, stream.getn(buf, sizeof(buf)).get());
+    VERIFY_ARE_EQUAL('q', buf[0]);
+    VERIFY_IS_TRUE(stream.acquire(data, count));
+    VERIFY_IS_TRUE(data == nullptr);
+    VERIFY_ARE_EQUAL(0, count);
+    VERIFY_ARE_EQUAL(0, stream.getn(buf, sizeof(buf)).get());
+
+    stream.seekpos(26, std::ios_base::in);
+    VERIFY_ARE_EQUAL('a', stream.bumpc().get());
+    VERIFY_ARE_EQUAL('b', stream.getc().get());
+
+    stream.close().get();
+    VERIFY_IS_FALSE(stream.is_open());
+}
+
+TEST(MappedIstreamTest)
+{
+    utility::string_t fname = U("MappedIstreamTest.txt");
+    fill_file(fname, 3);
+
+    auto stream = concurrency::streams::file_stream<char>::open_mapped_istream(fname).get();
+    concurrency::streams::container_buffer<std::string> target;
+    VERIFY_ARE_EQUAL(78, stream.read_to_end(target).get());
+    VERIFY_ARE_EQUAL("abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz", target.collection());
+    VERIFY_IS_TRUE(stream.is_eof());
+    stream.close().get();
+}
+
+TEST(MappedEmptyAndMissingFiles)
+{
+    utility::string_t fname = U("MappedEmptyFile.txt");
+    fill_file(fname, 0);
+
+    auto stream = concurrency::streams::file_buffer<char>::open_mapped(fname).get();
+    char *data;
+    size_t count;
+    VERIFY_IS_TRUE(stream.acquire(data, count));
+    VERIFY_IS_TRUE(data == nullptr);
+    VERIFY_ARE_EQUAL(0, count);
+    VERIFY_ARE_EQUAL(concurrency::streams::char_traits<char>::eof(), stream.bumpc().get());
+    stream.close().get();
+
+    VERIFY_THROWS_SYSTEM_ERROR(concurrency::streams::file_buffer<char>::open_mapped(U("MappedMissingFile.txt")).get(), std::errc::no_such_file_or_directory);
+}
+
+TEST(mapped_large_file)
+{
+    const size_t file_size = 4 * 1024 * 1024 + 123, chunk_size = 64 * 1024;
+    utility::string_t fname = U("mapped_large_file.txt");
+    std::vector<char> contents(file_size);
+    for (size_t i = 0; i < file_size; ++i)
+    {
+        contents[i] = static_cast<char>('a' + (i / 1000) % 26);
+    }
+    {
+        std::ofstream file(utility::conversions::to_utf8string(get_full_name(fname)), std::ios_base::binary);
+        file.write(&contents[0], file_size);
+    }
+
+    // Copying reads return the same bytes as the buffered file stream.
+    auto read_all = [&](concurrency::streams::streambuf<char> stream)
+    {
+        std::vector<char> target(file_size + chunk_size);
+        size_t total = 0, read;
+        while ((read = stream.getn(&target[total], chunk_size).get()) > 0)
+        {
+            total += read;
+        }
+        stream.close().wait();
+        target.resize(total);
+        return target;
+    };
+    VERIFY_IS_TRUE(contents == read_all(OPEN_R<char>(fname).get()));
+    VERIFY_IS_TRUE(contents == read_all(concurrency::streams::file_buffer<char>::open_mapped(fname).get()));
+
+    // Consuming the file in place, in blocks smaller than the mapping.
+    auto stream = concurrency::streams::file_buffer<char>::open_mapped(fname).get();
+    size_t total = 0;
+    char *data;
+    size_t count;
+    while (stream.acquire(data, count) && count > 0)
+    {
+        VERIFY_ARE_EQUAL(file_size - total, count);
+        const auto block = (std::min)(count, chunk_size);
+        VERIFY_IS_TRUE(std::equal(data, data + block, contents.begin() + total));
+        total += block;
+        stream.release(data, block);
+    }
+    VERIFY_ARE_EQUAL(file_size, total);
+    stream.close().wait();
+
+    std::remove(utility::conversions::to_utf8string(get_full_name(fname)).c_str());
+}
+#endif
+
 TEST(winrt_filestream_close)
 {
     std::string str("test data");
@@ -813,6 +813,82 @@ TEST(stream_read_to_end_flush)
     sbuf.close().get();
 }
 
+TEST(stream_read_line_blocks)
+{
+    // Lines split over the blocks of a producer/consumer buffer, one longer than the read's own buffer.
+    const std::string longLine(40000, 'x');
+    const std::vector<std::string> pieces = { "first line\r", "\nsecond", " line\n", longLine, "\r\n\rthird|line\n", "last" };
+    producer_consumer_buffer<char> rbuf;
+    for (const auto &piece : pieces)
+    {
+        rbuf.putn_nocopy(piece.data(), piece.size()).wait();
+    }
+    rbuf.close(std::ios_base::out).wait();
+
+    streams::basic_istream<char> stream(rbuf);
+    const std::vector<std::string> expected = { "first line", "second line", longLine, "", "third|line", "last" };
+    for (const auto &line : expected)
+    {
+        container_buffer<std::string> target;
+        VERIFY_ARE_EQUAL(line.size(), stream.read_line(target).get());
+        VERIFY_IS_TRUE(line == target.collection());
+    }
+    VERIFY_IS_TRUE(stream.is_eof());
+
+    // The same through a single block, and split at a delimiter.
+    stringstreambuf sbuf(std::string("alpha|beta|") + longLine);
+    streams::basic_istream<char> delimited(sbuf);
+    for (const auto &field : { std::string("alpha"), std::string("beta"), longLine })
+    {
+        container_buffer<std::string> target;
+        VERIFY_ARE_EQUAL(field.size(), delimited.read_to_delim(target, '|').get());
+        VERIFY_IS_TRUE(field == target.collection());
+    }
+    VERIFY_IS_TRUE(delimited.is_eof());
+
+    const std::string narrow("wide\r\nlines\nx");
+    container_buffer<std::basic_string<utf16char>> wbuf(std::basic_string<utf16char>(narrow.begin(), narrow.end()), std::ios_base::in);
+    streams::basic_istream<utf16char> wide(wbuf);
+    container_buffer<std::basic_string<utf16char>> wtarget;
+    VERIFY_ARE_EQUAL(4u, wide.read_line(wtarget).get());
+    VERIFY_ARE_EQUAL(5u, wide.read_line(wtarget).get());
+    const std::string joined("widelines");
+    VERIFY_IS_TRUE(std::basic_string<utf16char>(joined.begin(), joined.end()) == wtarget.collection());
+}
+
+TEST(stream_read_line_long_lines)
+{
+    // Lines shorter and much longer than the 16KB the reads copy through, some ending in "\r\n".
+    std::vector<std::string> lines;
+    std::string text;
+    for (size_t length : { 0, 1, 1000, 16383, 16384, 16385, 40000, 100000, 5 })
+    {
+        lines.push_back(std::string(length, static_cast<char>('a' + lines.size())));
+        text += lines.back() + (length % 2 == 0 ? "\r\n" : "\n");
+    }
+
+    stringstreambuf sbuf(text);
+    streams::basic_istream<char> stream(sbuf);
+    for (const auto &line : lines)
+    {
+        container_buffer<std::string> target;
+        VERIFY_ARE_EQUAL(line.size(), stream.read_line(target).get());
+        VERIFY_IS_TRUE(line == target.collection());
+    }
+    container_buffer<std::string> rest;
+    VERIFY_ARE_EQUAL(0u, stream.read_line(rest).get());
+
+    stringstreambuf delimited(text);
+    streams::basic_istream<char> delimitedStream(delimited);
+    for (const auto &line : lines)
+    {
+        container_buffer<std::string> target;
+        delimitedStream.read_to_delim(target, '\n').wait();
+        const std::string expected = line + (line.size() % 2 == 0 ? "\r" : "");
+        VERIFY_IS_TRUE(expected == target.collection());
+    }
+}
+
 TEST(istream_extract_string)
 {
     producer_consumer_buffer<char> rbuf;
@@ -1574,6 +1650,96 @@ TEST(extract_from_empty_stream)
 }
 
 
+TEST(extract_buffered_values)
+{
+    // Values which are in memory already come back without waiting.
+    container_buffer<std::string> sourceBuf(" 12\t-7\n3.5 true word 70000 x", std::ios::in);
+    auto inStream = sourceBuf.create_istream();
+
+    auto i = inStream.extract<int64_t>();
+    VERIFY_IS_TRUE(i.is_done());
+    VERIFY_ARE_EQUAL(12, i.get());
+    auto s = inStream.extract<int>();
+    VERIFY_IS_TRUE(s.is_done());
+    VERIFY_ARE_EQUAL(-7, s.get());
+    VERIFY_ARE_EQUAL(3.5, inStream.extract<double>().get());
+    VERIFY_IS_TRUE(inStream.extract<bool>().get());
+    VERIFY_ARE_EQUAL("word", inStream.extract<std::string>().get());
+    auto c = inStream.extract<uint16_t>();
+    VERIFY_IS_TRUE(c.is_done());
+    VERIFY_THROWS(c.get(), std::range_error);
+    VERIFY_THROWS(inStream.extract<int64_t>().get(), std::range_error);
+}
+
+TEST(extract_n_values)
+{
+    std::string text;
+    for (int i = 0; i < 1000; ++i)
+    {
+        text += std::to_string(i * 7 - 500) + (i % 10 == 9 ? "\n" : " ");
+    }
+    container_buffer<std::string> sourceBuf(text + "one two  three\n", std::ios::in);
+    auto inStream = sourceBuf.create_istream();
+
+    auto values = inStream.extract_n<int>(1000).get();
+    VERIFY_ARE_EQUAL(1000u, values.size());
+    for (int i = 0; i < 1000; ++i)
+    {
+        VERIFY_ARE_EQUAL(i * 7 - 500, values[i]);
+    }
+
+    // Stops at the end of the stream, trailing whitespace and all.
+    auto tokens = inStream.extract_n<std::string>(10).get();
+    VERIFY_ARE_EQUAL(3u, tokens.size());
+    VERIFY_ARE_EQUAL("three", tokens[2]);
+    VERIFY_ARE_EQUAL(0u, inStream.extract_n<int>(10).get().size());
+
+    // Values split between writes, which have to be waited for.
+    producer_consumer_buffer<char> rbuf;
+    auto extracted = rbuf.create_istream().extract_n<double>(4);
+    rbuf.putn_nocopy("1.5 -2", 6).wait();
+    rbuf.putn_nocopy("5 1e3 ", 6).wait();
+    rbuf.putn_nocopy(" 7", 2).wait();
+    rbuf.close(std::ios_base::out).wait();
+    auto doubles = extracted.get();
+    VERIFY_ARE_EQUAL(4u, doubles.size());
+    VERIFY_ARE_EQUAL(1.5, doubles[0]);
+    VERIFY_ARE_EQUAL(-25, doubles[1]);
+    VERIFY_ARE_EQUAL(1000, doubles[2]);
+    VERIFY_ARE_EQUAL(7, doubles[3]);
+
+    container_buffer<std::string> badBuf("1 2 x 4", std::ios::in);
+    VERIFY_THROWS(badBuf.create_istream().extract_n<int>(4).get(), std::range_error);
+}
+
+TEST(extract_numbers_large_input)
+{
+    std::string text;
+    for (int i = 0; i < 20000; ++i)
+    {
+        text += std::to_string(i * 37) + (i % 16 == 15 ? "\n" : " ");
+    }
+
+    {
+        container_buffer<std::string> sourceBuf(text, std::ios::in);
+        auto inStream = sourceBuf.create_istream();
+        for (int i = 0; i < 20000; ++i)
+        {
+            VERIFY_ARE_EQUAL(i * 37, inStream.extract<int>().get());
+        }
+    }
+
+    {
+        container_buffer<std::string> sourceBuf(text, std::ios::in);
+        auto values = sourceBuf.create_istream().extract_n<int>(20000).get();
+        VERIFY_ARE_EQUAL(20000u, values.size());
+        for (int i = 0; i < 20000; ++i)
+        {
+            VERIFY_ARE_EQUAL(i * 37, values[i]);
+        }
+    }
+}
+
 TEST(seek_after_eof)
 {
     container_buffer<std::string> sourceBuf(std::ios::in);
@@ -30,6 +30,8 @@
 #include <Windows.h>
 #endif
 
+#include <thread>
+
 namespace tests { namespace functional { namespace streams {
 
 using namespace ::pplx;
@@ -821,6 +823,35 @@ streams::producer_consumer_buffer<uint8_t> create_producer_consumer_buffer_with_
     return buf;
 }
 
+void producer_consumer_buffer_bounded(streams::producer_consumer_buffer<uint8_t> buf)
+{
+    // Created with a high-water mark of 256 and a low-water mark of 64.
+    std::vector<uint8_t> data(300, 'x');
+    std::vector<uint8_t> target(300);
+
+    VERIFY_ARE_EQUAL(100u, buf.putn_nocopy(data.data(), 100).get());
+    auto write = buf.putn_nocopy(data.data(), 200);
+    VERIFY_ARE_EQUAL(300u, buf.in_avail());
+    VERIFY_IS_FALSE(write.is_done());
+    VERIFY_IS_TRUE(buf.alloc(10) == nullptr);
+
+    VERIFY_ARE_EQUAL(200u, buf.getn(target.data(), 200).get());
+    VERIFY_IS_FALSE(write.is_done());
+    VERIFY_ARE_EQUAL(50u, buf.getn(target.data(), 50).get());
+    VERIFY_ARE_EQUAL(200u, write.get());
+
+    auto ptr = buf.alloc(10);
+    VERIFY_IS_TRUE(ptr != nullptr);
+    buf.commit(10);
+
+    // Closing the read head releases a waiting write.
+    write = buf.putn_nocopy(data.data(), 300);
+    VERIFY_IS_FALSE(write.is_done());
+    buf.close(std::ios_base::in).wait();
+    VERIFY_ARE_EQUAL(300u, write.get());
+    buf.close().wait();
+}
+
 SUITE(memstream_tests)
 {
 
@@ -1356,6 +1387,252 @@ TEST(mem_buffer_close_destroy)
     pplx::when_all(std::begin(taskVector), std::end(taskVector)).wait();
 }
 
+TEST(spsc_buffer_operations)
+{
+    {
+        auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+        streambuf_putn_getn(buf);
+    }
+    {
+        auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+        streambuf_acquire_alloc(buf);
+    }
+    {
+        auto buf = streams::producer_consumer_buffer<char>::single_producer_consumer();
+        streambuf_alloc_commit(buf);
+    }
+    {
+        auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+        streambuf_close(buf);
+    }
+    {
+        auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+        streambuf_close_read_with_pending_read(buf);
+    }
+    {
+        auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+        streambuf_close_write_with_pending_read(buf);
+    }
+
+    uint8_t data[] = {'H', 'e', 'l', 'l', 'o', ' ', 'W', 'o', 'r', 'l', 'd'};
+    std::vector<uint8_t> s(std::begin(data), std::end(data));
+    auto with_data = [&s]()
+    {
+        // Blocks smaller than the data, so that reads cross them.
+        auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer(4);
+        VERIFY_ARE_EQUAL(buf.putn_nocopy(s.data(), s.size()).get(), s.size());
+        buf.close(std::ios_base::out).get();
+        return buf;
+    };
+    {
+        auto buf = with_data();
+        streambuf_getn(buf, s);
+    }
+    {
+        auto buf = with_data();
+        streambuf_bumpc(buf, s);
+    }
+    {
+        auto buf = with_data();
+        streambuf_sbumpc(buf, s);
+    }
+    {
+        auto buf = with_data();
+        streambuf_nextc(buf, s);
+    }
+    {
+        auto buf = with_data();
+        streambuf_acquire_release(buf, s);
+    }
+
+    // Reads queued before the data arrives, completed by sync().
+    auto rwbuf = streams::producer_consumer_buffer<char>::single_producer_consumer(8);
+    char buf1[128], buf2[128];
+    auto read1 = rwbuf.getn(buf1, 128);
+    auto read2 = rwbuf.getn(buf2, 128);
+    const std::string text1 = "This is a test";
+    VERIFY_ARE_EQUAL(text1.size(), rwbuf.putn_nocopy(text1.data(), text1.size()).get());
+    rwbuf.sync().wait();
+    const std::string text2 = "- but this is not";
+    VERIFY_ARE_EQUAL(text2.size(), rwbuf.putn_nocopy(text2.data(), text2.size()).get());
+    rwbuf.sync().wait();
+    VERIFY_ARE_EQUAL(text1.size(), read1.get());
+    VERIFY_ARE_EQUAL(text2.size(), read2.get());
+    VERIFY_ARE_EQUAL(text1, std::string(buf1, text1.size()));
+    VERIFY_ARE_EQUAL(text2, std::string(buf2, text2.size()));
+    rwbuf.close().get();
+}
+
+TEST(mem_buffer_bounded)
+{
+    producer_consumer_buffer_bounded(streams::producer_consumer_buffer<uint8_t>(64, 256, 64));
+    producer_consumer_buffer_bounded(streams::producer_consumer_buffer<uint8_t>::single_producer_consumer(64, 256, 64));
+
+    // Blocks which have been read are written again.
+    streams::producer_consumer_buffer<uint8_t> buf(64);
+    uint8_t data[32];
+    auto first = buf.alloc(32);
+    buf.commit(32);
+    VERIFY_ARE_EQUAL(32u, buf.getn(data, 32).get());
+    auto second = buf.alloc(16);
+    std::fill(second, second + 16, static_cast<uint8_t>(1));
+    buf.commit(16);
+    VERIFY_IS_TRUE(first == second);
+
+    // A partial commit leaves the rest of the recycled block for the next write.
+    std::fill(data, data + 8, static_cast<uint8_t>(2));
+    VERIFY_ARE_EQUAL(8u, buf.putn_nocopy(data, 8).get());
+    VERIFY_ARE_EQUAL(24u, buf.in_avail());
+    VERIFY_ARE_EQUAL(24u, buf.getn(data, 24).get());
+    VERIFY_ARE_EQUAL(16, std::count(data, data + 16, static_cast<uint8_t>(1)));
+    VERIFY_ARE_EQUAL(8, std::count(data + 16, data + 24, static_cast<uint8_t>(2)));
+    buf.close().wait();
+}
+
+TEST(spsc_buffer_threads)
+{
+    // A writer and a reader on their own threads, using pieces of all sizes around the block size.
+    auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer(256);
+    const size_t total = 4 * 1024 * 1024;
+
+    std::thread writer([buf, total]() mutable
+    {
+        std::vector<uint8_t> piece(1000);
+        size_t written = 0;
+        for (size_t i = 0; written < total; ++i)
+        {
+            const size_t count = (std::min)(total - written, (i * 37) % 1000 + 1);
+            if (i % 3 == 0)
+            {
+                auto ptr = buf.alloc(count);
+                for (size_t j = 0; j < count; ++j)
+                {
+                    ptr[j] = static_cast<uint8_t>((written + j) % 251);
+                }
+                buf.commit(count);
+            }
+            else
+            {
+                for (size_t j = 0; j < count; ++j)
+                {
+                    piece[j] = static_cast<uint8_t>((written + j) % 251);
+                }
+                VERIFY_ARE_EQUAL(count, buf.putn_nocopy(piece.data(), count).get());
+            }
+            written += count;
+        }
+        buf.close(std::ios_base::out).wait();
+    });
+
+    std::vector<uint8_t> chunk(700);
+    size_t read = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0;; ++i)
+    {
+        size_t count;
+        if (i % 4 == 0)
+        {
+            // Directly from the blocks.
+            uint8_t *ptr = nullptr;
+            if (!buf.acquire(ptr, count))
+            {
+                continue;
+            }
+            if (count == 0)
+            {
+                // The end of the stream.
+                break;
+            }
+            count = (std::min)(count, chunk.size());
+            std::copy(ptr, ptr + count, chunk.begin());
+            buf.release(ptr, count);
+        }
+        else
+        {
+            count = buf.getn(chunk.data(), (i * 53) % chunk.size() + 1).get();
+            if (count == 0)
+            {
+                break;
+            }
+        }
+        for (size_t j = 0; j < count; ++j)
+        {
+            mismatches += chunk[j] != static_cast<uint8_t>((read + j) % 251);
+        }
+        read += count;
+    }
+    writer.join();
+
+    VERIFY_ARE_EQUAL(total, read);
+    VERIFY_ARE_EQUAL(0u, mismatches);
+    buf.close().wait();
+}
+
+TEST(spsc_buffer_pass_through)
+{
+    // Streams 8 MB from a writer thread to a reader in pieces of varying size, like an HTTP response body.
+    const size_t total = 8 * 1024 * 1024;
+    auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer(16 * 1024);
+    std::thread writer([=]() mutable
+    {
+        std::vector<uint8_t> data(64 * 1024);
+        size_t written = 0;
+        for (size_t i = 0; written < total; ++i)
+        {
+            const size_t count = (std::min)(total - written, 1 + (i * 7919) % data.size());
+            for (size_t j = 0; j < count; ++j)
+            {
+                data[j] = static_cast<uint8_t>((written + j) % 251);
+            }
+            buf.putn_nocopy(data.data(), count).wait();
+            written += count;
+        }
+        buf.close(std::ios_base::out).wait();
+    });
+
+    std::vector<uint8_t> data(64 * 1024);
+    size_t read = 0;
+    bool matches = true;
+    for (size_t count; (count = buf.getn(data.data(), 1 + (read * 31) % data.size()).get()) > 0;)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            matches = matches && data[j] == static_cast<uint8_t>((read + j) % 251);
+        }
+        read += count;
+    }
+    writer.join();
+    VERIFY_ARE_EQUAL(total, read);
+    VERIFY_IS_TRUE(matches);
+}
+
+TEST(spsc_buffer_close_from_other_threads)
+{
+    // The reader gives up part way while the writer is still writing, then the writer closes its side.
+    for (int i = 0; i < 20; ++i)
+    {
+        auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer(512, 4096, 1024);
+        std::thread writer([=]() mutable
+        {
+            std::vector<uint8_t> data(700, 'x');
+            while (buf.can_write() && buf.can_read())
+            {
+                buf.putn_nocopy(data.data(), data.size()).wait();
+            }
+            buf.close(std::ios_base::out).wait();
+        });
+
+        std::vector<uint8_t> data(300);
+        for (int j = 0; j < i; ++j)
+        {
+            VERIFY_ARE_EQUAL(data.size(), buf.getn(data.data(), data.size()).get());
+        }
+        buf.close(std::ios_base::in).wait();
+        writer.join();
+        VERIFY_IS_FALSE(buf.is_open());
+    }
+}
+
 TEST(string_buffer_ctor)
 {
     std::string src("abcdef ghij");
@@ -2587,6 +2864,119 @@ TEST(close_twice)
     }
 }
 
+TEST(buffer_chain_acquire_blocks)
+{
+    auto header = std::make_shared<std::string>("HEAD");
+    auto body = std::make_shared<std::vector<uint8_t>>(3, static_cast<uint8_t>('b'));
+    const char tail[] = "TAIL";
+
+    buffer_chain<char> buf;
+    buf.append(header);
+    buf.append(std::make_shared<std::string>());
+    buf.append(reinterpret_cast<const char *>(body->data()), body->size(), body);
+    buf.append(tail, 4, nullptr);
+    VERIFY_ARE_EQUAL(3u, buf.block_count());
+    VERIFY_ARE_EQUAL(11u, buf.in_avail());
+    VERIFY_IS_FALSE(buf.can_write());
+
+    // Each block is handed out in turn, straight from the memory it was appended from.
+    char *ptr = nullptr;
+    size_t count = 0;
+    VERIFY_IS_TRUE(buf.acquire(ptr, count));
+    VERIFY_IS_TRUE(ptr == header->data());
+    VERIFY_ARE_EQUAL(4u, count);
+    buf.release(ptr, 1);
+
+    VERIFY_IS_TRUE(buf.acquire(ptr, count));
+    VERIFY_IS_TRUE(ptr == header->data() + 1);
+    VERIFY_ARE_EQUAL(3u, count);
+    buf.release(ptr, count);
+
+    VERIFY_IS_TRUE(buf.acquire(ptr, count));
+    VERIFY_IS_TRUE(ptr == reinterpret_cast<const char *>(body->data()));
+    VERIFY_ARE_EQUAL(3u, count);
+    buf.release(ptr, count);
+
+    VERIFY_IS_TRUE(buf.acquire(ptr, count));
+    VERIFY_IS_TRUE(ptr == tail);
+    buf.release(ptr, count);
+
+    VERIFY_IS_TRUE(buf.acquire(ptr, count));
+    VERIFY_IS_TRUE(ptr == nullptr);
+    VERIFY_ARE_EQUAL(0u, count);
+}
+
+TEST(buffer_chain_read_and_seek)
+{
+    buffer_chain<char> buf;
+    buf.append(std::make_shared<std::string>("abc"));
+    buf.append(std::make_shared<std::string>("defgh"));
+    buf.append(std::make_shared<std::string>("ij"));
+
+    // Reads cross block boundaries.
+    char chars[8] = {};
+    VERIFY_ARE_EQUAL(4u, buf.scopy(chars, 4));
+    VERIFY_ARE_EQUAL(std::string("abcd"), std::string(chars, 4));
+    VERIFY_ARE_EQUAL(7u, buf.getn(chars, 7).get());
+    VERIFY_ARE_EQUAL(std::string("abcdefg"), std::string(chars, 7));
+    VERIFY_ARE_EQUAL('h', buf.sbumpc());
+    VERIFY_ARE_EQUAL('i', buf.sgetc());
+    VERIFY_ARE_EQUAL('j', buf.nextc().get());
+
+    VERIFY_ARE_EQUAL(2, (int)buf.seekpos(2, std::ios_base::in));
+    container_buffer<std::string> rest;
+    VERIFY_ARE_EQUAL(8u, buf.create_istream().read_to_end(rest).get());
+    VERIFY_ARE_EQUAL(std::string("cdefghij"), rest.collection());
+
+    VERIFY_ARE_EQUAL(5, (int)buf.seekoff(-5, std::ios_base::end, std::ios_base::in));
+    VERIFY_ARE_EQUAL('f', buf.sbumpc());
+    VERIFY_ARE_EQUAL('f', buf.ungetc().get());
+    VERIFY_ARE_EQUAL(5, (int)buf.getpos(std::ios_base::in));
+
+    // The buffer is read-only and cannot seek past its end.
+    VERIFY_ARE_EQUAL((int)std::char_traits<char>::eof(), (int)buf.seekpos(11, std::ios_base::in));
+    VERIFY_ARE_EQUAL((int)std::char_traits<char>::eof(), (int)buf.seekpos(0, std::ios_base::out));
+    VERIFY_ARE_EQUAL(0u, buf.putn_nocopy("x", 1).get());
+}
+
+TEST(buffer_chain_owners)
+{
+    auto body = std::make_shared<std::string>("body");
+    std::weak_ptr<std::string> watch = body;
+    const uint8_t bytes[] = { 'x', 'y' };
+
+    buffer_chain<uint8_t> buf;
+    buf.append(body);
+    body.reset();
+    VERIFY_IS_FALSE(watch.expired());
+
+    // Another stream buffer holding its data in one block joins the chain, and stays open while it does.
+    rawptr_buffer<uint8_t> raw(bytes, sizeof(bytes));
+    VERIFY_IS_TRUE(buf.append(raw));
+    VERIFY_ARE_EQUAL(6u, buf.in_avail());
+    producer_consumer_buffer<uint8_t> pending;
+    VERIFY_IS_FALSE(buf.append(pending));
+
+    // A container still open for writing could move its data, an empty collection adds nothing.
+    container_buffer<std::vector<uint8_t>> writable;
+    writable.putn_nocopy(bytes, sizeof(bytes)).wait();
+    VERIFY_IS_FALSE(buf.append(writable));
+    buf.append(std::make_shared<std::vector<uint8_t>>());
+    VERIFY_ARE_EQUAL(6u, buf.in_avail());
+
+    std::vector<uint8_t> peeked;
+    auto chain = std::static_pointer_cast<concurrency::streams::details::basic_buffer_chain<uint8_t>>(buf.get_base());
+    VERIFY_ARE_EQUAL(5u, chain->peek_blocks(5, [&peeked](const uint8_t *data, size_t count)
+    {
+        peeked.insert(peeked.end(), data, data + count);
+    }));
+    VERIFY_ARE_EQUAL(std::string("bodyx"), std::string(peeked.begin(), peeked.end()));
+    VERIFY_ARE_EQUAL(6u, buf.in_avail());
+
+    buf.close().wait();
+    VERIFY_IS_TRUE(watch.expired());
+}
+
 }
 
 }}}
@@ -43,6 +43,7 @@ namespace pplx = Concurrency;
 #include "cpprest/producerconsumerstream.h"
 #include "cpprest/rawptrstream.h"
 #include "cpprest/containerstream.h"
+#include "cpprest/bufferchainstream.h"
 #include "cpprest/interopstream.h"
 #include "cpprest/streams.h"
 #include "cpprest/filestream.h"